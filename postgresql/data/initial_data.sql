@@ -40,18 +40,18 @@ VALUES
 
 SELECT setval('products_id_seq', (SELECT MAX(id) FROM products));
 
-INSERT INTO public.user_products (id, status, product_id, user_id)
+INSERT INTO public.user_products (id, status, product_id, user_id, room_id)
 VALUES
-    (1, 'PAID', 1, 1),
-    (2, 'PAID', 2, 2),
-    (3, 'PAID', 3, 3),
-    (4, 'UNPAID', 4, 4),
-    (5, 'UNPAID', 5, 5),
-    (6, 'UNPAID', 6, 6),
-    (7, 'UNPAID', 7, 7),
-    (8, 'UNPAID', 8, 8),
-    (9, 'UNPAID', 9, 9),
-    (10, 'PAID', 10, 10)
+    (1, 'PAID', 1, 1, 1),
+    (2, 'PAID', 2, 2, 1),
+    (3, 'PAID', 3, 3, 1),
+    (4, 'UNPAID', 4, 4, 2),
+    (5, 'UNPAID', 5, 5, 2),
+    (6, 'UNPAID', 6, 6, 3),
+    (7, 'UNPAID', 7, 7, 3),
+    (8, 'UNPAID', 8, 8, 3),
+    (9, 'UNPAID', 9, 9, 2),
+    (10, 'PAID', 10, 10, 2)
     ON CONFLICT DO NOTHING;
 
 SELECT setval('user_products_id_seq', (SELECT MAX(id) FROM user_products));
\ No newline at end of file
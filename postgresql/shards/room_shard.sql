@@ -0,0 +1,295 @@
+-- Schema of an additional room shard (see shard-router). Users and auth
+-- sessions live on the global database only, so references to users(id)
+-- can't be enforced here.
+DROP SCHEMA IF EXISTS public CASCADE;
+CREATE SCHEMA IF NOT EXISTS public;
+
+CREATE TABLE IF NOT EXISTS rooms
+(
+    id       serial4 PRIMARY KEY,
+    name     varchar(255) NOT NULL,
+    user_id  int4 NOT NULL,
+    version  int8 NOT NULL DEFAULT 1,
+    archived boolean NOT NULL DEFAULT false
+    );
+
+-- products and user_products are hash partitioned by room_id: every query
+-- of a room reads one partition, and vacuum and cascading deletes work on
+-- partitions a fraction of the table size. Queries addressing a row by id
+-- find its room in product_rooms or user_product_rooms first.
+CREATE TABLE IF NOT EXISTS products
+(
+    id      serial4,
+    name    varchar(255) NOT NULL,
+    price   bigint,
+    room_id int4 REFERENCES rooms(id) ON DELETE CASCADE NOT NULL,
+    -- Set by deletes, which hide the product at once; product-reaper purges
+    -- it with its user products later
+    deleted_at timestamptz,
+    PRIMARY KEY (room_id, id)
+) PARTITION BY HASH (room_id);
+
+CREATE TYPE user_product_status AS ENUM ('UNPAID', 'PAID');
+
+-- room_id is the room of the product, enforced by the foreign key
+CREATE TABLE IF NOT EXISTS user_products
+(
+    id         serial4,
+    status     user_product_status NOT NULL DEFAULT 'UNPAID',
+    product_id int4 NOT NULL,
+    user_id    int4 NOT NULL,
+    room_id    int4 NOT NULL,
+    PRIMARY KEY (room_id, id),
+    UNIQUE (room_id, user_id, product_id),
+    FOREIGN KEY (room_id, product_id)
+        REFERENCES products (room_id, id) ON DELETE CASCADE
+) PARTITION BY HASH (room_id);
+
+DO $$
+BEGIN
+    FOR i IN 0..15 LOOP
+        EXECUTE format('CREATE TABLE products_p%s PARTITION OF products '
+                       'FOR VALUES WITH (MODULUS 16, REMAINDER %s)', i, i);
+        EXECUTE format('CREATE TABLE user_products_p%s PARTITION OF user_products '
+                       'FOR VALUES WITH (MODULUS 16, REMAINDER %s)', i, i);
+    END LOOP;
+END;
+$$;
+
+CREATE TABLE IF NOT EXISTS product_rooms
+(
+    id      int4 PRIMARY KEY,
+    room_id int4 NOT NULL
+);
+
+CREATE TABLE IF NOT EXISTS user_product_rooms
+(
+    id      int4 PRIMARY KEY,
+    room_id int4 NOT NULL
+);
+
+-- Settled rooms moved out of products and user_products by room-archiver.
+-- details, calculation and summary are the gzipped bodies of
+-- GET /v1/rooms/{id}, /calculate and /summary at the archived version;
+-- room_rows keeps the moved rows until the room is edited again (see
+-- unarchive_room).
+CREATE TABLE IF NOT EXISTS room_archive
+(
+    room_id     int4 PRIMARY KEY REFERENCES rooms(id) ON DELETE CASCADE,
+    archived_at timestamptz NOT NULL DEFAULT now(),
+    details     bytea NOT NULL,
+    calculation bytea NOT NULL,
+    summary     bytea NOT NULL,
+    room_rows   jsonb NOT NULL
+);
+
+-- Already compressed, TOAST would only spend CPU trying again
+ALTER TABLE room_archive
+    ALTER COLUMN details SET STORAGE EXTERNAL,
+    ALTER COLUMN calculation SET STORAGE EXTERNAL,
+    ALTER COLUMN summary SET STORAGE EXTERNAL;
+
+CREATE TABLE IF NOT EXISTS user_rooms
+(
+    user_id   int4 NOT NULL,
+    room_id   int4 REFERENCES rooms(id) ON DELETE CASCADE NOT NULL,
+    PRIMARY KEY (user_id, room_id)
+    );
+
+CREATE INDEX IF NOT EXISTS idx_user_rooms_room_id ON user_rooms (room_id);
+
+CREATE INDEX IF NOT EXISTS idx_user_products_room ON user_products (room_id, product_id) INCLUDE (user_id, status);
+
+CREATE INDEX IF NOT EXISTS idx_products_room ON products (room_id) INCLUDE (name, price);
+
+CREATE UNIQUE INDEX IF NOT EXISTS products_live_name_room_id_key ON products (name, room_id) WHERE deleted_at IS NULL;
+
+CREATE INDEX IF NOT EXISTS idx_products_deleted ON products (deleted_at, room_id, id) WHERE deleted_at IS NOT NULL;
+
+CREATE INDEX IF NOT EXISTS idx_user_products_user ON user_products (user_id);
+
+CREATE INDEX IF NOT EXISTS idx_rooms_user_id ON rooms (user_id);
+
+CREATE INDEX IF NOT EXISTS idx_products_name ON products (name);
+
+-- True in room-archiver transactions, which move the rows of a room into
+-- room_archive without changing the room
+CREATE OR REPLACE FUNCTION is_archiving()
+RETURNS boolean AS $$
+    SELECT COALESCE(current_setting('split_bill.archiving', true) = 'on', false);
+$$ LANGUAGE sql STABLE;
+
+-- Moves the rows of an archived room back into products and user_products.
+-- A no-op for rooms that are not archived.
+CREATE OR REPLACE FUNCTION unarchive_room(target_room_id int4)
+RETURNS void AS $$
+DECLARE
+    restored jsonb;
+BEGIN
+    DELETE FROM room_archive WHERE room_id = target_room_id
+    RETURNING room_rows INTO restored;
+    IF restored IS NULL THEN
+        RETURN;
+    END IF;
+
+    UPDATE rooms SET archived = false, version = version + 1
+    WHERE id = target_room_id;
+    INSERT INTO products (id, name, price, room_id)
+    SELECT id, name, price, target_room_id
+    FROM jsonb_to_recordset(restored->'products')
+        AS p(id int4, name varchar(255), price bigint);
+    INSERT INTO user_products (id, status, product_id, user_id, room_id)
+    SELECT id, status, product_id, user_id, target_room_id
+    FROM jsonb_to_recordset(restored->'user_products')
+        AS up(id int4, status user_product_status, product_id int4,
+              user_id int4);
+END;
+$$ LANGUAGE plpgsql;
+
+-- rooms.version changes on every write to the room, its members, products or
+-- user products. Read paths use it to reuse room snapshots. A write reaching
+-- an archived room (a new member, say) unarchives it.
+CREATE OR REPLACE FUNCTION bump_room_version_by_room_id()
+RETURNS trigger AS $$
+DECLARE
+    changed record;
+BEGIN
+    IF is_archiving() THEN
+        RETURN NULL;
+    END IF;
+    FOR changed IN
+        UPDATE rooms SET version = version + 1
+        WHERE id IN (SELECT room_id FROM changed_rows)
+        RETURNING id, archived
+    LOOP
+        IF changed.archived THEN
+            PERFORM unarchive_room(changed.id);
+        END IF;
+    END LOOP;
+    RETURN NULL;
+END;
+$$ LANGUAGE plpgsql;
+
+-- Keeps a lookup table from ids of a partitioned table to their rooms
+-- (TG_ARGV[0]) in sync with inserts and deletes. Archived rooms keep their
+-- lookup rows, so writes addressing their rows by id find and unarchive them.
+CREATE OR REPLACE FUNCTION sync_room_lookup()
+RETURNS trigger AS $$
+BEGIN
+    IF TG_OP = 'INSERT' THEN
+        EXECUTE format('INSERT INTO %I SELECT id, room_id FROM changed_rows '
+                       'ON CONFLICT (id) DO NOTHING', TG_ARGV[0]);
+    ELSIF NOT is_archiving() THEN
+        EXECUTE format('DELETE FROM %I l USING changed_rows c WHERE l.id = c.id',
+                       TG_ARGV[0]);
+    END IF;
+    RETURN NULL;
+END;
+$$ LANGUAGE plpgsql;
+
+CREATE OR REPLACE FUNCTION bump_room_version_on_rename()
+RETURNS trigger AS $$
+BEGIN
+    NEW.version := OLD.version + 1;
+    RETURN NEW;
+END;
+$$ LANGUAGE plpgsql;
+
+-- The archived documents carry the room name
+CREATE OR REPLACE FUNCTION unarchive_renamed_room()
+RETURNS trigger AS $$
+BEGIN
+    PERFORM unarchive_room(NEW.id);
+    RETURN NULL;
+END;
+$$ LANGUAGE plpgsql;
+
+CREATE TRIGGER products_lookup_on_insert
+    AFTER INSERT ON products REFERENCING NEW TABLE AS changed_rows
+    FOR EACH STATEMENT EXECUTE FUNCTION sync_room_lookup('product_rooms');
+CREATE TRIGGER products_lookup_on_delete
+    AFTER DELETE ON products REFERENCING OLD TABLE AS changed_rows
+    FOR EACH STATEMENT EXECUTE FUNCTION sync_room_lookup('product_rooms');
+CREATE TRIGGER user_products_lookup_on_insert
+    AFTER INSERT ON user_products REFERENCING NEW TABLE AS changed_rows
+    FOR EACH STATEMENT EXECUTE FUNCTION sync_room_lookup('user_product_rooms');
+CREATE TRIGGER user_products_lookup_on_delete
+    AFTER DELETE ON user_products REFERENCING OLD TABLE AS changed_rows
+    FOR EACH STATEMENT EXECUTE FUNCTION sync_room_lookup('user_product_rooms');
+
+CREATE TRIGGER rooms_version_on_rename
+    BEFORE UPDATE OF name ON rooms
+    FOR EACH ROW WHEN (OLD.name IS DISTINCT FROM NEW.name)
+    EXECUTE FUNCTION bump_room_version_on_rename();
+CREATE TRIGGER rooms_unarchive_on_rename
+    AFTER UPDATE OF name ON rooms
+    FOR EACH ROW WHEN (NEW.archived AND OLD.name IS DISTINCT FROM NEW.name)
+    EXECUTE FUNCTION unarchive_renamed_room();
+
+CREATE TRIGGER products_version_on_insert
+    AFTER INSERT ON products REFERENCING NEW TABLE AS changed_rows
+    FOR EACH STATEMENT EXECUTE FUNCTION bump_room_version_by_room_id();
+CREATE TRIGGER products_version_on_update
+    AFTER UPDATE ON products REFERENCING NEW TABLE AS changed_rows
+    FOR EACH STATEMENT EXECUTE FUNCTION bump_room_version_by_room_id();
+CREATE TRIGGER products_version_on_delete
+    AFTER DELETE ON products REFERENCING OLD TABLE AS changed_rows
+    FOR EACH STATEMENT EXECUTE FUNCTION bump_room_version_by_room_id();
+
+CREATE TRIGGER user_products_version_on_insert
+    AFTER INSERT ON user_products REFERENCING NEW TABLE AS changed_rows
+    FOR EACH STATEMENT EXECUTE FUNCTION bump_room_version_by_room_id();
+CREATE TRIGGER user_products_version_on_update
+    AFTER UPDATE ON user_products REFERENCING NEW TABLE AS changed_rows
+    FOR EACH STATEMENT EXECUTE FUNCTION bump_room_version_by_room_id();
+CREATE TRIGGER user_products_version_on_delete
+    AFTER DELETE ON user_products REFERENCING OLD TABLE AS changed_rows
+    FOR EACH STATEMENT EXECUTE FUNCTION bump_room_version_by_room_id();
+
+CREATE TRIGGER user_rooms_version_on_insert
+    AFTER INSERT ON user_rooms REFERENCING NEW TABLE AS changed_rows
+    FOR EACH STATEMENT EXECUTE FUNCTION bump_room_version_by_room_id();
+CREATE TRIGGER user_rooms_version_on_delete
+    AFTER DELETE ON user_rooms REFERENCING OLD TABLE AS changed_rows
+    FOR EACH STATEMENT EXECUTE FUNCTION bump_room_version_by_room_id();
+
+-- Aligns id sequences of a room shard with the shard layout used by
+-- shard-router: every id produced on shard `shard_index` satisfies
+-- (id - 1) % shard_count = shard_index. Idempotent; existing ids are kept.
+CREATE OR REPLACE FUNCTION configure_room_shard(shard_index int, shard_count int)
+RETURNS void AS $$
+DECLARE
+    seq     record;
+    next_id bigint;
+BEGIN
+    FOR seq IN
+        SELECT s.sequencename, s.increment_by, t.table_name
+        FROM pg_sequences s
+        JOIN (VALUES ('rooms_id_seq', 'rooms'),
+                     ('products_id_seq', 'products'),
+                     ('user_products_id_seq', 'user_products'))
+            AS t(sequence_name, table_name)
+            ON s.sequencename = t.sequence_name
+        WHERE s.schemaname = 'public'
+    LOOP
+        CONTINUE WHEN seq.increment_by = shard_count;
+
+        EXECUTE format('SELECT COALESCE(MAX(id), 0) FROM %I', seq.table_name)
+            INTO next_id;
+        next_id := next_id + 1
+            + ((shard_index - next_id) % shard_count + shard_count) % shard_count;
+        EXECUTE format('ALTER SEQUENCE %I INCREMENT BY %s RESTART WITH %s',
+                       seq.sequencename, shard_count, next_id);
+    END LOOP;
+END;
+$$ LANGUAGE plpgsql;
+
+-- Versions applied by schema-migrator. A fresh schema is already at the
+-- latest version.
+CREATE TABLE IF NOT EXISTS schema_migrations
+(
+    version    int4 PRIMARY KEY,
+    applied_at timestamptz NOT NULL DEFAULT now()
+);
+
+INSERT INTO schema_migrations (version) VALUES (1), (2), (3), (4), (5), (6);
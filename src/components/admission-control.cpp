@@ -0,0 +1,279 @@
+#include "admission-control.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include <userver/logging/log.hpp>
+#include <userver/storages/postgres/exceptions.hpp>
+#include <userver/yaml_config/merge_schemas.hpp>
+
+#include "../handlers/lib/args.hpp"
+#include "../handlers/lib/auth.hpp"
+#include "../handlers/lib/fan-out.hpp"
+#include "shard-router.hpp"
+
+namespace split_bill {
+
+namespace {
+
+constexpr std::string_view kClassNames[] = {"interactive", "write", "heavy"};
+
+// Retry-After of requests shed by the concurrency limit or a class quota
+constexpr std::chrono::seconds kOverloadRetryAfter{1};
+
+}  // namespace
+
+AdmissionControl::Admission::Admission(std::atomic<int64_t>& in_flight)
+    : in_flight_(&in_flight) {}
+
+AdmissionControl::Admission::Admission(std::chrono::seconds retry_after)
+    : retry_after_(retry_after) {}
+
+AdmissionControl::Admission::Admission(Admission&& other) noexcept
+    : in_flight_(std::exchange(other.in_flight_, nullptr)),
+      quota_(std::exchange(other.quota_, nullptr)),
+      retry_after_(other.retry_after_) {}
+
+AdmissionControl::Admission::~Admission() {
+  if (quota_) {
+    quota_->unlock_shared();
+  }
+  if (in_flight_) {
+    in_flight_->fetch_sub(1);
+  }
+}
+
+AdmissionControl::AdmissionControl(
+    const userver::components::ComponentConfig& config,
+    const userver::components::ComponentContext& component_context)
+    : LoggableComponentBase(config, component_context),
+      probe_cluster_(
+          component_context.FindComponent<ShardRouter>().Global()),
+      buckets_(config["max-clients"].As<size_t>(100000)),
+      sessions_(config["max-clients"].As<size_t>(100000)),
+      min_concurrency_(config["concurrency"]["min"].As<int64_t>(16)),
+      max_concurrency_(config["concurrency"]["max"].As<int64_t>(512)),
+      probe_timeout_(config["concurrency"]["probe-timeout"]
+                         .As<std::chrono::milliseconds>(1000)),
+      wait_threshold_(config["concurrency"]["wait-threshold"]
+                          .As<std::chrono::milliseconds>(20)),
+      concurrency_limit_(max_concurrency_),
+      quota_wait_(config["quota-wait"].As<std::chrono::milliseconds>(100)) {
+  for (size_t i = 0; i < kClassCount; ++i) {
+    const std::string class_name{kClassNames[i]};
+    const auto settings = config["classes"][class_name];
+    bucket_settings_[i] = {settings["rate"].As<double>(),
+                           settings["burst"].As<double>()};
+    quotas_[i] = std::make_shared<userver::engine::Semaphore>(
+        config["quotas"][class_name].As<size_t>());
+  }
+
+  probe_task_.Start(
+      "admission-db-probe",
+      userver::utils::PeriodicTask::Settings{
+          config["concurrency"]["probe-period"].As<std::chrono::milliseconds>(
+              250)},
+      [this] { ProbeDatabase(); });
+}
+
+AdmissionControl::~AdmissionControl() { probe_task_.Stop(); }
+
+AdmissionControl::Admission AdmissionControl::Admit(
+    const userver::server::http::HttpRequest& request,
+    EEndpointClass endpoint_class) const {
+  if (in_flight_.fetch_add(1) >= concurrency_limit_.load()) {
+    in_flight_.fetch_sub(1);
+    return Admission{kOverloadRetryAfter};
+  }
+  Admission admission{in_flight_};
+
+  const auto retry_after = TakeToken(ClientKey(request), endpoint_class);
+  if (retry_after.count() > 0) {
+    return Admission{retry_after};
+  }
+
+  auto& quota = *quotas_[static_cast<size_t>(endpoint_class)];
+  if (!quota.try_lock_shared_for(quota_wait_)) {
+    return Admission{kOverloadRetryAfter};
+  }
+  admission.quota_ = &quota;
+  UseFanOutSlots(quotas_[static_cast<size_t>(endpoint_class)]);
+  return admission;
+}
+
+void AdmissionControl::RememberSession(const TSession& session) const {
+  std::lock_guard lock(mutex_);
+  sessions_.Put(session.id, session.user_id);
+}
+
+std::string AdmissionControl::ClientKey(
+    const userver::server::http::HttpRequest& request) const {
+  if (request.HasHeader(USER_TICKET_HEADER_NAME)) {
+    if (const auto session_id =
+            ParseInteger<int>(request.GetHeader(USER_TICKET_HEADER_NAME))) {
+      std::lock_guard lock(mutex_);
+      if (const auto* user_id = sessions_.Get(*session_id)) {
+        return "user:" + std::to_string(*user_id);
+      }
+    }
+  }
+  return "address:" + request.GetRemoteAddress().PrimaryAddressString();
+}
+
+std::chrono::seconds AdmissionControl::TakeToken(
+    const std::string& client, EEndpointClass endpoint_class) const {
+  const auto class_index = static_cast<size_t>(endpoint_class);
+  const auto& settings = bucket_settings_[class_index];
+  const auto now = std::chrono::steady_clock::now();
+  auto key = std::string{kClassNames[class_index]} + '/' + client;
+
+  std::lock_guard lock(mutex_);
+  auto* bucket = buckets_.Get(key);
+  if (!bucket) {
+    buckets_.Put(key, TBucket{settings.burst, now});
+    bucket = buckets_.Get(key);
+  }
+
+  const std::chrono::duration<double> elapsed = now - bucket->updated;
+  bucket->tokens = std::min(settings.burst,
+                            bucket->tokens + elapsed.count() * settings.rate);
+  bucket->updated = now;
+
+  if (bucket->tokens >= 1) {
+    bucket->tokens -= 1;
+    return std::chrono::seconds{0};
+  }
+  return std::chrono::seconds{static_cast<int64_t>(
+      std::ceil((1 - bucket->tokens) / settings.rate))};
+}
+
+void AdmissionControl::ProbeDatabase() {
+  const auto start = std::chrono::steady_clock::now();
+  bool overloaded = false;
+  try {
+    probe_cluster_->Execute(
+        userver::storages::postgres::ClusterHostType::kSlave,
+        userver::storages::postgres::CommandControl{probe_timeout_,
+                                                    probe_timeout_},
+        "SELECT 1");
+    overloaded = std::chrono::steady_clock::now() - start > wait_threshold_;
+  } catch (const userver::storages::postgres::Error& e) {
+    LOG_WARNING() << "Admission probe failed: " << e.what();
+    overloaded = true;
+  }
+
+  const auto limit = concurrency_limit_.load();
+  if (overloaded) {
+    const auto decreased = std::max(min_concurrency_, limit * 3 / 4);
+    if (decreased != limit) {
+      LOG_WARNING() << "Postgres is slow to respond, concurrency limit "
+                    << limit << " -> " << decreased;
+    }
+    concurrency_limit_ = decreased;
+  } else {
+    concurrency_limit_ = std::min(max_concurrency_, limit + 1);
+  }
+}
+
+userver::yaml_config::Schema AdmissionControl::GetStaticConfigSchema() {
+  return userver::yaml_config::MergeSchemas<
+      userver::components::LoggableComponentBase>(R"(
+type: object
+description: per-client token buckets and an adaptive concurrency limit
+additionalProperties: false
+properties:
+    max-clients:
+        type: integer
+        description: max number of token buckets and sessions kept in memory
+        defaultDescription: 100000
+    classes:
+        type: object
+        description: token bucket settings per endpoint class
+        additionalProperties: false
+        properties:
+            interactive:
+                type: object
+                description: single room or product reads
+                additionalProperties: false
+                properties:
+                    rate:
+                        type: number
+                        description: tokens added per second
+                    burst:
+                        type: number
+                        description: bucket capacity
+            write:
+                type: object
+                description: writes, register and login
+                additionalProperties: false
+                properties:
+                    rate:
+                        type: number
+                        description: tokens added per second
+                    burst:
+                        type: number
+                        description: bucket capacity
+            heavy:
+                type: object
+                description: lists fanned out to every shard
+                additionalProperties: false
+                properties:
+                    rate:
+                        type: number
+                        description: tokens added per second
+                    burst:
+                        type: number
+                        description: bucket capacity
+    quotas:
+        type: object
+        description: |
+            Postgres connections per endpoint class, on each pool: requests
+            and the subtasks of their fan-outs. Keep the sum within the
+            max_pool_size of every cluster.
+        additionalProperties: false
+        properties:
+            interactive:
+                type: integer
+                description: connections of interactive requests
+            write:
+                type: integer
+                description: connections of write requests
+            heavy:
+                type: integer
+                description: connections of heavy requests
+    quota-wait:
+        type: string
+        description: how long a request may wait for a connection of its class
+        defaultDescription: 100ms
+    concurrency:
+        type: object
+        description: adaptive limit on requests in flight
+        additionalProperties: false
+        properties:
+            min:
+                type: integer
+                description: the limit never goes below this
+                defaultDescription: 16
+            max:
+                type: integer
+                description: the limit never goes above this
+                defaultDescription: 512
+            probe-period:
+                type: string
+                description: how often the global cluster is probed
+                defaultDescription: 250ms
+            probe-timeout:
+                type: string
+                description: probe query timeout, counted as overload
+                defaultDescription: 1s
+            wait-threshold:
+                type: string
+                description: probe latency above which Postgres is overloaded
+                defaultDescription: 20ms
+)");
+}
+
+}  // namespace split_bill
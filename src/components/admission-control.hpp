@@ -0,0 +1,143 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include <userver/cache/lru_map.hpp>
+#include <userver/components/component_config.hpp>
+#include <userver/components/component_context.hpp>
+#include <userver/components/loggable_component_base.hpp>
+#include <userver/components/static_config_validator.hpp>
+#include <userver/engine/mutex.hpp>
+#include <userver/engine/semaphore.hpp>
+#include <userver/server/http/http_request.hpp>
+#include <userver/storages/postgres/cluster.hpp>
+#include <userver/utils/periodic_task.hpp>
+#include <userver/yaml_config/schema.hpp>
+
+#include "../models/session.hpp"
+
+namespace split_bill {
+
+// Token bucket settings are configured per class
+enum class EEndpointClass {
+  kInteractive,  // single room or product reads
+  kWrite,        // anything that modifies data, register and login
+  kHeavy,        // lists fanned out to every shard
+};
+
+// Sheds requests before they touch Postgres.
+//
+// Every client gets a token bucket per endpoint class. Clients are told apart
+// by user id: sessions seen at login or by a session lookup are remembered,
+// so every ticket of a user shares the user's buckets without a query
+// ahead of this check. Requests with a missing, malformed or not yet seen
+// ticket are keyed by remote address, so made-up tickets neither bypass
+// the limit nor take bucket slots of their own.
+//
+// On top of that, a global limit on requests in flight follows the time a
+// trivial query on the global cluster takes, which is dominated by the
+// connection pool wait when Postgres is saturated: the limit is cut by a
+// quarter while the probe is slow and grows by one while it is fast.
+//
+// Finally every class has its own budget of Postgres connections, its share
+// of the pool of each cluster. An admitted request holds a unit while it
+// runs, and each subtask of its fan-outs another one; a subtask finding no
+// free unit runs in the request task instead. So a class never has more
+// statements in flight than its budget, on any pool, and a spike of heavy
+// requests can't take the connections interactive ones need. A request
+// waits up to `quota-wait` for its first unit.
+class AdmissionControl final
+    : public userver::components::LoggableComponentBase {
+ public:
+  static constexpr std::string_view kName = "admission-control";
+
+  // Result of Admit. While an admitted request holds it, it counts against
+  // the concurrency limit and its class quota.
+  class Admission final {
+   public:
+    Admission(Admission&& other) noexcept;
+    Admission& operator=(Admission&&) = delete;
+    ~Admission();
+
+    explicit operator bool() const { return in_flight_ != nullptr; }
+    // When a rejected client should retry
+    std::chrono::seconds RetryAfter() const { return retry_after_; }
+
+   private:
+    friend class AdmissionControl;
+
+    explicit Admission(std::atomic<int64_t>& in_flight);
+    explicit Admission(std::chrono::seconds retry_after);
+
+    std::atomic<int64_t>* in_flight_{nullptr};
+    userver::engine::Semaphore* quota_{nullptr};
+    std::chrono::seconds retry_after_{0};
+  };
+
+  AdmissionControl(
+      const userver::components::ComponentConfig& config,
+      const userver::components::ComponentContext& component_context);
+  ~AdmissionControl() override;
+
+  Admission Admit(const userver::server::http::HttpRequest& request,
+                  EEndpointClass endpoint_class) const;
+  // Lets requests with the ticket of `session` use the buckets of its user
+  void RememberSession(const TSession& session) const;
+
+  static userver::yaml_config::Schema GetStaticConfigSchema();
+
+ private:
+  struct TBucketSettings {
+    double rate;  // tokens per second
+    double burst;
+  };
+
+  struct TBucket {
+    double tokens;
+    std::chrono::steady_clock::time_point updated;
+  };
+
+  static constexpr size_t kClassCount = 3;
+
+  // Bucket key of the client sending `request`
+  std::string ClientKey(
+      const userver::server::http::HttpRequest& request) const;
+  // Takes a token, returns zero on success or the time until the next one
+  std::chrono::seconds TakeToken(const std::string& client,
+                                 EEndpointClass endpoint_class) const;
+  void ProbeDatabase();
+
+  userver::storages::postgres::ClusterPtr probe_cluster_;
+  std::array<TBucketSettings, kClassCount> bucket_settings_;
+
+  mutable userver::engine::Mutex mutex_;
+  // Keyed by endpoint class and client
+  mutable userver::cache::LruMap<std::string, TBucket> buckets_;
+  // User ids by session id
+  mutable userver::cache::LruMap<int, int> sessions_;
+
+  const int64_t min_concurrency_;
+  const int64_t max_concurrency_;
+  const std::chrono::milliseconds probe_timeout_;
+  const std::chrono::milliseconds wait_threshold_;
+  mutable std::atomic<int64_t> in_flight_{0};
+  std::atomic<int64_t> concurrency_limit_;
+
+  // Connection budgets, shared with the fan-outs of admitted requests
+  std::array<std::shared_ptr<userver::engine::Semaphore>, kClassCount>
+      quotas_;
+  const std::chrono::milliseconds quota_wait_;
+
+  userver::utils::PeriodicTask probe_task_;
+};
+
+}  // namespace split_bill
+
+template <>
+inline constexpr bool
+    userver::components::kHasValidate<split_bill::AdmissionControl> = true;
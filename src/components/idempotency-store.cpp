@@ -0,0 +1,236 @@
+#include "idempotency-store.hpp"
+
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include <userver/logging/log.hpp>
+#include <userver/testsuite/testsuite_support.hpp>
+#include <userver/yaml_config/merge_schemas.hpp>
+
+#include "query-stats.hpp"
+#include "schema-migrator.hpp"
+#include "shard-router.hpp"
+
+namespace split_bill {
+
+namespace {
+
+namespace pg = userver::storages::postgres;
+
+std::string CacheKey(int user_id, const std::string& key) {
+  return std::to_string(user_id) + ':' + key;
+}
+
+double ToSeconds(std::chrono::seconds duration) {
+  return static_cast<double>(duration.count());
+}
+
+// `expires_in` seconds of a row from now on
+std::chrono::system_clock::time_point ExpiresAt(double expires_in) {
+  return std::chrono::system_clock::now() +
+         std::chrono::duration_cast<std::chrono::system_clock::duration>(
+             std::chrono::duration<double>(expires_in));
+}
+
+}  // namespace
+
+IdempotencyStore::IdempotencyStore(
+    const userver::components::ComponentConfig& config,
+    const userver::components::ComponentContext& component_context)
+    : LoggableComponentBase(config, component_context),
+      cluster_(component_context.FindComponent<ShardRouter>().Global()),
+      ttl_(config["ttl"].As<std::chrono::seconds>(std::chrono::hours{24})),
+      claim_timeout_(config["claim-timeout"].As<std::chrono::seconds>(60)),
+      cleanup_batch_size_(config["cleanup-batch-size"].As<size_t>(1000)),
+      responses_(config["size"].As<size_t>(10000)) {
+  // idempotency_keys exists only once the schema is migrated
+  component_context.FindComponent<SchemaMigrator>();
+
+  cleanup_task_.Start(
+      "idempotency-keys-cleanup",
+      userver::utils::PeriodicTask::Settings{
+          config["cleanup-period"].As<std::chrono::milliseconds>(
+              std::chrono::minutes{10})},
+      [this] { DeleteExpired(); });
+  cleanup_task_.RegisterInTestsuite(
+      component_context
+          .FindComponent<userver::components::TestsuiteSupport>()
+          .GetPeriodicTaskControl());
+}
+
+IdempotencyStore::~IdempotencyStore() { cleanup_task_.Stop(); }
+
+TIdempotencyClaim IdempotencyStore::Claim(
+    int user_id, const std::string& key,
+    const std::string& request_hash) const {
+  const auto cache_key = CacheKey(user_id, key);
+  {
+    std::lock_guard lock(mutex_);
+    const auto* cached = responses_.Get(cache_key);
+    if (cached && (*cached)->expires_at > std::chrono::system_clock::now()) {
+      return {(*cached)->request_hash == request_hash
+                  ? EIdempotencyState::kReplay
+                  : EIdempotencyState::kMismatch,
+              *cached};
+    }
+  }
+
+  // Takes over expired keys and abandoned claims
+  const auto claimed = CountedExecute(
+      cluster_, pg::ClusterHostType::kMaster,
+      "INSERT INTO idempotency_keys AS k (user_id, key, request_hash) "
+      "VALUES ($1, $2, $3) "
+      "ON CONFLICT (user_id, key) DO UPDATE "
+      "SET request_hash = EXCLUDED.request_hash, status = NULL, "
+      "    response = NULL, created_at = now() "
+      "WHERE k.created_at < now() - make_interval(secs => $4) "
+      "   OR (k.status IS NULL "
+      "       AND k.created_at < now() - make_interval(secs => $5)) "
+      "RETURNING 1",
+      user_id, key, request_hash, ToSeconds(ttl_), ToSeconds(claim_timeout_));
+  if (!claimed.IsEmpty()) {
+    return {EIdempotencyState::kClaimed, nullptr};
+  }
+
+  const auto stored = CountedExecute(
+      cluster_, pg::ClusterHostType::kMaster,
+      "SELECT request_hash, status, response, "
+      "       EXTRACT(EPOCH FROM created_at + make_interval(secs => $3) "
+      "                          - now())::float8 AS expires_in "
+      "FROM idempotency_keys WHERE user_id = $1 AND key = $2",
+      user_id, key, ToSeconds(ttl_));
+  if (stored.IsEmpty()) {
+    // Deleted by the cleanup in between, the retry may claim it
+    return {EIdempotencyState::kInProgress, nullptr};
+  }
+  const auto row = stored.Front();
+  const auto status = row["status"].As<std::optional<int16_t>>();
+  if (!status) {
+    return {row["request_hash"].As<std::string>() == request_hash
+                ? EIdempotencyState::kInProgress
+                : EIdempotencyState::kMismatch,
+            nullptr};
+  }
+
+  auto response = std::make_shared<const TStoredResponse>(TStoredResponse{
+      row["request_hash"].As<std::string>(), *status,
+      row["response"].As<std::string>(),
+      ExpiresAt(row["expires_in"].As<double>())});
+  {
+    std::lock_guard lock(mutex_);
+    responses_.Put(cache_key, response);
+  }
+  return {response->request_hash == request_hash
+              ? EIdempotencyState::kReplay
+              : EIdempotencyState::kMismatch,
+          std::move(response)};
+}
+
+void IdempotencyStore::Complete(int user_id, const std::string& key,
+                                const std::string& request_hash, int status,
+                                const std::string& body) const {
+  const auto completed = CountedExecute(
+      cluster_, pg::ClusterHostType::kMaster,
+      "UPDATE idempotency_keys SET status = $3, response = $4 "
+      "WHERE user_id = $1 AND key = $2 AND request_hash = $6 "
+      "AND status IS NULL "
+      "RETURNING EXTRACT(EPOCH FROM created_at + make_interval(secs => $5) "
+      "                            - now())::float8 AS expires_in",
+      user_id, key, static_cast<int16_t>(status), body, ToSeconds(ttl_),
+      request_hash);
+  if (completed.IsEmpty()) {
+    // Deleted by the cleanup, or taken over after `claim-timeout` by a
+    // request that now owns the row
+    return;
+  }
+
+  // Expires with the row, `ttl` after the claim rather than after now
+  auto response = std::make_shared<const TStoredResponse>(TStoredResponse{
+      request_hash, status, body,
+      ExpiresAt(completed.Front()["expires_in"].As<double>())});
+  std::lock_guard lock(mutex_);
+  responses_.Put(CacheKey(user_id, key), std::move(response));
+}
+
+TCacheMemory IdempotencyStore::GetMemoryUsage() const {
+  std::vector<std::shared_ptr<const TStoredResponse>> responses;
+  {
+    std::lock_guard lock(mutex_);
+    responses.reserve(responses_.GetSize());
+    responses_.VisitAll(
+        [&responses](const std::string&,
+                     const std::shared_ptr<const TStoredResponse>& response) {
+          responses.push_back(response);
+        });
+  }
+
+  TCacheMemory memory;
+  memory.entries = responses.size();
+  for (const auto& response : responses) {
+    memory.bytes += sizeof(*response) + HeapBytes(response->request_hash) +
+                    HeapBytes(response->body);
+  }
+  return memory;
+}
+
+void IdempotencyStore::Release(int user_id, const std::string& key,
+                               const std::string& request_hash) const {
+  CountedExecute(
+      cluster_, pg::ClusterHostType::kMaster,
+      "DELETE FROM idempotency_keys "
+      "WHERE user_id = $1 AND key = $2 AND request_hash = $3 "
+      "AND status IS NULL",
+      user_id, key, request_hash);
+}
+
+void IdempotencyStore::DeleteExpired() const {
+  // Small batches keep every statement short on a large backlog
+  size_t deleted = 0;
+  while (true) {
+    const auto result = CountedExecute(
+        cluster_, pg::ClusterHostType::kMaster,
+        "DELETE FROM idempotency_keys WHERE (user_id, key) IN ("
+        "  SELECT user_id, key FROM idempotency_keys "
+        "  WHERE created_at < now() - make_interval(secs => $1) "
+        "  LIMIT $2)",
+        ToSeconds(ttl_), static_cast<int64_t>(cleanup_batch_size_));
+    deleted += result.RowsAffected();
+    if (result.RowsAffected() < cleanup_batch_size_) {
+      break;
+    }
+  }
+  LOG_INFO() << "Deleted " << deleted << " expired idempotency keys";
+}
+
+userver::yaml_config::Schema IdempotencyStore::GetStaticConfigSchema() {
+  return userver::yaml_config::MergeSchemas<
+      userver::components::LoggableComponentBase>(R"(
+type: object
+description: stored responses of requests with an Idempotency-Key
+additionalProperties: false
+properties:
+    ttl:
+        type: string
+        description: how long a key is kept after its first request
+        defaultDescription: 24h
+    claim-timeout:
+        type: string
+        description: after which an uncompleted request no longer holds its key
+        defaultDescription: 60s
+    size:
+        type: integer
+        description: completed responses kept in memory per instance
+        defaultDescription: 10000
+    cleanup-period:
+        type: string
+        description: pause between deletions of expired keys
+        defaultDescription: 10m
+    cleanup-batch-size:
+        type: integer
+        description: keys deleted by one statement
+        defaultDescription: 1000
+)");
+}
+
+}  // namespace split_bill
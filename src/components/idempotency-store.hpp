@@ -0,0 +1,95 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include <userver/cache/lru_map.hpp>
+#include <userver/components/component_config.hpp>
+#include <userver/components/component_context.hpp>
+#include <userver/components/loggable_component_base.hpp>
+#include <userver/components/static_config_validator.hpp>
+#include <userver/engine/mutex.hpp>
+#include <userver/storages/postgres/cluster.hpp>
+#include <userver/utils/periodic_task.hpp>
+#include <userver/yaml_config/schema.hpp>
+
+#include "../models/memory-usage.hpp"
+
+namespace split_bill {
+
+// Response stored for an Idempotency-Key
+struct TStoredResponse {
+  std::string request_hash;
+  int status;
+  std::string body;
+  std::chrono::system_clock::time_point expires_at;
+};
+
+enum class EIdempotencyState {
+  kClaimed,     // first request with the key, to run and Complete or Release
+  kReplay,      // `response` is the response to the first request
+  kInProgress,  // the first request is still running
+  kMismatch,    // the key was used for a different request
+};
+
+struct TIdempotencyClaim {
+  EIdempotencyState state;
+  std::shared_ptr<const TStoredResponse> response;
+};
+
+// Responses of write requests by (user, Idempotency-Key) in the
+// idempotency_keys table of the global cluster, with recently completed
+// ones also kept in memory. A retry is answered from there without
+// touching the tables the first request wrote to.
+//
+// Keys expire `ttl` after the first request and are then deleted by a
+// periodic task. A key claimed by a request that never completed, say an
+// instance that went down, can be claimed again after `claim-timeout`.
+class IdempotencyStore final
+    : public userver::components::LoggableComponentBase {
+ public:
+  static constexpr std::string_view kName = "idempotency-store";
+
+  IdempotencyStore(
+      const userver::components::ComponentConfig& config,
+      const userver::components::ComponentContext& component_context);
+  ~IdempotencyStore() override;
+
+  TIdempotencyClaim Claim(int user_id, const std::string& key,
+                          const std::string& request_hash) const;
+  // Complete and Release leave a key alone once another request with
+  // another body took it over
+  void Complete(int user_id, const std::string& key,
+                const std::string& request_hash, int status,
+                const std::string& body) const;
+  // Lets a retry run the request again, after a failure not worth storing
+  void Release(int user_id, const std::string& key,
+               const std::string& request_hash) const;
+  // Responses kept in memory
+  TCacheMemory GetMemoryUsage() const;
+
+  static userver::yaml_config::Schema GetStaticConfigSchema();
+
+ private:
+  void DeleteExpired() const;
+
+  userver::storages::postgres::ClusterPtr cluster_;
+  const std::chrono::seconds ttl_;
+  const std::chrono::seconds claim_timeout_;
+  const size_t cleanup_batch_size_;
+
+  mutable userver::engine::Mutex mutex_;
+  mutable userver::cache::LruMap<std::string,
+                                 std::shared_ptr<const TStoredResponse>>
+      responses_;
+
+  userver::utils::PeriodicTask cleanup_task_;
+};
+
+}  // namespace split_bill
+
+template <>
+inline constexpr bool
+    userver::components::kHasValidate<split_bill::IdempotencyStore> = true;
@@ -0,0 +1,188 @@
+#include "product-reaper.hpp"
+
+#include <tuple>
+#include <vector>
+
+#include <userver/components/statistics_storage.hpp>
+#include <userver/engine/sleep.hpp>
+#include <userver/engine/task/cancel.hpp>
+#include <userver/logging/log.hpp>
+#include <userver/storages/postgres/exceptions.hpp>
+#include <userver/testsuite/testsuite_support.hpp>
+#include <userver/utils/statistics/writer.hpp>
+#include <userver/yaml_config/merge_schemas.hpp>
+
+#include "schema-migrator.hpp"
+
+namespace split_bill {
+
+namespace {
+
+namespace pg = userver::storages::postgres;
+
+// Served by idx_products_deleted
+constexpr std::string_view kDeletedProducts =
+    "SELECT room_id, id FROM products WHERE deleted_at IS NOT NULL "
+    "ORDER BY deleted_at, room_id, id LIMIT $1";
+
+// The lookup rows go in the same statement: with the archiving flag set the
+// triggers leave them, as they leave rooms.version of rows no read sees
+constexpr std::string_view kPurgeUserProducts =
+    "WITH gone AS ("
+    "  DELETE FROM user_products WHERE room_id = $1 AND id IN ("
+    "    SELECT id FROM user_products "
+    "    WHERE room_id = $1 AND product_id = $2 LIMIT $3) "
+    "  RETURNING id), "
+    "lookup AS (DELETE FROM user_product_rooms l USING gone "
+    "           WHERE l.id = gone.id) "
+    "SELECT count(*) FROM gone";
+
+constexpr std::string_view kPurgeProduct =
+    "WITH gone AS ("
+    "  DELETE FROM products "
+    "  WHERE room_id = $1 AND id = $2 AND deleted_at IS NOT NULL "
+    "  RETURNING id) "
+    "DELETE FROM product_rooms l USING gone WHERE l.id = gone.id";
+
+}  // namespace
+
+ProductReaper::ProductReaper(
+    const userver::components::ComponentConfig& config,
+    const userver::components::ComponentContext& component_context)
+    : LoggableComponentBase(config, component_context),
+      shard_router_(component_context.FindComponent<ShardRouter>()),
+      batch_size_(config["batch-size"].As<int64_t>(1000)),
+      batch_pause_(config["batch-pause"].As<std::chrono::milliseconds>(
+          std::chrono::milliseconds{50})) {
+  // products.deleted_at exists only once the schema is migrated
+  component_context.FindComponent<SchemaMigrator>();
+
+  statistics_holder_ =
+      component_context
+          .FindComponent<userver::components::StatisticsStorage>()
+          .GetStorage()
+          .RegisterWriter(
+              "split-bill", [this](userver::utils::statistics::Writer& writer) {
+                auto reaper = writer["product-reaper"];
+                reaper["backlog"] = backlog_.load();
+                reaper["purged-products"] = purged_products_.load();
+                reaper["purged-user-products"] = purged_user_products_.load();
+              });
+
+  task_.Start("product-reaper",
+              userver::utils::PeriodicTask::Settings{
+                  config["period"].As<std::chrono::milliseconds>(
+                      std::chrono::seconds{10})},
+              [this] { Run(); });
+  task_.RegisterInTestsuite(
+      component_context
+          .FindComponent<userver::components::TestsuiteSupport>()
+          .GetPeriodicTaskControl());
+}
+
+ProductReaper::~ProductReaper() {
+  task_.Stop();
+  statistics_holder_.Unregister();
+}
+
+void ProductReaper::Run() {
+  int64_t backlog = 0;
+  for (const auto& cluster : shard_router_.AllShards()) {
+    backlog += cluster
+                   ->Execute(pg::ClusterHostType::kSlave,
+                             "SELECT count(*) FROM products "
+                             "WHERE deleted_at IS NOT NULL")
+                   .AsSingleRow<int64_t>();
+  }
+  backlog_ = backlog;
+  if (backlog == 0) {
+    return;
+  }
+
+  const auto purged = purged_products_.load();
+  for (const auto& cluster : shard_router_.AllShards()) {
+    try {
+      ReapShard(cluster);
+    } catch (const pg::Error& e) {
+      // The next run picks up from what is left
+      LOG_WARNING() << "Failed to purge deleted products: " << e.what();
+    }
+    if (userver::engine::current_task::ShouldCancel()) {
+      break;
+    }
+  }
+  LOG_INFO() << "Purged " << purged_products_.load() - purged
+             << " deleted products";
+}
+
+void ProductReaper::ReapShard(const pg::ClusterPtr& cluster) {
+  for (;;) {
+    const auto products =
+        cluster
+            ->Execute(pg::ClusterHostType::kMaster,
+                      std::string{kDeletedProducts}, batch_size_)
+            .AsContainer<std::vector<std::tuple<int, int>>>(pg::kRowTag);
+    for (const auto& [room_id, product_id] : products) {
+      while (!PurgeBatch(cluster, room_id, product_id)) {
+        userver::engine::InterruptibleSleepFor(batch_pause_);
+        if (userver::engine::current_task::ShouldCancel()) {
+          return;
+        }
+      }
+      userver::engine::InterruptibleSleepFor(batch_pause_);
+      if (userver::engine::current_task::ShouldCancel()) {
+        return;
+      }
+    }
+    if (static_cast<int64_t>(products.size()) < batch_size_) {
+      return;
+    }
+  }
+}
+
+bool ProductReaper::PurgeBatch(const pg::ClusterPtr& cluster, int room_id,
+                               int product_id) {
+  auto transaction = cluster->Begin("purge_product", pg::TransactionOptions{});
+  transaction.Execute("SET LOCAL split_bill.archiving = 'on'");
+  const auto user_products =
+      transaction
+          .Execute(std::string{kPurgeUserProducts}, room_id, product_id,
+                   batch_size_)
+          .AsSingleRow<int64_t>();
+  const bool done = user_products < batch_size_;
+  if (done) {
+    transaction.Execute(std::string{kPurgeProduct}, room_id, product_id);
+  }
+  transaction.Commit();
+
+  purged_user_products_ += user_products;
+  if (done) {
+    ++purged_products_;
+    --backlog_;
+  }
+  return done;
+}
+
+userver::yaml_config::Schema ProductReaper::GetStaticConfigSchema() {
+  return userver::yaml_config::MergeSchemas<
+      userver::components::LoggableComponentBase>(R"(
+type: object
+description: purges soft-deleted products and their user products
+additionalProperties: false
+properties:
+    period:
+        type: string
+        description: pause between runs
+        defaultDescription: 10s
+    batch-size:
+        type: integer
+        description: rows deleted per transaction
+        defaultDescription: 1000
+    batch-pause:
+        type: string
+        description: pause between transactions
+        defaultDescription: 50ms
+)");
+}
+
+}  // namespace split_bill
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+
+#include <userver/components/component_config.hpp>
+#include <userver/components/component_context.hpp>
+#include <userver/components/loggable_component_base.hpp>
+#include <userver/components/static_config_validator.hpp>
+#include <userver/storages/postgres/cluster.hpp>
+#include <userver/utils/periodic_task.hpp>
+#include <userver/utils/statistics/storage.hpp>
+#include <userver/yaml_config/schema.hpp>
+
+#include "shard-router.hpp"
+
+namespace split_bill {
+
+// Purges soft-deleted products. DELETE /v1/products/{id} and the remove
+// list of PUT /v1/rooms/{id} only set products.deleted_at, which hides a
+// product from every read at once; its rows and those of its user products
+// are deleted here, `batch-size` rows per short transaction with
+// `batch-pause` between them, so a product with many users never holds
+// locks for long. Progress lives in the tables, so a stopped run resumes
+// where it left off.
+//
+// Exports `product-reaper.backlog` (products waiting as of the last run),
+// `product-reaper.purged-products` and `product-reaper.purged-user-products`.
+class ProductReaper final : public userver::components::LoggableComponentBase {
+ public:
+  static constexpr std::string_view kName = "product-reaper";
+
+  ProductReaper(const userver::components::ComponentConfig& config,
+                const userver::components::ComponentContext& component_context);
+  ~ProductReaper() override;
+
+  static userver::yaml_config::Schema GetStaticConfigSchema();
+
+ private:
+  void Run();
+  // Purges the deleted products of a shard, oldest first, until none are
+  // left or the task is cancelled
+  void ReapShard(const userver::storages::postgres::ClusterPtr& cluster);
+  // Deletes the next batch of the product's user products and the product
+  // itself once they are gone, returns whether the product is gone
+  bool PurgeBatch(const userver::storages::postgres::ClusterPtr& cluster,
+                  int room_id, int product_id);
+
+  const ShardRouter& shard_router_;
+  const int64_t batch_size_;
+  const std::chrono::milliseconds batch_pause_;
+
+  std::atomic<int64_t> backlog_{0};
+  std::atomic<uint64_t> purged_products_{0};
+  std::atomic<uint64_t> purged_user_products_{0};
+  userver::utils::statistics::Entry statistics_holder_;
+
+  userver::utils::PeriodicTask task_;
+};
+
+}  // namespace split_bill
+
+template <>
+inline constexpr bool
+    userver::components::kHasValidate<split_bill::ProductReaper> = true;
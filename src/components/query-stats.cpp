@@ -0,0 +1,90 @@
+#include "query-stats.hpp"
+
+#include <string>
+
+#include <userver/engine/task/inherited_variable.hpp>
+#include <userver/yaml_config/merge_schemas.hpp>
+
+#include "server-timing.hpp"
+
+namespace split_bill {
+
+namespace {
+
+// Inherited by the subtasks a handler starts, such as shard fan-outs
+userver::engine::TaskInheritedVariable<std::shared_ptr<TQueryStats>>
+    kRequestQueryStats;
+
+}  // namespace
+
+void RecordQuery(size_t rows, std::chrono::steady_clock::duration time) {
+  RecordTiming("db", time);
+  const auto* stats = kRequestQueryStats.GetOptional();
+  if (!stats) {
+    return;
+  }
+  (*stats)->queries.fetch_add(1, std::memory_order_relaxed);
+  (*stats)->rows.fetch_add(rows, std::memory_order_relaxed);
+  const uint64_t time_us =
+      std::chrono::duration_cast<std::chrono::microseconds>(time).count();
+  (*stats)->time_us.fetch_add(time_us, std::memory_order_relaxed);
+  auto slowest_us = (*stats)->slowest_us.load(std::memory_order_relaxed);
+  while (slowest_us < time_us &&
+         !(*stats)->slowest_us.compare_exchange_weak(
+             slowest_us, time_us, std::memory_order_relaxed)) {
+  }
+}
+
+const TQueryStats* GetRequestQueryStats() {
+  const auto* stats = kRequestQueryStats.GetOptional();
+  return stats ? stats->get() : nullptr;
+}
+
+QueryStats::TScope::TScope(const userver::server::http::HttpRequest& request,
+                           bool set_headers)
+    : request_(request),
+      set_headers_(set_headers),
+      stats_(std::make_shared<TQueryStats>()) {
+  kRequestQueryStats.Set(stats_);
+}
+
+QueryStats::TScope::~TScope() {
+  kRequestQueryStats.Erase();
+  if (!set_headers_) {
+    return;
+  }
+  auto& response = request_.GetHttpResponse();
+  response.SetHeader(std::string{"X-Db-Queries"},
+                     std::to_string(stats_->queries.load()));
+  response.SetHeader(std::string{"X-Db-Rows"},
+                     std::to_string(stats_->rows.load()));
+  response.SetHeader(std::string{"X-Db-Time-Us"},
+                     std::to_string(stats_->time_us.load()));
+}
+
+QueryStats::QueryStats(
+    const userver::components::ComponentConfig& config,
+    const userver::components::ComponentContext& component_context)
+    : LoggableComponentBase(config, component_context),
+      enabled_(config["enabled"].As<bool>(false)) {}
+
+QueryStats::TScope QueryStats::Track(
+    const userver::server::http::HttpRequest& request) const {
+  return TScope{request, enabled_};
+}
+
+userver::yaml_config::Schema QueryStats::GetStaticConfigSchema() {
+  return userver::yaml_config::MergeSchemas<
+      userver::components::LoggableComponentBase>(R"(
+type: object
+description: per-request database query counts in response headers
+additionalProperties: false
+properties:
+    enabled:
+        type: boolean
+        description: whether tracked requests get the X-Db-* headers
+        defaultDescription: false
+)");
+}
+
+}  // namespace split_bill
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <utility>
+
+#include <userver/components/component_config.hpp>
+#include <userver/components/component_context.hpp>
+#include <userver/components/loggable_component_base.hpp>
+#include <userver/components/static_config_validator.hpp>
+#include <userver/server/http/http_request.hpp>
+#include <userver/storages/postgres/cluster.hpp>
+#include <userver/storages/postgres/result_set.hpp>
+#include <userver/storages/postgres/transaction.hpp>
+#include <userver/yaml_config/schema.hpp>
+
+namespace split_bill {
+
+// Database round trips of one request, including those of its subtasks
+struct TQueryStats {
+  std::atomic<uint64_t> queries{0};
+  std::atomic<uint64_t> rows{0};
+  std::atomic<uint64_t> time_us{0};
+  std::atomic<uint64_t> slowest_us{0};
+};
+
+// Adds a query to the stats of the current request, if they are tracked
+void RecordQuery(size_t rows, std::chrono::steady_clock::duration time);
+
+// Stats of the current request, null outside of a tracked one
+const TQueryStats* GetRequestQueryStats();
+
+// `executor->Execute(args...)` for a ClusterPtr, `executor.Execute(args...)`
+// for a Transaction, counted in the stats of the current request. Queries of
+// request handlers and the components they call go through it.
+template <typename... Args>
+userver::storages::postgres::ResultSet CountedExecute(
+    const userver::storages::postgres::ClusterPtr& cluster, Args&&... args) {
+  const auto start = std::chrono::steady_clock::now();
+  auto result = cluster->Execute(std::forward<Args>(args)...);
+  RecordQuery(result.Size(), std::chrono::steady_clock::now() - start);
+  return result;
+}
+
+template <typename... Args>
+userver::storages::postgres::ResultSet CountedExecute(
+    userver::storages::postgres::Transaction& transaction, Args&&... args) {
+  const auto start = std::chrono::steady_clock::now();
+  auto result = transaction.Execute(std::forward<Args>(args)...);
+  RecordQuery(result.Size(), std::chrono::steady_clock::now() - start);
+  return result;
+}
+
+// Per-request query counts, attached to slow request logs (see
+// request-logging) and used for catching N+1 query loops in tests. When
+// `enabled` (in testing), a tracked request answers with X-Db-Queries,
+// X-Db-Rows and X-Db-Time-Us headers.
+class QueryStats final : public userver::components::LoggableComponentBase {
+ public:
+  static constexpr std::string_view kName = "query-stats";
+
+  // Tracks the request while alive and sets the headers when destroyed
+  class TScope final {
+   public:
+    TScope(TScope&&) = delete;
+    TScope& operator=(TScope&&) = delete;
+    ~TScope();
+
+   private:
+    friend class QueryStats;
+    TScope(const userver::server::http::HttpRequest& request,
+           bool set_headers);
+
+    const userver::server::http::HttpRequest& request_;
+    const bool set_headers_;
+    std::shared_ptr<TQueryStats> stats_;
+  };
+
+  QueryStats(const userver::components::ComponentConfig& config,
+             const userver::components::ComponentContext& component_context);
+
+  TScope Track(const userver::server::http::HttpRequest& request) const;
+
+  static userver::yaml_config::Schema GetStaticConfigSchema();
+
+ private:
+  const bool enabled_;
+};
+
+}  // namespace split_bill
+
+template <>
+inline constexpr bool
+    userver::components::kHasValidate<split_bill::QueryStats> = true;
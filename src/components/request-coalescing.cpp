@@ -0,0 +1,39 @@
+#include "request-coalescing.hpp"
+
+#include <mutex>
+
+#include <userver/components/statistics_storage.hpp>
+#include <userver/utils/statistics/writer.hpp>
+
+namespace split_bill {
+
+RequestCoalescing::RequestCoalescing(
+    const userver::components::ComponentConfig& config,
+    const userver::components::ComponentContext& component_context)
+    : LoggableComponentBase(config, component_context) {
+  statistics_holder_ =
+      component_context
+          .FindComponent<userver::components::StatisticsStorage>()
+          .GetStorage()
+          .RegisterWriter(
+              "split-bill", [this](userver::utils::statistics::Writer& writer) {
+                std::lock_guard lock(mutex_);
+                for (const auto& [name, counter] : counters_) {
+                  writer["coalesced-requests"].ValueWithLabels(
+                      counter->load(), {{"flight", name}});
+                }
+              });
+}
+
+RequestCoalescing::~RequestCoalescing() { statistics_holder_.Unregister(); }
+
+std::atomic<uint64_t>& RequestCoalescing::Counter(const std::string& name) {
+  std::lock_guard lock(mutex_);
+  auto& counter = counters_[name];
+  if (!counter) {
+    counter = std::make_unique<std::atomic<uint64_t>>(0);
+  }
+  return *counter;
+}
+
+}  // namespace split_bill
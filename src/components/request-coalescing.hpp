@@ -0,0 +1,39 @@
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include <userver/components/component_config.hpp>
+#include <userver/components/component_context.hpp>
+#include <userver/components/loggable_component_base.hpp>
+#include <userver/engine/mutex.hpp>
+#include <userver/utils/statistics/storage.hpp>
+
+namespace split_bill {
+
+// Owns the counters of every SingleFlight (see handlers/lib/single-flight.hpp)
+// and exports them as `coalesced-requests` labelled by flight name.
+class RequestCoalescing final
+    : public userver::components::LoggableComponentBase {
+ public:
+  static constexpr std::string_view kName = "request-coalescing";
+
+  RequestCoalescing(
+      const userver::components::ComponentConfig& config,
+      const userver::components::ComponentContext& component_context);
+  ~RequestCoalescing() override;
+
+  // Counter of requests coalesced by the flight `name`; the same name
+  // always returns the same counter
+  std::atomic<uint64_t>& Counter(const std::string& name);
+
+ private:
+  userver::engine::Mutex mutex_;
+  std::map<std::string, std::unique_ptr<std::atomic<uint64_t>>> counters_;
+  userver::utils::statistics::Entry statistics_holder_;
+};
+
+}  // namespace split_bill
@@ -0,0 +1,141 @@
+#include "request-logging.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+
+#include <userver/dynamic_config/storage/component.hpp>
+#include <userver/dynamic_config/value.hpp>
+#include <userver/logging/log.hpp>
+#include <userver/logging/log_extra.hpp>
+#include <userver/utils/rand.hpp>
+
+#include "query-stats.hpp"
+
+namespace split_bill {
+
+namespace {
+
+// Logs no request but the slow ones
+const userver::dynamic_config::Key<TRequestLoggingConfig> kRequestLogging{
+    "SPLIT_BILL_REQUEST_LOGGING",
+    userver::dynamic_config::DefaultAsJsonString{R"(
+{
+  "slow-request-ms": 500,
+  "handlers": {
+    "__default__": {
+      "level": "info",
+      "sample-rate": 0,
+      "log-bodies": false,
+      "max-body-size": 1024
+    }
+  }
+}
+)"}};
+
+THandlerLogging ParseHandlerLogging(const userver::formats::json::Value& value,
+                                    const THandlerLogging& base) {
+  THandlerLogging settings = base;
+  if (value.HasMember("level")) {
+    settings.level =
+        userver::logging::LevelFromString(value["level"].As<std::string>());
+  }
+  settings.sample_rate = std::clamp(
+      value["sample-rate"].As<double>(base.sample_rate), 0.0, 1.0);
+  settings.log_bodies = value["log-bodies"].As<bool>(base.log_bodies);
+  settings.max_body_size =
+      value["max-body-size"].As<size_t>(base.max_body_size);
+  return settings;
+}
+
+}  // namespace
+
+const THandlerLogging& TRequestLoggingConfig::ForHandler(
+    std::string_view handler) const {
+  const auto it = handlers.find(handler);
+  return it == handlers.end() ? defaults : it->second;
+}
+
+TRequestLoggingConfig Parse(
+    const userver::formats::json::Value& value,
+    userver::formats::parse::To<TRequestLoggingConfig>) {
+  TRequestLoggingConfig config;
+  config.slow_request = std::chrono::milliseconds{
+      value["slow-request-ms"].As<int64_t>(config.slow_request.count())};
+  const auto& handlers = value["handlers"];
+  config.defaults =
+      ParseHandlerLogging(handlers["__default__"], config.defaults);
+  for (auto it = handlers.begin(); it != handlers.end(); ++it) {
+    if (it.GetName() != "__default__") {
+      config.handlers.emplace(it.GetName(),
+                              ParseHandlerLogging(*it, config.defaults));
+    }
+  }
+  return config;
+}
+
+RequestLogging::TScope::TScope(
+    const userver::server::http::HttpRequest& request,
+    std::string_view handler, const THandlerLogging& settings,
+    std::chrono::milliseconds slow_request)
+    : request_(request),
+      handler_(handler),
+      settings_(settings),
+      slow_request_(slow_request),
+      start_(std::chrono::steady_clock::now()) {}
+
+RequestLogging::TScope::~TScope() {
+  const auto duration = std::chrono::steady_clock::now() - start_;
+  const bool slow = duration >= slow_request_;
+  if (!slow && (settings_.sample_rate <= 0 ||
+                userver::utils::RandRange(1.0) >= settings_.sample_rate)) {
+    return;
+  }
+
+  userver::logging::LogExtra extra{
+      {"handler", std::string{handler_}},
+      {"method", request_.GetMethodStr()},
+      {"path", request_.GetRequestPath()},
+      {"status",
+       static_cast<int>(request_.GetHttpResponse().GetStatus())},
+      {"duration_us",
+       std::chrono::duration_cast<std::chrono::microseconds>(duration)
+           .count()}};
+  if (const auto* stats = GetRequestQueryStats()) {
+    extra.Extend("db_queries", stats->queries.load());
+    extra.Extend("db_rows", stats->rows.load());
+    extra.Extend("db_time_us", stats->time_us.load());
+    extra.Extend("db_slowest_us", stats->slowest_us.load());
+  }
+  if (settings_.log_bodies) {
+    extra.Extend("url", request_.GetUrl());
+    extra.Extend("body",
+                 request_.RequestBody().substr(0, settings_.max_body_size));
+  }
+
+  if (slow) {
+    LOG_WARNING() << "Slow request" << extra;
+  } else {
+    LOG(settings_.level) << "Request" << extra;
+  }
+}
+
+RequestLogging::RequestLogging(
+    const userver::components::ComponentConfig& config,
+    const userver::components::ComponentContext& component_context)
+    : LoggableComponentBase(config, component_context),
+      config_source_(
+          component_context
+              .FindComponent<userver::components::DynamicConfig>()
+              .GetSource()) {}
+
+RequestLogging::TScope RequestLogging::Track(
+    const userver::server::http::HttpRequest& request,
+    std::string_view handler) const {
+  const auto snapshot = config_source_.GetSnapshot();
+  const auto& config = snapshot[kRequestLogging];
+  return TScope{request, handler, config.ForHandler(handler),
+                config.slow_request};
+}
+
+}  // namespace split_bill
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+
+#include <userver/components/component_config.hpp>
+#include <userver/components/component_context.hpp>
+#include <userver/components/loggable_component_base.hpp>
+#include <userver/dynamic_config/source.hpp>
+#include <userver/formats/json/value.hpp>
+#include <userver/logging/level.hpp>
+#include <userver/server/http/http_request.hpp>
+
+namespace split_bill {
+
+// How requests of one handler are logged
+struct THandlerLogging {
+  userver::logging::Level level = userver::logging::Level::kInfo;
+  // Share of the requests logged, from 0 to 1
+  double sample_rate = 0;
+  // Bodies and query strings may carry passwords and personal data
+  bool log_bodies = false;
+  size_t max_body_size = 1024;
+};
+
+// SPLIT_BILL_REQUEST_LOGGING dynamic config:
+//
+//   {
+//     "slow-request-ms": 500,
+//     "handlers": {
+//       "__default__": {"sample-rate": 0.001},
+//       "handler-v1-add-user-to-product": {"sample-rate": 0.1,
+//                                          "level": "debug",
+//                                          "log-bodies": true}
+//     }
+//   }
+//
+// A handler entry overrides the fields it sets of `__default__`.
+struct TRequestLoggingConfig {
+  std::chrono::milliseconds slow_request{500};
+  THandlerLogging defaults;
+  std::map<std::string, THandlerLogging, std::less<>> handlers;
+
+  const THandlerLogging& ForHandler(std::string_view handler) const;
+};
+
+TRequestLoggingConfig Parse(
+    const userver::formats::json::Value& value,
+    userver::formats::parse::To<TRequestLoggingConfig>);
+
+// Writes one structured line per logged request: the handler, method, path,
+// status, duration and the query stats of the request. A sample of the
+// requests is logged at the level configured for their handler, and every
+// request slower than `slow-request-ms` is logged as a warning, so the
+// handlers themselves don't have to log each call.
+class RequestLogging final
+    : public userver::components::LoggableComponentBase {
+ public:
+  static constexpr std::string_view kName = "request-logging";
+
+  // Logs the request, if it is sampled or slow, when destroyed. Has to be
+  // destroyed before the QueryStats scope of the request.
+  class TScope final {
+   public:
+    TScope(TScope&&) = delete;
+    TScope& operator=(TScope&&) = delete;
+    ~TScope();
+
+   private:
+    friend class RequestLogging;
+    TScope(const userver::server::http::HttpRequest& request,
+           std::string_view handler, const THandlerLogging& settings,
+           std::chrono::milliseconds slow_request);
+
+    const userver::server::http::HttpRequest& request_;
+    const std::string_view handler_;
+    const THandlerLogging settings_;
+    const std::chrono::milliseconds slow_request_;
+    const std::chrono::steady_clock::time_point start_;
+  };
+
+  RequestLogging(
+      const userver::components::ComponentConfig& config,
+      const userver::components::ComponentContext& component_context);
+
+  // `handler` has to outlive the scope, as the kName of a handler does
+  TScope Track(const userver::server::http::HttpRequest& request,
+               std::string_view handler) const;
+
+ private:
+  const userver::dynamic_config::Source config_source_;
+};
+
+}  // namespace split_bill
@@ -0,0 +1,164 @@
+#include "response-compression.hpp"
+
+#include <time.h>
+
+#include <chrono>
+#include <utility>
+
+#include <userver/components/statistics_storage.hpp>
+#include <userver/http/common_headers.hpp>
+#include <userver/utils/async.hpp>
+#include <userver/utils/statistics/writer.hpp>
+#include <userver/yaml_config/merge_schemas.hpp>
+
+#include "../handlers/lib/gzip.hpp"
+#include "../handlers/lib/strings.hpp"
+#include "../handlers/lib/vary.hpp"
+#include "server-timing.hpp"
+
+namespace split_bill {
+
+namespace {
+
+// Whether an Accept-Encoding value such as "br, gzip;q=0.8" allows gzip
+bool AllowsGzip(std::string_view accept_encoding) {
+  bool allowed = false;
+  while (!accept_encoding.empty()) {
+    const auto comma = accept_encoding.find(',');
+    auto coding = accept_encoding.substr(0, comma);
+    accept_encoding.remove_prefix(
+        comma == std::string_view::npos ? accept_encoding.size() : comma + 1);
+
+    const auto semicolon = coding.find(';');
+    const auto name = Trim(coding.substr(0, semicolon));
+    bool rejected = false;
+    if (semicolon != std::string_view::npos) {
+      const auto parameter = Trim(coding.substr(semicolon + 1));
+      // q=0, q=0.0, q=0.000 refuse the coding
+      rejected = parameter.size() >= 3 && (parameter[0] == 'q' ||
+                                           parameter[0] == 'Q') &&
+                 parameter[1] == '=' &&
+                 parameter.find_first_not_of("0.", 2) ==
+                     std::string_view::npos;
+    }
+    if (EqualsIgnoreCase(name, "gzip")) {
+      // An explicit entry overrides '*'
+      return !rejected;
+    }
+    if (name == "*") {
+      allowed = !rejected;
+    }
+  }
+  return allowed;
+}
+
+std::chrono::microseconds ThreadCpuTime() {
+  timespec time{};
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+  return std::chrono::seconds{time.tv_sec} +
+         std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::nanoseconds{time.tv_nsec});
+}
+
+void SetGzipHeaders(const userver::server::http::HttpRequest& request) {
+  request.GetHttpResponse().SetHeader(
+      userver::http::headers::kContentEncoding, std::string{"gzip"});
+}
+
+}  // namespace
+
+ResponseCompression::ResponseCompression(
+    const userver::components::ComponentConfig& config,
+    const userver::components::ComponentContext& component_context)
+    : LoggableComponentBase(config, component_context),
+      task_processor_(component_context.GetTaskProcessor(
+          config["task-processor"].As<std::string>(
+              "compression-task-processor"))),
+      min_size_(config["min-size"].As<size_t>(4096)),
+      level_(config["level"].As<int>(6)) {
+  statistics_holder_ =
+      component_context
+          .FindComponent<userver::components::StatisticsStorage>()
+          .GetStorage()
+          .RegisterWriter(
+              "split-bill", [this](userver::utils::statistics::Writer& writer) {
+                auto compression = writer["response-compression"];
+                compression["compressed"] = compressed_.load();
+                compression["bytes-in"] = bytes_in_.load();
+                compression["bytes-out"] = bytes_out_.load();
+                compression["cpu-time-us"] = cpu_time_us_.load();
+              });
+}
+
+ResponseCompression::~ResponseCompression() {
+  statistics_holder_.Unregister();
+}
+
+bool ResponseCompression::AcceptsGzip(
+    const userver::server::http::HttpRequest& request) const {
+  return AllowsGzip(
+      request.GetHeader(userver::http::headers::kAcceptEncoding));
+}
+
+std::string ResponseCompression::Compress(
+    const userver::server::http::HttpRequest& request,
+    std::string body) const {
+  // Sent compressed or not, the body could have been the other way
+  AddVary(request, userver::http::headers::kAcceptEncoding);
+  if (body.size() < min_size_ || !AcceptsGzip(request)) {
+    return body;
+  }
+
+  const TTimingScope timing("compress");
+  auto [compressed, cpu_time] =
+      userver::utils::Async(task_processor_, "compress-response",
+                            [this, &body] {
+                              const auto start = ThreadCpuTime();
+                              auto result = GzipCompress(body, level_);
+                              return std::make_pair(std::move(result),
+                                                    ThreadCpuTime() - start);
+                            })
+          .Get();
+  compressed_.fetch_add(1, std::memory_order_relaxed);
+  bytes_in_.fetch_add(body.size(), std::memory_order_relaxed);
+  bytes_out_.fetch_add(compressed.size(), std::memory_order_relaxed);
+  cpu_time_us_.fetch_add(cpu_time.count(), std::memory_order_relaxed);
+
+  SetGzipHeaders(request);
+  return std::move(compressed);
+}
+
+std::string ResponseCompression::FromGzip(
+    const userver::server::http::HttpRequest& request,
+    std::string_view gzipped) const {
+  AddVary(request, userver::http::headers::kAcceptEncoding);
+  if (!AcceptsGzip(request)) {
+    return GzipDecompress(gzipped);
+  }
+  SetGzipHeaders(request);
+  return std::string{gzipped};
+}
+
+userver::yaml_config::Schema ResponseCompression::GetStaticConfigSchema() {
+  return userver::yaml_config::MergeSchemas<
+      userver::components::LoggableComponentBase>(R"(
+type: object
+description: gzip Content-Encoding of large responses
+additionalProperties: false
+properties:
+    task-processor:
+        type: string
+        description: task processor compressing the bodies
+        defaultDescription: compression-task-processor
+    min-size:
+        type: integer
+        description: smallest body compressed, in bytes
+        defaultDescription: 4096
+    level:
+        type: integer
+        description: zlib compression level, from 1 (fastest) to 9 (smallest)
+        defaultDescription: 6
+)");
+}
+
+}  // namespace split_bill
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <string_view>
+
+#include <userver/components/component_config.hpp>
+#include <userver/components/component_context.hpp>
+#include <userver/components/loggable_component_base.hpp>
+#include <userver/components/static_config_validator.hpp>
+#include <userver/engine/task/task_processor_fwd.hpp>
+#include <userver/server/http/http_request.hpp>
+#include <userver/utils/statistics/storage.hpp>
+#include <userver/yaml_config/schema.hpp>
+
+namespace split_bill {
+
+// gzip Content-Encoding for response bodies of at least `min-size` bytes
+// sent to clients accepting it. Compression runs on its own task processor,
+// so a large body doesn't hold up the handler threads, and is exported as
+// `response-compression` metrics: bodies compressed, bytes in and out and
+// the CPU time spent. Every body passed through lists Accept-Encoding in
+// Vary, compressed or not, so that caches keep both.
+class ResponseCompression final
+    : public userver::components::LoggableComponentBase {
+ public:
+  static constexpr std::string_view kName = "response-compression";
+
+  ResponseCompression(
+      const userver::components::ComponentConfig& config,
+      const userver::components::ComponentContext& component_context);
+  ~ResponseCompression() override;
+
+  // `body` to send for the request, compressed if worth it
+  std::string Compress(const userver::server::http::HttpRequest& request,
+                       std::string body) const;
+  // A body stored gzipped: sent as is when the client accepts gzip,
+  // decompressed otherwise
+  std::string FromGzip(const userver::server::http::HttpRequest& request,
+                       std::string_view gzipped) const;
+
+  static userver::yaml_config::Schema GetStaticConfigSchema();
+
+ private:
+  bool AcceptsGzip(const userver::server::http::HttpRequest& request) const;
+
+  userver::engine::TaskProcessor& task_processor_;
+  const size_t min_size_;
+  const int level_;
+
+  mutable std::atomic<uint64_t> compressed_{0};
+  mutable std::atomic<uint64_t> bytes_in_{0};
+  mutable std::atomic<uint64_t> bytes_out_{0};
+  mutable std::atomic<uint64_t> cpu_time_us_{0};
+  userver::utils::statistics::Entry statistics_holder_;
+};
+
+}  // namespace split_bill
+
+template <>
+inline constexpr bool
+    userver::components::kHasValidate<split_bill::ResponseCompression> = true;
@@ -0,0 +1,163 @@
+#include "room-archiver.hpp"
+
+#include <chrono>
+#include <memory_resource>
+
+#include <userver/formats/json/string_builder.hpp>
+#include <userver/logging/log.hpp>
+#include <userver/storages/postgres/exceptions.hpp>
+#include <userver/storages/postgres/io/bytea.hpp>
+#include <userver/testsuite/testsuite_support.hpp>
+#include <userver/yaml_config/merge_schemas.hpp>
+
+#include "../handlers/lib/gzip.hpp"
+#include "schema-migrator.hpp"
+
+namespace split_bill {
+
+namespace {
+
+namespace pg = userver::storages::postgres;
+
+// Rooms with user products and none of them UNPAID, waiting for
+// product-reaper to purge none of their products
+constexpr std::string_view kSettledRooms =
+    "SELECT r.id FROM rooms r "
+    "WHERE r.id > $1 AND NOT r.archived "
+    "AND EXISTS (SELECT 1 FROM user_products up WHERE up.room_id = r.id) "
+    "AND NOT EXISTS (SELECT 1 FROM user_products up "
+    "                WHERE up.room_id = r.id AND up.status = 'UNPAID') "
+    "AND NOT EXISTS (SELECT 1 FROM products p "
+    "                WHERE p.room_id = r.id AND p.deleted_at IS NOT NULL) "
+    "ORDER BY r.id LIMIT $2";
+
+}  // namespace
+
+RoomArchiver::RoomArchiver(
+    const userver::components::ComponentConfig& config,
+    const userver::components::ComponentContext& component_context)
+    : LoggableComponentBase(config, component_context),
+      shard_router_(component_context.FindComponent<ShardRouter>()),
+      snapshot_cache_(component_context.FindComponent<RoomSnapshotCache>()),
+      batch_size_(config["batch-size"].As<size_t>(100)),
+      cursors_(shard_router_.ShardCount(), 0) {
+  // room_archive exists only once the schema is migrated
+  component_context.FindComponent<SchemaMigrator>();
+
+  task_.Start("room-archiver",
+              userver::utils::PeriodicTask::Settings{
+                  config["period"].As<std::chrono::milliseconds>(
+                      std::chrono::hours{1})},
+              [this] { Run(); });
+  task_.RegisterInTestsuite(
+      component_context
+          .FindComponent<userver::components::TestsuiteSupport>()
+          .GetPeriodicTaskControl());
+}
+
+RoomArchiver::~RoomArchiver() { task_.Stop(); }
+
+void RoomArchiver::Run() {
+  size_t archived = 0;
+  for (size_t shard_index = 0; shard_index < cursors_.size(); ++shard_index) {
+    archived += ArchiveShard(shard_index);
+  }
+  LOG_INFO() << "Archived " << archived << " settled rooms";
+}
+
+size_t RoomArchiver::ArchiveShard(size_t shard_index) {
+  const auto& cluster = shard_router_.AllShards()[shard_index];
+  auto& cursor = cursors_[shard_index];
+
+  const auto room_ids =
+      cluster
+          ->Execute(pg::ClusterHostType::kSlave, std::string{kSettledRooms},
+                    cursor, static_cast<int>(batch_size_))
+          .AsContainer<std::vector<int>>();
+  // Starts over once the whole shard is scanned
+  cursor = room_ids.size() < batch_size_ ? 0 : room_ids.back();
+
+  size_t archived = 0;
+  for (const auto room_id : room_ids) {
+    // Skips rooms changed since the scan
+    const auto room = snapshot_cache_.Get(room_id);
+    if (!room.snapshot || room.snapshot->UserProductCount() == 0 ||
+        room.snapshot->Status() != ERoomStatus::kArchived) {
+      continue;
+    }
+    try {
+      if (Archive(cluster, *room.snapshot)) {
+        ++archived;
+      }
+    } catch (const pg::Error& e) {
+      LOG_WARNING() << "Failed to archive room " << room_id << ": "
+                    << e.what();
+    }
+  }
+  return archived;
+}
+
+bool RoomArchiver::Archive(const pg::ClusterPtr& cluster,
+                           const TRoomSnapshot& snapshot) const {
+  userver::formats::json::StringBuilder details;
+  WriteToStream(snapshot.ToRoomDetails(std::pmr::new_delete_resource()),
+                details);
+  const auto compressed_details = GzipCompress(details.GetString());
+  const auto compressed_calculation = GzipCompress(
+      userver::formats::json::ToString(snapshot.ToCalculation()));
+  const auto compressed_summary =
+      GzipCompress(userver::formats::json::ToString(snapshot.ToSummary()));
+
+  const auto room_id = snapshot.RoomId();
+  auto transaction = cluster->Begin("archive_room", pg::TransactionOptions{});
+  // Keeps the triggers from bumping the version and dropping lookup rows
+  transaction.Execute("SET LOCAL split_bill.archiving = 'on'");
+  // Rows are locked before the room, in the order of every other write
+  transaction.Execute(
+      "WITH archived_user_products AS ("
+      "  DELETE FROM user_products WHERE room_id = $1 "
+      "  RETURNING id, status, product_id, user_id) "
+      "INSERT INTO room_archive "
+      "(room_id, details, calculation, summary, room_rows) "
+      "SELECT $1, $2, $3, $4, jsonb_build_object("
+      "  'products', (SELECT COALESCE(jsonb_agg(p), '[]') "
+      "               FROM (SELECT id, name, price FROM products "
+      "                     WHERE room_id = $1 FOR UPDATE) p), "
+      "  'user_products', (SELECT COALESCE(jsonb_agg(up), '[]') "
+      "                    FROM archived_user_products up))",
+      room_id, pg::Bytea(compressed_details),
+      pg::Bytea(compressed_calculation), pg::Bytea(compressed_summary));
+  transaction.Execute("DELETE FROM products WHERE room_id = $1", room_id);
+
+  const auto room = transaction.Execute(
+      "UPDATE rooms SET archived = true "
+      "WHERE id = $1 AND version = $2 AND NOT archived RETURNING id",
+      room_id, snapshot.Version());
+  if (room.IsEmpty()) {
+    // Changed since the snapshot was built
+    transaction.Rollback();
+    return false;
+  }
+  transaction.Commit();
+  return true;
+}
+
+userver::yaml_config::Schema RoomArchiver::GetStaticConfigSchema() {
+  return userver::yaml_config::MergeSchemas<
+      userver::components::LoggableComponentBase>(R"(
+type: object
+description: moves settled rooms into room_archive
+additionalProperties: false
+properties:
+    period:
+        type: string
+        description: pause between runs
+        defaultDescription: 1h
+    batch-size:
+        type: integer
+        description: rooms scanned per shard and run
+        defaultDescription: 100
+)");
+}
+
+}  // namespace split_bill
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+#include <userver/components/component_config.hpp>
+#include <userver/components/component_context.hpp>
+#include <userver/components/loggable_component_base.hpp>
+#include <userver/components/static_config_validator.hpp>
+#include <userver/storages/postgres/cluster.hpp>
+#include <userver/utils/periodic_task.hpp>
+#include <userver/yaml_config/schema.hpp>
+
+#include "../models/room-snapshot.hpp"
+#include "room-snapshot-cache.hpp"
+#include "shard-router.hpp"
+
+namespace split_bill {
+
+// Moves settled rooms, those with every user product PAID, out of products
+// and user_products into room_archive together with their GET
+// /v1/rooms/{id}, /calculate and /summary responses. Reads of such a room
+// serve the stored responses, and the hot tables and their indexes keep
+// only the rooms still in use.
+//
+// A room is archived only if it is still at the version its responses were
+// built from. Editing an archived room moves its rows back (unarchive_room
+// in the schema).
+class RoomArchiver final : public userver::components::LoggableComponentBase {
+ public:
+  static constexpr std::string_view kName = "room-archiver";
+
+  RoomArchiver(const userver::components::ComponentConfig& config,
+               const userver::components::ComponentContext& component_context);
+  ~RoomArchiver() override;
+
+  static userver::yaml_config::Schema GetStaticConfigSchema();
+
+ private:
+  void Run();
+  // Archives the settled rooms among the next `batch-size` rooms of a shard,
+  // returns how many were archived
+  size_t ArchiveShard(size_t shard_index);
+  bool Archive(const userver::storages::postgres::ClusterPtr& cluster,
+               const TRoomSnapshot& snapshot) const;
+
+  const ShardRouter& shard_router_;
+  const RoomSnapshotCache& snapshot_cache_;
+  const size_t batch_size_;
+  // Last room id scanned on every shard; runs never overlap
+  std::vector<int> cursors_;
+
+  userver::utils::PeriodicTask task_;
+};
+
+}  // namespace split_bill
+
+template <>
+inline constexpr bool
+    userver::components::kHasValidate<split_bill::RoomArchiver> = true;
@@ -0,0 +1,284 @@
+#include "query-stats.hpp"
+#include "room-snapshot-cache.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+#include <userver/storages/postgres/cluster.hpp>
+#include <userver/storages/postgres/io/bytea.hpp>
+#include <userver/yaml_config/merge_schemas.hpp>
+
+#include "../handlers/lib/fan-out.hpp"
+#include "../handlers/lib/users.hpp"
+#include "request-coalescing.hpp"
+#include "server-timing.hpp"
+
+namespace split_bill {
+
+RoomSnapshotCache::RoomSnapshotCache(
+    const userver::components::ComponentConfig& config,
+    const userver::components::ComponentContext& component_context)
+    : LoggableComponentBase(config, component_context),
+      shard_router_(component_context.FindComponent<ShardRouter>()),
+      flight_(component_context.FindComponent<RequestCoalescing>().Counter(
+          "room-snapshot")),
+      snapshots_(config["size"].As<size_t>(10000)),
+      archived_(config["size"].As<size_t>(10000)) {}
+
+TCachedRoom RoomSnapshotCache::Get(int room_id) const {
+  return flight_.Run(room_id, [&] { return Fetch(room_id); });
+}
+
+TRoomCacheMemory RoomSnapshotCache::GetMemoryUsage() const {
+  std::vector<std::shared_ptr<const TRoomSnapshot>> snapshots;
+  std::vector<std::shared_ptr<const TArchivedRoom>> archived;
+  {
+    std::lock_guard lock(mutex_);
+    snapshots.reserve(snapshots_.GetSize());
+    snapshots_.VisitAll(
+        [&snapshots](int, const std::shared_ptr<const TRoomSnapshot>& room) {
+          snapshots.push_back(room);
+        });
+    archived.reserve(archived_.GetSize());
+    archived_.VisitAll(
+        [&archived](int, const std::shared_ptr<const TArchivedRoom>& room) {
+          archived.push_back(room);
+        });
+  }
+
+  TRoomCacheMemory memory;
+  memory.snapshots.entries = snapshots.size();
+  for (const auto& room : snapshots) {
+    memory.snapshots.bytes += room->MemoryUsage();
+  }
+  memory.archived.entries = archived.size();
+  for (const auto& room : archived) {
+    memory.archived.bytes += room->MemoryUsage();
+  }
+  return memory;
+}
+
+TCachedRoom RoomSnapshotCache::Fetch(int room_id) const {
+  auto version_result = CountedExecute(
+      shard_router_.ForRoom(room_id),
+      userver::storages::postgres::ClusterHostType::kSlave,
+      "SELECT name, user_id, version, archived FROM rooms WHERE id = $1",
+      room_id);
+  if (version_result.IsEmpty()) {
+    return {};
+  }
+  const auto version_row = version_result.Front();
+  const auto version = version_row["version"].As<int64_t>();
+  const auto archived = version_row["archived"].As<bool>();
+
+  {
+    std::lock_guard lock(mutex_);
+    if (archived) {
+      const auto* cached = archived_.Get(room_id);
+      if (cached && (*cached)->version == version) {
+        return {nullptr, *cached};
+      }
+    } else {
+      const auto* cached = snapshots_.Get(room_id);
+      if (cached && (*cached)->Version() == version) {
+        return {*cached, nullptr};
+      }
+    }
+  }
+
+  const TTimingScope timing("snapshot-load");
+  TCachedRoom room;
+  if (!archived) {
+    room.snapshot = LoadConcurrently(
+        room_id, version_row["name"].As<std::string>(),
+        version_row["user_id"].As<int>(), version);
+  }
+  if (!room.snapshot) {
+    room = Load(room_id);
+  }
+
+  std::lock_guard lock(mutex_);
+  if (room.snapshot) {
+    const auto* cached = snapshots_.Get(room_id);
+    if (!cached || (*cached)->Version() < room.snapshot->Version()) {
+      snapshots_.Put(room_id, room.snapshot);
+    }
+  } else if (room.archived) {
+    const auto* cached = archived_.Get(room_id);
+    if (!cached || (*cached)->version < room.archived->version) {
+      archived_.Put(room_id, room.archived);
+    }
+  }
+  return room;
+}
+
+TCachedRoom RoomSnapshotCache::Load(int room_id) const {
+  // One repeatable read transaction, so the version matches the rows
+  auto transaction = shard_router_.ForRoom(room_id)->Begin(
+      "load_room_snapshot",
+      userver::storages::postgres::TransactionOptions{
+          userver::storages::postgres::IsolationLevel::kRepeatableRead,
+          userver::storages::postgres::TransactionOptions::kReadOnly});
+
+  auto room_result = CountedExecute(
+      transaction,
+      "SELECT name, user_id, version, archived FROM rooms WHERE id = $1",
+      room_id);
+  if (room_result.IsEmpty()) {
+    return {};
+  }
+  const auto room_row = room_result.Front();
+
+  auto member_ids =
+      CountedExecute(transaction,
+                     "SELECT user_id FROM user_rooms WHERE room_id = $1",
+                     room_id)
+          .AsContainer<std::vector<int>>();
+
+  if (room_row["archived"].As<bool>()) {
+    auto archive_row =
+        CountedExecute(
+            transaction,
+            "SELECT details, calculation, summary FROM room_archive "
+            "WHERE room_id = $1",
+            room_id)
+            .Front();
+    transaction.Commit();
+
+    auto archived = std::make_shared<TArchivedRoom>();
+    archived->room_id = room_id;
+    archived->owner_id = room_row["user_id"].As<int>();
+    archived->version = room_row["version"].As<int64_t>();
+    archived->member_ids = std::move(member_ids);
+    std::sort(archived->member_ids.begin(), archived->member_ids.end());
+    archive_row["details"].To(
+        userver::storages::postgres::Bytea(archived->details));
+    archive_row["calculation"].To(
+        userver::storages::postgres::Bytea(archived->calculation));
+    archive_row["summary"].To(
+        userver::storages::postgres::Bytea(archived->summary));
+    return {nullptr, std::move(archived)};
+  }
+
+  auto products =
+      CountedExecute(
+          transaction,
+          "SELECT id, name, COALESCE(price, 0) AS price "
+          "FROM products WHERE room_id = $1 AND deleted_at IS NULL",
+          room_id)
+          .AsContainer<std::vector<TRoomSnapshot::TProductRow>>(
+              userver::storages::postgres::kRowTag);
+
+  auto user_products =
+      CountedExecute(
+          transaction,
+          "SELECT up.id, up.product_id, up.user_id, "
+          "up.status = 'PAID' AS paid "
+          "FROM user_products up "
+          "WHERE up.room_id = $1",
+          room_id)
+          .AsContainer<std::vector<TRoomSnapshot::TUserProductRow>>(
+              userver::storages::postgres::kRowTag);
+  transaction.Commit();
+
+  std::vector<int> user_ids;
+  user_ids.reserve(user_products.size());
+  for (const auto& user_product : user_products) {
+    user_ids.push_back(user_product.user_id);
+  }
+  std::vector<TRoomSnapshot::TUserDetails> users;
+  for (auto& [id, info] : GetUsersInfo(shard_router_.Global(), user_ids)) {
+    users.push_back(
+        {id, std::move(info.full_name), std::move(info.photo_url)});
+  }
+
+  return {std::make_shared<const TRoomSnapshot>(
+              room_id, room_row["name"].As<std::string>(),
+              room_row["user_id"].As<int>(),
+              room_row["version"].As<int64_t>(), std::move(member_ids),
+              std::move(products), std::move(user_products),
+              std::move(users)),
+          nullptr};
+}
+
+std::shared_ptr<const TRoomSnapshot> RoomSnapshotCache::LoadConcurrently(
+    int room_id, std::string name, int owner_id, int64_t version) const {
+  namespace pg = userver::storages::postgres;
+  const auto cluster = shard_router_.ForRoom(room_id);
+
+  // Separate statements don't share a snapshot. They run on the primary,
+  // and the version read after them tells whether the room changed while
+  // they ran; every change bumps it.
+  auto [member_ids, products, user_products] = ConcurrentInvoke(
+      "load-room-snapshot",
+      [&] {
+        return CountedExecute(
+                   cluster, pg::ClusterHostType::kMaster,
+                   "SELECT user_id FROM user_rooms WHERE room_id = $1",
+                   room_id)
+            .AsContainer<std::vector<int>>();
+      },
+      [&] {
+        return CountedExecute(cluster, pg::ClusterHostType::kMaster,
+                              "SELECT id, name, COALESCE(price, 0) AS price "
+                              "FROM products "
+                              "WHERE room_id = $1 AND deleted_at IS NULL",
+                              room_id)
+            .AsContainer<std::vector<TRoomSnapshot::TProductRow>>(
+                pg::kRowTag);
+      },
+      [&] {
+        return CountedExecute(cluster, pg::ClusterHostType::kMaster,
+                              "SELECT up.id, up.product_id, up.user_id, "
+                              "up.status = 'PAID' AS paid "
+                              "FROM user_products up "
+                              "WHERE up.room_id = $1",
+                              room_id)
+            .AsContainer<std::vector<TRoomSnapshot::TUserProductRow>>(
+                pg::kRowTag);
+      });
+
+  std::vector<int> user_ids;
+  user_ids.reserve(user_products.size());
+  for (const auto& user_product : user_products) {
+    user_ids.push_back(user_product.user_id);
+  }
+  auto [current_version, users_info] = ConcurrentInvoke(
+      "load-room-snapshot",
+      [&] {
+        return CountedExecute(cluster, pg::ClusterHostType::kMaster,
+                              "SELECT version FROM rooms WHERE id = $1",
+                              room_id)
+            .AsOptionalSingleRow<int64_t>();
+      },
+      [&] { return GetUsersInfo(shard_router_.Global(), user_ids); });
+  if (current_version != version) {
+    return nullptr;
+  }
+
+  std::vector<TRoomSnapshot::TUserDetails> users;
+  for (auto& [id, info] : users_info) {
+    users.push_back(
+        {id, std::move(info.full_name), std::move(info.photo_url)});
+  }
+  return std::make_shared<const TRoomSnapshot>(
+      room_id, std::move(name), owner_id, version, std::move(member_ids),
+      std::move(products), std::move(user_products), std::move(users));
+}
+
+userver::yaml_config::Schema RoomSnapshotCache::GetStaticConfigSchema() {
+  return userver::yaml_config::MergeSchemas<
+      userver::components::LoggableComponentBase>(R"(
+type: object
+description: LRU of columnar room snapshots keyed by room id
+additionalProperties: false
+properties:
+    size:
+        type: integer
+        description: max number of cached rooms, applies to snapshots and to archived rooms separately
+        defaultDescription: 10000
+)");
+}
+
+}  // namespace split_bill
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include <userver/cache/lru_map.hpp>
+#include <userver/components/component_config.hpp>
+#include <userver/components/component_context.hpp>
+#include <userver/components/loggable_component_base.hpp>
+#include <userver/components/static_config_validator.hpp>
+#include <userver/engine/mutex.hpp>
+#include <userver/yaml_config/schema.hpp>
+
+#include "../handlers/lib/single-flight.hpp"
+#include "../models/archived-room.hpp"
+#include "../models/memory-usage.hpp"
+#include "../models/room-snapshot.hpp"
+#include "shard-router.hpp"
+
+namespace split_bill {
+
+// Current version of a room: a snapshot, or the stored responses of an
+// archived room. Both are null if there is no such room.
+struct TCachedRoom {
+  std::shared_ptr<const TRoomSnapshot> snapshot;
+  std::shared_ptr<const TArchivedRoom> archived;
+
+  explicit operator bool() const { return snapshot || archived; }
+  int OwnerId() const {
+    return snapshot ? snapshot->OwnerId() : archived->owner_id;
+  }
+  int64_t Version() const {
+    return snapshot ? snapshot->Version() : archived->version;
+  }
+  bool IsMember(int user_id) const {
+    return snapshot ? snapshot->IsMember(user_id)
+                    : archived->IsMember(user_id);
+  }
+};
+
+struct TRoomCacheMemory {
+  TCacheMemory snapshots;
+  TCacheMemory archived;
+};
+
+// Keeps the latest TRoomSnapshot of recently read rooms. A snapshot is
+// rebuilt only when rooms.version changes, which the schema triggers bump on
+// every write to the room, its members, products or user products.
+// Concurrent reads of the same room share one version probe and load.
+//
+// Archived rooms have no rows to build a snapshot from; their stored
+// responses are cached instead, keyed by the same version.
+class RoomSnapshotCache final
+    : public userver::components::LoggableComponentBase {
+ public:
+  static constexpr std::string_view kName = "room-snapshot-cache";
+
+  RoomSnapshotCache(
+      const userver::components::ComponentConfig& config,
+      const userver::components::ComponentContext& component_context);
+
+  TCachedRoom Get(int room_id) const;
+  // Sizes the cached rooms outside of the cache lock
+  TRoomCacheMemory GetMemoryUsage() const;
+
+  static userver::yaml_config::Schema GetStaticConfigSchema();
+
+ private:
+  TCachedRoom Fetch(int room_id) const;
+  // Reads the rows of the room in one repeatable read transaction
+  TCachedRoom Load(int room_id) const;
+  // Reads the rows of a room that isn't archived concurrently from the
+  // primary, null if the room changed from `version` meanwhile
+  std::shared_ptr<const TRoomSnapshot> LoadConcurrently(
+      int room_id, std::string name, int owner_id, int64_t version) const;
+
+  const ShardRouter& shard_router_;
+
+  mutable SingleFlight<int, TCachedRoom> flight_;
+
+  mutable userver::engine::Mutex mutex_;
+  mutable userver::cache::LruMap<int, std::shared_ptr<const TRoomSnapshot>>
+      snapshots_;
+  mutable userver::cache::LruMap<int, std::shared_ptr<const TArchivedRoom>>
+      archived_;
+};
+
+}  // namespace split_bill
+
+template <>
+inline constexpr bool
+    userver::components::kHasValidate<split_bill::RoomSnapshotCache> = true;
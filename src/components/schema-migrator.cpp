@@ -0,0 +1,930 @@
+#include "schema-migrator.hpp"
+
+#include <initializer_list>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <userver/engine/sleep.hpp>
+#include <userver/logging/log.hpp>
+#include <userver/storages/postgres/exceptions.hpp>
+#include <userver/utils/uuid4.hpp>
+#include <userver/yaml_config/merge_schemas.hpp>
+
+#include "shard-router.hpp"
+
+namespace split_bill {
+
+namespace {
+
+namespace pg = userver::storages::postgres;
+
+// Runs migration statements on one cluster
+class TMigrationRunner final {
+ public:
+  TMigrationRunner(pg::ClusterPtr cluster,
+                   const SchemaMigrator::TSettings& settings)
+      : cluster_(std::move(cluster)),
+        settings_(settings),
+        command_control_(settings.statement_timeout,
+                         settings.statement_timeout) {}
+
+  const SchemaMigrator::TSettings& Settings() const { return settings_; }
+
+  template <typename... Args>
+  pg::ResultSet Execute(const std::string& query, const Args&... args) {
+    return cluster_->Execute(pg::ClusterHostType::kMaster, command_control_,
+                             query, args...);
+  }
+
+  template <typename... Args>
+  bool Exists(const std::string& query, const Args&... args) {
+    return !Execute(query, args...).IsEmpty();
+  }
+
+  // Runs `statements` in one transaction that gives up on lock waits after
+  // `lock-timeout`, so a statement queued behind a long transaction doesn't
+  // block every query queued behind it. Retries the whole transaction.
+  void ExecuteLocked(const std::vector<std::string>& statements) {
+    for (size_t attempt = 1;; ++attempt) {
+      try {
+        auto transaction =
+            cluster_->Begin("schema_migration", pg::TransactionOptions{},
+                            command_control_);
+        transaction.Execute(fmt::format("SET LOCAL lock_timeout = '{}ms'",
+                                        settings_.lock_timeout.count()));
+        for (const auto& statement : statements) {
+          transaction.Execute(statement);
+        }
+        transaction.Commit();
+        return;
+      } catch (const pg::LockNotAvailable& e) {
+        if (attempt >= settings_.lock_retries) {
+          throw;
+        }
+        LOG_WARNING() << "Migration step is waiting for a lock, attempt "
+                      << attempt << ": " << e.what();
+        userver::engine::SleepFor(settings_.lock_timeout * attempt);
+      }
+    }
+  }
+
+  // Builds an index without blocking writes. A build interrupted earlier
+  // leaves an invalid index behind, which is dropped and built again.
+  void CreateIndexConcurrently(std::string_view name, bool unique,
+                               std::string_view definition) {
+    const auto valid = Execute(
+        "SELECT i.indisvalid FROM pg_index i "
+        "JOIN pg_class c ON c.oid = i.indexrelid "
+        "WHERE c.relname = $1",
+        std::string{name});
+    if (!valid.IsEmpty()) {
+      if (valid.AsSingleRow<bool>()) {
+        return;
+      }
+      LOG_WARNING() << "Rebuilding invalid index " << name;
+      DropIndexConcurrently(name);
+    }
+    Execute(fmt::format("CREATE {}INDEX CONCURRENTLY {} {}",
+                        unique ? "UNIQUE " : "", name, definition));
+  }
+
+  void DropIndexConcurrently(std::string_view name) {
+    Execute(fmt::format("DROP INDEX CONCURRENTLY IF EXISTS {}", name));
+  }
+
+  // CONCURRENTLY doesn't apply to partitioned tables. The index is created
+  // invalid on the parent only, built concurrently on every partition as
+  // `name`_p<i> and attached, and turns valid with the last partition.
+  void CreatePartitionedIndex(std::string_view name, bool unique,
+                              std::string_view table,
+                              std::string_view definition) {
+    Execute(fmt::format("CREATE {}INDEX IF NOT EXISTS {} ON ONLY {} {}",
+                        unique ? "UNIQUE " : "", name, table, definition));
+    const auto partitions =
+        Execute(
+            "SELECT c.relname FROM pg_inherits i "
+            "JOIN pg_class c ON c.oid = i.inhrelid "
+            "WHERE i.inhparent = $1::regclass ORDER BY c.relname",
+            std::string{table})
+            .AsContainer<std::vector<std::string>>();
+    for (const auto& partition : partitions) {
+      // products_p3 -> `name`_p3
+      const auto partition_index =
+          fmt::format("{}{}", name, partition.substr(table.size()));
+      CreateIndexConcurrently(partition_index, unique,
+                              fmt::format("ON {} {}", partition, definition));
+      // Attaching an attached index does nothing
+      Execute(fmt::format("ALTER INDEX {} ATTACH PARTITION {}", name,
+                          partition_index));
+    }
+  }
+
+  // Runs `query` with ($1, $2] bounds over every id of `table` existing at
+  // the start, pausing between batches. Rows inserted later are expected to
+  // be handled by a trigger.
+  void Backfill(std::string_view table, const std::string& query) {
+    const auto max_id =
+        Execute(fmt::format("SELECT COALESCE(MAX(id), 0) FROM {}", table))
+            .AsSingleRow<int>();
+    const auto batch_size = static_cast<int>(settings_.batch_size);
+    for (int from = 0; from < max_id; from += batch_size) {
+      Execute(query, from, from + batch_size);
+      userver::engine::SleepFor(settings_.batch_pause);
+    }
+  }
+
+ private:
+  pg::ClusterPtr cluster_;
+  const SchemaMigrator::TSettings& settings_;
+  const pg::CommandControl command_control_;
+};
+
+bool IsUserProductStatusEnum(TMigrationRunner& runner) {
+  return runner.Exists(
+      "SELECT 1 FROM information_schema.columns "
+      "WHERE table_schema = 'public' AND table_name = 'user_products' "
+      "AND column_name = 'status' AND udt_name = 'user_product_status'");
+}
+
+// rooms.version with the triggers bumping it and configure_room_shard(),
+// as the room snapshot cache and shard-router came with them: version 1
+// databases have none of these. Version 2 moves the user_products triggers
+// onto bump_room_version_by_room_id() once user products have a room_id.
+void CreateRoomVersions(TMigrationRunner& runner) {
+  std::vector<std::string> statements{
+      // A constant default is stored in the catalog, the table is not
+      // rewritten
+      "ALTER TABLE rooms "
+      "ADD COLUMN IF NOT EXISTS version int8 NOT NULL DEFAULT 1",
+      "CREATE OR REPLACE FUNCTION bump_room_version_by_room_id() "
+      "RETURNS trigger AS $$ BEGIN "
+      "UPDATE rooms SET version = version + 1 "
+      "WHERE id IN (SELECT room_id FROM changed_rows); "
+      "RETURN NULL; "
+      "END $$ LANGUAGE plpgsql",
+      "CREATE OR REPLACE FUNCTION bump_room_version_by_user_products() "
+      "RETURNS trigger AS $$ BEGIN "
+      "UPDATE rooms SET version = version + 1 "
+      "WHERE id IN (SELECT p.room_id FROM changed_rows c "
+      "             JOIN products p ON p.id = c.product_id); "
+      "RETURN NULL; "
+      "END $$ LANGUAGE plpgsql",
+      "CREATE OR REPLACE FUNCTION bump_room_version_on_rename() "
+      "RETURNS trigger AS $$ BEGIN "
+      "NEW.version := OLD.version + 1; "
+      "RETURN NEW; "
+      "END $$ LANGUAGE plpgsql",
+      "DROP TRIGGER IF EXISTS rooms_version_on_rename ON rooms",
+      "CREATE TRIGGER rooms_version_on_rename "
+      "BEFORE UPDATE OF name ON rooms "
+      "FOR EACH ROW WHEN (OLD.name IS DISTINCT FROM NEW.name) "
+      "EXECUTE FUNCTION bump_room_version_on_rename()",
+      "CREATE OR REPLACE FUNCTION configure_room_shard("
+      "    shard_index int, shard_count int) "
+      "RETURNS void AS $$ "
+      "DECLARE seq record; next_id bigint; "
+      "BEGIN "
+      "FOR seq IN "
+      "  SELECT s.sequencename, s.increment_by, t.table_name "
+      "  FROM pg_sequences s "
+      "  JOIN (VALUES ('rooms_id_seq', 'rooms'), "
+      "               ('products_id_seq', 'products'), "
+      "               ('user_products_id_seq', 'user_products')) "
+      "      AS t(sequence_name, table_name) "
+      "      ON s.sequencename = t.sequence_name "
+      "  WHERE s.schemaname = 'public' "
+      "LOOP "
+      "  CONTINUE WHEN seq.increment_by = shard_count; "
+      "  EXECUTE format('SELECT COALESCE(MAX(id), 0) FROM %I', "
+      "                 seq.table_name) INTO next_id; "
+      "  next_id := next_id + 1 + ((shard_index - next_id) % shard_count "
+      "                            + shard_count) % shard_count; "
+      "  EXECUTE format('ALTER SEQUENCE %I INCREMENT BY %s RESTART WITH %s', "
+      "                 seq.sequencename, shard_count, next_id); "
+      "END LOOP; "
+      "END $$ LANGUAGE plpgsql",
+  };
+  for (const auto& [table, event, transition, function] :
+       std::initializer_list<
+           std::tuple<const char*, const char*, const char*, const char*>>{
+           {"products", "insert", "NEW", "bump_room_version_by_room_id"},
+           {"products", "update", "NEW", "bump_room_version_by_room_id"},
+           {"products", "delete", "OLD", "bump_room_version_by_room_id"},
+           {"user_products", "insert", "NEW",
+            "bump_room_version_by_user_products"},
+           {"user_products", "update", "NEW",
+            "bump_room_version_by_user_products"},
+           {"user_products", "delete", "OLD",
+            "bump_room_version_by_user_products"},
+           {"user_rooms", "insert", "NEW", "bump_room_version_by_room_id"},
+           {"user_rooms", "delete", "OLD", "bump_room_version_by_room_id"},
+       }) {
+    statements.push_back(fmt::format(
+        "DROP TRIGGER IF EXISTS {0}_version_on_{1} ON {0}", table, event));
+    statements.push_back(fmt::format(
+        "CREATE TRIGGER {0}_version_on_{1} "
+        "AFTER {1} ON {0} REFERENCING {2} TABLE AS changed_rows "
+        "FOR EACH STATEMENT EXECUTE FUNCTION {3}()",
+        table, event, transition, function));
+  }
+  runner.ExecuteLocked(statements);
+}
+
+// Version 2: user_products.status becomes an enum, user products get a
+// denormalized room_id, a unique (user_id, product_id) pair and covering
+// indexes for the per-room reads, indexes nothing uses are dropped.
+void MigrateToCompactSchema(TMigrationRunner& runner,
+                            SchemaMigrator::TRoles roles) {
+  if (roles.users) {
+    // Duplicates the index behind UNIQUE (username)
+    runner.DropIndexConcurrently("idx_users_username");
+    // Can't serve the substring search on full_name
+    runner.DropIndexConcurrently("idx_users_full_name");
+  }
+  if (!roles.rooms) {
+    return;
+  }
+  if (!runner.Exists("SELECT 1 FROM information_schema.columns "
+                     "WHERE table_schema = 'public' AND table_name = 'rooms' "
+                     "AND column_name = 'version'")) {
+    CreateRoomVersions(runner);
+  }
+
+  runner.Execute(
+      "DO $$ BEGIN "
+      "CREATE TYPE user_product_status AS ENUM ('UNPAID', 'PAID'); "
+      "EXCEPTION WHEN duplicate_object THEN NULL; "
+      "END $$");
+
+  if (!IsUserProductStatusEnum(runner)) {
+    // New columns are filled by a trigger for new writes and by the backfill
+    // for existing rows, and swapped in once both are complete
+    runner.ExecuteLocked({
+        "ALTER TABLE user_products "
+        "ADD COLUMN IF NOT EXISTS status_v2 user_product_status, "
+        "ADD COLUMN IF NOT EXISTS room_id int4",
+        "CREATE OR REPLACE FUNCTION user_products_migrate_v2() "
+        "RETURNS trigger AS $$ BEGIN "
+        "NEW.status_v2 := "
+        "    COALESCE(NEW.status, 'UNPAID')::user_product_status; "
+        "NEW.room_id := (SELECT room_id FROM products "
+        "                WHERE id = NEW.product_id); "
+        "RETURN NEW; "
+        "END $$ LANGUAGE plpgsql",
+        "DROP TRIGGER IF EXISTS user_products_migrate_v2 ON user_products",
+        "CREATE TRIGGER user_products_migrate_v2 "
+        "BEFORE INSERT OR UPDATE ON user_products "
+        "FOR EACH ROW EXECUTE FUNCTION user_products_migrate_v2()",
+    });
+    runner.Backfill(
+        "user_products",
+        "UPDATE user_products up "
+        "SET status_v2 = "
+        "        COALESCE(up.status, 'UNPAID')::user_product_status, "
+        "    room_id = p.room_id "
+        "FROM products p "
+        "WHERE p.id = up.product_id AND up.id > $1 AND up.id <= $2 "
+        "AND (up.status_v2 IS NULL OR up.room_id IS NULL)");
+
+    // Add-user-to-product used to check for an existing pair and then
+    // insert, which let concurrent requests insert the pair twice
+    for (size_t attempt = 1;; ++attempt) {
+      runner.Execute(
+          "DELETE FROM user_products a USING user_products b "
+          "WHERE a.user_id = b.user_id AND a.product_id = b.product_id "
+          "AND a.id > b.id");
+      try {
+        runner.CreateIndexConcurrently(
+            "user_products_user_id_product_id_key", true,
+            "ON user_products (user_id, product_id)");
+        break;
+      } catch (const pg::UniqueViolation&) {
+        // A duplicate was inserted by an old instance during the build
+        if (attempt >= runner.Settings().lock_retries) {
+          throw;
+        }
+        runner.DropIndexConcurrently("user_products_user_id_product_id_key");
+      }
+    }
+    if (!runner.Exists(
+            "SELECT 1 FROM pg_constraint "
+            "WHERE conname = 'user_products_user_id_product_id_key'")) {
+      runner.ExecuteLocked({
+          "ALTER TABLE user_products "
+          "ADD CONSTRAINT user_products_user_id_product_id_key "
+          "UNIQUE USING INDEX user_products_user_id_product_id_key",
+      });
+    }
+
+    runner.CreateIndexConcurrently(
+        "idx_user_products_room", false,
+        "ON user_products (room_id, product_id) INCLUDE (user_id, status_v2)");
+
+    // Lets SET NOT NULL below skip the full table scan
+    if (!runner.Exists("SELECT 1 FROM pg_constraint "
+                       "WHERE conname = 'user_products_v2_not_null'")) {
+      runner.ExecuteLocked({
+          "ALTER TABLE user_products ADD CONSTRAINT user_products_v2_not_null "
+          "CHECK (status_v2 IS NOT NULL AND room_id IS NOT NULL) NOT VALID",
+      });
+    }
+    runner.ExecuteLocked({
+        "ALTER TABLE user_products VALIDATE CONSTRAINT "
+        "user_products_v2_not_null",
+    });
+
+    runner.ExecuteLocked({
+        "DROP TRIGGER user_products_migrate_v2 ON user_products",
+        "DROP FUNCTION user_products_migrate_v2()",
+        "ALTER TABLE user_products RENAME COLUMN status TO status_legacy",
+        "ALTER TABLE user_products RENAME COLUMN status_v2 TO status",
+        "ALTER TABLE user_products "
+        "ALTER COLUMN status SET DEFAULT 'UNPAID', "
+        "ALTER COLUMN status SET NOT NULL, "
+        "ALTER COLUMN room_id SET NOT NULL",
+        "ALTER TABLE user_products "
+        "DROP CONSTRAINT user_products_v2_not_null, "
+        "DROP COLUMN status_legacy",
+        "CREATE OR REPLACE FUNCTION user_products_set_room_id() "
+        "RETURNS trigger AS $$ BEGIN "
+        "NEW.room_id := (SELECT room_id FROM products "
+        "                WHERE id = NEW.product_id); "
+        "RETURN NEW; "
+        "END $$ LANGUAGE plpgsql",
+        "CREATE TRIGGER user_products_room_id "
+        "BEFORE INSERT OR UPDATE OF product_id ON user_products "
+        "FOR EACH ROW EXECUTE FUNCTION user_products_set_room_id()",
+        "DROP TRIGGER IF EXISTS user_products_version_on_insert "
+        "ON user_products",
+        "CREATE TRIGGER user_products_version_on_insert "
+        "AFTER INSERT ON user_products "
+        "REFERENCING NEW TABLE AS changed_rows "
+        "FOR EACH STATEMENT EXECUTE FUNCTION bump_room_version_by_room_id()",
+        "DROP TRIGGER IF EXISTS user_products_version_on_update "
+        "ON user_products",
+        "CREATE TRIGGER user_products_version_on_update "
+        "AFTER UPDATE ON user_products "
+        "REFERENCING NEW TABLE AS changed_rows "
+        "FOR EACH STATEMENT EXECUTE FUNCTION bump_room_version_by_room_id()",
+        "DROP TRIGGER IF EXISTS user_products_version_on_delete "
+        "ON user_products",
+        "CREATE TRIGGER user_products_version_on_delete "
+        "AFTER DELETE ON user_products "
+        "REFERENCING OLD TABLE AS changed_rows "
+        "FOR EACH STATEMENT EXECUTE FUNCTION bump_room_version_by_room_id()",
+        "DROP FUNCTION IF EXISTS bump_room_version_by_user_products()",
+    });
+  }
+
+  runner.CreateIndexConcurrently("idx_products_room", false,
+                                 "ON products (room_id) INCLUDE (name, price)");
+
+  // Covered by the primary keys, the unique pair or the indexes above
+  for (const auto index :
+       {"idx_user_products_user_id", "idx_user_products_user_product",
+        "idx_user_products_status", "idx_products_room_id",
+        "idx_user_rooms_user_id"}) {
+    runner.DropIndexConcurrently(index);
+  }
+
+  // Keeps rows of a room together whenever the tables get clustered
+  runner.ExecuteLocked({
+      "ALTER TABLE user_products CLUSTER ON idx_user_products_room",
+      "ALTER TABLE products CLUSTER ON idx_products_room",
+  });
+  if (runner.Settings().cluster_tables) {
+    LOG_INFO() << "Clustering room tables, writes are blocked meanwhile";
+    runner.Execute("CLUSTER user_products");
+    runner.Execute("CLUSTER products");
+  }
+}
+
+bool IsPartitioned(TMigrationRunner& runner, const std::string& table) {
+  return runner.Exists(
+      "SELECT 1 FROM pg_partitioned_table pt "
+      "JOIN pg_class c ON c.oid = pt.partrelid "
+      "WHERE c.relname = $1 AND c.relnamespace = 'public'::regnamespace",
+      table);
+}
+
+// Creates hash partitions `table`_p0 .. `table`_p{n-1} of `table`
+std::string CreateHashPartitions(std::string_view table, size_t partitions) {
+  return fmt::format(
+      "DO $$ BEGIN "
+      "FOR i IN 0..{1} LOOP "
+      "EXECUTE format('CREATE TABLE IF NOT EXISTS {0}_p%s PARTITION OF {0} "
+      "FOR VALUES WITH (MODULUS {2}, REMAINDER %s)', i, i); "
+      "END LOOP; "
+      "END $$",
+      table, partitions - 1, partitions);
+}
+
+// Renames partitions `table`_v3_p* of `table` to `table`_p*
+std::string RenamePartitions(std::string_view table) {
+  return fmt::format(
+      "DO $$ DECLARE partition record; BEGIN "
+      "FOR partition IN SELECT c.relname FROM pg_inherits i "
+      "JOIN pg_class c ON c.oid = i.inhrelid "
+      "WHERE i.inhparent = '{0}'::regclass LOOP "
+      "EXECUTE format('ALTER TABLE %I RENAME TO %I', partition.relname, "
+      "replace(partition.relname, '{0}_v3_p', '{0}_p')); "
+      "END LOOP; "
+      "END $$",
+      table);
+}
+
+// Version 3: products and user_products become hash partitioned by room_id.
+//
+// Partitioned copies (`*_v3`) are created next to the live tables, every
+// write to a live table is mirrored into its copy by a trigger and existing
+// rows are copied in id ranges. Once both copies are complete they replace
+// the live tables in one short transaction.
+void MigrateToPartitionedTables(TMigrationRunner& runner,
+                                SchemaMigrator::TRoles roles) {
+  if (!roles.rooms || IsPartitioned(runner, "products")) {
+    return;
+  }
+  const auto partitions = runner.Settings().partitions;
+
+  runner.ExecuteLocked({
+      "CREATE TABLE IF NOT EXISTS products_v3 "
+      "(id int4 NOT NULL DEFAULT nextval('products_id_seq'), "
+      " name varchar(255) NOT NULL, "
+      " price bigint, "
+      " room_id int4 NOT NULL "
+      "     CONSTRAINT products_v3_room_id_fkey REFERENCES rooms(id) "
+      "     ON DELETE CASCADE, "
+      " CONSTRAINT products_v3_pkey PRIMARY KEY (room_id, id), "
+      " CONSTRAINT products_v3_name_room_id_key UNIQUE (name, room_id)) "
+      "PARTITION BY HASH (room_id)",
+      CreateHashPartitions("products_v3", partitions),
+      fmt::format(
+          "CREATE TABLE IF NOT EXISTS user_products_v3 "
+          "(id int4 NOT NULL DEFAULT nextval('user_products_id_seq'), "
+          " status user_product_status NOT NULL DEFAULT 'UNPAID', "
+          " product_id int4 NOT NULL, "
+          " user_id int4 NOT NULL{}, "
+          " room_id int4 NOT NULL, "
+          " CONSTRAINT user_products_v3_pkey PRIMARY KEY (room_id, id), "
+          " CONSTRAINT user_products_v3_room_id_user_id_product_id_key "
+          "     UNIQUE (room_id, user_id, product_id), "
+          " CONSTRAINT user_products_v3_room_id_product_id_fkey "
+          "     FOREIGN KEY (room_id, product_id) "
+          "     REFERENCES products_v3 (room_id, id) ON DELETE CASCADE) "
+          "PARTITION BY HASH (room_id)",
+          // Users live on the global cluster only
+          roles.users ? " CONSTRAINT user_products_v3_user_id_fkey "
+                        "REFERENCES users(id) ON DELETE CASCADE"
+                      : ""),
+      CreateHashPartitions("user_products_v3", partitions),
+      // Building indexes of empty partitioned tables takes no time
+      "CREATE INDEX IF NOT EXISTS idx_products_v3_room "
+      "ON products_v3 (room_id) INCLUDE (name, price)",
+      "CREATE INDEX IF NOT EXISTS idx_products_v3_name ON products_v3 (name)",
+      "CREATE INDEX IF NOT EXISTS idx_user_products_v3_room "
+      "ON user_products_v3 (room_id, product_id) INCLUDE (user_id, status)",
+      "CREATE INDEX IF NOT EXISTS idx_user_products_v3_user "
+      "ON user_products_v3 (user_id)",
+      "CREATE TABLE IF NOT EXISTS product_rooms "
+      "(id int4 PRIMARY KEY, room_id int4 NOT NULL)",
+      "CREATE TABLE IF NOT EXISTS user_product_rooms "
+      "(id int4 PRIMARY KEY, room_id int4 NOT NULL)",
+      "CREATE OR REPLACE FUNCTION sync_room_lookup() "
+      "RETURNS trigger AS $$ BEGIN "
+      "IF TG_OP = 'INSERT' THEN "
+      "  EXECUTE format('INSERT INTO %I SELECT id, room_id FROM changed_rows', "
+      "                 TG_ARGV[0]); "
+      "ELSE "
+      "  EXECUTE format('DELETE FROM %I l USING changed_rows c "
+      "                  WHERE l.id = c.id', TG_ARGV[0]); "
+      "END IF; "
+      "RETURN NULL; "
+      "END $$ LANGUAGE plpgsql",
+      "DROP TRIGGER IF EXISTS products_lookup_on_insert ON products_v3",
+      "CREATE TRIGGER products_lookup_on_insert "
+      "AFTER INSERT ON products_v3 REFERENCING NEW TABLE AS changed_rows "
+      "FOR EACH STATEMENT EXECUTE FUNCTION sync_room_lookup('product_rooms')",
+      "DROP TRIGGER IF EXISTS products_lookup_on_delete ON products_v3",
+      "CREATE TRIGGER products_lookup_on_delete "
+      "AFTER DELETE ON products_v3 REFERENCING OLD TABLE AS changed_rows "
+      "FOR EACH STATEMENT EXECUTE FUNCTION sync_room_lookup('product_rooms')",
+      "DROP TRIGGER IF EXISTS user_products_lookup_on_insert "
+      "ON user_products_v3",
+      "CREATE TRIGGER user_products_lookup_on_insert "
+      "AFTER INSERT ON user_products_v3 REFERENCING NEW TABLE AS changed_rows "
+      "FOR EACH STATEMENT "
+      "EXECUTE FUNCTION sync_room_lookup('user_product_rooms')",
+      "DROP TRIGGER IF EXISTS user_products_lookup_on_delete "
+      "ON user_products_v3",
+      "CREATE TRIGGER user_products_lookup_on_delete "
+      "AFTER DELETE ON user_products_v3 REFERENCING OLD TABLE AS changed_rows "
+      "FOR EACH STATEMENT "
+      "EXECUTE FUNCTION sync_room_lookup('user_product_rooms')",
+
+      "CREATE OR REPLACE FUNCTION products_mirror_v3() "
+      "RETURNS trigger AS $$ BEGIN "
+      "IF TG_OP = 'DELETE' THEN "
+      "  DELETE FROM products_v3 WHERE room_id = OLD.room_id AND id = OLD.id; "
+      "  RETURN OLD; "
+      "END IF; "
+      "INSERT INTO products_v3 (id, name, price, room_id) "
+      "VALUES (NEW.id, NEW.name, NEW.price, NEW.room_id) "
+      "ON CONFLICT (room_id, id) DO UPDATE "
+      "SET name = EXCLUDED.name, price = EXCLUDED.price; "
+      "RETURN NEW; "
+      "END $$ LANGUAGE plpgsql",
+      "DROP TRIGGER IF EXISTS products_mirror_v3 ON products",
+      "CREATE TRIGGER products_mirror_v3 "
+      "AFTER INSERT OR UPDATE OR DELETE ON products "
+      "FOR EACH ROW EXECUTE FUNCTION products_mirror_v3()",
+  });
+  // Row locks make a concurrent delete either wait for the copied row, or
+  // commit first so that the row is skipped
+  runner.Backfill("products",
+                  "INSERT INTO products_v3 (id, name, price, room_id) "
+                  "SELECT id, name, price, room_id FROM products "
+                  "WHERE id > $1 AND id <= $2 FOR SHARE "
+                  "ON CONFLICT DO NOTHING");
+
+  // Mirrored only now: every product a user product refers to is copied
+  runner.ExecuteLocked({
+      "CREATE OR REPLACE FUNCTION user_products_mirror_v3() "
+      "RETURNS trigger AS $$ BEGIN "
+      "IF TG_OP = 'DELETE' THEN "
+      "  DELETE FROM user_products_v3 "
+      "  WHERE room_id = OLD.room_id AND id = OLD.id; "
+      "  RETURN OLD; "
+      "END IF; "
+      "INSERT INTO user_products_v3 (id, status, product_id, user_id, room_id) "
+      "VALUES (NEW.id, NEW.status, NEW.product_id, NEW.user_id, NEW.room_id) "
+      "ON CONFLICT (room_id, id) DO UPDATE "
+      "SET status = EXCLUDED.status, product_id = EXCLUDED.product_id, "
+      "    user_id = EXCLUDED.user_id; "
+      "RETURN NEW; "
+      "END $$ LANGUAGE plpgsql",
+      "DROP TRIGGER IF EXISTS user_products_mirror_v3 ON user_products",
+      "CREATE TRIGGER user_products_mirror_v3 "
+      "AFTER INSERT OR UPDATE OR DELETE ON user_products "
+      "FOR EACH ROW EXECUTE FUNCTION user_products_mirror_v3()",
+  });
+  runner.Backfill(
+      "user_products",
+      "INSERT INTO user_products_v3 (id, status, product_id, user_id, room_id) "
+      "SELECT id, status, product_id, user_id, room_id FROM user_products "
+      "WHERE id > $1 AND id <= $2 FOR SHARE "
+      "ON CONFLICT DO NOTHING");
+
+  std::vector<std::string> swap{
+      "LOCK TABLE products, user_products, products_v3, user_products_v3 "
+      "IN ACCESS EXCLUSIVE MODE",
+      "ALTER TABLE user_products RENAME TO user_products_v2",
+      "ALTER TABLE products RENAME TO products_v2",
+      // The sequences would be dropped with the tables owning them
+      "ALTER SEQUENCE products_id_seq OWNED BY products_v3.id",
+      "ALTER SEQUENCE user_products_id_seq OWNED BY user_products_v3.id",
+      "DROP TABLE user_products_v2",
+      "DROP TABLE products_v2",
+      "DROP FUNCTION products_mirror_v3()",
+      "DROP FUNCTION user_products_mirror_v3()",
+      "DROP FUNCTION IF EXISTS user_products_set_room_id()",
+      "ALTER TABLE products_v3 RENAME TO products",
+      "ALTER TABLE user_products_v3 RENAME TO user_products",
+      RenamePartitions("products"),
+      RenamePartitions("user_products"),
+  };
+  for (const auto& [table, from, to] :
+       std::initializer_list<std::tuple<const char*, const char*,
+                                        const char*>>{
+           {"products", "products_v3_pkey", "products_pkey"},
+           {"products", "products_v3_name_room_id_key",
+            "products_name_room_id_key"},
+           {"products", "products_v3_room_id_fkey", "products_room_id_fkey"},
+           {"user_products", "user_products_v3_pkey", "user_products_pkey"},
+           {"user_products", "user_products_v3_room_id_user_id_product_id_key",
+            "user_products_room_id_user_id_product_id_key"},
+           {"user_products", "user_products_v3_room_id_product_id_fkey",
+            "user_products_room_id_product_id_fkey"},
+       }) {
+    swap.push_back(fmt::format("ALTER TABLE {} RENAME CONSTRAINT {} TO {}",
+                               table, from, to));
+  }
+  if (roles.users) {
+    swap.push_back(
+        "ALTER TABLE user_products RENAME CONSTRAINT "
+        "user_products_v3_user_id_fkey TO user_products_user_id_fkey");
+  }
+  for (const auto& [from, to] :
+       std::initializer_list<std::pair<const char*, const char*>>{
+           {"idx_products_v3_room", "idx_products_room"},
+           {"idx_products_v3_name", "idx_products_name"},
+           {"idx_user_products_v3_room", "idx_user_products_room"},
+           {"idx_user_products_v3_user", "idx_user_products_user"},
+       }) {
+    swap.push_back(fmt::format("ALTER INDEX {} RENAME TO {}", from, to));
+  }
+  for (const auto table : {"products", "user_products"}) {
+    for (const auto& [event, transition] :
+         std::initializer_list<std::pair<const char*, const char*>>{
+             {"insert", "NEW"}, {"update", "NEW"}, {"delete", "OLD"}}) {
+      swap.push_back(fmt::format(
+          "CREATE TRIGGER {0}_version_on_{1} "
+          "AFTER {1} ON {0} REFERENCING {2} TABLE AS changed_rows "
+          "FOR EACH STATEMENT EXECUTE FUNCTION bump_room_version_by_room_id()",
+          table, event, transition));
+    }
+  }
+  runner.ExecuteLocked(swap);
+}
+
+// Version 4: settled rooms are moved out of products and user_products into
+// room_archive by room-archiver and moved back once they are edited.
+void MigrateToRoomArchive(TMigrationRunner& runner,
+                          SchemaMigrator::TRoles roles) {
+  if (!roles.rooms) {
+    return;
+  }
+  // A constant default is stored in the catalog, the table is not rewritten
+  runner.ExecuteLocked({
+      "ALTER TABLE rooms "
+      "ADD COLUMN IF NOT EXISTS archived boolean NOT NULL DEFAULT false",
+      "CREATE TABLE IF NOT EXISTS room_archive "
+      "(room_id int4 PRIMARY KEY REFERENCES rooms(id) ON DELETE CASCADE, "
+      " archived_at timestamptz NOT NULL DEFAULT now(), "
+      " details bytea NOT NULL, "
+      " calculation bytea NOT NULL, "
+      " summary bytea NOT NULL, "
+      " room_rows jsonb NOT NULL)",
+      "ALTER TABLE room_archive "
+      "ALTER COLUMN details SET STORAGE EXTERNAL, "
+      "ALTER COLUMN calculation SET STORAGE EXTERNAL, "
+      "ALTER COLUMN summary SET STORAGE EXTERNAL",
+      "CREATE OR REPLACE FUNCTION is_archiving() "
+      "RETURNS boolean AS $$ "
+      "SELECT COALESCE(current_setting('split_bill.archiving', true) = 'on', "
+      "                false) "
+      "$$ LANGUAGE sql STABLE",
+      "CREATE OR REPLACE FUNCTION unarchive_room(target_room_id int4) "
+      "RETURNS void AS $$ "
+      "DECLARE restored jsonb; "
+      "BEGIN "
+      "DELETE FROM room_archive WHERE room_id = target_room_id "
+      "RETURNING room_rows INTO restored; "
+      "IF restored IS NULL THEN RETURN; END IF; "
+      "UPDATE rooms SET archived = false, version = version + 1 "
+      "WHERE id = target_room_id; "
+      "INSERT INTO products (id, name, price, room_id) "
+      "SELECT id, name, price, target_room_id "
+      "FROM jsonb_to_recordset(restored->'products') "
+      "    AS p(id int4, name varchar(255), price bigint); "
+      "INSERT INTO user_products (id, status, product_id, user_id, room_id) "
+      "SELECT id, status, product_id, user_id, target_room_id "
+      "FROM jsonb_to_recordset(restored->'user_products') "
+      "    AS up(id int4, status user_product_status, product_id int4, "
+      "          user_id int4); "
+      "END $$ LANGUAGE plpgsql",
+      "CREATE OR REPLACE FUNCTION bump_room_version_by_room_id() "
+      "RETURNS trigger AS $$ "
+      "DECLARE changed record; "
+      "BEGIN "
+      "IF is_archiving() THEN RETURN NULL; END IF; "
+      "FOR changed IN "
+      "  UPDATE rooms SET version = version + 1 "
+      "  WHERE id IN (SELECT room_id FROM changed_rows) "
+      "  RETURNING id, archived "
+      "LOOP "
+      "  IF changed.archived THEN "
+      "    PERFORM unarchive_room(changed.id); "
+      "  END IF; "
+      "END LOOP; "
+      "RETURN NULL; "
+      "END $$ LANGUAGE plpgsql",
+      "CREATE OR REPLACE FUNCTION sync_room_lookup() "
+      "RETURNS trigger AS $$ BEGIN "
+      "IF TG_OP = 'INSERT' THEN "
+      "  EXECUTE format('INSERT INTO %I SELECT id, room_id FROM changed_rows "
+      "                  ON CONFLICT (id) DO NOTHING', TG_ARGV[0]); "
+      "ELSIF NOT is_archiving() THEN "
+      "  EXECUTE format('DELETE FROM %I l USING changed_rows c "
+      "                  WHERE l.id = c.id', TG_ARGV[0]); "
+      "END IF; "
+      "RETURN NULL; "
+      "END $$ LANGUAGE plpgsql",
+      "CREATE OR REPLACE FUNCTION unarchive_renamed_room() "
+      "RETURNS trigger AS $$ BEGIN "
+      "PERFORM unarchive_room(NEW.id); "
+      "RETURN NULL; "
+      "END $$ LANGUAGE plpgsql",
+      "DROP TRIGGER IF EXISTS rooms_unarchive_on_rename ON rooms",
+      "CREATE TRIGGER rooms_unarchive_on_rename "
+      "AFTER UPDATE OF name ON rooms "
+      "FOR EACH ROW WHEN (NEW.archived AND OLD.name IS DISTINCT FROM NEW.name) "
+      "EXECUTE FUNCTION unarchive_renamed_room()",
+  });
+}
+
+// Version 5: idempotency_keys for IdempotencyStore
+void MigrateToIdempotencyKeys(TMigrationRunner& runner,
+                              SchemaMigrator::TRoles roles) {
+  if (!roles.users) {
+    return;
+  }
+  runner.ExecuteLocked({
+      "CREATE TABLE IF NOT EXISTS idempotency_keys "
+      "(user_id int4 REFERENCES users(id) ON DELETE CASCADE NOT NULL, "
+      " key varchar(255) NOT NULL, "
+      " request_hash text NOT NULL, "
+      " status int2, "
+      " response text, "
+      " created_at timestamptz NOT NULL DEFAULT now(), "
+      " PRIMARY KEY (user_id, key))",
+      "CREATE INDEX IF NOT EXISTS idempotency_keys_created_at_idx "
+      "ON idempotency_keys (created_at)",
+  });
+}
+
+// Version 6: products are deleted by setting deleted_at, which hides them
+// at once, and purged with their user products by product-reaper. Names
+// only have to be unique among the products not deleted yet.
+void MigrateToSoftDelete(TMigrationRunner& runner,
+                         SchemaMigrator::TRoles roles) {
+  if (!roles.rooms) {
+    return;
+  }
+  runner.ExecuteLocked({
+      "ALTER TABLE products ADD COLUMN IF NOT EXISTS deleted_at timestamptz",
+  });
+  runner.CreatePartitionedIndex("products_live_name_room_id_key", true,
+                                "products",
+                                "(name, room_id) WHERE deleted_at IS NULL");
+  runner.CreatePartitionedIndex(
+      "idx_products_deleted", false, "products",
+      "(deleted_at, room_id, id) WHERE deleted_at IS NOT NULL");
+  runner.ExecuteLocked({
+      "ALTER TABLE products "
+      "DROP CONSTRAINT IF EXISTS products_name_room_id_key",
+  });
+}
+
+struct TMigration {
+  int version;
+  void (*migrate)(TMigrationRunner&, SchemaMigrator::TRoles);
+};
+
+// Version 1 is the schema the service was first deployed with, without
+// rooms.version: version 2 adds it first
+constexpr TMigration kMigrations[] = {
+    {2, &MigrateToCompactSchema},
+    {3, &MigrateToPartitionedTables},
+    {4, &MigrateToRoomArchive},
+    {5, &MigrateToIdempotencyKeys},
+    {6, &MigrateToSoftDelete},
+};
+
+}  // namespace
+
+SchemaMigrator::SchemaMigrator(
+    const userver::components::ComponentConfig& config,
+    const userver::components::ComponentContext& component_context)
+    : LoggableComponentBase(config, component_context),
+      settings_{
+          config["batch-size"].As<size_t>(5000),
+          config["batch-pause"].As<std::chrono::milliseconds>(50),
+          config["lock-timeout"].As<std::chrono::milliseconds>(2000),
+          config["lock-retries"].As<size_t>(30),
+          config["statement-timeout"].As<std::chrono::milliseconds>(3600000),
+          config["lease-duration"].As<std::chrono::seconds>(1800),
+          config["cluster-tables"].As<bool>(false),
+          config["partitions"].As<size_t>(16),
+      },
+      instance_id_(userver::utils::generators::GenerateUuid()) {
+  const auto& router = component_context.FindComponent<ShardRouter>();
+
+  // The global cluster may double as a room shard
+  std::vector<std::pair<pg::ClusterPtr, TRoles>> clusters{
+      {router.Global(), TRoles{true, false}}};
+  for (const auto& shard : router.AllShards()) {
+    if (shard == router.Global()) {
+      clusters.front().second.rooms = true;
+    } else {
+      clusters.push_back({shard, TRoles{false, true}});
+    }
+  }
+
+  for (const auto& [cluster, roles] : clusters) {
+    Migrate(cluster, roles);
+  }
+}
+
+void SchemaMigrator::Migrate(const pg::ClusterPtr& cluster,
+                             TRoles roles) const {
+  TMigrationRunner runner{cluster, settings_};
+  runner.Execute(
+      "CREATE TABLE IF NOT EXISTS schema_migrations "
+      "(version int4 PRIMARY KEY, "
+      " applied_at timestamptz NOT NULL DEFAULT now())");
+  runner.Execute(
+      "CREATE TABLE IF NOT EXISTS schema_migration_lease "
+      "(id int4 PRIMARY KEY CHECK (id = 1), "
+      " holder text NOT NULL, "
+      " expires_at timestamptz NOT NULL)");
+
+  const auto current_version = [&runner] {
+    return runner
+        .Execute("SELECT COALESCE(MAX(version), 1) FROM schema_migrations")
+        .AsSingleRow<int>();
+  };
+  // Also renews the lease this instance already holds
+  const auto take_lease = [this, &runner] {
+    return runner.Exists(
+        "INSERT INTO schema_migration_lease AS l (id, holder, expires_at) "
+        "VALUES (1, $1, now() + make_interval(secs => $2)) "
+        "ON CONFLICT (id) DO UPDATE "
+        "SET holder = EXCLUDED.holder, expires_at = EXCLUDED.expires_at "
+        "WHERE l.expires_at < now() OR l.holder = EXCLUDED.holder "
+        "RETURNING id",
+        instance_id_,
+        static_cast<double>(settings_.lease_duration.count()));
+  };
+
+  const auto latest_version = std::end(kMigrations)[-1].version;
+  if (current_version() >= latest_version) {
+    return;
+  }
+  while (!take_lease()) {
+    LOG_INFO() << "Waiting for another instance to migrate the schema";
+    userver::engine::SleepFor(std::chrono::seconds{5});
+    if (current_version() >= latest_version) {
+      return;
+    }
+  }
+
+  for (const auto& migration : kMigrations) {
+    if (current_version() >= migration.version) {
+      continue;
+    }
+    if (!take_lease()) {
+      throw std::runtime_error(
+          "Schema migration lease expired, increase lease-duration");
+    }
+    LOG_INFO() << "Migrating schema to version " << migration.version;
+    migration.migrate(runner, roles);
+    runner.Execute(
+        "INSERT INTO schema_migrations (version) VALUES ($1) "
+        "ON CONFLICT DO NOTHING",
+        migration.version);
+  }
+  runner.Execute("DELETE FROM schema_migration_lease WHERE holder = $1",
+                 instance_id_);
+}
+
+userver::yaml_config::Schema SchemaMigrator::GetStaticConfigSchema() {
+  return userver::yaml_config::MergeSchemas<
+      userver::components::LoggableComponentBase>(R"(
+type: object
+description: applies schema migrations before the server starts
+additionalProperties: false
+properties:
+    batch-size:
+        type: integer
+        description: rows updated per backfill statement
+        defaultDescription: 5000
+    batch-pause:
+        type: string
+        description: pause between backfill statements
+        defaultDescription: 50ms
+    lock-timeout:
+        type: string
+        description: lock_timeout of statements taking exclusive locks
+        defaultDescription: 2s
+    lock-retries:
+        type: integer
+        description: attempts of a step that keeps hitting lock-timeout
+        defaultDescription: 30
+    statement-timeout:
+        type: string
+        description: timeout of index builds and backfill statements
+        defaultDescription: 1h
+    lease-duration:
+        type: string
+        description: how long a crashed instance keeps others from migrating
+        defaultDescription: 30m
+    cluster-tables:
+        type: boolean
+        description: |
+            run CLUSTER on room tables, which blocks reads and writes to them
+            while it runs
+        defaultDescription: false
+    partitions:
+        type: integer
+        description: |
+            hash partitions of products and user_products created when
+            partitioning an existing database
+        defaultDescription: 16
+)");
+}
+
+}  // namespace split_bill
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <string_view>
+
+#include <userver/components/component_config.hpp>
+#include <userver/components/component_context.hpp>
+#include <userver/components/loggable_component_base.hpp>
+#include <userver/components/static_config_validator.hpp>
+#include <userver/storages/postgres/cluster.hpp>
+#include <userver/yaml_config/schema.hpp>
+
+namespace split_bill {
+
+// Brings the global cluster and every room shard up to the latest schema
+// version before the server starts accepting requests.
+//
+// Migrations are written to run against a loaded database: new columns are
+// added without defaults and backfilled in small id ranges, indexes are
+// built CONCURRENTLY, NOT NULL is proven by a validated CHECK constraint, and
+// the few statements needing an exclusive lock run with a short lock_timeout
+// and are retried. Every step is idempotent, so an interrupted migration is
+// resumed by the next start. A lease row keeps concurrently starting
+// instances from migrating the same cluster twice.
+//
+// Fresh databases created from postgresql/schemas and postgresql/shards are
+// already at the latest version.
+class SchemaMigrator final : public userver::components::LoggableComponentBase {
+ public:
+  static constexpr std::string_view kName = "schema-migrator";
+
+  SchemaMigrator(
+      const userver::components::ComponentConfig& config,
+      const userver::components::ComponentContext& component_context);
+
+  static userver::yaml_config::Schema GetStaticConfigSchema();
+
+  struct TSettings {
+    size_t batch_size;
+    std::chrono::milliseconds batch_pause;
+    std::chrono::milliseconds lock_timeout;
+    size_t lock_retries;
+    std::chrono::milliseconds statement_timeout;
+    std::chrono::seconds lease_duration;
+    // Physically reorder room tables by room (takes exclusive locks)
+    bool cluster_tables;
+    // Hash partitions of products and user_products
+    size_t partitions;
+  };
+
+  // What a cluster stores
+  struct TRoles {
+    bool users;
+    bool rooms;
+  };
+
+ private:
+  void Migrate(const userver::storages::postgres::ClusterPtr& cluster,
+               TRoles roles) const;
+
+  const TSettings settings_;
+  const std::string instance_id_;
+};
+
+}  // namespace split_bill
+
+template <>
+inline constexpr bool
+    userver::components::kHasValidate<split_bill::SchemaMigrator> = true;
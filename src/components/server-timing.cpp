@@ -0,0 +1,141 @@
+#include "server-timing.hpp"
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <userver/engine/mutex.hpp>
+#include <userver/engine/task/inherited_variable.hpp>
+#include <userver/logging/log.hpp>
+#include <userver/logging/log_extra.hpp>
+#include <userver/yaml_config/merge_schemas.hpp>
+
+namespace split_bill {
+
+struct TServerTimings {
+  struct TPhase {
+    std::string_view name;
+    std::chrono::steady_clock::duration time{};
+    size_t count = 0;
+  };
+
+  userver::engine::Mutex mutex;
+  // In the order phases were first recorded, a handful per request
+  std::vector<TPhase> phases;
+};
+
+namespace {
+
+// Inherited by the subtasks a handler starts, such as shard fan-outs
+userver::engine::TaskInheritedVariable<std::shared_ptr<TServerTimings>>
+    kRequestTimings;
+
+TServerTimings* GetRequestTimings() {
+  const auto* timings = kRequestTimings.GetOptional();
+  return timings ? timings->get() : nullptr;
+}
+
+void AddTiming(TServerTimings& timings, std::string_view name,
+               std::chrono::steady_clock::duration time) {
+  std::lock_guard lock(timings.mutex);
+  for (auto& phase : timings.phases) {
+    if (phase.name == name) {
+      phase.time += time;
+      ++phase.count;
+      return;
+    }
+  }
+  timings.phases.push_back({name, time, 1});
+}
+
+double ToMilliseconds(std::chrono::steady_clock::duration time) {
+  return std::chrono::duration<double, std::milli>(time).count();
+}
+
+}  // namespace
+
+void RecordTiming(std::string_view name,
+                  std::chrono::steady_clock::duration time) {
+  if (auto* timings = GetRequestTimings()) {
+    AddTiming(*timings, name, time);
+  }
+}
+
+TTimingScope::TTimingScope(std::string_view name)
+    : name_(name), timings_(GetRequestTimings()) {
+  if (timings_) {
+    start_ = std::chrono::steady_clock::now();
+  }
+}
+
+TTimingScope::~TTimingScope() {
+  if (timings_) {
+    AddTiming(*timings_, name_, std::chrono::steady_clock::now() - start_);
+  }
+}
+
+ServerTiming::TScope::TScope(
+    const userver::server::http::HttpRequest* request)
+    : request_(request) {
+  if (request_) {
+    timings_ = std::make_shared<TServerTimings>();
+    kRequestTimings.Set(timings_);
+    start_ = std::chrono::steady_clock::now();
+  }
+}
+
+ServerTiming::TScope::~TScope() {
+  if (!request_) {
+    return;
+  }
+  const auto total = std::chrono::steady_clock::now() - start_;
+  kRequestTimings.Erase();
+
+  std::string value;
+  for (const auto& phase : timings_->phases) {
+    value += fmt::format("{};dur={:.3f}", phase.name,
+                         ToMilliseconds(phase.time));
+    if (phase.count > 1) {
+      value += fmt::format(";desc=\"{} calls\"", phase.count);
+    }
+    value += ", ";
+  }
+  value += fmt::format("total;dur={:.3f}", ToMilliseconds(total));
+
+  LOG_TRACE() << "Server timing"
+              << userver::logging::LogExtra{
+                     {"path", request_->GetRequestPath()},
+                     {"server_timing", value}};
+  request_->GetHttpResponse().SetHeader(std::string{"Server-Timing"},
+                                        std::move(value));
+}
+
+ServerTiming::ServerTiming(
+    const userver::components::ComponentConfig& config,
+    const userver::components::ComponentContext& component_context)
+    : LoggableComponentBase(config, component_context),
+      enabled_(config["enabled"].As<bool>(false)) {}
+
+ServerTiming::TScope ServerTiming::Track(
+    const userver::server::http::HttpRequest& request) const {
+  const bool asked = enabled_ && request.GetHeader("X-Server-Timing") == "1";
+  return TScope{asked ? &request : nullptr};
+}
+
+userver::yaml_config::Schema ServerTiming::GetStaticConfigSchema() {
+  return userver::yaml_config::MergeSchemas<
+      userver::components::LoggableComponentBase>(R"(
+type: object
+description: per-phase Server-Timing header for requests asking for it
+additionalProperties: false
+properties:
+    enabled:
+        type: boolean
+        description: whether requests may ask for the header
+        defaultDescription: false
+)");
+}
+
+}  // namespace split_bill
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string_view>
+
+#include <userver/components/component_config.hpp>
+#include <userver/components/component_context.hpp>
+#include <userver/components/loggable_component_base.hpp>
+#include <userver/components/static_config_validator.hpp>
+#include <userver/server/http/http_request.hpp>
+#include <userver/yaml_config/schema.hpp>
+
+namespace split_bill {
+
+struct TServerTimings;
+
+// Adds `time` to the phase `name` of the Server-Timing header of the current
+// request, if it asked for one. `name` has to outlive the request, as a
+// literal does.
+void RecordTiming(std::string_view name,
+                  std::chrono::steady_clock::duration time);
+
+// Times the enclosing block as the phase `name`:
+//
+//   {
+//     const TTimingScope timing("serialize");
+//     WriteToStream(room_details, sw);
+//   }
+//
+// A phase timed several times, such as `db` for every query, is summed.
+// Outside of a timed request it only checks that there is none.
+class TTimingScope final {
+ public:
+  explicit TTimingScope(std::string_view name);
+  TTimingScope(const TTimingScope&) = delete;
+  TTimingScope& operator=(const TTimingScope&) = delete;
+  ~TTimingScope();
+
+ private:
+  const std::string_view name_;
+  TServerTimings* timings_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+// Per-phase time breakdown of a request. When `enabled`, a request with an
+// `X-Server-Timing: 1` header is answered with
+//
+//   Server-Timing: admission;dur=0.012, auth;dur=0.843,
+//                  db;dur=2.310;desc="3 calls", ..., total;dur=4.025
+//
+// durations in milliseconds, and the same breakdown is logged at trace
+// level. Phases may overlap: `db` includes the queries of every other one.
+class ServerTiming final : public userver::components::LoggableComponentBase {
+ public:
+  static constexpr std::string_view kName = "server-timing";
+
+  // Times the request while alive and sets the header when destroyed
+  class TScope final {
+   public:
+    TScope(TScope&&) = delete;
+    TScope& operator=(TScope&&) = delete;
+    ~TScope();
+
+   private:
+    friend class ServerTiming;
+    explicit TScope(const userver::server::http::HttpRequest* request);
+
+    const userver::server::http::HttpRequest* request_;
+    std::shared_ptr<TServerTimings> timings_;
+    std::chrono::steady_clock::time_point start_;
+  };
+
+  ServerTiming(const userver::components::ComponentConfig& config,
+               const userver::components::ComponentContext& component_context);
+
+  TScope Track(const userver::server::http::HttpRequest& request) const;
+
+  static userver::yaml_config::Schema GetStaticConfigSchema();
+
+ private:
+  const bool enabled_;
+};
+
+}  // namespace split_bill
+
+template <>
+inline constexpr bool
+    userver::components::kHasValidate<split_bill::ServerTiming> = true;
@@ -0,0 +1,165 @@
+#include "shard-router.hpp"
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <userver/logging/log.hpp>
+#include <userver/storages/postgres/component.hpp>
+#include <userver/utils/assert.hpp>
+#include <userver/yaml_config/merge_schemas.hpp>
+
+namespace split_bill {
+
+ShardRouter::ShardRouter(
+    const userver::components::ComponentConfig& config,
+    const userver::components::ComponentContext& component_context)
+    : LoggableComponentBase(config, component_context),
+      global_(component_context
+                  .FindComponent<userver::components::Postgres>(
+                      config["global"].As<std::string>())
+                  .GetCluster()) {
+  for (const auto& name : config["shards"].As<std::vector<std::string>>()) {
+    shards_.push_back(
+        component_context.FindComponent<userver::components::Postgres>(name)
+            .GetCluster());
+  }
+  UINVARIANT(!shards_.empty(), "shard-router needs at least one shard");
+
+  if (!config["configure-sequences"].As<bool>(true)) {
+    return;
+  }
+  const auto shard_count = static_cast<int>(shards_.size());
+  CheckShardCount(shard_count);
+
+  // A single shard keeps the plain serial sequences, so the default setup
+  // works on an unmodified database.
+  if (shard_count > 1) {
+    for (int shard_index = 0; shard_index < shard_count; ++shard_index) {
+      shards_[shard_index]->Execute(
+          userver::storages::postgres::ClusterHostType::kMaster,
+          "SELECT configure_room_shard($1, $2)", shard_index, shard_count);
+    }
+    LOG_INFO() << "Room data is sharded across " << shard_count
+               << " clusters";
+  }
+}
+
+void ShardRouter::CheckShardCount(int shard_count) const {
+  // The sequences of a configured shard step by the shard count it was
+  // configured for; an unconfigured one steps by 1
+  for (size_t shard_index = 0; shard_index < shards_.size(); ++shard_index) {
+    const auto& shard = shards_[shard_index];
+    const auto increments =
+        shard
+            ->Execute(userver::storages::postgres::ClusterHostType::kMaster,
+                      "SELECT DISTINCT increment_by FROM pg_sequences "
+                      "WHERE schemaname = 'public' AND sequencename IN "
+                      "('rooms_id_seq', 'products_id_seq', "
+                      "'user_products_id_seq')")
+            .AsContainer<std::vector<int64_t>>();
+    bool unconfigured = false;
+    for (const auto increment : increments) {
+      if (increment != 1 && increment != shard_count) {
+        throw std::runtime_error(fmt::format(
+            "Room shard {} was configured for {} shards, not {}: room ids "
+            "would be routed to the wrong shards. Resharding is not "
+            "supported",
+            shard_index, increment, shard_count));
+      }
+      unconfigured |= increment == 1;
+    }
+    if (!unconfigured || shard_count == 1) {
+      continue;
+    }
+
+    // An unconfigured shard may hold the rows of a single-shard deployment,
+    // such as postgres-db-1 switched to several shards
+    const auto misplaced =
+        shard
+            ->Execute(
+                userver::storages::postgres::ClusterHostType::kMaster,
+                "SELECT EXISTS (SELECT 1 FROM rooms "
+                "               WHERE (id - 1) % $1 <> $2) "
+                "    OR EXISTS (SELECT 1 FROM products "
+                "               WHERE (id - 1) % $1 <> $2) "
+                "    OR EXISTS (SELECT 1 FROM user_products "
+                "               WHERE (id - 1) % $1 <> $2)",
+                shard_count, static_cast<int>(shard_index))
+            .AsSingleRow<bool>();
+    if (misplaced) {
+      throw std::runtime_error(fmt::format(
+          "Room shard {} holds rows that belong to other shards of {}: it "
+          "was filled with another shard count. Resharding is not "
+          "supported",
+          shard_index, shard_count));
+    }
+  }
+}
+
+userver::storages::postgres::ClusterPtr ShardRouter::Global() const {
+  return global_;
+}
+
+userver::storages::postgres::ClusterPtr ShardRouter::ForRoom(
+    int room_id) const {
+  return shards_[ShardIndex(room_id)];
+}
+
+userver::storages::postgres::ClusterPtr ShardRouter::ForProduct(
+    int product_id) const {
+  return shards_[ShardIndex(product_id)];
+}
+
+userver::storages::postgres::ClusterPtr ShardRouter::ForUserProduct(
+    int user_product_id) const {
+  return shards_[ShardIndex(user_product_id)];
+}
+
+userver::storages::postgres::ClusterPtr ShardRouter::ForNewRoom(
+    int owner_id) const {
+  return shards_[static_cast<size_t>(owner_id) % shards_.size()];
+}
+
+const std::vector<userver::storages::postgres::ClusterPtr>&
+ShardRouter::AllShards() const {
+  return shards_;
+}
+
+size_t ShardRouter::ShardCount() const { return shards_.size(); }
+
+size_t ShardRouter::ShardIndex(int id) const {
+  // Ids start from 1; anything else can't exist and goes to the first shard
+  if (id <= 0) {
+    return 0;
+  }
+  return static_cast<size_t>(id - 1) % shards_.size();
+}
+
+userver::yaml_config::Schema ShardRouter::GetStaticConfigSchema() {
+  return userver::yaml_config::MergeSchemas<
+      userver::components::LoggableComponentBase>(R"(
+type: object
+description: routes room-scoped data to Postgres shards
+additionalProperties: false
+properties:
+    global:
+        type: string
+        description: Postgres component with users and auth sessions
+    shards:
+        type: array
+        description: Postgres components with room data, in shard order
+        items:
+            type: string
+            description: Postgres component name
+    configure-sequences:
+        type: boolean
+        description: align id sequences of every shard with the shard layout
+        defaultDescription: true
+)");
+}
+
+}  // namespace split_bill
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+#include <userver/components/component_config.hpp>
+#include <userver/components/component_context.hpp>
+#include <userver/components/loggable_component_base.hpp>
+#include <userver/components/static_config_validator.hpp>
+#include <userver/storages/postgres/cluster.hpp>
+#include <userver/yaml_config/schema.hpp>
+
+#include "../handlers/lib/fan-out.hpp"
+
+namespace split_bill {
+
+// Routes room-scoped tables (rooms, user_rooms, products, user_products) to
+// one of N Postgres clusters. Users and auth sessions stay on the global
+// cluster.
+//
+// Every id sequence of shard `k` out of `N` produces ids with
+// `(id - 1) % N == k`, so the shard of a room, product or user product is
+// derived from its id alone. N can't change once rooms exist: startup fails
+// if a shard was configured for a different N.
+class ShardRouter final : public userver::components::LoggableComponentBase {
+ public:
+  static constexpr std::string_view kName = "shard-router";
+
+  ShardRouter(const userver::components::ComponentConfig& config,
+              const userver::components::ComponentContext& component_context);
+
+  // users, auth_sessions
+  userver::storages::postgres::ClusterPtr Global() const;
+
+  userver::storages::postgres::ClusterPtr ForRoom(int room_id) const;
+  userver::storages::postgres::ClusterPtr ForProduct(int product_id) const;
+  userver::storages::postgres::ClusterPtr ForUserProduct(
+      int user_product_id) const;
+
+  // Shard a new room of `owner_id` is created on
+  userver::storages::postgres::ClusterPtr ForNewRoom(int owner_id) const;
+
+  const std::vector<userver::storages::postgres::ClusterPtr>& AllShards()
+      const;
+  size_t ShardCount() const;
+
+  // Runs `func(cluster)` on every shard concurrently and returns the results
+  // in shard order. Takes its slots as ConcurrentInvoke does.
+  template <typename Func>
+  auto FanOut(std::string_view name, const Func& func) const {
+    return ConcurrentMap(name, shards_, func);
+  }
+
+  static userver::yaml_config::Schema GetStaticConfigSchema();
+
+ private:
+  // Throws if a shard was configured for, or holds rows of, another shard
+  // count
+  void CheckShardCount(int shard_count) const;
+  size_t ShardIndex(int id) const;
+
+  userver::storages::postgres::ClusterPtr global_;
+  std::vector<userver::storages::postgres::ClusterPtr> shards_;
+};
+
+}  // namespace split_bill
+
+template <>
+inline constexpr bool
+    userver::components::kHasValidate<split_bill::ShardRouter> = true;
@@ -0,0 +1,262 @@
+#include "traffic-capture.hpp"
+
+#include <array>
+#include <exception>
+#include <mutex>
+#include <utility>
+
+#include <userver/components/statistics_storage.hpp>
+#include <userver/formats/json.hpp>
+#include <userver/logging/log.hpp>
+#include <userver/testsuite/testsuite_support.hpp>
+#include <userver/utils/async.hpp>
+#include <userver/utils/statistics/writer.hpp>
+#include <userver/yaml_config/merge_schemas.hpp>
+
+namespace split_bill {
+
+namespace {
+
+constexpr std::string_view kMagic{"SBTRAFF\x01", 8};
+constexpr uint64_t kBodyOmitted = 1;
+constexpr uint64_t kFailed = 2;
+
+// Headers the response depends on. X-Ya-User-Ticket is left out on purpose.
+constexpr std::array<std::string_view, 5> kCapturedHeaders{
+    "Content-Type", "Accept", "Accept-Encoding", "If-Match",
+    "Idempotency-Key"};
+
+void AppendVarint(std::string& out, uint64_t value) {
+  while (value >= 0x80) {
+    out += static_cast<char>((value & 0x7f) | 0x80);
+    value >>= 7;
+  }
+  out += static_cast<char>(value);
+}
+
+void AppendString(std::string& out, std::string_view value) {
+  AppendVarint(out, value.size());
+  out += value;
+}
+
+uint64_t ToMicroseconds(std::chrono::steady_clock::duration duration) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(duration)
+      .count();
+}
+
+// The body with its password replaced, or nothing if it isn't an object
+std::string SanitizeCredentials(const std::string& body) {
+  try {
+    userver::formats::json::ValueBuilder json(
+        userver::formats::json::FromString(body));
+    if (json.HasMember("password")) {
+      json["password"] = std::string{kReplayPassword};
+    }
+    return userver::formats::json::ToString(json.ExtractValue());
+  } catch (const std::exception&) {
+    return {};
+  }
+}
+
+}  // namespace
+
+TrafficCapture::TScope::TScope(
+    const TrafficCapture* capture,
+    const userver::server::http::HttpRequest& request,
+    std::string_view handler, ECaptureBody body)
+    : capture_(capture),
+      request_(request),
+      handler_(handler),
+      body_(body),
+      start_(std::chrono::steady_clock::now()),
+      uncaught_exceptions_(std::uncaught_exceptions()) {}
+
+TrafficCapture::TScope::~TScope() {
+  if (capture_) {
+    capture_->Append(*this,
+                     std::uncaught_exceptions() > uncaught_exceptions_);
+  }
+}
+
+TrafficCapture::TrafficCapture(
+    const userver::components::ComponentConfig& config,
+    const userver::components::ComponentContext& component_context)
+    : LoggableComponentBase(config, component_context),
+      enabled_(config["enabled"].As<bool>(false)),
+      max_body_size_(config["max-body-size"].As<size_t>(1 << 20)),
+      max_buffer_size_(config["max-buffer-size"].As<size_t>(64 << 20)),
+      max_file_size_(config["max-file-size"].As<uint64_t>(uint64_t{1} << 30)),
+      start_(std::chrono::steady_clock::now()),
+      fs_task_processor_(component_context.GetTaskProcessor(
+          config["fs-task-processor"].As<std::string>("fs-task-processor"))) {
+  if (!enabled_) {
+    return;
+  }
+
+  const auto path = config["file"].As<std::string>();
+  namespace blocking = userver::fs::blocking;
+  file_ = blocking::FileDescriptor::Open(
+      path, {blocking::OpenFlag::kWrite,
+             blocking::OpenFlag::kCreateIfNotExists,
+             blocking::OpenFlag::kTruncate});
+  buffer_ += kMagic;
+  AppendVarint(buffer_,
+               std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+                   .count());
+  file_size_ = buffer_.size();
+  LOG_WARNING() << "Capturing requests to " << path;
+
+  statistics_holder_ =
+      component_context
+          .FindComponent<userver::components::StatisticsStorage>()
+          .GetStorage()
+          .RegisterWriter(
+              "split-bill", [this](userver::utils::statistics::Writer& writer) {
+                auto capture = writer["traffic-capture"];
+                capture["captured"] = captured_.load();
+                capture["dropped"] = dropped_.load();
+                capture["written-bytes"] = written_bytes_.load();
+              });
+
+  flush_task_.Start(
+      "traffic-capture-flush",
+      userver::utils::PeriodicTask::Settings{
+          config["flush-period"].As<std::chrono::milliseconds>(
+              std::chrono::seconds{1})},
+      [this] { Flush(); });
+  flush_task_.RegisterInTestsuite(
+      component_context
+          .FindComponent<userver::components::TestsuiteSupport>()
+          .GetPeriodicTaskControl());
+}
+
+TrafficCapture::~TrafficCapture() {
+  if (!enabled_) {
+    return;
+  }
+  flush_task_.Stop();
+  statistics_holder_.Unregister();
+  try {
+    Flush();
+  } catch (const std::exception& e) {
+    LOG_ERROR() << "Failed to write the last captured requests: "
+                << e.what();
+  }
+}
+
+TrafficCapture::TScope TrafficCapture::Track(
+    const userver::server::http::HttpRequest& request,
+    std::string_view handler, ECaptureBody body) const {
+  return TScope{enabled_ ? this : nullptr, request, handler, body};
+}
+
+void TrafficCapture::Append(const TScope& scope, bool failed) const {
+  const auto& request = scope.request_;
+  const auto& body = request.RequestBody();
+  const bool body_omitted = body.size() > max_body_size_;
+
+  std::string fields;
+  AppendVarint(fields, ToMicroseconds(scope.start_ - start_));
+  AppendVarint(fields,
+               ToMicroseconds(std::chrono::steady_clock::now() - scope.start_));
+  AppendVarint(fields, failed ? 0
+                              : static_cast<uint64_t>(
+                                    request.GetHttpResponse().GetStatus()));
+  AppendVarint(fields, static_cast<uint64_t>(scope.user_id_));
+  AppendString(fields, scope.handler_);
+  AppendString(fields, request.GetMethodStr());
+  AppendString(fields, request.GetUrl());
+
+  size_t header_count = 0;
+  for (const auto name : kCapturedHeaders) {
+    header_count += !request.GetHeader(name).empty();
+  }
+  AppendVarint(fields, header_count);
+  for (const auto name : kCapturedHeaders) {
+    if (const auto& value = request.GetHeader(name); !value.empty()) {
+      AppendString(fields, name);
+      AppendString(fields, value);
+    }
+  }
+
+  AppendVarint(fields,
+               (body_omitted ? kBodyOmitted : 0) | (failed ? kFailed : 0));
+  if (body_omitted) {
+    AppendString(fields, {});
+  } else if (scope.body_ == ECaptureBody::kCredentials) {
+    AppendString(fields, SanitizeCredentials(body));
+  } else {
+    AppendString(fields, body);
+  }
+
+  std::string record;
+  AppendVarint(record, fields.size());
+  record += fields;
+
+  std::lock_guard lock(mutex_);
+  if (buffer_.size() + record.size() > max_buffer_size_ ||
+      file_size_ + record.size() > max_file_size_) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  buffer_ += record;
+  file_size_ += record.size();
+  captured_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void TrafficCapture::Flush() const {
+  std::lock_guard file_lock(file_mutex_);
+  std::string chunk;
+  {
+    std::lock_guard lock(mutex_);
+    chunk.swap(buffer_);
+  }
+  if (chunk.empty()) {
+    return;
+  }
+
+  userver::utils::Async(fs_task_processor_, "traffic-capture-write",
+                        [this, &chunk] { file_->Write(chunk); })
+      .Get();
+  written_bytes_.fetch_add(chunk.size(), std::memory_order_relaxed);
+}
+
+userver::yaml_config::Schema TrafficCapture::GetStaticConfigSchema() {
+  return userver::yaml_config::MergeSchemas<
+      userver::components::LoggableComponentBase>(R"(
+type: object
+description: capture of the requests served, for replaying them
+additionalProperties: false
+properties:
+    enabled:
+        type: boolean
+        description: whether requests are captured
+        defaultDescription: false
+    file:
+        type: string
+        description: file the requests are written to, truncated on start
+    fs-task-processor:
+        type: string
+        description: task processor writing the file
+        defaultDescription: fs-task-processor
+    flush-period:
+        type: string
+        description: pause between writes of the captured requests
+        defaultDescription: 1s
+    max-body-size:
+        type: integer
+        description: larger bodies are captured empty, in bytes
+        defaultDescription: 1048576
+    max-buffer-size:
+        type: integer
+        description: unwritten records kept in memory, in bytes
+        defaultDescription: 67108864
+    max-file-size:
+        type: integer
+        description: size of the file past which requests are dropped
+        defaultDescription: 1073741824
+)");
+}
+
+}  // namespace split_bill
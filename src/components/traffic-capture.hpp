@@ -0,0 +1,123 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <userver/components/component_config.hpp>
+#include <userver/components/component_context.hpp>
+#include <userver/components/loggable_component_base.hpp>
+#include <userver/components/static_config_validator.hpp>
+#include <userver/engine/mutex.hpp>
+#include <userver/engine/task/task_processor_fwd.hpp>
+#include <userver/fs/blocking/file_descriptor.hpp>
+#include <userver/server/http/http_request.hpp>
+#include <userver/utils/periodic_task.hpp>
+#include <userver/utils/statistics/storage.hpp>
+#include <userver/yaml_config/schema.hpp>
+
+namespace split_bill {
+
+// What of a request body may be captured
+enum class ECaptureBody {
+  kAsIs,
+  kCredentials,  // a JSON object whose "password" is replaced
+};
+
+// Password the captured credentials are given, for the replayer to set on
+// the users of the seeded database
+inline constexpr std::string_view kReplayPassword = "replay";
+
+// Opt-in capture of the requests served, for tests/load/replay_traffic.py
+// to send them again. Requests are appended to `file`, truncated on start,
+// every `flush-period` from the fs task processor; past `max-buffer-size`
+// of unwritten records or `max-file-size` of file new ones are dropped.
+//
+// The file starts with "SBTRAFF\x01" and the capture start in microseconds
+// since the epoch, then holds one record per request, its length first.
+// Integers are unsigned LEB128 varints, strings a varint length and the
+// bytes:
+//
+//   start offset from the capture start in us, duration in us, status,
+//   user id of the session or 0, handler, method, path with the query,
+//   header count and as many name and value strings, flags, body
+//
+// Session tickets are never captured, the replayer signs in as the user
+// id instead. Flag 1 marks a body over `max-body-size`, captured empty.
+// Flag 2 marks a handler that threw: its status is set by userver once the
+// exception is mapped, after the capture, and is recorded as 0.
+class TrafficCapture final
+    : public userver::components::LoggableComponentBase {
+ public:
+  static constexpr std::string_view kName = "traffic-capture";
+
+  // Captures the request, if capture is enabled, when destroyed
+  class TScope final {
+   public:
+    TScope(TScope&&) = delete;
+    TScope& operator=(TScope&&) = delete;
+    ~TScope();
+
+    void SetUserId(int user_id) { user_id_ = user_id; }
+
+   private:
+    friend class TrafficCapture;
+    TScope(const TrafficCapture* capture,
+           const userver::server::http::HttpRequest& request,
+           std::string_view handler, ECaptureBody body);
+
+    const TrafficCapture* const capture_;  // null when not capturing
+    const userver::server::http::HttpRequest& request_;
+    const std::string_view handler_;
+    const ECaptureBody body_;
+    const std::chrono::steady_clock::time_point start_;
+    // Of the handler, to tell a throwing one from a returning one
+    const int uncaught_exceptions_;
+    int user_id_ = 0;
+  };
+
+  TrafficCapture(
+      const userver::components::ComponentConfig& config,
+      const userver::components::ComponentContext& component_context);
+  ~TrafficCapture() override;
+
+  // `handler` has to outlive the scope, as the kName of a handler does
+  TScope Track(const userver::server::http::HttpRequest& request,
+               std::string_view handler,
+               ECaptureBody body = ECaptureBody::kAsIs) const;
+
+  static userver::yaml_config::Schema GetStaticConfigSchema();
+
+ private:
+  void Append(const TScope& scope, bool failed) const;
+  void Flush() const;
+
+  const bool enabled_;
+  const size_t max_body_size_;
+  const size_t max_buffer_size_;
+  const uint64_t max_file_size_;
+  const std::chrono::steady_clock::time_point start_;
+  userver::engine::TaskProcessor& fs_task_processor_;
+
+  mutable userver::engine::Mutex mutex_;
+  mutable std::string buffer_;
+  mutable uint64_t file_size_ = 0;  // written and buffered
+  // Held while writing, so flushes write their chunks in order
+  mutable userver::engine::Mutex file_mutex_;
+  mutable std::optional<userver::fs::blocking::FileDescriptor> file_;
+
+  mutable std::atomic<uint64_t> captured_{0};
+  mutable std::atomic<uint64_t> dropped_{0};
+  mutable std::atomic<uint64_t> written_bytes_{0};
+  userver::utils::statistics::Entry statistics_holder_;
+  userver::utils::PeriodicTask flush_task_;
+};
+
+}  // namespace split_bill
+
+template <>
+inline constexpr bool
+    userver::components::kHasValidate<split_bill::TrafficCapture> = true;
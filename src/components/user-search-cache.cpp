@@ -0,0 +1,86 @@
+#include "user-search-cache.hpp"
+
+#include <memory>
+#include <vector>
+
+#include <userver/yaml_config/merge_schemas.hpp>
+
+#include "shard-router.hpp"
+
+namespace split_bill {
+
+namespace {
+
+constexpr std::string_view kSelectUsers =
+    "SELECT id, username, full_name, photo_url FROM users";
+
+}  // namespace
+
+UserSearchCache::UserSearchCache(
+    const userver::components::ComponentConfig& config,
+    const userver::components::ComponentContext& component_context)
+    : CachingComponentBase(config, component_context),
+      cluster_(component_context.FindComponent<ShardRouter>().Global()),
+      full_update_control_(
+          config["full-update-timeout"].As<std::chrono::milliseconds>(
+              std::chrono::minutes{1}),
+          config["full-update-timeout"].As<std::chrono::milliseconds>(
+              std::chrono::minutes{1})) {
+  StartPeriodicUpdates();
+}
+
+UserSearchCache::~UserSearchCache() { StopPeriodicUpdates(); }
+
+void UserSearchCache::Update(
+    userver::cache::UpdateType type,
+    const std::chrono::system_clock::time_point& /*last_update*/,
+    const std::chrono::system_clock::time_point& /*now*/,
+    userver::cache::UpdateStatisticsScope& stats_scope) {
+  std::shared_ptr<const TUserSearchIndex> index;
+  if (type == userver::cache::UpdateType::kIncremental) {
+    const auto current = Get();
+    auto new_users =
+        cluster_
+            ->Execute(userver::storages::postgres::ClusterHostType::kSlave,
+                      std::string{kSelectUsers} + " WHERE id > $1",
+                      current->MaxId())
+            .AsContainer<std::vector<TUserInfo>>(
+                userver::storages::postgres::kRowTag);
+    stats_scope.IncreaseDocumentsReadCount(new_users.size());
+    if (new_users.empty()) {
+      stats_scope.FinishNoChanges();
+      return;
+    }
+    index = std::make_shared<const TUserSearchIndex>(*current,
+                                                     std::move(new_users));
+  } else {
+    auto users =
+        cluster_
+            ->Execute(userver::storages::postgres::ClusterHostType::kSlave,
+                      full_update_control_, std::string{kSelectUsers})
+            .AsContainer<std::vector<TUserInfo>>(
+                userver::storages::postgres::kRowTag);
+    stats_scope.IncreaseDocumentsReadCount(users.size());
+    index = std::make_shared<const TUserSearchIndex>(std::move(users));
+  }
+
+  const auto size = index->Size();
+  Set(std::move(index));
+  stats_scope.Finish(size);
+}
+
+userver::yaml_config::Schema UserSearchCache::GetStaticConfigSchema() {
+  return userver::yaml_config::MergeSchemas<
+      userver::components::CachingComponentBase<TUserSearchIndex>>(R"(
+type: object
+description: in-memory search index over users
+additionalProperties: false
+properties:
+    full-update-timeout:
+        type: string
+        description: timeout of the query reading every user
+        defaultDescription: 1m
+)");
+}
+
+}  // namespace split_bill
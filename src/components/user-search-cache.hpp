@@ -0,0 +1,46 @@
+#pragma once
+
+#include <chrono>
+#include <string_view>
+
+#include <userver/cache/caching_component_base.hpp>
+#include <userver/components/component_config.hpp>
+#include <userver/components/component_context.hpp>
+#include <userver/components/static_config_validator.hpp>
+#include <userver/storages/postgres/cluster.hpp>
+#include <userver/yaml_config/schema.hpp>
+
+#include "../models/user-search-index.hpp"
+
+namespace split_bill {
+
+// TUserSearchIndex over every user of the global cluster. An incremental
+// update indexes the users registered since the previous one; renamed and
+// deleted users are picked up by full updates.
+class UserSearchCache final
+    : public userver::components::CachingComponentBase<TUserSearchIndex> {
+ public:
+  static constexpr std::string_view kName = "user-search-cache";
+
+  UserSearchCache(
+      const userver::components::ComponentConfig& config,
+      const userver::components::ComponentContext& component_context);
+  ~UserSearchCache() override;
+
+  static userver::yaml_config::Schema GetStaticConfigSchema();
+
+ private:
+  void Update(userver::cache::UpdateType type,
+              const std::chrono::system_clock::time_point& last_update,
+              const std::chrono::system_clock::time_point& now,
+              userver::cache::UpdateStatisticsScope& stats_scope) override;
+
+  userver::storages::postgres::ClusterPtr cluster_;
+  const userver::storages::postgres::CommandControl full_update_control_;
+};
+
+}  // namespace split_bill
+
+template <>
+inline constexpr bool
+    userver::components::kHasValidate<split_bill::UserSearchCache> = true;
@@ -0,0 +1,17 @@
+#include "admission.hpp"
+
+#include <userver/http/common_headers.hpp>
+
+#include "errors.hpp"
+
+namespace split_bill {
+
+std::string RejectRequest(const userver::server::http::HttpRequest& request,
+                          const AdmissionControl::Admission& admission) {
+  request.GetHttpResponse().SetHeader(
+      userver::http::headers::kRetryAfter,
+      std::to_string(admission.RetryAfter().count()));
+  return kTooManyRequestsError(request);
+}
+
+}  // namespace split_bill
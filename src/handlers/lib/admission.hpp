@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+
+#include <userver/server/http/http_request.hpp>
+
+#include "../../components/admission-control.hpp"
+
+namespace split_bill {
+
+// Turns the request into 429 Too Many Requests with Retry-After and returns
+// the response body
+std::string RejectRequest(const userver::server::http::HttpRequest& request,
+                          const AdmissionControl::Admission& admission);
+
+}  // namespace split_bill
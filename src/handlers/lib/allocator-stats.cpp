@@ -0,0 +1,63 @@
+#include "allocator-stats.hpp"
+
+#include <malloc.h>
+
+#include <cstdint>
+#include <string>
+
+#include <userver/formats/json/value_builder.hpp>
+
+// Defined only when jemalloc is linked in
+extern "C" int mallctl(const char* name, void* oldp, size_t* oldlenp,
+                       void* newp, size_t newlen) __attribute__((weak));
+
+namespace split_bill {
+
+namespace {
+
+userver::formats::json::Value GetJemallocStats() {
+  // Stats are snapshots taken at the last epoch change
+  uint64_t epoch = 1;
+  size_t epoch_size = sizeof(epoch);
+  mallctl("epoch", &epoch, &epoch_size, &epoch, epoch_size);
+
+  userver::formats::json::ValueBuilder stats;
+  stats["allocator"] = "jemalloc";
+  for (const std::string name :
+       {"allocated", "active", "metadata", "resident", "mapped", "retained"}) {
+    size_t value = 0;
+    size_t value_size = sizeof(value);
+    if (mallctl(("stats." + name).c_str(), &value, &value_size, nullptr, 0) ==
+        0) {
+      stats[name] = value;
+    }
+  }
+  return stats.ExtractValue();
+}
+
+}  // namespace
+
+userver::formats::json::Value GetAllocatorStats() {
+  if (mallctl) {
+    return GetJemallocStats();
+  }
+
+  userver::formats::json::ValueBuilder stats;
+  stats["allocator"] = "glibc";
+#if __GLIBC_PREREQ(2, 33)
+  const auto info = mallinfo2();
+#else
+  // Fields wrap around past 2 GB
+  const auto info = mallinfo();
+#endif
+  // Held by the main and the other arenas
+  stats["arena"] = static_cast<size_t>(info.arena);
+  stats["mmapped"] = static_cast<size_t>(info.hblkhd);
+  stats["allocated"] = static_cast<size_t>(info.uordblks);
+  // Free in the arenas, not returned to the system
+  stats["free"] = static_cast<size_t>(info.fordblks);
+  stats["releasable"] = static_cast<size_t>(info.keepcost);
+  return stats.ExtractValue();
+}
+
+}  // namespace split_bill
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <userver/formats/json/value.hpp>
+
+namespace split_bill {
+
+// Heap statistics of the allocator the service runs with, in bytes:
+// jemalloc's when it is linked in, glibc malloc's otherwise
+userver::formats::json::Value GetAllocatorStats();
+
+}  // namespace split_bill
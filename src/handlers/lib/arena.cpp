@@ -0,0 +1,29 @@
+#include "arena.hpp"
+
+#include <memory>
+#include <string>
+
+namespace split_bill {
+
+namespace {
+
+using TArena = std::unique_ptr<std::pmr::monotonic_buffer_resource>;
+
+const std::string kArenaKey = "split_bill_request_arena";
+
+// Enough for a room with a few dozen products in one upstream allocation
+constexpr size_t kInitialArenaSize = 16 * 1024;
+
+}  // namespace
+
+std::pmr::memory_resource& GetRequestArena(
+    userver::server::request::RequestContext& context) {
+  if (auto* arena = context.GetDataOptional<TArena>(kArenaKey)) {
+    return **arena;
+  }
+  return *context.SetData<TArena>(
+      kArenaKey,
+      std::make_unique<std::pmr::monotonic_buffer_resource>(kInitialArenaSize));
+}
+
+}  // namespace split_bill
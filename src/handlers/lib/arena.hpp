@@ -0,0 +1,15 @@
+#pragma once
+
+#include <memory_resource>
+
+#include <userver/server/request/request_context.hpp>
+
+namespace split_bill {
+
+// Monotonic arena living as long as the request context. Memory taken from it
+// is never freed piecemeal, only all at once when the request is destroyed,
+// so use it for response models assembled once and then serialized.
+std::pmr::memory_resource& GetRequestArena(
+    userver::server::request::RequestContext& context);
+
+}  // namespace split_bill
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <charconv>
+#include <optional>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+
+#include <userver/server/http/http_request.hpp>
+
+namespace split_bill {
+
+// Decimal integer taking up all of `value`; nullopt for an empty value,
+// spaces, trailing characters or overflow. Unlike std::stoi it never throws,
+// so a malformed id is a 400 and not a 500.
+template <typename T>
+std::optional<T> ParseInteger(std::string_view value) {
+  static_assert(std::is_integral_v<T>);
+  T result{};
+  const auto* end = value.data() + value.size();
+  const auto [ptr, error] = std::from_chars(value.data(), end, result);
+  if (value.empty() || error != std::errc{} || ptr != end) {
+    return std::nullopt;
+  }
+  return result;
+}
+
+// Integer path argument such as the {id} of /v1/rooms/{id}
+inline std::optional<int> GetIntPathArg(
+    const userver::server::http::HttpRequest& request, std::string_view name) {
+  return ParseInteger<int>(request.GetPathArg(name));
+}
+
+// Integer query argument, nullopt when missing or malformed
+inline std::optional<int> GetIntArg(
+    const userver::server::http::HttpRequest& request, std::string_view name) {
+  if (!request.HasArg(name)) {
+    return std::nullopt;
+  }
+  return ParseInteger<int>(request.GetArg(name));
+}
+
+}  // namespace split_bill
@@ -1,4 +1,6 @@
 #include "auth.hpp"
+#include "../../components/query-stats.hpp"
+#include "args.hpp"
 
 namespace split_bill {
 
@@ -10,12 +12,17 @@ std::optional<TSession> GetSessionInfo(
         return std::nullopt;
     }
 
-    auto id = std::stoi(request.GetHeader(USER_TICKET_HEADER_NAME));
-    auto result = pg_cluster->Execute(
-        userver::storages::postgres::ClusterHostType::kSlave,
+    // A malformed ticket is no session rather than a 500
+    const auto id =
+        ParseInteger<int>(request.GetHeader(USER_TICKET_HEADER_NAME));
+    if (!id) {
+        return std::nullopt;
+    }
+    auto result = CountedExecute(
+        pg_cluster, userver::storages::postgres::ClusterHostType::kSlave,
         "SELECT * FROM auth_sessions "
         "WHERE id = $1 ",
-        id
+        *id
     );
 
     if (result.IsEmpty()) {
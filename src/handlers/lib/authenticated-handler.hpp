@@ -0,0 +1,90 @@
+#pragma once
+
+#include <string>
+
+#include <userver/components/component_config.hpp>
+#include <userver/components/component_context.hpp>
+#include <userver/server/handlers/http_handler_base.hpp>
+#include <userver/server/http/http_request.hpp>
+#include <userver/server/request/request_context.hpp>
+
+#include "../../components/admission-control.hpp"
+#include "../../components/query-stats.hpp"
+#include "../../components/request-logging.hpp"
+#include "../../components/server-timing.hpp"
+#include "../../components/shard-router.hpp"
+#include "../../components/traffic-capture.hpp"
+#include "../../models/session.hpp"
+#include "admission.hpp"
+#include "auth.hpp"
+#include "errors.hpp"
+
+namespace split_bill {
+
+// Base of the JSON endpoints of signed-in users. Does what each of them
+// starts with: query stats, the request log, Server-Timing, traffic capture,
+// the content type, admission for Derived::kEndpointClass and the session
+// lookup, answering 429 and 401 itself. The rest is up to
+//
+//   std::string Derived::HandleAuthenticated(
+//       const userver::server::http::HttpRequest& request,
+//       userver::server::request::RequestContext& context,
+//       const TSession& session) const;
+template <typename Derived>
+class AuthenticatedJsonHandler
+    : public userver::server::handlers::HttpHandlerBase {
+ public:
+  AuthenticatedJsonHandler(
+      const userver::components::ComponentConfig& config,
+      const userver::components::ComponentContext& component_context)
+      : HttpHandlerBase(config, component_context),
+        shard_router_(component_context.FindComponent<ShardRouter>()),
+        admission_control_(
+            component_context.FindComponent<AdmissionControl>()),
+        query_stats_(component_context.FindComponent<QueryStats>()),
+        request_logging_(component_context.FindComponent<RequestLogging>()),
+        server_timing_(component_context.FindComponent<ServerTiming>()),
+        traffic_capture_(component_context.FindComponent<TrafficCapture>()) {}
+
+  std::string HandleRequestThrow(
+      const userver::server::http::HttpRequest& request,
+      userver::server::request::RequestContext& context) const final {
+    const auto query_stats = query_stats_.Track(request);
+    const auto request_log = request_logging_.Track(request, Derived::kName);
+    const auto server_timing = server_timing_.Track(request);
+    auto capture = traffic_capture_.Track(request, Derived::kName);
+    request.GetHttpResponse().SetContentType(
+        userver::http::content_type::kApplicationJson);
+    const auto admission = [&] {
+      const TTimingScope timing("admission");
+      return admission_control_.Admit(request, Derived::kEndpointClass);
+    }();
+    if (!admission) {
+      return RejectRequest(request, admission);
+    }
+
+    const auto session = [&] {
+      const TTimingScope timing("auth");
+      return GetSessionInfo(shard_router_.Global(), request);
+    }();
+    if (!session) {
+      return kUnauthorizedError(request);
+    }
+    admission_control_.RememberSession(*session);
+    capture.SetUserId(session->user_id);
+    return static_cast<const Derived&>(*this).HandleAuthenticated(
+        request, context, *session);
+  }
+
+ protected:
+  const ShardRouter& shard_router_;
+
+ private:
+  const AdmissionControl& admission_control_;
+  const QueryStats& query_stats_;
+  const RequestLogging& request_logging_;
+  const ServerTiming& server_timing_;
+  const TrafficCapture& traffic_capture_;
+};
+
+}  // namespace split_bill
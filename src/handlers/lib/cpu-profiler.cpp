@@ -0,0 +1,181 @@
+#include "cpu-profiler.hpp"
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <signal.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <userver/engine/sleep.hpp>
+
+namespace split_bill {
+
+namespace {
+
+constexpr int kMaxDepth = 64;
+// The signal handler and the signal trampoline
+constexpr int kSkippedFrames = 2;
+// 25 MB of frames at most
+constexpr size_t kMaxSamples = 50000;
+
+struct TSamples {
+  explicit TSamples(size_t capacity)
+      : frames(capacity * kMaxDepth), depths(capacity, 0) {}
+
+  std::vector<void*> frames;  // kMaxDepth per sample
+  std::vector<int> depths;    // 0 for a sample never taken
+  std::atomic<size_t> next{0};
+};
+
+std::atomic<bool> profiling{false};
+std::atomic<TSamples*> current_samples{nullptr};
+std::atomic<int> running_handlers{0};
+
+// Async-signal-safe once backtrace() has been called outside of it
+void OnProfilingSignal(int) {
+  const auto saved_errno = errno;
+  ++running_handlers;
+  if (auto* samples = current_samples.load()) {
+    const auto index = samples->next.fetch_add(1, std::memory_order_relaxed);
+    if (index < samples->depths.size()) {
+      samples->depths[index] =
+          backtrace(&samples->frames[index * kMaxDepth], kMaxDepth);
+    }
+  }
+  --running_handlers;
+  errno = saved_errno;
+}
+
+// Installed once and kept: a SIGPROF still pending when a profile stops
+// would kill the process with the default action
+void InstallSignalHandler() {
+  static std::once_flag installed;
+  std::call_once(installed, [] {
+    // backtrace() loads the unwinder, allocating, on its first call
+    void* frame = nullptr;
+    backtrace(&frame, 1);
+
+    struct sigaction action {};
+    action.sa_handler = &OnProfilingSignal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, nullptr);
+  });
+}
+
+void SetProfilingTimer(int hz) {
+  itimerval timer{};
+  if (hz > 0) {
+    const auto interval_us = 1000000 / hz;
+    timer.it_interval.tv_sec = interval_us / 1000000;
+    timer.it_interval.tv_usec = interval_us % 1000000;
+    timer.it_value = timer.it_interval;
+  }
+  setitimer(ITIMER_PROF, &timer, nullptr);
+}
+
+// `address` is a return address unless it is the interrupted instruction;
+// one byte back it is inside the call, as addr2line expects
+std::string FrameName(void* address, bool interrupted) {
+  if (!interrupted) {
+    address = static_cast<char*>(address) - 1;
+  }
+  Dl_info info{};
+  if (dladdr(address, &info) == 0) {
+    return fmt::format("{}", address);
+  }
+  if (info.dli_sname) {
+    int status = 0;
+    const std::unique_ptr<char, decltype(&std::free)> demangled(
+        abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status),
+        &std::free);
+    return status == 0 ? demangled.get() : info.dli_sname;
+  }
+  const char* module = info.dli_fname ? info.dli_fname : "?";
+  if (const char* slash = std::strrchr(module, '/')) {
+    module = slash + 1;
+  }
+  return fmt::format(
+      "{}+{:#x}", module,
+      static_cast<char*>(address) - static_cast<char*>(info.dli_fbase));
+}
+
+std::string FoldStacks(const TSamples& samples, size_t taken) {
+  std::unordered_map<void*, std::string> names;
+  std::map<std::string, size_t> stacks;
+  std::string stack;
+  for (size_t sample = 0; sample < taken; ++sample) {
+    const auto depth = samples.depths[sample];
+    if (depth <= kSkippedFrames) {
+      continue;
+    }
+    const auto* frames = &samples.frames[sample * kMaxDepth];
+    stack.clear();
+    for (int frame = depth - 1; frame >= kSkippedFrames; --frame) {
+      auto [name, inserted] = names.try_emplace(frames[frame]);
+      if (inserted) {
+        name->second =
+            FrameName(frames[frame], frame == kSkippedFrames);
+        std::replace(name->second.begin(), name->second.end(), ';', ':');
+      }
+      if (!stack.empty()) {
+        stack += ';';
+      }
+      stack += name->second;
+    }
+    ++stacks[stack];
+  }
+
+  std::string folded;
+  for (const auto& [folded_stack, count] : stacks) {
+    folded += fmt::format("{} {}\n", folded_stack, count);
+  }
+  return folded;
+}
+
+}  // namespace
+
+std::optional<std::string> CaptureCpuProfile(
+    std::chrono::milliseconds duration, int hz) {
+  if (profiling.exchange(true)) {
+    return std::nullopt;
+  }
+  struct TProfilingGuard {
+    ~TProfilingGuard() { profiling = false; }
+  } guard;
+  InstallSignalHandler();
+
+  const auto cpus = std::max(1u, std::thread::hardware_concurrency());
+  const auto expected = static_cast<size_t>(
+      static_cast<double>(hz) * cpus * duration.count() / 1000);
+  TSamples samples(std::min(kMaxSamples, expected + 1));
+
+  current_samples = &samples;
+  SetProfilingTimer(hz);
+  userver::engine::InterruptibleSleepFor(duration);
+  SetProfilingTimer(0);
+  current_samples = nullptr;
+  // A handler that got the samples before they were unset is still counted
+  while (running_handlers.load() != 0) {
+    std::this_thread::yield();
+  }
+
+  return FoldStacks(samples,
+                    std::min(samples.next.load(), samples.depths.size()));
+}
+
+}  // namespace split_bill
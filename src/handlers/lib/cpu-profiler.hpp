@@ -0,0 +1,22 @@
+#pragma once
+
+#include <chrono>
+#include <optional>
+#include <string>
+
+namespace split_bill {
+
+// Samples the stacks of whatever the process runs on CPU for `duration`:
+// SIGPROF fires `hz` times per second of CPU time the process uses and
+// interrupts one of the threads using it. The calling task sleeps
+// meanwhile.
+//
+// Returns the samples folded, one "outer;...;inner count" line per distinct
+// stack, as flamegraph.pl and speedscope read them. Functions are named
+// through dladdr, which only sees exported symbols (the service is linked
+// with them exported); other frames are given as module+offset, for
+// addr2line. Returns nullopt if another profile is running.
+std::optional<std::string> CaptureCpuProfile(
+    std::chrono::milliseconds duration, int hz);
+
+}  // namespace split_bill
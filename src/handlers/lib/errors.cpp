@@ -0,0 +1,52 @@
+#include "errors.hpp"
+
+#include <userver/formats/json/value_builder.hpp>
+
+namespace split_bill {
+
+TErrorResponse::TErrorResponse(userver::server::http::HttpStatus status,
+                               std::string_view message)
+    : status_(status),
+      body_(userver::formats::json::ToString(
+          userver::formats::json::ValueBuilder{{"error", std::string{message}}}
+              .ExtractValue())) {}
+
+std::string TErrorResponse::operator()(
+    const userver::server::http::HttpRequest& request) const {
+  request.SetResponseStatus(status_);
+  return body_;
+}
+
+const TErrorResponse kUnauthorizedError{
+    userver::server::http::HttpStatus::kUnauthorized, "Unauthorized"};
+const TErrorResponse kInvalidRoomIdError{
+    userver::server::http::HttpStatus::kBadRequest, "Invalid room ID"};
+const TErrorResponse kRoomNotFoundError{
+    userver::server::http::HttpStatus::kNotFound, "Room not found"};
+const TErrorResponse kInvalidProductIdError{
+    userver::server::http::HttpStatus::kBadRequest, "Invalid product ID"};
+const TErrorResponse kInvalidStatusError{
+    userver::server::http::HttpStatus::kBadRequest,
+    "Status is not valid!(PAID | UNPAID)"};
+const TErrorResponse kPayloadTooLargeError{
+    userver::server::http::HttpStatus::kPayloadTooLarge,
+    "Request body is too large"};
+const TErrorResponse kRoomChangedError{
+    userver::server::http::HttpStatus::kPreconditionFailed,
+    "The room has changed, reload it and retry"};
+const TErrorResponse kPageOutOfReachError{
+    userver::server::http::HttpStatus::kBadRequest,
+    "Pages past the first 10000 rows are not served, narrow the listing"};
+const TErrorResponse kTooManyRequestsError{
+    userver::server::http::HttpStatus::kTooManyRequests, "Too many requests"};
+const TErrorResponse kIdempotencyKeyTooLongError{
+    userver::server::http::HttpStatus::kBadRequest,
+    "Idempotency-Key must be up to 255 characters long"};
+const TErrorResponse kIdempotencyKeyInProgressError{
+    userver::server::http::HttpStatus::kConflict,
+    "A request with this Idempotency-Key is in progress"};
+const TErrorResponse kIdempotencyKeyMismatchError{
+    userver::server::http::HttpStatus::kUnprocessableEntity,
+    "Idempotency-Key was used for a different request"};
+
+}  // namespace split_bill
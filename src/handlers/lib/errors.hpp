@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include <userver/server/http/http_request.hpp>
+#include <userver/server/http/http_status.hpp>
+
+namespace split_bill {
+
+// Error response with an {"error": message} body serialized once, at
+// startup, instead of through a ValueBuilder on every request
+class TErrorResponse final {
+ public:
+  TErrorResponse(userver::server::http::HttpStatus status,
+                 std::string_view message);
+
+  // Sets the status of the response to `request` and returns the body
+  std::string operator()(
+      const userver::server::http::HttpRequest& request) const;
+
+ private:
+  userver::server::http::HttpStatus status_;
+  std::string body_;
+};
+
+// Shared by most endpoints; the rest are defined next to their handlers
+extern const TErrorResponse kUnauthorizedError;
+extern const TErrorResponse kInvalidRoomIdError;
+extern const TErrorResponse kRoomNotFoundError;
+extern const TErrorResponse kInvalidProductIdError;
+extern const TErrorResponse kInvalidStatusError;
+extern const TErrorResponse kPayloadTooLargeError;
+extern const TErrorResponse kRoomChangedError;
+extern const TErrorResponse kPageOutOfReachError;
+extern const TErrorResponse kTooManyRequestsError;
+extern const TErrorResponse kIdempotencyKeyTooLongError;
+extern const TErrorResponse kIdempotencyKeyInProgressError;
+extern const TErrorResponse kIdempotencyKeyMismatchError;
+
+}  // namespace split_bill
@@ -0,0 +1,35 @@
+#include "fan-out.hpp"
+
+#include <utility>
+
+#include <userver/engine/task/inherited_variable.hpp>
+
+namespace split_bill {
+
+namespace {
+
+userver::engine::TaskInheritedVariable<
+    std::shared_ptr<userver::engine::Semaphore>>
+    fan_out_slots;
+
+}  // namespace
+
+void UseFanOutSlots(std::shared_ptr<userver::engine::Semaphore> slots) {
+  fan_out_slots.Set(std::move(slots));
+}
+
+namespace impl {
+
+std::shared_ptr<userver::engine::Semaphore> GetFanOutSlots() {
+  if (const auto* slots = fan_out_slots.GetOptional()) {
+    return *slots;
+  }
+  // One set for everything outside admitted requests, as they share pools
+  static const auto shared_slots =
+      std::make_shared<userver::engine::Semaphore>(kMaxParallelStatements);
+  return shared_slots;
+}
+
+}  // namespace impl
+
+}  // namespace split_bill
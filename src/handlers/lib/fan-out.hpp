@@ -0,0 +1,146 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <userver/engine/semaphore.hpp>
+#include <userver/engine/task/task_with_result.hpp>
+#include <userver/utils/async.hpp>
+
+namespace split_bill {
+
+// Subtasks running at once of all the fan-outs outside of admitted
+// requests, such as those of tests and benchmarks. Admitted requests take
+// theirs from the connection budget of their class (see UseFanOutSlots),
+// so the cap follows the pool and not the number of requests.
+inline constexpr size_t kMaxParallelStatements = 8;
+
+// Makes the fan-outs of the current request and its subtasks take a unit of
+// `slots` per subtask instead of per-request slots. Admission control passes
+// the connection budget of the request's class, so subtasks can't hold more
+// connections than the class was given.
+void UseFanOutSlots(std::shared_ptr<userver::engine::Semaphore> slots);
+
+namespace impl {
+
+// Slots of the current request, inherited by its subtasks, or the shared
+// ones
+std::shared_ptr<userver::engine::Semaphore> GetFanOutSlots();
+
+// One function of a fan-out: started in a subtask if a slot is free, run in
+// the calling task by Run() otherwise. An unfinished subtask is cancelled
+// when the call is destroyed, e.g. as another function's exception unwinds.
+template <typename Func>
+class TFanOutCall final {
+ public:
+  using Result = std::invoke_result_t<Func&>;
+  static_assert(!std::is_void_v<Result>);
+
+  TFanOutCall(std::string_view name, Func& func,
+              const std::shared_ptr<userver::engine::Semaphore>& slots)
+      : func_(func) {
+    if (!slots) {
+      return;
+    }
+    std::shared_lock slot(*slots, std::try_to_lock);
+    if (slot) {
+      task_.emplace(userver::utils::Async(
+          std::string{name},
+          [&func, slot = std::move(slot)] { return func(); }));
+    }
+  }
+
+  void Run() {
+    if (!task_) {
+      result_.emplace(func_());
+    }
+  }
+
+  Result Get() { return task_ ? task_->Get() : std::move(*result_); }
+
+ private:
+  Func& func_;
+  std::optional<userver::engine::TaskWithResult<Result>> task_;
+  std::optional<Result> result_;
+};
+
+template <typename... Funcs, size_t... Indices>
+auto ConcurrentInvoke(std::string_view name, std::index_sequence<Indices...>,
+                      Funcs&... funcs) {
+  const auto slots = GetFanOutSlots();
+  // The first function runs in the calling task, which would only wait
+  std::tuple<TFanOutCall<Funcs>...> calls{
+      TFanOutCall<Funcs>(name, funcs, Indices == 0 ? nullptr : slots)...};
+  std::apply([](auto&... call) { (call.Run(), ...); }, calls);
+  return std::apply(
+      [](auto&... call) {
+        return std::tuple<typename TFanOutCall<Funcs>::Result...>{
+            call.Get()...};
+      },
+      calls);
+}
+
+}  // namespace impl
+
+// Runs independent statements of a request concurrently and returns their
+// results as a tuple:
+//
+//   auto [count, page] = ConcurrentInvoke(
+//       "get-products-shard", [&] { return ...; }, [&] { return ...; });
+//
+// Subtasks inherit the deadline and the query stats of the request. Once
+// the slots of the request (see UseFanOutSlots) are taken, the rest of the
+// functions run one by one in the calling task. If a function throws,
+// the unfinished ones are cancelled and the exception is rethrown.
+template <typename... Funcs>
+auto ConcurrentInvoke(std::string_view name, Funcs&&... funcs) {
+  return impl::ConcurrentInvoke(name, std::index_sequence_for<Funcs...>{},
+                                funcs...);
+}
+
+// `func(item)` for every item of `items`, run as by ConcurrentInvoke, with
+// the results in the order of `items`
+template <typename Container, typename Func>
+auto ConcurrentMap(std::string_view name, const Container& items,
+                   const Func& func) {
+  using Item = typename Container::value_type;
+  struct TItemCall {
+    const Func* func;
+    const Item* item;
+
+    auto operator()() const { return (*func)(*item); }
+  };
+
+  std::vector<TItemCall> funcs;
+  funcs.reserve(items.size());
+  for (const auto& item : items) {
+    funcs.push_back({&func, &item});
+  }
+
+  const auto slots = impl::GetFanOutSlots();
+  std::vector<impl::TFanOutCall<TItemCall>> calls;
+  calls.reserve(funcs.size());
+  for (auto& item_call : funcs) {
+    calls.emplace_back(name, item_call, calls.empty() ? nullptr : slots);
+  }
+  for (auto& call : calls) {
+    call.Run();
+  }
+
+  std::vector<typename impl::TFanOutCall<TItemCall>::Result> results;
+  results.reserve(calls.size());
+  for (auto& call : calls) {
+    results.push_back(call.Get());
+  }
+  return results;
+}
+
+}  // namespace split_bill
@@ -0,0 +1,69 @@
+#include "fan-out.hpp"
+
+#include <chrono>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <userver/engine/run_standalone.hpp>
+#include <userver/engine/sleep.hpp>
+
+namespace split_bill {
+
+namespace {
+
+// Stands in for a statement round trip to the database
+constexpr std::chrono::milliseconds kStatementLatency{1};
+
+int Statement(int value) {
+  userver::engine::SleepFor(kStatementLatency);
+  return value;
+}
+
+std::vector<int> MakeShards(int shards) {
+  std::vector<int> result;
+  for (int shard = 0; shard < shards; ++shard) {
+    result.push_back(shard);
+  }
+  return result;
+}
+
+// A listing the way handlers read it before the fan-out: for every shard
+// the count, then the page
+void ListingSequential(benchmark::State& state) {
+  const auto shards = MakeShards(state.range(0));
+  userver::engine::RunStandalone(4, [&] {
+    for ([[maybe_unused]] auto _ : state) {
+      int total = 0;
+      for (const auto shard : shards) {
+        total += Statement(shard);
+        total += Statement(shard);
+      }
+      benchmark::DoNotOptimize(total);
+    }
+  });
+}
+BENCHMARK(ListingSequential)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
+
+void ListingConcurrent(benchmark::State& state) {
+  const auto shards = MakeShards(state.range(0));
+  userver::engine::RunStandalone(4, [&] {
+    for ([[maybe_unused]] auto _ : state) {
+      int total = 0;
+      const auto results =
+          ConcurrentMap("listing-shard", shards, [](int shard) {
+            return ConcurrentInvoke(
+                "listing-statement", [shard] { return Statement(shard); },
+                [shard] { return Statement(shard); });
+          });
+      for (const auto& [count, page] : results) {
+        total += count + page;
+      }
+      benchmark::DoNotOptimize(total);
+    }
+  });
+}
+BENCHMARK(ListingConcurrent)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
+
+}  // namespace
+
+}  // namespace split_bill
@@ -0,0 +1,69 @@
+#include "gzip.hpp"
+
+#include <stdexcept>
+
+#include <zlib.h>
+
+namespace split_bill {
+
+namespace {
+
+// deflateInit2/inflateInit2 window bits selecting the gzip wrapper
+constexpr int kGzipWindowBits = 15 + 16;
+
+constexpr size_t kChunkSize = 16 * 1024;
+
+}  // namespace
+
+std::string GzipCompress(std::string_view data, int level) {
+  z_stream stream{};
+  if (deflateInit2(&stream, level, Z_DEFLATED, kGzipWindowBits, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    throw std::runtime_error("deflateInit2 failed");
+  }
+
+  std::string result(deflateBound(&stream, data.size()), '\0');
+  stream.next_in =
+      reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  stream.avail_in = static_cast<uInt>(data.size());
+  stream.next_out = reinterpret_cast<Bytef*>(result.data());
+  stream.avail_out = static_cast<uInt>(result.size());
+
+  const auto status = deflate(&stream, Z_FINISH);
+  deflateEnd(&stream);
+  if (status != Z_STREAM_END) {
+    throw std::runtime_error("deflate failed");
+  }
+  result.resize(stream.total_out);
+  return result;
+}
+
+std::string GzipDecompress(std::string_view data) {
+  z_stream stream{};
+  if (inflateInit2(&stream, kGzipWindowBits) != Z_OK) {
+    throw std::runtime_error("inflateInit2 failed");
+  }
+  stream.next_in =
+      reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  stream.avail_in = static_cast<uInt>(data.size());
+
+  std::string result;
+  int status = Z_OK;
+  while (status != Z_STREAM_END) {
+    const auto offset = result.size();
+    result.resize(offset + kChunkSize);
+    stream.next_out = reinterpret_cast<Bytef*>(result.data() + offset);
+    stream.avail_out = kChunkSize;
+
+    status = inflate(&stream, Z_NO_FLUSH);
+    if (status != Z_OK && status != Z_STREAM_END) {
+      inflateEnd(&stream);
+      throw std::runtime_error("inflate failed: corrupted gzip stream");
+    }
+    result.resize(offset + kChunkSize - stream.avail_out);
+  }
+  inflateEnd(&stream);
+  return result;
+}
+
+}  // namespace split_bill
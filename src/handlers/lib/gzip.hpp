@@ -0,0 +1,14 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace split_bill {
+
+// gzip streams, so stored documents can also be sent as is to clients
+// accepting Content-Encoding: gzip. Both throw std::runtime_error on zlib
+// errors. `level` is the zlib one, from 1 (fastest) to 9 (smallest).
+std::string GzipCompress(std::string_view data, int level = 9);
+std::string GzipDecompress(std::string_view data);
+
+}  // namespace split_bill
@@ -0,0 +1,74 @@
+#include "idempotency.hpp"
+
+#include <userver/crypto/hash.hpp>
+#include <userver/logging/log.hpp>
+#include <userver/server/http/http_status.hpp>
+
+#include "errors.hpp"
+
+namespace split_bill {
+
+namespace {
+
+constexpr std::string_view kIdempotencyKeyHeader = "Idempotency-Key";
+constexpr std::string_view kReplayedHeader = "Idempotent-Replayed";
+constexpr size_t kMaxKeyLength = 255;
+
+}  // namespace
+
+std::string HandleIdempotently(
+    const IdempotencyStore& store,
+    const userver::server::http::HttpRequest& request, int user_id,
+    const std::function<std::string()>& handle) {
+  const auto& key = request.GetHeader(kIdempotencyKeyHeader);
+  if (key.empty()) {
+    return handle();
+  }
+  if (key.size() > kMaxKeyLength) {
+    return kIdempotencyKeyTooLongError(request);
+  }
+
+  // Reusing a key for another endpoint or body is a client error
+  const auto request_hash = userver::crypto::hash::Sha256(
+      request.GetMethodStr() + ' ' + request.GetRequestPath() + '\n' +
+      request.RequestBody());
+  const auto claim = store.Claim(user_id, key, request_hash);
+  switch (claim.state) {
+    case EIdempotencyState::kReplay:
+      request.SetResponseStatus(
+          static_cast<userver::server::http::HttpStatus>(
+              claim.response->status));
+      request.GetHttpResponse().SetHeader(kReplayedHeader,
+                                          std::string{"true"});
+      return claim.response->body;
+    case EIdempotencyState::kInProgress:
+      return kIdempotencyKeyInProgressError(request);
+    case EIdempotencyState::kMismatch:
+      return kIdempotencyKeyMismatchError(request);
+    case EIdempotencyState::kClaimed:
+      break;
+  }
+
+  std::string body;
+  try {
+    body = handle();
+  } catch (const std::exception&) {
+    try {
+      store.Release(user_id, key, request_hash);
+    } catch (const std::exception& e) {
+      // The claim times out instead
+      LOG_WARNING() << "Failed to release Idempotency-Key: " << e.what();
+    }
+    throw;
+  }
+  const auto status =
+      static_cast<int>(request.GetHttpResponse().GetStatus());
+  if (status >= 500) {
+    store.Release(user_id, key, request_hash);
+  } else {
+    store.Complete(user_id, key, request_hash, status, body);
+  }
+  return body;
+}
+
+}  // namespace split_bill
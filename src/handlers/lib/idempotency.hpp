@@ -0,0 +1,21 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+#include <userver/server/http/http_request.hpp>
+
+#include "../../components/idempotency-store.hpp"
+
+namespace split_bill {
+
+// Runs `handle` for a request without an Idempotency-Key header. With one,
+// runs it only for the first request with the key and answers retries with
+// the stored response and an Idempotent-Replayed header. Responses with a
+// 5xx status or an exception are not stored, so a retry runs again.
+std::string HandleIdempotently(
+    const IdempotencyStore& store,
+    const userver::server::http::HttpRequest& request, int user_id,
+    const std::function<std::string()>& handle);
+
+}  // namespace split_bill
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+namespace split_bill {
+
+// Deepest offset the paged listings serve. Every shard returns all the rows
+// up to the end of the page, so a page costs O(shards * offset).
+inline constexpr size_t kMaxPageOffset = 10000;
+
+// Whether the page starts within kMaxPageOffset rows
+inline bool IsPageInReach(size_t page, size_t limit) {
+  return page - 1 <= kMaxPageOffset / limit;
+}
+
+// LIMIT/OFFSET each shard is queried with, so that merging the shard results
+// and skipping `skip` rows yields the requested page.
+struct TShardWindow {
+  int limit;
+  int offset;
+  size_t skip;
+};
+
+inline TShardWindow GetShardWindow(size_t page, size_t limit,
+                                   size_t shard_count) {
+  const size_t offset = (page - 1) * limit;
+  if (shard_count == 1) {
+    return {static_cast<int>(limit), static_cast<int>(offset), 0};
+  }
+  // Any shard may hold the whole page, so each one returns everything up to
+  // its end.
+  return {static_cast<int>(offset + limit), 0, offset};
+}
+
+// Merges per-shard pages sorted by `less` and cuts the requested page out.
+// The shards have to sort as `less` does: text compared as std::string is
+// ordered with COLLATE "C" in their queries, not by the database collation.
+template <typename T, typename Less>
+std::vector<T> MergeShardPages(std::vector<std::vector<T>>&& pages,
+                               const TShardWindow& window, size_t limit,
+                               Less less) {
+  if (pages.size() == 1) {
+    return std::move(pages.front());
+  }
+
+  std::vector<T> merged;
+  for (auto& page : pages) {
+    merged.insert(merged.end(), std::make_move_iterator(page.begin()),
+                  std::make_move_iterator(page.end()));
+  }
+  std::stable_sort(merged.begin(), merged.end(), less);
+
+  if (window.skip >= merged.size()) {
+    return {};
+  }
+  const auto first = merged.begin() + window.skip;
+  const auto last = first + std::min(limit, merged.size() - window.skip);
+  return {std::make_move_iterator(first), std::make_move_iterator(last)};
+}
+
+}  // namespace split_bill
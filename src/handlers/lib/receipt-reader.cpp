@@ -0,0 +1,200 @@
+#include "receipt-reader.hpp"
+
+#include <charconv>
+
+#include <userver/formats/json.hpp>
+
+#include "strings.hpp"
+
+namespace split_bill {
+
+namespace {
+
+constexpr size_t kMaxNameLength = 255;
+
+// Also takes the \r of CRLF line ends
+std::string_view TrimBlank(std::string_view value) {
+  return Trim(value, " \t\r");
+}
+
+template <typename T>
+std::optional<T> ParseNumber(std::string_view value) {
+  value = TrimBlank(value);
+  T result{};
+  const auto [end, error] =
+      std::from_chars(value.data(), value.data() + value.size(), result);
+  if (value.empty() || error != std::errc{} ||
+      end != value.data() + value.size()) {
+    return std::nullopt;
+  }
+  return result;
+}
+
+// Sets item.error unless the item is fit for the products table
+void Validate(TReceiptItem& item) {
+  if (item.error) {
+    return;
+  }
+  if (item.name.empty() || item.name.size() > kMaxNameLength) {
+    item.error = "'name' must be 1 to 255 characters long";
+  } else if (item.price < 0) {
+    item.error = "'price' must not be negative";
+  }
+}
+
+}  // namespace
+
+std::optional<EReceiptFormat> ParseReceiptFormat(
+    std::string_view content_type) {
+  // Drops parameters such as charset
+  content_type = TrimBlank(content_type.substr(0, content_type.find(';')));
+  if (content_type == "text/csv") {
+    return EReceiptFormat::kCsv;
+  }
+  if (content_type == "application/x-ndjson" ||
+      content_type == "application/jsonl") {
+    return EReceiptFormat::kNdjson;
+  }
+  return std::nullopt;
+}
+
+TReceiptReader::TReceiptReader(std::string_view body, EReceiptFormat format)
+    : body_(body), format_(format) {}
+
+bool TReceiptReader::Next(TReceiptItem& item) {
+  item.name.clear();
+  item.price = 0;
+  item.user_ids.clear();
+  item.error.reset();
+  const auto found =
+      format_ == EReceiptFormat::kCsv ? NextCsv(item) : NextNdjson(item);
+  if (found) {
+    Validate(item);
+  }
+  return found;
+}
+
+bool TReceiptReader::ReadCsvRecord(std::vector<std::string>& fields,
+                                   std::optional<std::string>& error) {
+  fields.clear();
+  if (pos_ >= body_.size()) {
+    return false;
+  }
+  fields.emplace_back();
+  bool quoted = false;
+  while (pos_ < body_.size()) {
+    const auto c = body_[pos_++];
+    if (quoted) {
+      if (c == '"') {
+        if (pos_ < body_.size() && body_[pos_] == '"') {
+          fields.back() += '"';
+          ++pos_;
+        } else {
+          quoted = false;
+        }
+      } else {
+        if (c == '\n') {
+          ++line_;
+        }
+        fields.back() += c;
+      }
+    } else if (c == '"' && TrimBlank(fields.back()).empty()) {
+      fields.back().clear();
+      quoted = true;
+    } else if (c == ',') {
+      fields.emplace_back();
+    } else if (c == '\n') {
+      ++line_;
+      return true;
+    } else {
+      fields.back() += c;
+    }
+  }
+  if (quoted) {
+    error = "Unterminated quoted field";
+  }
+  return true;
+}
+
+bool TReceiptReader::NextCsv(TReceiptItem& item) {
+  while (true) {
+    item.line = line_;
+    const auto header = pos_ == 0;
+    if (!ReadCsvRecord(fields_, item.error)) {
+      return false;
+    }
+    if (item.error) {
+      return true;
+    }
+    if (fields_.size() == 1 && TrimBlank(fields_[0]).empty()) {
+      continue;
+    }
+    if (header && TrimBlank(fields_[0]) == "name") {
+      continue;
+    }
+    break;
+  }
+
+  if (fields_.size() < 2 || fields_.size() > 3) {
+    item.error = "Expected 'name,price[,user_ids]'";
+    return true;
+  }
+  item.name = std::string{TrimBlank(fields_[0])};
+  const auto price = ParseNumber<int64_t>(fields_[1]);
+  if (!price) {
+    item.error = "'price' must be an integer";
+    return true;
+  }
+  item.price = *price;
+
+  if (fields_.size() == 3) {
+    std::string_view user_ids = fields_[2];
+    while (!TrimBlank(user_ids).empty()) {
+      const auto separator = user_ids.find(';');
+      const auto user_id = ParseNumber<int>(user_ids.substr(0, separator));
+      if (!user_id) {
+        item.error = "'user_ids' must be integers separated by ';'";
+        return true;
+      }
+      item.user_ids.push_back(*user_id);
+      if (separator == std::string_view::npos) {
+        break;
+      }
+      user_ids.remove_prefix(separator + 1);
+    }
+  }
+  return true;
+}
+
+bool TReceiptReader::NextNdjson(TReceiptItem& item) {
+  std::string_view line;
+  do {
+    if (pos_ >= body_.size()) {
+      return false;
+    }
+    const auto end = std::min(body_.find('\n', pos_), body_.size());
+    line = TrimBlank(body_.substr(pos_, end - pos_));
+    pos_ = end + 1;
+    item.line = line_++;
+  } while (line.empty());
+
+  try {
+    const auto object = userver::formats::json::FromString(line);
+    const auto name = object["name"].As<std::optional<std::string>>();
+    const auto price = object["price"].As<std::optional<int64_t>>();
+    if (!name || !price) {
+      item.error = "'name' and 'price' fields are required";
+      return true;
+    }
+    item.name = *name;
+    item.price = *price;
+    item.user_ids =
+        object["user_ids"].As<std::optional<std::vector<int>>>().value_or(
+            std::vector<int>{});
+  } catch (const std::exception&) {
+    item.error = "Invalid JSON object";
+  }
+  return true;
+}
+
+}  // namespace split_bill
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace split_bill {
+
+enum class EReceiptFormat { kCsv, kNdjson };
+
+// Receipt format by request Content-Type: text/csv or application/x-ndjson
+std::optional<EReceiptFormat> ParseReceiptFormat(std::string_view content_type);
+
+// Item of a receipt line, or the reason the line is invalid
+struct TReceiptItem {
+  size_t line = 0;  // 1-based line of the body the item starts on
+  std::string name;
+  int64_t price = 0;
+  std::vector<int> user_ids;
+  std::optional<std::string> error;
+};
+
+// Reads receipt items one at a time straight from the request body, without
+// building a document of the whole receipt. Blank lines are skipped.
+//
+// CSV: `name,price[,user_ids]` records, user ids separated by ';', fields
+// optionally double-quoted with "" for a quote. A first line starting with
+// a `name` field is a header.
+// NDJSON: one {"name": ..., "price": ..., "user_ids": [...]} object a line.
+class TReceiptReader {
+ public:
+  TReceiptReader(std::string_view body, EReceiptFormat format);
+
+  // Reads the next item into `item`, returns false at the end of the body
+  bool Next(TReceiptItem& item);
+
+ private:
+  bool NextCsv(TReceiptItem& item);
+  bool NextNdjson(TReceiptItem& item);
+  // Splits the next CSV record into `fields`, returns false at the end or
+  // sets `error` on an unterminated quote
+  bool ReadCsvRecord(std::vector<std::string>& fields,
+                     std::optional<std::string>& error);
+
+  std::string_view body_;
+  const EReceiptFormat format_;
+  size_t pos_ = 0;
+  size_t line_ = 1;
+  std::vector<std::string> fields_;
+};
+
+}  // namespace split_bill
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <optional>
+#include <string>
+
+#include <userver/server/http/http_request.hpp>
+#include <userver/server/http/http_status.hpp>
+
+#include "../../models/dto.hpp"
+#include "errors.hpp"
+
+namespace split_bill {
+
+// Reads the body of `request` into the DTO T in one pass. A body over
+// T::kMaxBodySize is a 413 and one not matching T a 400 naming the field,
+// e.g. "product.add[3].price: expected an integer at offset 1234"; either
+// way nullopt is returned and `error` is the response body.
+template <typename T>
+std::optional<T> ParseRequestBody(
+    const userver::server::http::HttpRequest& request, std::string& error) {
+  const auto& body = request.RequestBody();
+  if (body.size() > T::kMaxBodySize) {
+    error = kPayloadTooLargeError(request);
+    return std::nullopt;
+  }
+  try {
+    return ReadDto<T>(body);
+  } catch (const TJsonReadError& e) {
+    error = TErrorResponse{userver::server::http::HttpStatus::kBadRequest,
+                           e.what()}(request);
+    return std::nullopt;
+  }
+}
+
+}  // namespace split_bill
@@ -0,0 +1,68 @@
+#include "response-format.hpp"
+
+#include <userver/formats/json/serialize.hpp>
+#include <userver/http/common_headers.hpp>
+#include <userver/http/content_type.hpp>
+
+#include "../../models/msgpack.hpp"
+#include "strings.hpp"
+#include "vary.hpp"
+
+namespace split_bill {
+
+namespace {
+
+// Whether an Accept value such as "application/msgpack, */*;q=0.1" asks for
+// MessagePack
+bool AllowsMsgPack(std::string_view accept) {
+  while (!accept.empty()) {
+    const auto comma = accept.find(',');
+    auto media_range = accept.substr(0, comma);
+    accept.remove_prefix(comma == std::string_view::npos ? accept.size()
+                                                         : comma + 1);
+
+    const auto semicolon = media_range.find(';');
+    const auto type = Trim(media_range.substr(0, semicolon));
+    if (!EqualsIgnoreCase(type, kMsgPackContentType) &&
+        !EqualsIgnoreCase(type, "application/x-msgpack")) {
+      continue;
+    }
+    bool rejected = false;
+    if (semicolon != std::string_view::npos) {
+      const auto parameter = Trim(media_range.substr(semicolon + 1));
+      // q=0, q=0.0, q=0.000 refuse the type
+      rejected = parameter.size() >= 3 &&
+                 (parameter[0] == 'q' || parameter[0] == 'Q') &&
+                 parameter[1] == '=' &&
+                 parameter.find_first_not_of("0.", 2) ==
+                     std::string_view::npos;
+    }
+    if (!rejected) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+EResponseFormat NegotiateResponseFormat(
+    const userver::server::http::HttpRequest& request) {
+  AddVary(request, userver::http::headers::kAccept);
+  auto& response = request.GetHttpResponse();
+  if (AllowsMsgPack(request.GetHeader(userver::http::headers::kAccept))) {
+    response.SetContentType(
+        userver::http::ContentType{std::string{kMsgPackContentType}});
+    return EResponseFormat::kMsgPack;
+  }
+  response.SetContentType(userver::http::content_type::kApplicationJson);
+  return EResponseFormat::kJson;
+}
+
+std::string JsonToMsgPack(std::string_view json) {
+  TMsgPackWriter writer;
+  WriteToMsgPack(userver::formats::json::FromString(json), writer);
+  return writer.ExtractString();
+}
+
+}  // namespace split_bill
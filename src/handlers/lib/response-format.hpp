@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <userver/server/http/http_request.hpp>
+
+namespace split_bill {
+
+enum class EResponseFormat : uint8_t { kJson, kMsgPack };
+
+// MessagePack when the Accept header lists application/msgpack (or
+// application/x-msgpack) without q=0, JSON otherwise. Sets the matching
+// Content-Type on the response and adds Accept to its Vary.
+EResponseFormat NegotiateResponseFormat(
+    const userver::server::http::HttpRequest& request);
+
+// MessagePack body of a stored JSON document, such as an archived room
+// response
+std::string JsonToMsgPack(std::string_view json);
+
+}  // namespace split_bill
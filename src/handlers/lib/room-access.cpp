@@ -0,0 +1,65 @@
+#include "room-access.hpp"
+
+#include <string>
+#include <unordered_map>
+
+#include "../../components/query-stats.hpp"
+
+namespace split_bill {
+
+namespace {
+
+using TRoomAccessMemo = std::unordered_map<int, std::optional<TRoomAccess>>;
+
+const std::string kRoomAccessKey = "split_bill_room_access";
+
+TRoomAccessMemo& GetMemo(userver::server::request::RequestContext& context) {
+  if (auto* memo = context.GetDataOptional<TRoomAccessMemo>(kRoomAccessKey)) {
+    return *memo;
+  }
+  return context.SetData<TRoomAccessMemo>(kRoomAccessKey, TRoomAccessMemo{});
+}
+
+}  // namespace
+
+std::optional<TRoomAccess> GetRoomAccess(
+    userver::server::request::RequestContext& context,
+    const ShardRouter& shard_router, int room_id) {
+  auto& memo = GetMemo(context);
+  if (const auto it = memo.find(room_id); it != memo.end()) {
+    return it->second;
+  }
+
+  auto result = CountedExecute(
+      shard_router.ForRoom(room_id),
+      userver::storages::postgres::ClusterHostType::kMaster,
+      "SELECT user_id, archived FROM rooms WHERE id = $1", room_id);
+  std::optional<TRoomAccess> access;
+  if (!result.IsEmpty()) {
+    const auto row = result.Front();
+    access = TRoomAccess{row["user_id"].As<int>(), row["archived"].As<bool>()};
+  }
+  memo.emplace(room_id, access);
+  return access;
+}
+
+void UnarchiveRoom(userver::server::request::RequestContext& context,
+                   userver::storages::postgres::Transaction& transaction,
+                   int room_id) {
+  // The flag memoized by GetRoomAccess may predate an archiving committed
+  // since; the lock makes room-archiver wait for this transaction, and fail
+  // on the version it bumps
+  const auto archived = CountedExecute(
+      transaction, "SELECT archived FROM rooms WHERE id = $1 FOR UPDATE",
+      room_id);
+  if (archived.IsEmpty() || !archived.AsSingleRow<bool>()) {
+    return;
+  }
+  CountedExecute(transaction, "SELECT unarchive_room($1)", room_id);
+  auto& memo = GetMemo(context);
+  if (const auto it = memo.find(room_id); it != memo.end() && it->second) {
+    it->second->archived = false;
+  }
+}
+
+}  // namespace split_bill
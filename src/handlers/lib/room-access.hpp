@@ -0,0 +1,32 @@
+#pragma once
+
+#include <optional>
+
+#include <userver/server/request/request_context.hpp>
+#include <userver/storages/postgres/cluster.hpp>
+#include <userver/storages/postgres/transaction.hpp>
+
+#include "../../components/shard-router.hpp"
+
+namespace split_bill {
+
+struct TRoomAccess {
+  int owner_id;
+  bool archived;
+};
+
+// Owner and archive flag of a room, nullopt if there is no such room. Read
+// from the primary once per request: later calls for the same room are
+// answered from the request context.
+std::optional<TRoomAccess> GetRoomAccess(
+    userver::server::request::RequestContext& context,
+    const ShardRouter& shard_router, int room_id);
+
+// Moves the rows of an archived room back from room_archive in the
+// transaction about to change the room, reading the archive flag there
+// under a row lock. Does nothing for a room that isn't archived.
+void UnarchiveRoom(userver::server::request::RequestContext& context,
+                   userver::storages::postgres::Transaction& transaction,
+                   int room_id);
+
+}  // namespace split_bill
@@ -0,0 +1,81 @@
+#include "room-version.hpp"
+
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <userver/http/common_headers.hpp>
+
+#include "../../components/query-stats.hpp"
+#include "args.hpp"
+#include "strings.hpp"
+
+namespace split_bill {
+
+namespace {
+
+constexpr std::string_view kMsgPackSuffix = "-msgpack";
+
+}  // namespace
+
+void SetRoomETag(const userver::server::http::HttpRequest& request,
+                 int64_t version, EResponseFormat format) {
+  auto tag = '"' + std::to_string(version);
+  if (format == EResponseFormat::kMsgPack) {
+    tag += kMsgPackSuffix;
+  }
+  tag += '"';
+  request.GetHttpResponse().SetHeader(userver::http::headers::kETag,
+                                      std::move(tag));
+}
+
+std::optional<std::vector<int64_t>> GetIfMatchVersions(
+    const userver::server::http::HttpRequest& request) {
+  if (!request.HasHeader(userver::http::headers::kIfMatch)) {
+    return std::nullopt;
+  }
+  std::string_view header =
+      request.GetHeader(userver::http::headers::kIfMatch);
+  if (Trim(header) == "*") {
+    return std::nullopt;
+  }
+
+  std::vector<int64_t> versions;
+  while (!header.empty()) {
+    const auto comma = header.find(',');
+    const auto tag = Trim(header.substr(0, comma));
+    header = comma == std::string_view::npos ? std::string_view{}
+                                             : header.substr(comma + 1);
+    if (tag.size() < 2 || tag.front() != '"' || tag.back() != '"') {
+      continue;
+    }
+    auto opaque = tag.substr(1, tag.size() - 2);
+    if (opaque.size() > kMsgPackSuffix.size() &&
+        opaque.substr(opaque.size() - kMsgPackSuffix.size()) ==
+            kMsgPackSuffix) {
+      opaque.remove_suffix(kMsgPackSuffix.size());
+    }
+    if (const auto version = ParseInteger<int64_t>(opaque)) {
+      versions.push_back(*version);
+    }
+  }
+  return versions;
+}
+
+bool ClaimRoomVersion(const userver::server::http::HttpRequest& request,
+                      userver::storages::postgres::Transaction& transaction,
+                      int room_id) {
+  const auto versions = GetIfMatchVersions(request);
+  if (!versions) {
+    return true;
+  }
+  // Under read committed a concurrent claim of the same version makes this
+  // one wait for its commit and then find a newer version
+  return !CountedExecute(transaction,
+                         "UPDATE rooms SET version = version + 1 "
+                         "WHERE id = $1 AND version = ANY($2) RETURNING id",
+                         room_id, *versions)
+              .IsEmpty();
+}
+
+}  // namespace split_bill
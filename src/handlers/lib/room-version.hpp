@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include <userver/server/http/http_request.hpp>
+#include <userver/storages/postgres/transaction.hpp>
+
+#include "response-format.hpp"
+
+namespace split_bill {
+
+// ETag of GET /v1/rooms/{id}: the quoted rooms.version, which the schema
+// triggers bump on every change of the room, followed by "-msgpack" for the
+// MessagePack body so that the two bodies of a version differ in tag
+void SetRoomETag(const userver::server::http::HttpRequest& request,
+                 int64_t version, EResponseFormat format);
+
+// Room versions the If-Match header of `request` lists, nullopt if any
+// version matches: without the header or with "*". Tags of either format
+// match their version, weak and malformed ones none.
+std::optional<std::vector<int64_t>> GetIfMatchVersions(
+    const userver::server::http::HttpRequest& request);
+
+// Checks the If-Match precondition of a request changing the room and bumps
+// the version in `transaction`. Of concurrent requests sent with the same
+// ETag the first one passes; the others wait only for it to commit and then
+// fail instead of overwriting its changes. True without If-Match.
+bool ClaimRoomVersion(const userver::server::http::HttpRequest& request,
+                      userver::storages::postgres::Transaction& transaction,
+                      int room_id);
+
+}  // namespace split_bill
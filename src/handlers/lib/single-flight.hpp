@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+#include <userver/engine/condition_variable.hpp>
+#include <userver/engine/mutex.hpp>
+#include <userver/engine/task/cancel.hpp>
+#include <userver/server/request/task_inherited_data.hpp>
+
+namespace split_bill {
+
+// Coalesces concurrent calls with equal keys: the first caller runs `func`,
+// callers arriving while it runs wait for it and get a copy of its result
+// or exception. Nothing is kept once the call finishes, so this is not a
+// cache, and callers never see a result computed before they arrived.
+//
+// A leader cancelled or past its deadline hands the call over rather than
+// its exception: the first waiter runs `func` again as the new leader.
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class SingleFlight final {
+ public:
+  // `coalesced` is incremented for every call served by another one
+  explicit SingleFlight(std::atomic<uint64_t>& coalesced)
+      : coalesced_(coalesced) {}
+
+  template <typename Func>
+  Value Run(const Key& key, const Func& func) {
+    while (true) {
+      std::unique_lock lock(mutex_);
+      if (const auto it = calls_.find(key); it != calls_.end()) {
+        const auto call = it->second;
+        lock.unlock();
+        if (auto value = call->Wait()) {
+          ++coalesced_;
+          return std::move(*value);
+        }
+        continue;  // the leader gave up
+      }
+      const auto call = std::make_shared<TCall>();
+      calls_.emplace(key, call);
+      lock.unlock();
+
+      // Forgotten before finishing, so that waiters taking over don't find
+      // the finished call again
+      try {
+        auto value = func();
+        Forget(key);
+        call->Finish(value, {});
+        return value;
+      } catch (...) {
+        Forget(key);
+        if (GaveUp()) {
+          call->Finish(std::nullopt, {});
+        } else {
+          call->Finish(std::nullopt, std::current_exception());
+        }
+        throw;
+      }
+    }
+  }
+
+ private:
+  class TCall final {
+   public:
+    void Finish(std::optional<Value> value, std::exception_ptr exception) {
+      {
+        std::lock_guard lock(mutex_);
+        value_ = std::move(value);
+        exception_ = std::move(exception);
+        finished_ = true;
+      }
+      finished_cv_.NotifyAll();
+    }
+
+    // Nothing if the leader gave up
+    std::optional<Value> Wait() {
+      std::unique_lock lock(mutex_);
+      if (!finished_cv_.Wait(lock, [this] { return finished_; })) {
+        throw userver::engine::WaitInterruptedException(
+            userver::engine::current_task::CancellationReason());
+      }
+      if (exception_) {
+        std::rethrow_exception(exception_);
+      }
+      return value_;
+    }
+
+   private:
+    userver::engine::Mutex mutex_;
+    userver::engine::ConditionVariable finished_cv_;
+    bool finished_{false};
+    std::optional<Value> value_;
+    std::exception_ptr exception_;
+  };
+
+  // Whether the failure is the caller's own rather than the call's
+  static bool GaveUp() {
+    return userver::engine::current_task::ShouldCancel() ||
+           userver::server::request::GetTaskInheritedDeadline().IsReached();
+  }
+
+  void Forget(const Key& key) {
+    std::lock_guard lock(mutex_);
+    calls_.erase(key);
+  }
+
+  std::atomic<uint64_t>& coalesced_;
+  userver::engine::Mutex mutex_;
+  std::unordered_map<Key, std::shared_ptr<TCall>, Hash> calls_;
+};
+
+}  // namespace split_bill
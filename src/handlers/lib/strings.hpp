@@ -0,0 +1,30 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <string_view>
+
+namespace split_bill {
+
+// `value` without the leading and trailing `characters`, by default the
+// optional whitespace of HTTP header values
+inline std::string_view Trim(std::string_view value,
+                             std::string_view characters = " \t") {
+  const auto begin = value.find_first_not_of(characters);
+  if (begin == std::string_view::npos) {
+    return {};
+  }
+  const auto end = value.find_last_not_of(characters);
+  return value.substr(begin, end - begin + 1);
+}
+
+// ASCII case-insensitive comparison, as for header values and tokens
+inline bool EqualsIgnoreCase(std::string_view lhs, std::string_view rhs) {
+  return lhs.size() == rhs.size() &&
+         std::equal(lhs.begin(), lhs.end(), rhs.begin(), [](char l, char r) {
+           return std::tolower(static_cast<unsigned char>(l)) ==
+                  std::tolower(static_cast<unsigned char>(r));
+         });
+}
+
+}  // namespace split_bill
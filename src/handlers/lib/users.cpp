@@ -0,0 +1,29 @@
+#include "users.hpp"
+#include "../../components/query-stats.hpp"
+
+namespace split_bill {
+
+std::unordered_map<int, TUserInfo> GetUsersInfo(
+    userver::storages::postgres::ClusterPtr pg_cluster,
+    const std::vector<int>& user_ids) {
+    std::unordered_map<int, TUserInfo> users;
+    if (user_ids.empty()) {
+        return users;
+    }
+
+    auto result = CountedExecute(
+        pg_cluster, userver::storages::postgres::ClusterHostType::kSlave,
+        "SELECT id, username, full_name, photo_url FROM users "
+        "WHERE id = ANY($1)",
+        user_ids
+    );
+
+    users.reserve(result.Size());
+    for (auto& user : result.AsContainer<std::vector<TUserInfo>>(
+             userver::storages::postgres::kRowTag)) {
+        users.emplace(user.id, std::move(user));
+    }
+    return users;
+}
+
+}  // namespace split_bill
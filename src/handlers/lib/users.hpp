@@ -0,0 +1,18 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include <userver/storages/postgres/cluster.hpp>
+
+#include "../../models/user.hpp"
+
+namespace split_bill {
+
+// Users live on the global shard only, so room-scoped handlers resolve names
+// and avatars with a separate lookup instead of a JOIN.
+std::unordered_map<int, TUserInfo> GetUsersInfo(
+    userver::storages::postgres::ClusterPtr pg_cluster,
+    const std::vector<int>& user_ids);
+
+}  // namespace split_bill
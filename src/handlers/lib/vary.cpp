@@ -0,0 +1,36 @@
+#include "vary.hpp"
+
+#include <string>
+#include <utility>
+
+#include <userver/http/common_headers.hpp>
+
+#include "strings.hpp"
+
+namespace split_bill {
+
+void AddVary(const userver::server::http::HttpRequest& request,
+             std::string_view header) {
+  auto& response = request.GetHttpResponse();
+  if (!response.HasHeader(userver::http::headers::kVary)) {
+    response.SetHeader(userver::http::headers::kVary, std::string{header});
+    return;
+  }
+
+  std::string_view vary = response.GetHeader(userver::http::headers::kVary);
+  std::string merged{vary};
+  while (!vary.empty()) {
+    const auto comma = vary.find(',');
+    const auto listed = Trim(vary.substr(0, comma));
+    if (listed == "*" || EqualsIgnoreCase(listed, header)) {
+      return;
+    }
+    vary.remove_prefix(comma == std::string_view::npos ? vary.size()
+                                                       : comma + 1);
+  }
+  merged += ", ";
+  merged += header;
+  response.SetHeader(userver::http::headers::kVary, std::move(merged));
+}
+
+}  // namespace split_bill
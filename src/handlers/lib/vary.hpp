@@ -0,0 +1,14 @@
+#pragma once
+
+#include <string_view>
+
+#include <userver/server/http/http_request.hpp>
+
+namespace split_bill {
+
+// Adds `header` to the Vary header of the response, keeping the headers
+// already listed there
+void AddVary(const userver::server::http::HttpRequest& request,
+             std::string_view header);
+
+}  // namespace split_bill
@@ -0,0 +1,65 @@
+#include "view.hpp"
+
+#include <chrono>
+#include <string>
+#include <utility>
+
+#include <userver/components/component_context.hpp>
+#include <userver/http/content_type.hpp>
+#include <userver/server/handlers/http_handler_base.hpp>
+#include <userver/server/http/http_status.hpp>
+
+#include "../../lib/args.hpp"
+#include "../../lib/cpu-profiler.hpp"
+
+namespace split_bill {
+
+namespace {
+
+constexpr int kDefaultSeconds = 10;
+constexpr int kMaxSeconds = 60;
+// Off the 100 Hz of timers, not to sample in step with them
+constexpr int kDefaultHz = 99;
+constexpr int kMaxHz = 1000;
+
+// Samples the CPU for ?seconds= and returns the folded stacks, ready for
+// flamegraph.pl. Served on the monitor listener only.
+class CpuProfile final : public userver::server::handlers::HttpHandlerBase {
+ public:
+  static constexpr std::string_view kName = "handler-service-cpu-profile";
+
+  using HttpHandlerBase::HttpHandlerBase;
+
+  std::string HandleRequestThrow(
+      const userver::server::http::HttpRequest& request,
+      userver::server::request::RequestContext&) const override {
+    auto& response = request.GetHttpResponse();
+    response.SetContentType(userver::http::content_type::kTextPlain);
+
+    const auto seconds = request.HasArg("seconds")
+                             ? GetIntArg(request, "seconds")
+                             : kDefaultSeconds;
+    const auto hz = request.HasArg("hz") ? GetIntArg(request, "hz")
+                                         : kDefaultHz;
+    if (!seconds || *seconds < 1 || *seconds > kMaxSeconds || !hz ||
+        *hz < 1 || *hz > kMaxHz) {
+      response.SetStatus(userver::server::http::HttpStatus::kBadRequest);
+      return "seconds must be 1 to 60 and hz 1 to 1000\n";
+    }
+
+    auto profile = CaptureCpuProfile(std::chrono::seconds{*seconds}, *hz);
+    if (!profile) {
+      response.SetStatus(userver::server::http::HttpStatus::kConflict);
+      return "Another profile is running\n";
+    }
+    return std::move(*profile);
+  }
+};
+
+}  // namespace
+
+void AppendCpuProfile(userver::components::ComponentList& component_list) {
+  component_list.Append<CpuProfile>();
+}
+
+}  // namespace split_bill
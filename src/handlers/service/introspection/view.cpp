@@ -0,0 +1,86 @@
+#include "view.hpp"
+
+#include <userver/components/component_context.hpp>
+#include <userver/components/statistics_storage.hpp>
+#include <userver/formats/json.hpp>
+#include <userver/http/content_type.hpp>
+#include <userver/server/handlers/http_handler_base.hpp>
+#include <userver/utils/statistics/json.hpp>
+#include <userver/utils/statistics/storage.hpp>
+
+#include "../../../components/idempotency-store.hpp"
+#include "../../../components/room-snapshot-cache.hpp"
+#include "../../../components/user-search-cache.hpp"
+#include "../../lib/allocator-stats.hpp"
+
+namespace split_bill {
+
+namespace {
+
+userver::formats::json::Value ToJson(const TCacheMemory& memory) {
+  userver::formats::json::ValueBuilder json;
+  json["entries"] = memory.entries;
+  json["bytes"] = memory.bytes;
+  return json.ExtractValue();
+}
+
+// Memory held by the allocator and the in-memory caches, and the engine
+// metrics: coroutine pool usage and the task processor queues. Served on
+// the monitor listener only.
+class Introspection final
+    : public userver::server::handlers::HttpHandlerBase {
+ public:
+  static constexpr std::string_view kName = "handler-service-introspection";
+
+  Introspection(const userver::components::ComponentConfig& config,
+                const userver::components::ComponentContext& component_context)
+      : HttpHandlerBase(config, component_context),
+        snapshot_cache_(component_context.FindComponent<RoomSnapshotCache>()),
+        search_cache_(component_context.FindComponent<UserSearchCache>()),
+        idempotency_store_(
+            component_context.FindComponent<IdempotencyStore>()),
+        statistics_(
+            component_context
+                .FindComponent<userver::components::StatisticsStorage>()
+                .GetStorage()) {}
+
+  std::string HandleRequestThrow(
+      const userver::server::http::HttpRequest& request,
+      userver::server::request::RequestContext&) const override {
+    request.GetHttpResponse().SetContentType(
+        userver::http::content_type::kApplicationJson);
+
+    userver::formats::json::ValueBuilder response;
+    response["allocator"] = GetAllocatorStats();
+
+    const auto rooms = snapshot_cache_.GetMemoryUsage();
+    response["caches"]["room-snapshots"] = ToJson(rooms.snapshots);
+    response["caches"]["archived-rooms"] = ToJson(rooms.archived);
+    const auto search_index = search_cache_.Get();
+    response["caches"]["user-search"] =
+        ToJson({search_index->Size(), search_index->MemoryUsage()});
+    response["caches"]["idempotency"] =
+        ToJson(idempotency_store_.GetMemoryUsage());
+
+    response["engine"] = userver::formats::json::FromString(
+        userver::utils::statistics::ToJsonFormat(
+            statistics_,
+            userver::utils::statistics::Request::MakeWithPrefix("engine")));
+
+    return userver::formats::json::ToString(response.ExtractValue());
+  }
+
+ private:
+  const RoomSnapshotCache& snapshot_cache_;
+  const UserSearchCache& search_cache_;
+  const IdempotencyStore& idempotency_store_;
+  userver::utils::statistics::Storage& statistics_;
+};
+
+}  // namespace
+
+void AppendIntrospection(userver::components::ComponentList& component_list) {
+  component_list.Append<Introspection>();
+}
+
+}  // namespace split_bill
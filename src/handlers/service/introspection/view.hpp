@@ -0,0 +1,9 @@
+#pragma once
+
+#include <userver/components/component_list.hpp>
+
+namespace split_bill {
+
+void AppendIntrospection(userver::components::ComponentList& component_list);
+
+}  // namespace split_bill
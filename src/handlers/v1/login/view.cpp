@@ -12,6 +12,14 @@
 #include <userver/utils/assert.hpp>
 #include <userver/crypto/hash.hpp>
 
+#include "../../../components/admission-control.hpp"
+#include "../../../components/query-stats.hpp"
+#include "../../../components/request-logging.hpp"
+#include "../../../components/shard-router.hpp"
+#include "../../../components/traffic-capture.hpp"
+#include "../../lib/admission.hpp"
+#include "../../lib/request-body.hpp"
+#include "../../../models/requests.hpp"
 #include "../../../models/user.hpp"
 
 namespace split_bill {
@@ -25,21 +33,35 @@ public:
     LoginUser(const userver::components::ComponentConfig& config,
               const userver::components::ComponentContext& component_context)
         : HttpHandlerBase(config, component_context),
-            pg_cluster_(
-                component_context
-                    .FindComponent<userver::components::Postgres>("postgres-db-1")
-                    .GetCluster()) {}
+            shard_router_(component_context.FindComponent<ShardRouter>()),
+            admission_control_(
+                component_context.FindComponent<AdmissionControl>()),
+            query_stats_(component_context.FindComponent<QueryStats>()),
+            request_logging_(
+                component_context.FindComponent<RequestLogging>()),
+            traffic_capture_(
+                component_context.FindComponent<TrafficCapture>()) {}
 
     std::string HandleRequestThrow(
         const userver::server::http::HttpRequest& request,
         userver::server::request::RequestContext&
     ) const override {
+        const auto query_stats = query_stats_.Track(request);
+        const auto request_log = request_logging_.Track(request, kName);
+        const auto capture = traffic_capture_.Track(
+            request, kName, ECaptureBody::kCredentials);
         request.GetHttpResponse().SetContentType(userver::http::content_type::kApplicationJson);
-        auto request_body = userver::formats::json::FromString(request.RequestBody());
-
-
-        auto username = request_body["username"].As<std::optional<std::string>>();
-        auto password = request_body["password"].As<std::optional<std::string>>();
+        const auto admission = admission_control_.Admit(
+            request, EEndpointClass::kWrite);
+        if (!admission) {
+            return RejectRequest(request, admission);
+        }
+        std::string error;
+        const auto body = ParseRequestBody<TLoginRequest>(request, error);
+        if (!body) {
+            return error;
+        }
+        const auto& [username, password] = *body;
 
       if (!username || !password) {
         request.SetResponseStatus(userver::server::http::HttpStatus::kBadRequest);
@@ -48,7 +70,8 @@ public:
         return userver::formats::json::ToString(response.ExtractValue());
       }
 
-        auto userResult = pg_cluster_->Execute(
+        auto userResult = CountedExecute(
+            shard_router_.Global(),
             userver::storages::postgres::ClusterHostType::kSlave,
             "SELECT * FROM users "
             "WHERE username = $1 ",
@@ -71,7 +94,8 @@ public:
             return {};
         }
 
-        auto result = pg_cluster_->Execute(
+        auto result = CountedExecute(
+            shard_router_.Global(),
             userver::storages::postgres::ClusterHostType::kSlave,
             "INSERT INTO auth_sessions(user_id) VALUES($1) "
             "ON CONFLICT DO NOTHING "
@@ -79,14 +103,21 @@ public:
             user.id
         );
 
+        const TSession session{result.AsSingleRow<int>(), user.id};
+        admission_control_.RememberSession(session);
+
         userver::formats::json::ValueBuilder response;
-        response["id"] = result.AsSingleRow<int>();
+        response["id"] = session.id;
 
         return userver::formats::json::ToString(response.ExtractValue());
     }
 
 private:
-    userver::storages::postgres::ClusterPtr pg_cluster_;
+    const ShardRouter& shard_router_;
+    const AdmissionControl& admission_control_;
+    const QueryStats& query_stats_;
+    const RequestLogging& request_logging_;
+    const TrafficCapture& traffic_capture_;
 };
 
 }  // namespace
@@ -5,45 +5,56 @@
 
 #include <userver/components/component_context.hpp>
 #include <userver/formats/json.hpp>
-#include <userver/server/handlers/http_handler_base.hpp>
 
 #include <userver/storages/postgres/cluster.hpp>
 #include <userver/storages/postgres/component.hpp>
 #include <userver/utils/assert.hpp>
 
+#include "../../../../components/idempotency-store.hpp"
 #include "../../../../models/product.hpp"
-#include "../../../lib/auth.hpp"
+#include "../../../lib/authenticated-handler.hpp"
+#include "../../../lib/idempotency.hpp"
+#include "../../../lib/room-access.hpp"
+#include "../../../lib/room-version.hpp"
 
 namespace split_bill {
 
 namespace {
 
-class AddProduct final : public userver::server::handlers::HttpHandlerBase {
+const TErrorResponse kMissingFieldsError{
+    userver::server::http::HttpStatus::kBadRequest,
+    "'name', 'price', and 'room_id' fields are required."};
+const TErrorResponse kInvalidRoomError{
+    userver::server::http::HttpStatus::kNotFound, "Room ID is Invalid!"};
+const TErrorResponse kProductExistsError{
+    userver::server::http::HttpStatus::kConflict, "Product already exists."};
+
+class AddProduct final : public AuthenticatedJsonHandler<AddProduct> {
  public:
   static constexpr std::string_view kName = "handler-v1-add-product";
+  static constexpr auto kEndpointClass = EEndpointClass::kWrite;
 
   AddProduct(const userver::components::ComponentConfig& config,
              const userver::components::ComponentContext& component_context)
-      : HttpHandlerBase(config, component_context),
-        pg_cluster_(
-            component_context
-                .FindComponent<userver::components::Postgres>("postgres-db-1")
-                .GetCluster()) {}
+      : AuthenticatedJsonHandler(config, component_context),
+        idempotency_store_(
+            component_context.FindComponent<IdempotencyStore>()) {}
 
-  std::string HandleRequestThrow(
+  std::string HandleAuthenticated(
       const userver::server::http::HttpRequest& request,
-      userver::server::request::RequestContext&) const override {
-    request.GetHttpResponse().SetContentType(
-        userver::http::content_type::kApplicationJson);
-    auto session = GetSessionInfo(pg_cluster_, request);
-    if (!session) {
-      request.SetResponseStatus(
-          userver::server::http::HttpStatus::kUnauthorized);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "Unauthorized";
-      return userver::formats::json::ToString(response.ExtractValue());
-    }
+      userver::server::request::RequestContext& context,
+      const TSession& session) const {
+    // Retries with the same Idempotency-Key get the first response
+    return HandleIdempotently(
+        idempotency_store_, request, session.user_id,
+        [&] { return CreateProduct(request, context, session); });
+  }
 
+ private:
+  std::string CreateProduct(
+      const userver::server::http::HttpRequest& request,
+      userver::server::request::RequestContext& context,
+      const TSession& session) const {
     auto request_body =
         userver::formats::json::FromString(request.RequestBody());
     auto name = request_body["name"].As<std::optional<std::string>>();
@@ -51,48 +62,40 @@ class AddProduct final : public userver::server::handlers::HttpHandlerBase {
     auto room_id = request_body["room_id"].As<std::optional<int>>();
 
     if (!name || !price || !room_id) {
-      request.SetResponseStatus(userver::server::http::HttpStatus::kBadRequest);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "'name', 'price', and 'room_id' fields are required.";
-      return userver::formats::json::ToString(response.ExtractValue());
+      return kMissingFieldsError(request);
+    }
+    if (!GetRoomAccess(context, shard_router_, *room_id)) {
+      return kInvalidRoomError(request);
     }
-    auto check_result = pg_cluster_->Execute(
-        userver::storages::postgres::ClusterHostType::kMaster,
-        "SELECT 1 FROM rooms WHERE id = $1 "
-        "LIMIT 1",
-        *room_id);
-
-    if (check_result.IsEmpty()) {
-      request.SetResponseStatus(userver::server::http::HttpStatus::kNotFound);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "Room ID is Invalid!";
-      return userver::formats::json::ToString(response.ExtractValue());
+    auto pg_cluster = shard_router_.ForRoom(*room_id);
+    auto transaction = pg_cluster->Begin(
+        userver::storages::postgres::TransactionOptions(),
+        userver::storages::postgres::OptionalCommandControl{});
+    if (!ClaimRoomVersion(request, transaction, *room_id)) {
+      return kRoomChangedError(request);
     }
-    LOG_INFO() << "Adding product: " << *name << " " << *price << " "
-               << *room_id;
+    // Restores the archived products first, the name may be taken by one
+    UnarchiveRoom(context, transaction, *room_id);
 
-    auto result = pg_cluster_->Execute(
-        userver::storages::postgres::ClusterHostType::kSlave,
+    auto result = CountedExecute(
+        transaction,
         "INSERT INTO products (name, price, room_id) VALUES($1, $2, $3) "
-        "ON CONFLICT (name, room_id) DO NOTHING "
+        "ON CONFLICT (name, room_id) WHERE deleted_at IS NULL DO NOTHING "
         "RETURNING id, name, price, room_id",
         name.value(), price.value(), room_id.value());
 
     if (!result.IsEmpty()) {
+      transaction.Commit();
       auto product =
           result.AsSingleRow<TProduct>(userver::storages::postgres::kRowTag);
       return ToString(
           userver::formats::json::ValueBuilder{product}.ExtractValue());
     } else {
-      request.SetResponseStatus(userver::server::http::HttpStatus::kConflict);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "Product already exists.";
-      return userver::formats::json::ToString(response.ExtractValue());
+      return kProductExistsError(request);
     }
   }
 
- private:
-  userver::storages::postgres::ClusterPtr pg_cluster_;
+  const IdempotencyStore& idempotency_store_;
 };
 
 }  // namespace
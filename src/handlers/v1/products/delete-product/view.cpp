@@ -1,84 +1,85 @@
 #include "view.hpp"
 
 #include <fmt/format.h>
+#include <tuple>
 
 #include <userver/components/component_context.hpp>
-#include <userver/server/handlers/http_handler_base.hpp>
 #include <userver/server/http/http_status.hpp>
 #include <userver/storages/postgres/cluster.hpp>
 #include <userver/storages/postgres/component.hpp>
 #include <userver/utils/assert.hpp>
 
-#include "../../../lib/auth.hpp"
+#include "../../../lib/args.hpp"
+#include "../../../lib/authenticated-handler.hpp"
+#include "../../../lib/room-version.hpp"
 
 namespace split_bill {
 
 namespace {
 
-class DeleteProduct final : public userver::server::handlers::HttpHandlerBase {
+const TErrorResponse kProductNotFoundError{
+    userver::server::http::HttpStatus::kNotFound,
+    "Product not found or access denied"};
+
+class DeleteProduct final : public AuthenticatedJsonHandler<DeleteProduct> {
  public:
   static constexpr std::string_view kName = "handler-v1-delete-product";
+  static constexpr auto kEndpointClass = EEndpointClass::kWrite;
 
   DeleteProduct(const userver::components::ComponentConfig& config,
                 const userver::components::ComponentContext& component_context)
-      : HttpHandlerBase(config, component_context),
-        pg_cluster_(
-            component_context
-                .FindComponent<userver::components::Postgres>("postgres-db-1")
-                .GetCluster()) {}
+      : AuthenticatedJsonHandler(config, component_context) {}
 
-  std::string HandleRequestThrow(
+  std::string HandleAuthenticated(
       const userver::server::http::HttpRequest& request,
-      userver::server::request::RequestContext&) const override {
-    request.GetHttpResponse().SetContentType(
-        userver::http::content_type::kApplicationJson);
-
-    auto session = GetSessionInfo(pg_cluster_, request);
-    if (!session) {
-      request.SetResponseStatus(
-          userver::server::http::HttpStatus::kUnauthorized);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "Unauthorized";
-      return userver::formats::json::ToString(response.ExtractValue());
-    }
-
-    const auto& id_str = request.GetPathArg("id");
-    int product_id;
-    try {
-      product_id = std::stoi(id_str);
-    } catch (const std::exception&) {
-      request.SetResponseStatus(userver::server::http::HttpStatus::kBadRequest);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "Invalid product ID";
-      return userver::formats::json::ToString(response.ExtractValue());
+      userver::server::request::RequestContext&,
+      const TSession& session) const {
+    const auto product_id = GetIntPathArg(request, "id");
+    if (!product_id) {
+      return kInvalidProductIdError(request);
     }
 
-    auto result = pg_cluster_->Execute(
-        userver::storages::postgres::ClusterHostType::kSlave,
-        "SELECT p.id FROM products p "
-        "JOIN rooms r ON p.room_id = r.id "
-        "WHERE p.id = $1 AND r.user_id = $2",
-        product_id, session->user_id);
+    auto pg_cluster = shard_router_.ForProduct(*product_id);
+    auto result = CountedExecute(
+        pg_cluster, userver::storages::postgres::ClusterHostType::kSlave,
+        "SELECT l.room_id, r.archived FROM product_rooms l "
+        "JOIN rooms r ON l.room_id = r.id "
+        "WHERE l.id = $1 AND r.user_id = $2",
+        *product_id, session.user_id);
 
     if (result.IsEmpty()) {
-      request.SetResponseStatus(userver::server::http::HttpStatus::kNotFound);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "Product not found or access denied";
-      return userver::formats::json::ToString(response.ExtractValue());
+      return kProductNotFoundError(request);
+    }
+    const auto [room_id, archived] =
+        result.AsSingleRow<std::tuple<int, bool>>(
+            userver::storages::postgres::kRowTag);
+    auto transaction = pg_cluster->Begin(
+        userver::storages::postgres::TransactionOptions(),
+        userver::storages::postgres::OptionalCommandControl{});
+    if (!ClaimRoomVersion(request, transaction, room_id)) {
+      return kRoomChangedError(request);
+    }
+    if (archived) {
+      CountedExecute(transaction, "SELECT unarchive_room($1)", room_id);
     }
 
-    auto delete_result = pg_cluster_->Execute(
-        userver::storages::postgres::ClusterHostType::kSlave,
-        "DELETE FROM products WHERE id = $1", product_id);
+    // Hidden at once; product-reaper purges it and its user products later,
+    // outside of the request
+    const auto deleted = CountedExecute(
+        transaction,
+        "UPDATE products SET deleted_at = now() "
+        "WHERE room_id = $1 AND id = $2 AND deleted_at IS NULL RETURNING id",
+        room_id, *product_id);
+    if (deleted.IsEmpty()) {
+      return kProductNotFoundError(request);
+    }
+    transaction.Commit();
 
     userver::formats::json::ValueBuilder response;
-    response["id"] = product_id;
+    response["id"] = *product_id;
     response["status"] = "deleted";
     return userver::formats::json::ToString(response.ExtractValue());
   }
-
- private:
-  userver::storages::postgres::ClusterPtr pg_cluster_;
 };
 
 }  // namespace
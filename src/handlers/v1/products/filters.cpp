@@ -3,6 +3,8 @@
 #include "filters.hpp"
 #include <unordered_map>
 
+#include "../../lib/args.hpp"
+
 namespace split_bill {
 
 TFilters TFilters::Parse(const userver::server::http::HttpRequest& request) {
@@ -10,30 +12,21 @@ TFilters TFilters::Parse(const userver::server::http::HttpRequest& request) {
 
   // Validate and set 'limit'
   if (request.HasArg("limit")) {
-    try {
-      auto limit_value = std::stoul(request.GetArg("limit"));
-      if (limit_value > 0 && limit_value <= 1000) {
-        result.limit = limit_value;
-      } else {
-        // Set to default if out of range
-        result.limit = 100;
-      }
-    } catch (const std::exception&) {
-      // Set to default if parsing fails
+    const auto limit_value = ParseInteger<size_t>(request.GetArg("limit"));
+    if (limit_value && *limit_value > 0 && *limit_value <= 1000) {
+      result.limit = *limit_value;
+    } else {
+      // Set to default if out of range or parsing fails
       result.limit = 100;
     }
   }
 
   if (request.HasArg("page")) {
-    try {
-      auto page_value = std::stoul(request.GetArg("page"));
-      if (page_value > 0) {
-        result.page = page_value;
-      } else {
-        result.page = 1; // Default to first page
-      }
-    } catch (const std::exception&) {
-      result.page = 1; // Default to first page if parsing fails
+    const auto page_value = ParseInteger<size_t>(request.GetArg("page"));
+    if (page_value && *page_value > 0) {
+      result.page = *page_value;
+    } else {
+      result.page = 1; // Default to first page
     }
   }
 
@@ -3,70 +3,60 @@
 #include <fmt/format.h>
 
 #include <userver/components/component_context.hpp>
-#include <userver/server/handlers/http_handler_base.hpp>
 #include <userver/server/http/http_status.hpp>
 #include <userver/storages/postgres/cluster.hpp>
 #include <userver/storages/postgres/component.hpp>
 #include <userver/utils/assert.hpp>
 
 #include "../../../../models/product.hpp"
-#include "../../../lib/auth.hpp"
+#include "../../../lib/args.hpp"
+#include "../../../lib/authenticated-handler.hpp"
 
 namespace split_bill {
 
 namespace {
 
-class GetProduct final : public userver::server::handlers::HttpHandlerBase {
+const TErrorResponse kProductNotFoundError{
+    userver::server::http::HttpStatus::kNotFound, "Product not found"};
+
+class GetProduct final : public AuthenticatedJsonHandler<GetProduct> {
  public:
   static constexpr std::string_view kName = "handler-v1-get-product";
+  static constexpr auto kEndpointClass = EEndpointClass::kInteractive;
 
   GetProduct(const userver::components::ComponentConfig& config,
              const userver::components::ComponentContext& component_context)
-      : HttpHandlerBase(config, component_context),
-        pg_cluster_(
-            component_context
-                .FindComponent<userver::components::Postgres>("postgres-db-1")
-                .GetCluster()) {}
+      : AuthenticatedJsonHandler(config, component_context) {}
 
-  std::string HandleRequestThrow(
+  std::string HandleAuthenticated(
       const userver::server::http::HttpRequest& request,
-      userver::server::request::RequestContext&) const override {
-    request.GetHttpResponse().SetContentType(
-        userver::http::content_type::kApplicationJson);
-
-    auto session = GetSessionInfo(pg_cluster_, request);
-    if (!session) {
-      request.SetResponseStatus(
-          userver::server::http::HttpStatus::kUnauthorized);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "Unauthorized";
-      return userver::formats::json::ToString(response.ExtractValue());
-    }
-
-    const auto& id_str = request.GetPathArg("id");
-    int product_id;
-    try {
-      product_id = std::stoi(id_str);
-    } catch (const std::exception&) {
-      request.SetResponseStatus(userver::server::http::HttpStatus::kBadRequest);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "Invalid product ID";
-      return userver::formats::json::ToString(response.ExtractValue());
+      userver::server::request::RequestContext&,
+      const TSession& session) const {
+    const auto product_id = GetIntPathArg(request, "id");
+    if (!product_id) {
+      return kInvalidProductIdError(request);
     }
 
-    // Check if the user owns the room the product belongs to
-    auto result = pg_cluster_->Execute(
+    // Check if the user owns the room the product belongs to. Products of
+    // archived rooms are read from room_archive.
+    auto result = CountedExecute(
+        shard_router_.ForProduct(*product_id),
         userver::storages::postgres::ClusterHostType::kSlave,
-        "SELECT p.* FROM products p "
+        "SELECT p.id, p.name, p.price, p.room_id FROM products p "
         "JOIN rooms r ON p.room_id = r.id "
-        "WHERE p.id = $1 AND r.user_id = $2",
-        product_id, session->user_id);
+        "WHERE p.room_id = (SELECT room_id FROM product_rooms WHERE id = $1) "
+        "AND p.id = $1 AND r.user_id = $2 AND p.deleted_at IS NULL "
+        "UNION ALL "
+        "SELECT p.id, p.name, p.price, a.room_id FROM room_archive a "
+        "JOIN rooms r ON a.room_id = r.id "
+        "CROSS JOIN jsonb_to_recordset(a.room_rows->'products') "
+        "    AS p(id int4, name varchar(255), price bigint) "
+        "WHERE a.room_id = (SELECT room_id FROM product_rooms WHERE id = $1) "
+        "AND p.id = $1 AND r.user_id = $2",
+        *product_id, session.user_id);
 
     if (result.IsEmpty()) {
-      request.SetResponseStatus(userver::server::http::HttpStatus::kNotFound);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "Product not found";
-      return userver::formats::json::ToString(response.ExtractValue());
+      return kProductNotFoundError(request);
     }
 
     auto product =
@@ -75,9 +65,6 @@ class GetProduct final : public userver::server::handlers::HttpHandlerBase {
     return userver::formats::json::ToString(
         userver::formats::json::ValueBuilder{product}.ExtractValue());
   }
-
- private:
-  userver::storages::postgres::ClusterPtr pg_cluster_;
 };
 
 }  // namespace
@@ -1,87 +1,135 @@
 #include "view.hpp"
 
 #include <fmt/format.h>
+#include <tuple>
 #include <unordered_map>
 
 #include <userver/components/component_context.hpp>
 #include <userver/formats/serialize/common_containers.hpp>
-#include <userver/server/handlers/http_handler_base.hpp>
 #include <userver/server/http/http_status.hpp>
 #include <userver/storages/postgres/cluster.hpp>
 #include <userver/storages/postgres/component.hpp>
 
+#include "../../../../components/request-coalescing.hpp"
+#include "../../../../components/response-compression.hpp"
 #include "../../../../models/product.hpp"
-#include "../../../lib/auth.hpp"
+#include "../../../lib/authenticated-handler.hpp"
+#include "../../../lib/fan-out.hpp"
+#include "../../../lib/pagination.hpp"
+#include "../../../lib/single-flight.hpp"
 #include "../filters.hpp"
 
 namespace split_bill {
 
 namespace {
 
-class GetProducts final : public userver::server::handlers::HttpHandlerBase {
+class GetProducts final : public AuthenticatedJsonHandler<GetProducts> {
  public:
   static constexpr std::string_view kName = "handler-v1-get-products";
+  static constexpr auto kEndpointClass = EEndpointClass::kHeavy;
 
   GetProducts(const userver::components::ComponentConfig& config,
               const userver::components::ComponentContext& component_context)
-      : HttpHandlerBase(config, component_context),
-        pg_cluster_(
-            component_context
-                .FindComponent<userver::components::Postgres>("postgres-db-1")
-                .GetCluster()) {}
+      : AuthenticatedJsonHandler(config, component_context),
+        flight_(component_context.FindComponent<RequestCoalescing>().Counter(
+            "get-products")),
+        compression_(
+            component_context.FindComponent<ResponseCompression>()) {}
 
-  std::string HandleRequestThrow(
+  std::string HandleAuthenticated(
       const userver::server::http::HttpRequest& request,
-      userver::server::request::RequestContext&) const override {
-    request.GetHttpResponse().SetContentType(
-        userver::http::content_type::kApplicationJson);
-
-    auto session = GetSessionInfo(pg_cluster_, request);
-    if (!session) {
-      request.SetResponseStatus(
-          userver::server::http::HttpStatus::kUnauthorized);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "Unauthorized";
-      return userver::formats::json::ToString(response.ExtractValue());
+      userver::server::request::RequestContext&,
+      const TSession& session) const {
+    auto filters = TFilters::Parse(request);
+    if (!IsPageInReach(filters.page, filters.limit)) {
+      return kPageOutOfReachError(request);
     }
 
-    auto filters = TFilters::Parse(request);
+    // Identical concurrent listings of one user share a single fan-out
+    return compression_.Compress(
+        request,
+        flight_.Run(
+            fmt::format("{}/{}/{}/{}", session.user_id,
+                        static_cast<int>(filters.order_by), filters.page,
+                        filters.limit),
+            [&] { return BuildResponse(session.user_id, filters); }));
+  }
 
+ private:
+  std::string BuildResponse(int user_id, const TFilters& filters) const {
     static const std::unordered_map<TFilters::ESortOrder, std::string>
         order_by_columns{
             {TFilters::ESortOrder::ID, "p.id"},
-            {TFilters::ESortOrder::NAME, "p.name"},
+            {TFilters::ESortOrder::NAME, "p.name COLLATE \"C\""},
             {TFilters::ESortOrder::PRICE, "p.price"},
             {TFilters::ESortOrder::ROOM_ID, "p.room_id"},
         };
     auto order_by_column = order_by_columns.at(filters.order_by);
 
-    size_t offset = (filters.page - 1) * filters.limit;
+    const auto window = GetShardWindow(filters.page, filters.limit,
+                                       shard_router_.ShardCount());
 
     std::string query = fmt::format(
-        "SELECT p.* FROM products p "
-        "JOIN user_products up ON p.id = up.product_id "
-        "WHERE up.user_id = $1 "
-        "ORDER BY {} "
+        "SELECT p.id, p.name, p.price, p.room_id FROM products p "
+        "JOIN user_products up "
+        "ON p.room_id = up.room_id AND p.id = up.product_id "
+        "WHERE up.user_id = $1 AND p.deleted_at IS NULL "
+        "ORDER BY {}, p.id "
         "LIMIT $2 OFFSET $3",
         order_by_column);
 
-    auto count_result = pg_cluster_->Execute(
-        userver::storages::postgres::ClusterHostType::kSlave,
-        "SELECT COUNT(*) FROM products p "
-        "JOIN user_products up ON p.id = up.product_id "
-        "WHERE up.user_id = $1",
-        session->user_id);
-
-    int total_count = count_result.AsSingleRow<int>();
-
-    auto result = pg_cluster_->Execute(
-        userver::storages::postgres::ClusterHostType::kSlave, query,
-        session->user_id, static_cast<int>(filters.limit),
-        static_cast<int>(offset));
+    auto shard_results = shard_router_.FanOut(
+        "get-products-shard",
+        [&](const userver::storages::postgres::ClusterPtr& pg_cluster) {
+          // The count and the page don't depend on each other
+          return ConcurrentInvoke(
+              "get-products-statement",
+              [&] {
+                return CountedExecute(
+                           pg_cluster,
+                           userver::storages::postgres::ClusterHostType::kSlave,
+                           "SELECT COUNT(*) FROM products p "
+                           "JOIN user_products up "
+                           "ON p.room_id = up.room_id AND p.id = up.product_id "
+                           "WHERE up.user_id = $1 AND p.deleted_at IS NULL",
+                           user_id)
+                    .AsSingleRow<int>();
+              },
+              [&] {
+                return CountedExecute(
+                           pg_cluster,
+                           userver::storages::postgres::ClusterHostType::kSlave,
+                           query, user_id, window.limit, window.offset)
+                    .AsContainer<std::vector<TProduct>>(
+                        userver::storages::postgres::kRowTag);
+              });
+        });
+
+    int total_count = 0;
+    std::vector<std::vector<TProduct>> pages;
+    for (auto& [count, items] : shard_results) {
+      total_count += count;
+      pages.push_back(std::move(items));
+    }
 
-    auto products = result.AsContainer<std::vector<TProduct>>(
-        userver::storages::postgres::kRowTag);
+    auto products = MergeShardPages(
+        std::move(pages), window, filters.limit,
+        [order_by = filters.order_by](const TProduct& lhs,
+                                      const TProduct& rhs) {
+          switch (order_by) {
+            case TFilters::ESortOrder::NAME:
+              return std::tie(lhs.name, lhs.id) < std::tie(rhs.name, rhs.id);
+            case TFilters::ESortOrder::PRICE:
+              return std::tie(lhs.price, lhs.id) <
+                     std::tie(rhs.price, rhs.id);
+            case TFilters::ESortOrder::ROOM_ID:
+              return std::tie(lhs.room_id, lhs.id) <
+                     std::tie(rhs.room_id, rhs.id);
+            case TFilters::ESortOrder::ID:
+              break;
+          }
+          return lhs.id < rhs.id;
+        });
 
     userver::formats::json::ValueBuilder response;
     response["items"] = products;
@@ -94,8 +142,8 @@ class GetProducts final : public userver::server::handlers::HttpHandlerBase {
     return userver::formats::json::ToString(response.ExtractValue());
   }
 
- private:
-  userver::storages::postgres::ClusterPtr pg_cluster_;
+  mutable SingleFlight<std::string, std::string> flight_;
+  const ResponseCompression& compression_;
 };
 
 }  // namespace
@@ -13,7 +13,15 @@
 #include <userver/storages/postgres/component.hpp>
 #include <userver/utils/assert.hpp>
 
+#include "../../../components/admission-control.hpp"
+#include "../../../components/query-stats.hpp"
+#include "../../../components/request-logging.hpp"
+#include "../../../components/shard-router.hpp"
+#include "../../../components/traffic-capture.hpp"
+#include "../../lib/admission.hpp"
+#include "../../lib/request-body.hpp"
 #include "../../../models/product.hpp"
+#include "../../../models/requests.hpp"
 
 namespace split_bill {
 
@@ -26,23 +34,33 @@ class RegisterUser final : public userver::server::handlers::HttpHandlerBase {
   RegisterUser(const userver::components::ComponentConfig& config,
                const userver::components::ComponentContext& component_context)
       : HttpHandlerBase(config, component_context),
-        pg_cluster_(
-            component_context
-                .FindComponent<userver::components::Postgres>("postgres-db-1")
-                .GetCluster()) {}
+        shard_router_(component_context.FindComponent<ShardRouter>()),
+        admission_control_(
+            component_context.FindComponent<AdmissionControl>()),
+        query_stats_(component_context.FindComponent<QueryStats>()),
+        request_logging_(component_context.FindComponent<RequestLogging>()),
+        traffic_capture_(component_context.FindComponent<TrafficCapture>()) {}
 
   std::string HandleRequestThrow(
       const userver::server::http::HttpRequest& request,
       userver::server::request::RequestContext&) const override {
-    auto request_body =
-        userver::formats::json::FromString(request.RequestBody());
+    const auto query_stats = query_stats_.Track(request);
+    const auto request_log = request_logging_.Track(request, kName);
+    const auto capture =
+        traffic_capture_.Track(request, kName, ECaptureBody::kCredentials);
     request.GetHttpResponse().SetContentType(
         userver::http::content_type::kApplicationJson);
-
-    auto username = request_body["username"].As<std::optional<std::string>>();
-    auto password = request_body["password"].As<std::optional<std::string>>();
-    auto full_name = request_body["full_name"].As<std::optional<std::string>>();
-    auto photo_url = request_body["photo_url"].As<std::optional<std::string>>();
+    const auto admission =
+        admission_control_.Admit(request, EEndpointClass::kWrite);
+    if (!admission) {
+      return RejectRequest(request, admission);
+    }
+    std::string error;
+    const auto body = ParseRequestBody<TRegisterRequest>(request, error);
+    if (!body) {
+      return error;
+    }
+    const auto& [username, password, full_name, photo_url] = *body;
 
     if (!username || !password) {
       request.SetResponseStatus(userver::server::http::HttpStatus::kBadRequest);
@@ -53,7 +71,8 @@ class RegisterUser final : public userver::server::handlers::HttpHandlerBase {
 
     auto hashed_password = userver::crypto::hash::Sha256(password.value());
 
-    auto result = pg_cluster_->Execute(
+    auto result = CountedExecute(
+        shard_router_.Global(),
         userver::storages::postgres::ClusterHostType::kSlave,
         "INSERT INTO users(username, password, full_name, photo_url) "
         "VALUES($1, $2, $3, $4) "
@@ -62,7 +81,8 @@ class RegisterUser final : public userver::server::handlers::HttpHandlerBase {
         username.value(), hashed_password, full_name, photo_url);
 
     if (result.IsEmpty()) {
-      auto check_result = pg_cluster_->Execute(
+      auto check_result = CountedExecute(
+          shard_router_.Global(),
           userver::storages::postgres::ClusterHostType::kSlave,
           "SELECT id FROM users WHERE username = $1", username.value());
 
@@ -88,7 +108,11 @@ class RegisterUser final : public userver::server::handlers::HttpHandlerBase {
   }
 
  private:
-  userver::storages::postgres::ClusterPtr pg_cluster_;
+  const ShardRouter& shard_router_;
+  const AdmissionControl& admission_control_;
+  const QueryStats& query_stats_;
+  const RequestLogging& request_logging_;
+  const TrafficCapture& traffic_capture_;
 };
 
 }  // namespace
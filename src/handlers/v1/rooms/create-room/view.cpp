@@ -5,63 +5,64 @@
 
 #include <userver/components/component_context.hpp>
 #include <userver/formats/json.hpp>
-#include <userver/server/handlers/http_handler_base.hpp>
 
 #include <userver/storages/postgres/cluster.hpp>
 #include <userver/storages/postgres/component.hpp>
 #include <userver/utils/assert.hpp>
 
+#include "../../../../components/idempotency-store.hpp"
 #include "../../../../models/room.hpp"
-#include "../../../lib/auth.hpp"
+#include "../../../lib/authenticated-handler.hpp"
+#include "../../../lib/idempotency.hpp"
 
 namespace split_bill {
 
 namespace {
 
-class AddRoom final : public userver::server::handlers::HttpHandlerBase {
+const TErrorResponse kNameRequiredError{
+    userver::server::http::HttpStatus::kBadRequest, "name is required"};
+const TErrorResponse kCreateRoomFailedError{
+    userver::server::http::HttpStatus::kConflict, "Failed to create room"};
+
+class AddRoom final : public AuthenticatedJsonHandler<AddRoom> {
  public:
   static constexpr std::string_view kName = "handler-v1-create-room";
+  static constexpr auto kEndpointClass = EEndpointClass::kWrite;
 
   AddRoom(const userver::components::ComponentConfig& config,
           const userver::components::ComponentContext& component_context)
-      : HttpHandlerBase(config, component_context),
-        pg_cluster_(
-            component_context
-                .FindComponent<userver::components::Postgres>("postgres-db-1")
-                .GetCluster()) {}
+      : AuthenticatedJsonHandler(config, component_context),
+        idempotency_store_(
+            component_context.FindComponent<IdempotencyStore>()) {}
 
-  std::string HandleRequestThrow(
+  std::string HandleAuthenticated(
       const userver::server::http::HttpRequest& request,
-      userver::server::request::RequestContext&) const override {
-    request.GetHttpResponse().SetContentType(
-        userver::http::content_type::kApplicationJson);
-
-    auto session = GetSessionInfo(pg_cluster_, request);
-    if (!session) {
-      request.SetResponseStatus(userver::server::http::HttpStatus::kUnauthorized);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "Unauthorized";
-      return userver::formats::json::ToString(response.ExtractValue());
-    }
+      userver::server::request::RequestContext&,
+      const TSession& session) const {
+    // Retries with the same Idempotency-Key get the first response
+    return HandleIdempotently(
+        idempotency_store_, request, session.user_id,
+        [&] { return CreateRoom(request, session); });
+  }
 
+ private:
+  std::string CreateRoom(const userver::server::http::HttpRequest& request,
+                         const TSession& session) const {
     auto request_body =
         userver::formats::json::FromString(request.RequestBody());
     auto name = request_body["name"].As<std::optional<std::string>>();
 
     if (!name) {
-      request.SetResponseStatus(userver::server::http::HttpStatus::kBadRequest);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "name is required";
-      return userver::formats::json::ToString(response.ExtractValue());
+      return kNameRequiredError(request);
     }
 
-    auto result = pg_cluster_->Execute(
-        userver::storages::postgres::ClusterHostType::kSlave,
+    // Sessions live on the global shard, so the owner is passed explicitly
+    auto result = CountedExecute(
+        shard_router_.ForNewRoom(session.user_id),
+        userver::storages::postgres::ClusterHostType::kMaster,
         "WITH inserted_room AS ("
         "    INSERT INTO rooms (name, user_id) "
-        "    SELECT $1, user_id "
-        "    FROM auth_sessions "
-        "    WHERE id = $2 "
+        "    VALUES ($1, $2) "
         "    RETURNING id, name, user_id"
         "), user_room_link AS ("
         "    INSERT INTO user_rooms (user_id, room_id) "
@@ -70,7 +71,7 @@ class AddRoom final : public userver::server::handlers::HttpHandlerBase {
         ") "
         "SELECT ir.id, ir.name, ir.user_id "
         "FROM inserted_room ir",
-        name.value(), session->id);
+        name.value(), session.user_id);
 
     if (!result.IsEmpty()) {
       auto room =
@@ -82,15 +83,11 @@ class AddRoom final : public userver::server::handlers::HttpHandlerBase {
       response["user_id"] = room.user_id;
       return userver::formats::json::ToString(response.ExtractValue());
     } else {
-      request.SetResponseStatus(userver::server::http::HttpStatus::kConflict);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "Failed to create room";
-      return userver::formats::json::ToString(response.ExtractValue());
+      return kCreateRoomFailedError(request);
     }
   }
 
- private:
-  userver::storages::postgres::ClusterPtr pg_cluster_;
+  const IdempotencyStore& idempotency_store_;
 };
 
 }  // namespace
@@ -1,79 +1,128 @@
 #include "view.hpp"
 
 #include <fmt/format.h>
+#include <tuple>
 #include <unordered_map>
 
 #include <userver/components/component_context.hpp>
 #include <userver/formats/serialize/common_containers.hpp>
-#include <userver/server/handlers/http_handler_base.hpp>
 #include <userver/server/http/http_status.hpp>
 #include <userver/storages/postgres/cluster.hpp>
 #include <userver/storages/postgres/component.hpp>
 
+#include "../../../../components/request-coalescing.hpp"
+#include "../../../../components/response-compression.hpp"
 #include "../../../../models/room.hpp"
-#include "../../../lib/auth.hpp"
+#include "../../../lib/authenticated-handler.hpp"
+#include "../../../lib/fan-out.hpp"
+#include "../../../lib/pagination.hpp"
+#include "../../../lib/single-flight.hpp"
 #include "../filters.hpp"
 
 namespace split_bill {
 
 namespace {
 
-class GetCreatedRooms final
-    : public userver::server::handlers::HttpHandlerBase {
+class GetCreatedRooms final : public AuthenticatedJsonHandler<GetCreatedRooms> {
  public:
   static constexpr std::string_view kName = "handler-v1-get-created-rooms";
+  static constexpr auto kEndpointClass = EEndpointClass::kHeavy;
 
   GetCreatedRooms(
       const userver::components::ComponentConfig& config,
       const userver::components::ComponentContext& component_context)
-      : HttpHandlerBase(config, component_context),
-        pg_cluster_(
-            component_context
-                .FindComponent<userver::components::Postgres>("postgres-db-1")
-                .GetCluster()) {}
+      : AuthenticatedJsonHandler(config, component_context),
+        flight_(component_context.FindComponent<RequestCoalescing>().Counter(
+            "get-created-rooms")),
+        compression_(
+            component_context.FindComponent<ResponseCompression>()) {}
 
-  std::string HandleRequestThrow(
+  std::string HandleAuthenticated(
       const userver::server::http::HttpRequest& request,
-      userver::server::request::RequestContext&) const override {
-    request.GetHttpResponse().SetContentType(
-        userver::http::content_type::kApplicationJson);
-    auto session = GetSessionInfo(pg_cluster_, request);
-    if (!session) {
-      request.SetResponseStatus(
-          userver::server::http::HttpStatus::kUnauthorized);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "Unauthorized";
-      return userver::formats::json::ToString(response.ExtractValue());
+      userver::server::request::RequestContext&,
+      const TSession& session) const {
+    auto filters = TFilters::Parse(request);
+    if (!IsPageInReach(filters.page, filters.limit)) {
+      return kPageOutOfReachError(request);
     }
 
-    auto filters = TFilters::Parse(request);
+    // Identical concurrent listings of one user share a single fan-out
+    return compression_.Compress(
+        request,
+        flight_.Run(
+            fmt::format("{}/{}/{}/{}", session.user_id,
+                        static_cast<int>(filters.order_by), filters.page,
+                        filters.limit),
+            [&] { return BuildResponse(session.user_id, filters); }));
+  }
 
+ private:
+  std::string BuildResponse(int user_id, const TFilters& filters) const {
     static const std::unordered_map<TFilters::ESortOrder, std::string>
         order_by_columns{
             {TFilters::ESortOrder::ID, "r.id"},
-            {TFilters::ESortOrder::NAME, "r.name"},
+            {TFilters::ESortOrder::NAME, "r.name COLLATE \"C\""},
             {TFilters::ESortOrder::USER_ID, "r.user_id"},
         };
     auto order_by_column = order_by_columns.at(filters.order_by);
 
-    size_t offset = (filters.page - 1) * filters.limit;
-
-    auto count_result = pg_cluster_->Execute(
-        userver::storages::postgres::ClusterHostType::kSlave,
-        "SELECT COUNT(*) FROM rooms r WHERE r.user_id = $1", session->user_id);
-    auto total_count = count_result.AsSingleRow<int>();
+    const auto window = GetShardWindow(filters.page, filters.limit,
+                                       shard_router_.ShardCount());
+
+    std::string query = fmt::format(
+        "SELECT r.id, r.name, r.user_id "
+        "FROM rooms r "
+        "WHERE r.user_id = $1 "
+        "ORDER BY {}, r.id "
+        "LIMIT $2 OFFSET $3",
+        order_by_column);
+
+    auto shard_results = shard_router_.FanOut(
+        "get-created-rooms-shard",
+        [&](const userver::storages::postgres::ClusterPtr& pg_cluster) {
+          // The count and the page don't depend on each other
+          return ConcurrentInvoke(
+              "get-created-rooms-statement",
+              [&] {
+                return CountedExecute(
+                           pg_cluster,
+                           userver::storages::postgres::ClusterHostType::kSlave,
+                           "SELECT COUNT(*) FROM rooms r WHERE r.user_id = $1",
+                           user_id)
+                    .AsSingleRow<int>();
+              },
+              [&] {
+                return CountedExecute(
+                           pg_cluster,
+                           userver::storages::postgres::ClusterHostType::kSlave,
+                           query, user_id, window.limit, window.offset)
+                    .AsContainer<std::vector<TRoom>>(
+                        userver::storages::postgres::kRowTag);
+              });
+        });
+
+    int total_count = 0;
+    std::vector<std::vector<TRoom>> pages;
+    for (auto& [count, items] : shard_results) {
+      total_count += count;
+      pages.push_back(std::move(items));
+    }
 
-    auto rooms_result = pg_cluster_->Execute(
-        userver::storages::postgres::ClusterHostType::kSlave,
-        fmt::format("SELECT r.* FROM rooms r "
-                    "WHERE r.user_id = $1 "
-                    "ORDER BY {} "
-                    "LIMIT $2 OFFSET $3",
-                    order_by_column),
-        session->user_id, static_cast<int>(filters.limit),
-        static_cast<int>(offset));
+    auto rooms = MergeShardPages(
+        std::move(pages), window, filters.limit,
+        [order_by = filters.order_by](const TRoom& lhs, const TRoom& rhs) {
+          switch (order_by) {
+            case TFilters::ESortOrder::NAME:
+              return std::tie(lhs.name, lhs.id) < std::tie(rhs.name, rhs.id);
+            case TFilters::ESortOrder::USER_ID:
+              return std::tie(lhs.user_id, lhs.id) <
+                     std::tie(rhs.user_id, rhs.id);
+            case TFilters::ESortOrder::ID:
+              break;
+          }
+          return lhs.id < rhs.id;
+        });
 
-    auto rooms = rooms_result.AsContainer<std::vector<TRoom>>(userver::storages::postgres::kRowTag);
     userver::formats::json::ValueBuilder response;
     response["items"] = rooms;
     response["page"] = filters.page;
@@ -84,8 +133,8 @@ class GetCreatedRooms final
     return userver::formats::json::ToString(response.ExtractValue());
   }
 
- private:
-  userver::storages::postgres::ClusterPtr pg_cluster_;
+  mutable SingleFlight<std::string, std::string> flight_;
+  const ResponseCompression& compression_;
 };
 
 }  // namespace
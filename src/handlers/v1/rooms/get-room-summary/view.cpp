@@ -0,0 +1,64 @@
+#include "view.hpp"
+
+#include <userver/components/component_context.hpp>
+#include <userver/server/http/http_status.hpp>
+#include <userver/formats/json/value_builder.hpp>
+
+#include "../../../../components/response-compression.hpp"
+#include "../../../../components/room-snapshot-cache.hpp"
+#include "../../../lib/args.hpp"
+#include "../../../lib/authenticated-handler.hpp"
+
+namespace split_bill {
+
+namespace {
+
+// Totals and per-user shares of a room, readable by its owner and members
+class GetRoomSummary final : public AuthenticatedJsonHandler<GetRoomSummary> {
+ public:
+  static constexpr std::string_view kName = "handler-v1-get-room-summary";
+  static constexpr auto kEndpointClass = EEndpointClass::kInteractive;
+
+  GetRoomSummary(const userver::components::ComponentConfig& config,
+                 const userver::components::ComponentContext& component_context)
+      : AuthenticatedJsonHandler(config, component_context),
+        snapshot_cache_(component_context.FindComponent<RoomSnapshotCache>()),
+        compression_(
+            component_context.FindComponent<ResponseCompression>()) {}
+
+  std::string HandleAuthenticated(
+      const userver::server::http::HttpRequest& request,
+      userver::server::request::RequestContext&,
+      const TSession& session) const {
+    const auto room_id = GetIntPathArg(request, "id");
+    if (!room_id) {
+      return kInvalidRoomIdError(request);
+    }
+
+    const auto room = snapshot_cache_.Get(*room_id);
+    if (!room || (room.OwnerId() != session.user_id &&
+                  !room.IsMember(session.user_id))) {
+      return kRoomNotFoundError(request);
+    }
+
+    if (room.archived) {
+      return compression_.FromGzip(request, room.archived->summary);
+    }
+
+    return compression_.Compress(
+        request,
+        userver::formats::json::ToString(room.snapshot->ToSummary()));
+  }
+
+ private:
+  const RoomSnapshotCache& snapshot_cache_;
+  const ResponseCompression& compression_;
+};
+
+}  // namespace
+
+void AppendGetRoomSummary(userver::components::ComponentList& component_list) {
+  component_list.Append<GetRoomSummary>();
+}
+
+}  // namespace split_bill
@@ -2,94 +2,95 @@
 
 #include <userver/components/component_context.hpp>
 #include <userver/formats/json.hpp>
-#include <userver/server/handlers/http_handler_base.hpp>
 #include <userver/storages/postgres/cluster.hpp>
 #include <userver/storages/postgres/component.hpp>
 
-#include "../../../lib/auth.hpp"
+#include "../../../../components/request-coalescing.hpp"
+#include "../../../../components/response-compression.hpp"
+#include "../../../lib/args.hpp"
+#include "../../../lib/authenticated-handler.hpp"
+#include "../../../lib/single-flight.hpp"
+#include "../../../lib/users.hpp"
 
 namespace split_bill {
 
 namespace {
 
-class GetRoomUsers final : public userver::server::handlers::HttpHandlerBase {
+class GetRoomUsers final : public AuthenticatedJsonHandler<GetRoomUsers> {
  public:
   static constexpr std::string_view kName = "handler-v1-get-room-users";
+  static constexpr auto kEndpointClass = EEndpointClass::kInteractive;
 
   GetRoomUsers(const userver::components::ComponentConfig& config,
           const userver::components::ComponentContext& component_context)
-      : HttpHandlerBase(config, component_context),
-        pg_cluster_(
-            component_context
-                .FindComponent<userver::components::Postgres>("postgres-db-1")
-                .GetCluster()) {}
+      : AuthenticatedJsonHandler(config, component_context),
+        flight_(component_context.FindComponent<RequestCoalescing>().Counter(
+            "get-room-users")),
+        compression_(
+            component_context.FindComponent<ResponseCompression>()) {}
 
-  std::string HandleRequestThrow(
+  std::string HandleAuthenticated(
       const userver::server::http::HttpRequest& request,
-      userver::server::request::RequestContext&) const override {
-    request.GetHttpResponse().SetContentType(
-        userver::http::content_type::kApplicationJson);
-
-    auto session = GetSessionInfo(pg_cluster_, request);
-    if (!session) {
-      request.SetResponseStatus(
-          userver::server::http::HttpStatus::kUnauthorized);
-      return userver::formats::json::ToString(
-          userver::formats::json::ValueBuilder{{"error", "Unauthorized"}}
-              .ExtractValue());
-    }
-
+      userver::server::request::RequestContext&,
+      const TSession& session) const {
     // Validate and parse room ID
-    const auto& id_str = request.GetPathArg("id");
-    int room_id;
-    try {
-      room_id = std::stoi(id_str);
-    } catch (const std::exception&) {
-      request.SetResponseStatus(userver::server::http::HttpStatus::kBadRequest);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "Invalid room ID";
-      return userver::formats::json::ToString(response.ExtractValue());
+    const auto room_id = GetIntPathArg(request, "id");
+    if (!room_id) {
+      return kInvalidRoomIdError(request);
     }
 
-    // Query the database for users in the specified room
-    auto result = pg_cluster_->Execute(
+    // Everyone opening the room at once shares one set of queries
+    return compression_.Compress(
+        request,
+        flight_.Run(*room_id, [&] { return BuildResponse(*room_id); }));
+  }
+
+ private:
+  std::string BuildResponse(int room_id) const {
+    // Membership is stored with the room, the users themselves on the
+    // global shard
+    auto result = CountedExecute(
+        shard_router_.ForRoom(room_id),
         userver::storages::postgres::ClusterHostType::kSlave,
-        "SELECT u.id, u.username, u.full_name, u.photo_url "
-        "FROM users u "
-        "INNER JOIN user_rooms ur ON u.id = ur.user_id "
-        "WHERE ur.room_id = $1", room_id);
+        "SELECT user_id FROM user_rooms WHERE room_id = $1", room_id);
+    const auto user_ids = result.AsContainer<std::vector<int>>();
+    const auto users = GetUsersInfo(shard_router_.Global(), user_ids);
 
     userver::formats::json::ValueBuilder response;
     response["room_id"] = room_id;
 
     response["users"] = userver::formats::json::ValueBuilder(userver::formats::json::Type::kArray);
 
-    for (const auto& row : result) {
+    for (const auto user_id : user_ids) {
+      const auto it = users.find(user_id);
+      if (it == users.end()) {
+        continue;
+      }
+      const auto& info = it->second;
+
       userver::formats::json::ValueBuilder user;
-      user["id"] = row["id"].As<int>();
-      user["username"] = row["username"].As<std::string>();
+      user["id"] = info.id;
+      user["username"] = info.username;
 
-      if (row["full_name"].As<std::optional<std::string>>()) {
-        user["full_name"] = *row["full_name"].As<std::optional<std::string>>();
+      if (info.full_name) {
+        user["full_name"] = *info.full_name;
       } else {
         user["full_name"] = nullptr;
       }
 
-      if (row["photo_url"].As<std::optional<std::string>>()) {
-        user["photo_url"] = *row["photo_url"].As<std::optional<std::string>>();
+      if (info.photo_url) {
+        user["photo_url"] = *info.photo_url;
       } else {
         user["photo_url"] = nullptr;
       }
       response["users"].PushBack(std::move(user));
     }
 
-
-
     return userver::formats::json::ToString(response.ExtractValue());
   }
 
- private:
-  userver::storages::postgres::ClusterPtr pg_cluster_;
+  mutable SingleFlight<int, std::string> flight_;
+  const ResponseCompression& compression_;
 };
 
 }  // namespace
@@ -1,138 +1,253 @@
 #include "view.hpp"
 
+#include <algorithm>
+#include <optional>
+
 #include <fmt/format.h>
 
 #include <userver/components/component_context.hpp>
-#include <userver/server/handlers/http_handler_base.hpp>
 #include <userver/server/http/http_status.hpp>
 #include <userver/storages/postgres/cluster.hpp>
 #include <userver/storages/postgres/component.hpp>
 #include <userver/utils/assert.hpp>
+#include <userver/formats/json/string_builder.hpp>
 #include <userver/formats/json/value_builder.hpp>
 
+#include "../../../../components/response-compression.hpp"
+#include "../../../../components/room-snapshot-cache.hpp"
+#include "../../../../components/server-timing.hpp"
 #include "../../../../models/detailed-room.hpp"
-#include "../../../../models/room.hpp"
-#include "../../../../models/user-product.hpp"
-#include "../../../../models/user.hpp"
-#include "../../../lib/auth.hpp"
+#include "../../../lib/args.hpp"
+#include "../../../lib/arena.hpp"
+#include "../../../lib/authenticated-handler.hpp"
+#include "../../../lib/gzip.hpp"
+#include "../../../lib/response-format.hpp"
+#include "../../../lib/room-version.hpp"
 
 namespace split_bill {
 
 namespace {
 
-struct MemberCount {
-  int count;
-};
+constexpr size_t kDefaultSectionLimit = 100;
+constexpr size_t kMaxSectionLimit = 500;
+
+const TErrorResponse kInvalidSectionError{
+    userver::server::http::HttpStatus::kBadRequest,
+    "Invalid 'section', 'filter', 'cursor' or 'limit'"};
 
-struct TotalPrice {
-  long total;
+enum class ESection : uint8_t { kHeader, kProducts };
+
+// ?section=header, or ?section=products[&filter=mine|unpaid][&cursor=<last
+// product id of the previous page>][&limit=N]
+struct TSectionQuery {
+  ESection section;
+  EProductFilter filter = EProductFilter::kAll;
+  int after_id = 0;
+  size_t limit = kDefaultSectionLimit;
 };
 
-class GetRoom final : public userver::server::handlers::HttpHandlerBase {
+std::optional<TSectionQuery> ParseSectionQuery(
+    const userver::server::http::HttpRequest& request) {
+  TSectionQuery query{};
+  const auto& section = request.GetArg("section");
+  if (section == "header") {
+    query.section = ESection::kHeader;
+    return query;
+  }
+  if (section != "products") {
+    return std::nullopt;
+  }
+  query.section = ESection::kProducts;
+
+  if (request.HasArg("filter")) {
+    const auto& filter = request.GetArg("filter");
+    if (filter == "mine") {
+      query.filter = EProductFilter::kMine;
+    } else if (filter == "unpaid") {
+      query.filter = EProductFilter::kUnpaid;
+    } else if (filter != "all") {
+      return std::nullopt;
+    }
+  }
+  if (request.HasArg("cursor")) {
+    const auto cursor = GetIntArg(request, "cursor");
+    if (!cursor) {
+      return std::nullopt;
+    }
+    query.after_id = *cursor;
+  }
+  if (request.HasArg("limit")) {
+    const auto limit = GetIntArg(request, "limit");
+    if (!limit) {
+      return std::nullopt;
+    }
+    query.limit = std::clamp<int>(*limit, 1, kMaxSectionLimit);
+  }
+  return query;
+}
+
+bool MatchesFilter(const userver::formats::json::Value& room_product,
+                   EProductFilter filter, int user_id) {
+  if (filter == EProductFilter::kAll) {
+    return true;
+  }
+  for (const auto& user_product : room_product["user_products"]) {
+    if (filter == EProductFilter::kMine
+            ? user_product["user_id"].As<int>() == user_id
+            : user_product["status"].As<std::string>() == "UNPAID") {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Sections of an archived room, cut from its stored response since its rows
+// are gone. Archived rooms are settled and rarely read, unlike the large
+// active ones the sections are for.
+userver::formats::json::Value ArchivedSection(const TArchivedRoom& room,
+                                              const TSectionQuery& query,
+                                              int user_id) {
+  const auto details =
+      userver::formats::json::FromString(GzipDecompress(room.details));
+  const auto room_products = details["room_products"];
+
+  userver::formats::json::ValueBuilder response;
+  if (query.section == ESection::kHeader) {
+    for (const auto* key : {"id", "name", "owner_id", "room_status",
+                            "total_price", "total_members"}) {
+      response[key] = details[key];
+    }
+    response["unpaid_count"] = 0;
+    response["product_count"] = room_products.GetSize();
+    response["member_ids"] = room.member_ids;
+    return response.ExtractValue();
+  }
+
+  response["room_products"] =
+      userver::formats::json::ValueBuilder{
+          userver::formats::json::Type::kArray};
+  size_t count = 0;
+  int last_id = 0;
+  for (const auto& room_product : room_products) {
+    if (room_product["id"].As<int>() <= query.after_id ||
+        !MatchesFilter(room_product, query.filter, user_id)) {
+      continue;
+    }
+    if (count == query.limit) {
+      // Products are stored in id order, like a snapshot keeps them
+      response["next_cursor"] = last_id;
+      break;
+    }
+    response["room_products"].PushBack(room_product);
+    last_id = room_product["id"].As<int>();
+    ++count;
+  }
+  return response.ExtractValue();
+}
+
+class GetRoom final : public AuthenticatedJsonHandler<GetRoom> {
  public:
   static constexpr std::string_view kName = "handler-v1-get-rooms-by-id";
+  static constexpr auto kEndpointClass = EEndpointClass::kInteractive;
 
   GetRoom(const userver::components::ComponentConfig& config,
           const userver::components::ComponentContext& component_context)
-      : HttpHandlerBase(config, component_context),
-        pg_cluster_(
-            component_context
-                .FindComponent<userver::components::Postgres>("postgres-db-1")
-                .GetCluster()) {}
+      : AuthenticatedJsonHandler(config, component_context),
+        snapshot_cache_(component_context.FindComponent<RoomSnapshotCache>()),
+        compression_(
+            component_context.FindComponent<ResponseCompression>()) {}
 
-  std::string HandleRequestThrow(
+  std::string HandleAuthenticated(
       const userver::server::http::HttpRequest& request,
-      userver::server::request::RequestContext&) const override {
-
-    request.GetHttpResponse().SetContentType(
-        userver::http::content_type::kApplicationJson);
-
-    auto session = GetSessionInfo(pg_cluster_, request);
-    if (!session) {
-      request.SetResponseStatus(
-          userver::server::http::HttpStatus::kUnauthorized);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "Unauthorized";
-      return userver::formats::json::ToString(response.ExtractValue());
+      userver::server::request::RequestContext& context,
+      const TSession& session) const {
+    const auto room_id = GetIntPathArg(request, "id");
+    if (!room_id) {
+      return kInvalidRoomIdError(request);
     }
-
-    const auto& id_str = request.GetPathArg("id");
-    int room_id;
-    try {
-      room_id = std::stoi(id_str);
-    } catch (const std::exception&) {
-      request.SetResponseStatus(userver::server::http::HttpStatus::kBadRequest);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "Invalid room ID";
-      return userver::formats::json::ToString(response.ExtractValue());
+    std::optional<TSectionQuery> section;
+    if (request.HasArg("section")) {
+      section = ParseSectionQuery(request);
+      if (!section) {
+        return kInvalidSectionError(request);
+      }
     }
 
-    auto room_result = pg_cluster_->Execute(
-        userver::storages::postgres::ClusterHostType::kSlave,
-        "SELECT id, name, user_id FROM rooms WHERE id = $1 AND user_id = $2", room_id, session->user_id);
-
-
-    if (room_result.IsEmpty()) {
-      request.SetResponseStatus(userver::server::http::HttpStatus::kNotFound);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "Room not found";
-      return userver::formats::json::ToString(response.ExtractValue());
+    // One version probe per request; products and user products are read
+    // only when the room has changed since the cached snapshot.
+    const auto room = snapshot_cache_.Get(*room_id);
+    if (!room || room.OwnerId() != session.user_id) {
+      return kRoomNotFoundError(request);
     }
+    const auto format = NegotiateResponseFormat(request);
+    // Sent back in If-Match by edits of the room
+    SetRoomETag(request, room.Version(), format);
 
-    auto room = room_result.AsSingleRow<split_bill::TRoom>(userver::storages::postgres::kRowTag);
-
-    auto products_result = pg_cluster_->Execute(
-        userver::storages::postgres::ClusterHostType::kSlave,
-        "SELECT id, name, price, room_id FROM products WHERE room_id = $1", room.id);
-
-    std::vector<split_bill::TRoomProduct> room_products;
-    long total_price = 0;
-    std::string room_status = "ARCHIVED";
-
-    for (const auto& row : products_result) {
-      auto product = row.As<split_bill::TProduct>(userver::storages::postgres::kRowTag);
-      total_price += product.price;
-
-      auto user_products_result = pg_cluster_->Execute(
-          userver::storages::postgres::ClusterHostType::kSlave,
-          "SELECT up.id, up.status, up.product_id, up.user_id, u.full_name, u.photo_url "
-          "FROM user_products up "
-          "JOIN users u ON up.user_id = u.id "
-          "WHERE up.product_id = $1",
-          product.id);
-
-      std::vector<split_bill::TUserProductWithDetails> user_products;
-      for (const auto& user_row : user_products_result) {
-        if(user_row["status"].As<std::string>() == "UNPAID") {
-          room_status = "ACTIVE";
-        }
-        user_products.push_back({
-            user_row["id"].As<int>(),
-            user_row["status"].As<std::string>(),
-            user_row["product_id"].As<int>(),
-            user_row["user_id"].As<int>(),
-            user_row["full_name"].As<std::optional<std::string>>(),
-            user_row["photo_url"].As<std::optional<std::string>>()
-        });
+    if (section) {
+      return Section(request, context, room, *section, session.user_id,
+                     format);
+    }
+    if (room.archived) {
+      if (format == EResponseFormat::kMsgPack) {
+        return compression_.Compress(
+            request,
+            JsonToMsgPack(GzipDecompress(room.archived->details)));
       }
-
-      room_products.push_back({product.id, product.name, product.price, product.room_id, std::move(user_products)});
+      return compression_.FromGzip(request, room.archived->details);
     }
 
-    auto members_result = pg_cluster_->Execute(
-        userver::storages::postgres::ClusterHostType::kSlave,
-        "SELECT COUNT(*) as count FROM user_rooms WHERE room_id = $1", room.id);
+    // Product names, statuses and user details of the response all come from
+    // the request arena instead of one heap allocation each
+    const auto room_details = [&] {
+      const TTimingScope timing("assemble");
+      return room.snapshot->ToRoomDetails(&GetRequestArena(context));
+    }();
+    return compression_.Compress(request, Serialize(room_details, format));
+  }
 
-    int total_members = members_result.AsSingleRow<MemberCount>(userver::storages::postgres::kRowTag).count;
+ private:
+  std::string Section(const userver::server::http::HttpRequest& request,
+                      userver::server::request::RequestContext& context,
+                      const TCachedRoom& room, const TSectionQuery& query,
+                      int user_id, EResponseFormat format) const {
+    if (room.archived || query.section == ESection::kHeader) {
+      const auto section =
+          room.archived ? ArchivedSection(*room.archived, query, user_id)
+                        : room.snapshot->ToHeader();
+      if (format == EResponseFormat::kMsgPack) {
+        TMsgPackWriter writer;
+        WriteToMsgPack(section, writer);
+        return compression_.Compress(request, writer.ExtractString());
+      }
+      return compression_.Compress(
+          request, userver::formats::json::ToString(section));
+    }
 
-    split_bill::TRoomDetails room_details{room.id, room.name, room.user_id, std::move(room_products), room_status, total_price, total_members};
+    const auto page = [&] {
+      const TTimingScope timing("assemble");
+      return room.snapshot->ToProductsPage(query.filter, user_id,
+                                           query.after_id, query.limit,
+                                           &GetRequestArena(context));
+    }();
+    return compression_.Compress(request, Serialize(page, format));
+  }
 
-    return userver::formats::json::ToString(
-        userver::formats::json::ValueBuilder{room_details}.ExtractValue());
+  template <typename Document>
+  static std::string Serialize(const Document& document,
+                               EResponseFormat format) {
+    const TTimingScope timing("serialize");
+    if (format == EResponseFormat::kMsgPack) {
+      TMsgPackWriter writer;
+      WriteToMsgPack(document, writer);
+      return writer.ExtractString();
+    }
+    userver::formats::json::StringBuilder sw;
+    WriteToStream(document, sw);
+    return sw.GetString();
   }
 
- private:
-  userver::storages::postgres::ClusterPtr pg_cluster_;
+  const RoomSnapshotCache& snapshot_cache_;
+  const ResponseCompression& compression_;
 };
 
 }  // namespace
@@ -0,0 +1,239 @@
+#include "view.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <userver/components/component_context.hpp>
+#include <userver/formats/json.hpp>
+#include <userver/storages/postgres/cluster.hpp>
+
+#include "../../../lib/args.hpp"
+#include "../../../lib/authenticated-handler.hpp"
+#include "../../../lib/receipt-reader.hpp"
+#include "../../../lib/room-access.hpp"
+#include "../../../lib/room-version.hpp"
+
+namespace split_bill {
+
+namespace {
+
+const TErrorResponse kUnsupportedContentTypeError{
+    userver::server::http::HttpStatus::kUnsupportedMediaType,
+    "Content-Type must be text/csv or application/x-ndjson"};
+const TErrorResponse kNotMemberError{
+    userver::server::http::HttpStatus::kForbidden,
+    "You are not a member of the room"};
+const TErrorResponse kTooManyItemsError{
+    userver::server::http::HttpStatus::kPayloadTooLarge,
+    "A receipt may have up to 2000 items"};
+
+// Items inserted by one statement
+constexpr size_t kBatchSize = 200;
+constexpr size_t kMaxItems = 2000;
+
+enum class EItemOutcome { kCreated, kDuplicate, kInvalid };
+
+std::string ToString(EItemOutcome outcome) {
+  switch (outcome) {
+    case EItemOutcome::kCreated:
+      return "CREATED";
+    case EItemOutcome::kDuplicate:
+      return "DUPLICATE";
+    case EItemOutcome::kInvalid:
+      return "INVALID";
+  }
+  return "INVALID";
+}
+
+struct TLineOutcome {
+  size_t line;
+  EItemOutcome outcome;
+  std::optional<int> product_id;
+  std::optional<std::string> error;
+};
+
+class ImportReceipt final : public AuthenticatedJsonHandler<ImportReceipt> {
+ public:
+  static constexpr std::string_view kName = "handler-v1-import-receipt";
+  static constexpr auto kEndpointClass = EEndpointClass::kWrite;
+
+  ImportReceipt(const userver::components::ComponentConfig& config,
+                const userver::components::ComponentContext& component_context)
+      : AuthenticatedJsonHandler(config, component_context) {}
+
+  std::string HandleAuthenticated(
+      const userver::server::http::HttpRequest& request,
+      userver::server::request::RequestContext& context,
+      const TSession& session) const {
+    const auto room_id = GetIntPathArg(request, "id");
+    if (!room_id) {
+      return kInvalidRoomIdError(request);
+    }
+
+    const auto format = ParseReceiptFormat(request.GetHeader("Content-Type"));
+    if (!format) {
+      return kUnsupportedContentTypeError(request);
+    }
+
+    if (!GetRoomAccess(context, shard_router_, *room_id)) {
+      return kRoomNotFoundError(request);
+    }
+    auto pg_cluster = shard_router_.ForRoom(*room_id);
+    auto member_ids =
+        CountedExecute(pg_cluster,
+                       userver::storages::postgres::ClusterHostType::kMaster,
+                       "SELECT user_id FROM user_rooms WHERE room_id = $1",
+                       *room_id)
+            .AsContainer<std::vector<int>>();
+    std::sort(member_ids.begin(), member_ids.end());
+    if (!std::binary_search(member_ids.begin(), member_ids.end(),
+                            session.user_id)) {
+      return kNotMemberError(request);
+    }
+
+    // One transaction for the whole receipt: the room changes once, and an
+    // oversized receipt leaves no items behind
+    auto transaction = pg_cluster->Begin(
+        userver::storages::postgres::TransactionOptions(),
+        userver::storages::postgres::OptionalCommandControl{});
+    if (!ClaimRoomVersion(request, transaction, *room_id)) {
+      return kRoomChangedError(request);
+    }
+    // The names may be taken by products in room_archive
+    UnarchiveRoom(context, transaction, *room_id);
+
+    std::vector<TLineOutcome> outcomes;
+    std::vector<TReceiptItem> batch;
+    std::unordered_set<std::string> names;
+    TReceiptReader reader(request.RequestBody(), *format);
+    TReceiptItem item;
+    size_t items = 0;
+    while (reader.Next(item)) {
+      if (++items > kMaxItems) {
+        return kTooManyItemsError(request);
+      }
+      if (!item.error) {
+        const auto not_member = std::find_if(
+            item.user_ids.begin(), item.user_ids.end(), [&](int user_id) {
+              return !std::binary_search(member_ids.begin(), member_ids.end(),
+                                         user_id);
+            });
+        if (not_member != item.user_ids.end()) {
+          item.error =
+              "User " + std::to_string(*not_member) + " is not a room member";
+        }
+      }
+      if (item.error) {
+        outcomes.push_back(
+            {item.line, EItemOutcome::kInvalid, std::nullopt, item.error});
+        continue;
+      }
+      if (!names.insert(item.name).second) {
+        outcomes.push_back(
+            {item.line, EItemOutcome::kDuplicate, std::nullopt, std::nullopt});
+        continue;
+      }
+      batch.push_back(std::move(item));
+      if (batch.size() == kBatchSize) {
+        InsertBatch(transaction, *room_id, batch, outcomes);
+      }
+    }
+    InsertBatch(transaction, *room_id, batch, outcomes);
+    transaction.Commit();
+
+    std::sort(outcomes.begin(), outcomes.end(),
+              [](const TLineOutcome& lhs, const TLineOutcome& rhs) {
+                return lhs.line < rhs.line;
+              });
+    userver::formats::json::ValueBuilder response;
+    response["room_id"] = *room_id;
+    std::unordered_map<EItemOutcome, int> counts;
+    response["lines"] =
+        userver::formats::json::ValueBuilder(userver::formats::json::Type::kArray);
+    for (const auto& outcome : outcomes) {
+      ++counts[outcome.outcome];
+      userver::formats::json::ValueBuilder line;
+      line["line"] = outcome.line;
+      line["status"] = ToString(outcome.outcome);
+      if (outcome.product_id) {
+        line["product_id"] = *outcome.product_id;
+      }
+      if (outcome.error) {
+        line["error"] = *outcome.error;
+      }
+      response["lines"].PushBack(std::move(line));
+    }
+    response["created"] = counts[EItemOutcome::kCreated];
+    response["duplicates"] = counts[EItemOutcome::kDuplicate];
+    response["invalid"] = counts[EItemOutcome::kInvalid];
+    return userver::formats::json::ToString(response.ExtractValue());
+  }
+
+ private:
+  // Inserts the products of `batch` and their user products with one
+  // statement each, names already in the room are left as they are
+  static void InsertBatch(userver::storages::postgres::Transaction& transaction,
+                          int room_id, std::vector<TReceiptItem>& batch,
+                          std::vector<TLineOutcome>& outcomes) {
+    if (batch.empty()) {
+      return;
+    }
+    std::vector<std::string> product_names;
+    std::vector<int64_t> product_prices;
+    product_names.reserve(batch.size());
+    product_prices.reserve(batch.size());
+    for (const auto& item : batch) {
+      product_names.push_back(item.name);
+      product_prices.push_back(item.price);
+    }
+    auto product_result = CountedExecute(
+        transaction,
+        "INSERT INTO products (name, price, room_id) "
+        "SELECT name, price, $3 FROM unnest($1::text[], $2::int8[]) "
+        "AS items(name, price) "
+        "ON CONFLICT (name, room_id) WHERE deleted_at IS NULL DO NOTHING "
+        "RETURNING id, name",
+        product_names, product_prices, room_id);
+    std::unordered_map<std::string, int> product_ids;
+    for (const auto& row : product_result) {
+      product_ids.emplace(row["name"].As<std::string>(), row["id"].As<int>());
+    }
+
+    std::vector<int> user_product_product_ids;
+    std::vector<int> user_product_user_ids;
+    for (const auto& item : batch) {
+      const auto it = product_ids.find(item.name);
+      if (it == product_ids.end()) {
+        outcomes.push_back(
+            {item.line, EItemOutcome::kDuplicate, std::nullopt, std::nullopt});
+        continue;
+      }
+      outcomes.push_back(
+          {item.line, EItemOutcome::kCreated, it->second, std::nullopt});
+      for (const auto user_id : item.user_ids) {
+        user_product_product_ids.push_back(it->second);
+        user_product_user_ids.push_back(user_id);
+      }
+    }
+    if (!user_product_product_ids.empty()) {
+      CountedExecute(
+          transaction,
+          "INSERT INTO user_products (product_id, user_id, room_id) "
+          "SELECT product_id, user_id, $3 "
+          "FROM unnest($1::int4[], $2::int4[]) AS items(product_id, user_id) "
+          "ON CONFLICT (room_id, user_id, product_id) DO NOTHING",
+          user_product_product_ids, user_product_user_ids, room_id);
+    }
+    batch.clear();
+  }
+};
+
+}  // namespace
+
+void AppendImportReceipt(userver::components::ComponentList& component_list) {
+  component_list.Append<ImportReceipt>();
+}
+
+}  // namespace split_bill
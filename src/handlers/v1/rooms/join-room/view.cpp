@@ -4,59 +4,41 @@
 
 #include <userver/components/component_context.hpp>
 #include <userver/formats/json/value_builder.hpp>
-#include <userver/server/handlers/http_handler_base.hpp>
 #include <userver/server/http/http_status.hpp>
 #include <userver/storages/postgres/cluster.hpp>
 #include <userver/storages/postgres/component.hpp>
 #include <userver/utils/assert.hpp>
 
 #include "../../../../models/room.hpp"
-#include "../../../lib/auth.hpp"
+#include "../../../lib/args.hpp"
+#include "../../../lib/authenticated-handler.hpp"
 
 namespace split_bill {
 
 namespace {
 
-class JoinRoom final : public userver::server::handlers::HttpHandlerBase {
+class JoinRoom final : public AuthenticatedJsonHandler<JoinRoom> {
  public:
   static constexpr std::string_view kName = "handler-v1-join-room";
+  static constexpr auto kEndpointClass = EEndpointClass::kWrite;
 
   JoinRoom(const userver::components::ComponentConfig& config,
            const userver::components::ComponentContext& component_context)
-      : HttpHandlerBase(config, component_context),
-        pg_cluster_(
-            component_context
-                .FindComponent<userver::components::Postgres>("postgres-db-1")
-                .GetCluster()) {}
+      : AuthenticatedJsonHandler(config, component_context) {}
 
-  std::string HandleRequestThrow(
+  std::string HandleAuthenticated(
       const userver::server::http::HttpRequest& request,
-      userver::server::request::RequestContext&) const override {
-    request.GetHttpResponse().SetContentType(
-        userver::http::content_type::kApplicationJson);
-    auto session = GetSessionInfo(pg_cluster_, request);
-    if (!session) {
-      request.SetResponseStatus(
-          userver::server::http::HttpStatus::kUnauthorized);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "Unauthorized";
-      return userver::formats::json::ToString(response.ExtractValue());
+      userver::server::request::RequestContext&,
+      const TSession& session) const {
+    const auto room_id = GetIntPathArg(request, "id");
+    if (!room_id) {
+      return kInvalidRoomIdError(request);
     }
 
-    const auto& id_str = request.GetPathArg("id");
-    int room_id;
-    try {
-      room_id = std::stoi(id_str);
-    } catch (const std::exception&) {
-      request.SetResponseStatus(userver::server::http::HttpStatus::kBadRequest);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "Invalid room ID";
-      return userver::formats::json::ToString(response.ExtractValue());
-    }
-
-    auto room_check_result = pg_cluster_->Execute(
-        userver::storages::postgres::ClusterHostType::kSlave,
-        "SELECT 1 FROM rooms WHERE id = $1", room_id);
+    auto pg_cluster = shard_router_.ForRoom(*room_id);
+    auto room_check_result = CountedExecute(
+        pg_cluster, userver::storages::postgres::ClusterHostType::kSlave,
+        "SELECT 1 FROM rooms WHERE id = $1", *room_id);
 
     if (room_check_result.IsEmpty()) {
       request.SetResponseStatus(userver::server::http::HttpStatus::kNotFound);
@@ -65,20 +47,17 @@ class JoinRoom final : public userver::server::handlers::HttpHandlerBase {
       return userver::formats::json::ToString(response.ExtractValue());
     }
 
-    auto result = pg_cluster_->Execute(
-        userver::storages::postgres::ClusterHostType::kSlave,
+    auto result = CountedExecute(
+        pg_cluster, userver::storages::postgres::ClusterHostType::kSlave,
         "INSERT INTO user_rooms (user_id, room_id) VALUES($1, $2) "
         "ON CONFLICT (user_id, room_id) DO NOTHING "
         "RETURNING 1",
-        session->user_id, room_id);
+        session.user_id, *room_id);
 
     userver::formats::json::ValueBuilder response;
     response["status"] = true;
     return userver::formats::json::ToString(response.ExtractValue());
   }
-
- private:
-  userver::storages::postgres::ClusterPtr pg_cluster_;
 };
 
 }  // namespace
@@ -1,265 +1,231 @@
 #include "view.hpp"
 
 #include <fmt/format.h>
+#include <tuple>
 
 #include <userver/components/component_context.hpp>
 #include <userver/formats/json.hpp>
-#include <userver/server/handlers/http_handler_base.hpp>
-
 #include <userver/storages/postgres/cluster.hpp>
 #include <userver/storages/postgres/component.hpp>
+#include <userver/storages/postgres/transaction.hpp>
 
+#include "../../../../components/idempotency-store.hpp"
+#include "../../../../models/requests.hpp"
 #include "../../../../models/room.hpp"
-#include "../../../lib/auth.hpp"
+#include "../../../../models/user-product.hpp"
+#include "../../../lib/args.hpp"
+#include "../../../lib/authenticated-handler.hpp"
+#include "../../../lib/idempotency.hpp"
+#include "../../../lib/request-body.hpp"
+#include "../../../lib/room-access.hpp"
+#include "../../../lib/room-version.hpp"
 
 namespace split_bill {
 
 namespace {
 
-class UpdateRoom final : public userver::server::handlers::HttpHandlerBase {
- public:
-  static constexpr std::string_view kName = "handler-v1-update-room";
+namespace pg = userver::storages::postgres;
 
-  UpdateRoom(const userver::components::ComponentConfig& config,
-             const userver::components::ComponentContext& component_context)
-      : HttpHandlerBase(config, component_context),
-        pg_cluster_(
-            component_context
-                .FindComponent<userver::components::Postgres>("postgres-db-1")
-                .GetCluster()) {}
+const TErrorResponse kNotOwnerError{
+    userver::server::http::HttpStatus::kForbidden, "You can't update the room"};
 
-  std::string HandleRequestThrow(
-      const userver::server::http::HttpRequest& request,
-      userver::server::request::RequestContext&) const override {
-    request.GetHttpResponse().SetContentType(
-        userver::http::content_type::kApplicationJson);
-    auto session = GetSessionInfo(pg_cluster_, request);
-    if (!session) {
-      request.SetResponseStatus(
-          userver::server::http::HttpStatus::kUnauthorized);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "Unauthorized";
-      return userver::formats::json::ToString(response.ExtractValue());
-    }
-
-    auto request_body =
-        userver::formats::json::FromString(request.RequestBody());
+void AddProducts(pg::Transaction& transaction, int room_id,
+                 const std::vector<TProductToAdd>& products) {
+  std::vector<std::string> names;
+  std::vector<int> prices;
+  names.reserve(products.size());
+  prices.reserve(products.size());
+  for (const auto& product : products) {
+    names.push_back(product.name);
+    prices.push_back(product.price);
+  }
 
-    const auto& id_str = request.GetPathArg("id");
-    int room_id;
-    try {
-      room_id = std::stoi(id_str);
-    } catch (const std::exception&) {
-      request.SetResponseStatus(userver::server::http::HttpStatus::kBadRequest);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "Invalid room ID";
-      return userver::formats::json::ToString(response.ExtractValue());
+  // Ids come back in the order of the unnested arrays
+  const auto product_ids =
+      CountedExecute(transaction,
+                     "INSERT INTO products (name, price, room_id) "
+                     "SELECT unnest($1::text[]), unnest($2::int[]), $3 "
+                     "RETURNING id",
+                     names, prices, room_id)
+          .AsContainer<std::vector<int>>();
+
+  std::vector<int> user_product_ids;
+  std::vector<int> user_ids;
+  for (size_t i = 0; i < products.size(); ++i) {
+    for (const auto user_id : products[i].add_users) {
+      user_product_ids.push_back(product_ids[i]);
+      user_ids.push_back(user_id);
     }
+  }
+  if (!user_product_ids.empty()) {
+    CountedExecute(
+        transaction,
+        "INSERT INTO user_products (product_id, user_id, room_id) "
+        "VALUES (unnest($1::int[]), unnest($2::int[]), $3) "
+        "ON CONFLICT (room_id, user_id, product_id) DO NOTHING",
+        user_product_ids, user_ids, room_id);
+  }
+}
 
-    auto room_user_id = pg_cluster_->Execute(
-        userver::storages::postgres::ClusterHostType::kSlave,
-        "SELECT user_id FROM rooms WHERE id = $1", room_id);
-
-    if (room_user_id.AsSingleRow<int>() != session->user_id) {
-      request.SetResponseStatus(userver::server::http::HttpStatus::kForbidden);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "You can't update the room";
-      return userver::formats::json::ToString(response.ExtractValue());
+void EditProducts(pg::Transaction& transaction, int room_id,
+                  const std::vector<TProductEdit>& products) {
+  std::vector<int> name_update_ids;
+  std::vector<std::string> name_update_values;
+  std::vector<int> price_update_ids;
+  std::vector<int> price_update_values;
+  std::vector<int> status_update_product_ids;
+  std::vector<std::string> status_update_values;
+  std::vector<int> delete_product_ids;
+  std::vector<int> delete_user_ids;
+
+  for (const auto& product : products) {
+    if (product.name) {
+      name_update_ids.push_back(product.id);
+      name_update_values.push_back(*product.name);
     }
-
-    auto transaction = pg_cluster_->Begin(
-        userver::storages::postgres::TransactionOptions(),
-        userver::storages::postgres::OptionalCommandControl{});
-
-    if (request_body.HasMember("room") && !request_body["room"].IsNull()) {
-      const auto& room_data = request_body["room"];
-      if (room_data.HasMember("name") && !room_data["name"].IsNull()) {
-        const auto& name = room_data["name"].As<std::string>();
-        transaction.Execute(
-            "UPDATE rooms SET name = $1 WHERE id = $2 AND user_id = $3", name,
-            room_id, session->user_id);
-      }
+    if (product.price) {
+      price_update_ids.push_back(product.id);
+      price_update_values.push_back(*product.price);
     }
+    if (product.status) {
+      status_update_product_ids.push_back(product.id);
+      status_update_values.push_back(*product.status);
+    }
+    for (const auto user_id : product.delete_users) {
+      delete_product_ids.push_back(product.id);
+      delete_user_ids.push_back(user_id);
+    }
+  }
 
-    if (request_body.HasMember("product") && !request_body["product"].IsNull()) {
-      const auto& product_data = request_body["product"];
-
-      if (product_data.HasMember("add") && !product_data["add"].IsNull()) {
-        // Bulk insert products
-        std::vector<std::string> product_values;
-        std::vector<int> product_prices;
-        std::vector<int> product_room_ids;
-
-        std::vector<std::pair<int, int>> user_product_mappings;
-
-        for (const auto& product : product_data["add"]) {
-          auto name = product["name"].As<std::string>();
-          auto price = product["price"].As<int>();
-          auto user_ids = product["add_users"].As<std::vector<int>>();
-
-          product_values.push_back(name);
-          product_prices.push_back(price);
-          product_room_ids.push_back(room_id);
-
-          // Prepare user_product mappings
-          for (int user_id : user_ids) {
-            user_product_mappings.emplace_back(0, user_id);  // 0 will be replaced with actual product_id
-          }
-        }
-
-        // Single bulk insert for products
-        auto product_result = transaction.Execute(
-            "INSERT INTO products (name, price, room_id) "
-            "VALUES (unnest($1::text[]), unnest($2::int[]), unnest($3::int[])) "
-            "RETURNING id",
-            product_values, product_prices, product_room_ids);
-
-        // Get the inserted product IDs manually
-        std::vector<int> product_ids;
-        for (const auto& row : product_result) {
-          product_ids.push_back(row["id"].As<int>());
-        }
+  if (!name_update_ids.empty()) {
+    CountedExecute(transaction,
+                   "UPDATE products AS p SET name = u.name "
+                   "FROM (SELECT unnest($1::int[]) AS id, "
+                   "             unnest($2::text[]) AS name) AS u "
+                   "WHERE p.room_id = $3 AND p.id = u.id "
+                   "AND p.deleted_at IS NULL",
+                   name_update_ids, name_update_values, room_id);
+  }
+  if (!price_update_ids.empty()) {
+    CountedExecute(transaction,
+                   "UPDATE products AS p SET price = u.price "
+                   "FROM (SELECT unnest($1::int[]) AS id, "
+                   "             unnest($2::int[]) AS price) AS u "
+                   "WHERE p.room_id = $3 AND p.id = u.id "
+                   "AND p.deleted_at IS NULL",
+                   price_update_ids, price_update_values, room_id);
+  }
+  if (!status_update_product_ids.empty()) {
+    CountedExecute(transaction,
+                   "UPDATE user_products AS up "
+                   "SET status = u.status::user_product_status "
+                   "FROM (SELECT unnest($1::int[]) AS product_id, "
+                   "             unnest($2::text[]) AS status) AS u "
+                   "WHERE up.room_id = $3 AND up.product_id = u.product_id",
+                   status_update_product_ids, status_update_values, room_id);
+  }
+  if (!delete_product_ids.empty()) {
+    CountedExecute(transaction,
+                   "DELETE FROM user_products AS up "
+                   "WHERE up.room_id = $3 AND (up.product_id, up.user_id) IN "
+                   "(SELECT unnest($1::int[]), unnest($2::int[]))",
+                   delete_product_ids, delete_user_ids, room_id);
+  }
+}
 
-        // Update user_product mappings with actual product IDs
-        std::vector<std::pair<int, int>> final_user_product_mappings;
-        size_t product_index = 0;
-        for (const auto& mapping : user_product_mappings) {
-          if (mapping.first == 0) {
-            final_user_product_mappings.emplace_back(
-                product_ids[product_index / mapping.second],
-                mapping.second
-            );
+// Hidden at once, purged with their user products by product-reaper
+void RemoveProducts(pg::Transaction& transaction, int room_id,
+                    const std::vector<TProductToRemove>& products) {
+  std::vector<int> product_ids;
+  product_ids.reserve(products.size());
+  for (const auto& product : products) {
+    product_ids.push_back(product.id);
+  }
+  CountedExecute(
+      transaction,
+      "UPDATE products SET deleted_at = now() "
+      "WHERE room_id = $2 AND id = ANY($1::int[]) AND deleted_at IS NULL",
+      product_ids, room_id);
+}
 
-            if ((product_index + 1) % mapping.second == 0) {
-              product_index++;
-            }
-          }
-        }
+class UpdateRoom final : public AuthenticatedJsonHandler<UpdateRoom> {
+ public:
+  static constexpr std::string_view kName = "handler-v1-update-room";
+  static constexpr auto kEndpointClass = EEndpointClass::kWrite;
 
-        // Bulk insert user_products
-        if (!final_user_product_mappings.empty()) {
-          std::vector<int> product_ids_to_insert;
-          std::vector<int> user_ids_to_insert;
+  UpdateRoom(const userver::components::ComponentConfig& config,
+             const userver::components::ComponentContext& component_context)
+      : AuthenticatedJsonHandler(config, component_context),
+        idempotency_store_(
+            component_context.FindComponent<IdempotencyStore>()) {}
 
-          for (const auto& mapping : final_user_product_mappings) {
-            product_ids_to_insert.push_back(mapping.first);
-            user_ids_to_insert.push_back(mapping.second);
-          }
+  std::string HandleAuthenticated(
+      const userver::server::http::HttpRequest& request,
+      userver::server::request::RequestContext& context,
+      const TSession& session) const {
+    // Retries with the same Idempotency-Key get the first response
+    return HandleIdempotently(
+        idempotency_store_, request, session.user_id,
+        [&] { return UpdateRoomData(request, context, session); });
+  }
 
-          transaction.Execute(
-              "INSERT INTO user_products (product_id, user_id) "
-              "VALUES (unnest($1::int[]), unnest($2::int[]))",
-              product_ids_to_insert,
-              user_ids_to_insert
-          );
+ private:
+  std::string UpdateRoomData(
+      const userver::server::http::HttpRequest& request,
+      userver::server::request::RequestContext& context,
+      const TSession& session) const {
+    std::string error;
+    const auto body = ParseRequestBody<TUpdateRoomRequest>(request, error);
+    if (!body) {
+      return error;
+    }
+    if (body->product && body->product->edit) {
+      for (const auto& product : *body->product->edit) {
+        if (product.status && !ParseUserProductStatus(*product.status)) {
+          return kInvalidStatusError(request);
         }
       }
+    }
 
-      // Replace the existing edit section with this bulk update approach
-      if (product_data.HasMember("edit") && !product_data["edit"].IsNull()) {
-        // Prepare vectors for bulk operations
-        std::vector<int> name_update_ids;
-        std::vector<std::string> name_update_values;
-        std::vector<int> price_update_ids;
-        std::vector<int> price_update_values;
-        std::vector<int> status_update_product_ids;
-        std::vector<std::string> status_update_values;
-
-        // Prepare vectors for user-product deletions
-        std::vector<int> delete_product_ids;
-        std::vector<int> delete_user_ids;
-
-        for (const auto& product : product_data["edit"]) {
-          int product_id = product["id"].As<int>();
-          auto name = product["name"].As<std::optional<std::string>>();
-          auto price = product["price"].As<std::optional<int>>();
-          auto status = product["status"].As<std::optional<std::string>>();
-          auto delete_users = product["delete_users"].As<std::vector<int>>();
-
-          // Collect name updates
-          if (name) {
-            name_update_ids.push_back(product_id);
-            name_update_values.push_back(name.value());
-          }
-
-          // Collect price updates
-          if (price) {
-            price_update_ids.push_back(product_id);
-            price_update_values.push_back(price.value());
-          }
-
-          // Collect status updates
-          if (status) {
-            status_update_product_ids.push_back(product_id);
-            status_update_values.push_back(status.value());
-          }
-
-          // Collect user-product deletions
-          for (int user_id : delete_users) {
-            delete_product_ids.push_back(product_id);
-            delete_user_ids.push_back(user_id);
-          }
-        }
-
-        // Bulk update names
-        if (!name_update_ids.empty()) {
-          transaction.Execute(
-              "UPDATE products AS p "
-              "SET name = u.name "
-              "FROM (SELECT unnest($1::int[]) AS id, unnest($2::text[]) AS name) AS u "
-              "WHERE p.id = u.id",
-              name_update_ids,
-              name_update_values
-          );
-        }
+    const auto room_id = GetIntPathArg(request, "id");
+    if (!room_id) {
+      return kInvalidRoomIdError(request);
+    }
 
-        // Bulk update prices
-        if (!price_update_ids.empty()) {
-          transaction.Execute(
-              "UPDATE products AS p "
-              "SET price = u.price "
-              "FROM (SELECT unnest($1::int[]) AS id, unnest($2::int[]) AS price) AS u "
-              "WHERE p.id = u.id",
-              price_update_ids,
-              price_update_values
-          );
-        }
+    const auto room = GetRoomAccess(context, shard_router_, *room_id);
+    if (!room) {
+      return kRoomNotFoundError(request);
+    }
+    if (room->owner_id != session.user_id) {
+      return kNotOwnerError(request);
+    }
 
-        // Bulk update statuses in user_products
-        if (!status_update_product_ids.empty()) {
-          transaction.Execute(
-              "UPDATE user_products AS up "
-              "SET status = u.status "
-              "FROM (SELECT unnest($1::int[]) AS product_id, unnest($2::text[]) AS status) AS u "
-              "WHERE up.product_id = u.product_id",
-              status_update_product_ids,
-              status_update_values
-          );
-        }
+    auto pg_cluster = shard_router_.ForRoom(*room_id);
+    auto transaction = pg_cluster->Begin(
+        userver::storages::postgres::TransactionOptions(),
+        userver::storages::postgres::OptionalCommandControl{});
+    if (!ClaimRoomVersion(request, transaction, *room_id)) {
+      return kRoomChangedError(request);
+    }
+    // Products and user products of an archived room are in room_archive
+    UnarchiveRoom(context, transaction, *room_id);
+
+    if (body->room && body->room->name) {
+      CountedExecute(
+          transaction,
+          "UPDATE rooms SET name = $1 WHERE id = $2 AND user_id = $3",
+          *body->room->name, *room_id, session.user_id);
+    }
 
-        // Bulk delete user-product associations
-        if (!delete_product_ids.empty()) {
-          transaction.Execute(
-              "DELETE FROM user_products AS up "
-              "WHERE (up.product_id, up.user_id) IN "
-              "(SELECT unnest($1::int[]), unnest($2::int[]))",
-              delete_product_ids,
-              delete_user_ids
-          );
-        }
+    if (body->product) {
+      if (body->product->add) {
+        AddProducts(transaction, *room_id, *body->product->add);
       }
-
-      if (product_data.HasMember("remove") && !product_data["remove"].IsNull()) {
-        // Batch deletion of products
-        std::vector<int> product_ids_to_remove;
-        for (const auto& product : product_data["remove"]) {
-          product_ids_to_remove.push_back(product["id"].As<int>());
-        }
-
-        transaction.Execute(
-            "DELETE FROM products WHERE id = ANY($1::int[])",
-            product_ids_to_remove
-        );
+      if (body->product->edit) {
+        EditProducts(transaction, *room_id, *body->product->edit);
+      }
+      if (body->product->remove) {
+        RemoveProducts(transaction, *room_id, *body->product->remove);
       }
     }
 
@@ -269,8 +235,7 @@ class UpdateRoom final : public userver::server::handlers::HttpHandlerBase {
     return userver::formats::json::ToString(response.ExtractValue());
   }
 
- private:
-  userver::storages::postgres::ClusterPtr pg_cluster_;
+  const IdempotencyStore& idempotency_store_;
 };
 
 }  // namespace
@@ -2,115 +2,120 @@
 
 #include <fmt/format.h>
 #include <regex>
+#include <tuple>
 
 #include <userver/components/component_context.hpp>
 #include <userver/formats/json.hpp>
-#include <userver/server/handlers/http_handler_base.hpp>
 
 #include <userver/storages/postgres/cluster.hpp>
 #include <userver/storages/postgres/component.hpp>
 #include <userver/utils/assert.hpp>
 
+#include "../../../../components/idempotency-store.hpp"
+#include "../../../../models/requests.hpp"
 #include "../../../../models/user-product.hpp"
-#include "../../../lib/auth.hpp"
+#include "../../../lib/authenticated-handler.hpp"
+#include "../../../lib/idempotency.hpp"
+#include "../../../lib/request-body.hpp"
 
 namespace split_bill {
 
 namespace {
 
+const TErrorResponse kMissingFieldsError{
+    userver::server::http::HttpStatus::kBadRequest,
+    "'product_id' and 'user_id' fields are required"};
+const TErrorResponse kUnknownProductError{
+    userver::server::http::HttpStatus::kNotFound, "Product Does not exist"};
+const TErrorResponse kUnknownUserError{
+    userver::server::http::HttpStatus::kNotFound, "User Does not exist!"};
+const TErrorResponse kAlreadyAssociatedError{
+    userver::server::http::HttpStatus::kConflict,
+    "User already associated with this product"};
+
 class AddUserToProduct final
-    : public userver::server::handlers::HttpHandlerBase {
+    : public AuthenticatedJsonHandler<AddUserToProduct> {
  public:
   static constexpr std::string_view kName = "handler-v1-add-user-to-product";
+  static constexpr auto kEndpointClass = EEndpointClass::kWrite;
 
   AddUserToProduct(
       const userver::components::ComponentConfig& config,
       const userver::components::ComponentContext& component_context)
-      : HttpHandlerBase(config, component_context),
-        pg_cluster_(
-            component_context
-                .FindComponent<userver::components::Postgres>("postgres-db-1")
-                .GetCluster()) {}
+      : AuthenticatedJsonHandler(config, component_context),
+        idempotency_store_(
+            component_context.FindComponent<IdempotencyStore>()) {}
 
-  std::string HandleRequestThrow(
+  std::string HandleAuthenticated(
       const userver::server::http::HttpRequest& request,
-      userver::server::request::RequestContext&) const override {
-    request.GetHttpResponse().SetContentType(
-        userver::http::content_type::kApplicationJson);
-    auto session = GetSessionInfo(pg_cluster_, request);
-    if (!session) {
-      request.SetResponseStatus(
-          userver::server::http::HttpStatus::kUnauthorized);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "Unauthorized";
-      return userver::formats::json::ToString(response.ExtractValue());
-    }
-    LOG_INFO() << "Request Body: " << request.RequestBody();
+      userver::server::request::RequestContext&,
+      const TSession& session) const {
+    // Retries with the same Idempotency-Key get the first response
+    return HandleIdempotently(
+        idempotency_store_, request, session.user_id,
+        [&] { return CreateUserProduct(request, session); });
+  }
 
-    auto request_body =
-        userver::formats::json::FromString(request.RequestBody());
-    auto status = request_body["status"].As<std::optional<std::string>>();
-    auto product_id = request_body["product_id"].As<std::optional<int>>();
-    auto user_id = request_body["user_id"].As<std::optional<int>>();
+ private:
+  std::string CreateUserProduct(
+      const userver::server::http::HttpRequest& request,
+      const TSession& session) const {
+    std::string error;
+    const auto body =
+        ParseRequestBody<TAddUserToProductRequest>(request, error);
+    if (!body) {
+      return error;
+    }
+    const auto& status = body->status;
+    const auto& product_id = body->product_id;
+    const auto& user_id = body->user_id;
     std::string status_str;
     if (!status) {
-      status_str = "UNPAID";
+      status_str = ToString(EUserProductStatus::kUnpaid);
     } else {
       status_str = status.value();
     }
-    if(status_str != "PAID" && status_str != "UNPAID"){
-      request.SetResponseStatus(userver::server::http::HttpStatus::kBadRequest);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "Status is not valid!(PAID | UNPAID)";
-      return userver::formats::json::ToString(response.ExtractValue());
+    if(!ParseUserProductStatus(status_str)){
+      return kInvalidStatusError(request);
     }
     if (!product_id || !user_id) {
-      request.SetResponseStatus(userver::server::http::HttpStatus::kBadRequest);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "'product_id' and 'user_id' fields are required";
-      return userver::formats::json::ToString(response.ExtractValue());
+      return kMissingFieldsError(request);
     }
 
-    LOG_INFO() << "Executing query with status: " << status_str
-               << ", product_id: " << *product_id << ", user_id: " << user_id.value();
-
-    auto check_result = pg_cluster_->Execute(
-        userver::storages::postgres::ClusterHostType::kSlave,
-        "SELECT 1 FROM user_products WHERE product_id = $1 AND user_id = $2 "
-        "LIMIT 1",
-        product_id.value(), user_id.value());
-
-    if (!check_result.IsEmpty()) {
-      request.SetResponseStatus(userver::server::http::HttpStatus::kConflict);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "User already associated with this product";
-      return userver::formats::json::ToString(response.ExtractValue());
-    }
-    auto check_product_id = pg_cluster_->Execute(
-        userver::storages::postgres::ClusterHostType::kSlave,
-        "SELECT 1 FROM products WHERE id = $1", product_id.value());
-    if (check_product_id.IsEmpty()) {
-      request.SetResponseStatus(userver::server::http::HttpStatus::kNotFound);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "Product Does not exist";
-      return userver::formats::json::ToString(response.ExtractValue());
+    auto pg_cluster = shard_router_.ForProduct(product_id.value());
+    auto product_room = CountedExecute(
+        pg_cluster, userver::storages::postgres::ClusterHostType::kSlave,
+        "SELECT l.room_id, r.archived FROM product_rooms l "
+        "JOIN rooms r ON l.room_id = r.id WHERE l.id = $1 AND NOT EXISTS ("
+        "    SELECT 1 FROM products p WHERE p.room_id = l.room_id "
+        "    AND p.id = l.id AND p.deleted_at IS NOT NULL)",
+        product_id.value());
+    if (product_room.IsEmpty()) {
+      return kUnknownProductError(request);
     }
-    auto check_user_id = pg_cluster_->Execute(
+    auto check_user_id = CountedExecute(
+        shard_router_.Global(),
         userver::storages::postgres::ClusterHostType::kSlave,
         "SELECT 1 FROM users WHERE id = $1", user_id.value());
     if (check_user_id.IsEmpty()) {
-      request.SetResponseStatus(userver::server::http::HttpStatus::kNotFound);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "User Does not exist!";
-      return userver::formats::json::ToString(response.ExtractValue());
+      return kUnknownUserError(request);
     }
-    auto result = pg_cluster_->Execute(
-        userver::storages::postgres::ClusterHostType::kSlave,
-        "INSERT INTO user_products (status, product_id, user_id) VALUES($1, "
-        "$2, $3) "
-        "ON CONFLICT DO NOTHING "
-        "RETURNING id, status, product_id, user_id",
-        status_str, product_id.value(), user_id.value());
+    const auto [room_id, archived] =
+        product_room.AsSingleRow<std::tuple<int, bool>>(
+            userver::storages::postgres::kRowTag);
+    // The user may already be on the product in room_archive
+    if (archived) {
+      CountedExecute(pg_cluster,
+                     userver::storages::postgres::ClusterHostType::kMaster,
+                     "SELECT unarchive_room($1)", room_id);
+    }
+    auto result = CountedExecute(
+        pg_cluster, userver::storages::postgres::ClusterHostType::kSlave,
+        "INSERT INTO user_products (status, product_id, user_id, room_id) "
+        "VALUES($1::user_product_status, $2, $3, $4) "
+        "ON CONFLICT (room_id, user_id, product_id) DO NOTHING "
+        "RETURNING id, status::text AS status, product_id, user_id",
+        status_str, product_id.value(), user_id.value(), room_id);
 
     if (!result.IsEmpty()) {
       auto user_product = result.AsSingleRow<TUserProduct>(
@@ -118,15 +123,11 @@ class AddUserToProduct final
       return ToString(
           userver::formats::json::ValueBuilder{user_product}.ExtractValue());
     } else {
-      request.SetResponseStatus(userver::server::http::HttpStatus::kConflict);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "User already associated with this product";
-      return userver::formats::json::ToString(response.ExtractValue());
+      return kAlreadyAssociatedError(request);
     }
   }
 
- private:
-  userver::storages::postgres::ClusterPtr pg_cluster_;
+  const IdempotencyStore& idempotency_store_;
 };
 
 }  // namespace
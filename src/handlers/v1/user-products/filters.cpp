@@ -5,15 +5,17 @@
 #include <stdexcept>
 #include <string>
 #include <unordered_map>
+
+#include "../../lib/args.hpp"
+
 namespace split_bill {
 
 TFilters Parse(const userver::server::http::HttpRequest& request) {
   TFilters result;
 
   if (request.HasPathArg("id")) {
-    try {
-      result.room_id = std::stoul(request.GetPathArg("id"));
-    } catch (const std::exception&) {
+    result.room_id = ParseInteger<size_t>(request.GetPathArg("id"));
+    if (!result.room_id) {
       throw std::invalid_argument("Invalid roomId provided in the path.");
     }
   }
@@ -5,81 +5,72 @@
 
 #include <userver/components/component_context.hpp>
 #include <userver/formats/serialize/common_containers.hpp>
-#include <userver/server/handlers/http_handler_base.hpp>
 #include <userver/server/http/http_status.hpp>
 #include <userver/storages/postgres/cluster.hpp>
 #include <userver/storages/postgres/component.hpp>
 
+#include "../../../../components/response-compression.hpp"
 #include "../../../../models/user-product.hpp"
 
-#include "../../../lib/auth.hpp"
+#include "../../../lib/args.hpp"
+#include "../../../lib/authenticated-handler.hpp"
 #include "../filters.hpp"
 
 namespace split_bill {
 
 namespace {
 
-class GetUserProducts final
-    : public userver::server::handlers::HttpHandlerBase {
+const TErrorResponse kMissingRoomIdError{
+    userver::server::http::HttpStatus::kBadRequest,
+    "Missing room_id query parameter."};
+const TErrorResponse kRoomWithoutProductsError{
+    userver::server::http::HttpStatus::kNotFound,
+    "Room Id does not exist or does not have any products"};
+
+class GetUserProducts final : public AuthenticatedJsonHandler<GetUserProducts> {
  public:
   static constexpr std::string_view kName = "handler-v1-get-all-user-products";
+  static constexpr auto kEndpointClass = EEndpointClass::kHeavy;
 
   GetUserProducts(
       const userver::components::ComponentConfig& config,
       const userver::components::ComponentContext& component_context)
-      : HttpHandlerBase(config, component_context),
-        pg_cluster_(
-            component_context
-                .FindComponent<userver::components::Postgres>("postgres-db-1")
-                .GetCluster()) {}
+      : AuthenticatedJsonHandler(config, component_context),
+        compression_(
+            component_context.FindComponent<ResponseCompression>()) {}
 
-  std::string HandleRequestThrow(
+  std::string HandleAuthenticated(
       const userver::server::http::HttpRequest& request,
-      userver::server::request::RequestContext&) const override {
-    request.GetHttpResponse().SetContentType(
-        userver::http::content_type::kApplicationJson);
-    auto session = GetSessionInfo(pg_cluster_, request);
-    if (!session) {
-      request.SetResponseStatus(
-          userver::server::http::HttpStatus::kUnauthorized);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "Unauthorized";
-      return userver::formats::json::ToString(response.ExtractValue());
-    }
-
+      userver::server::request::RequestContext&,
+      const TSession& session) const {
     if (!request.HasArg("room_id")) {
-      request.SetResponseStatus(userver::server::http::HttpStatus::kBadRequest);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "Missing room_id query parameter.";
-      return userver::formats::json::ToString(response.ExtractValue());
+      return kMissingRoomIdError(request);
     }
 
-    const auto& id_str = request.GetArg("room_id");
-    int room_id;
-    try {
-      room_id = std::stoi(id_str);
-    } catch (const std::exception&) {
-      request.SetResponseStatus(userver::server::http::HttpStatus::kBadRequest);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "Invalid room ID";
-      return userver::formats::json::ToString(response.ExtractValue());
+    const auto room_id = GetIntArg(request, "room_id");
+    if (!room_id) {
+      return kInvalidRoomIdError(request);
     }
 
-    auto result = pg_cluster_->Execute(
+    // An archived room keeps its user products in room_archive
+    auto result = CountedExecute(
+        shard_router_.ForRoom(*room_id),
         userver::storages::postgres::ClusterHostType::kSlave,
-        "SELECT u.id AS user_id, "
+        "SELECT up.user_id, "
         "ARRAY_AGG(up.product_id) AS product_ids "
-        "FROM users u "
-        "JOIN user_products up ON u.id = up.user_id "
-        "JOIN products p ON up.product_id = p.id "
-        "WHERE p.room_id = $1 "
-        "GROUP BY u.id;",
-        room_id);
+        "FROM (SELECT user_id, product_id FROM user_products u "
+        "      WHERE room_id = $1 AND NOT EXISTS ("
+        "          SELECT 1 FROM products p WHERE p.room_id = u.room_id "
+        "          AND p.id = u.product_id AND p.deleted_at IS NOT NULL) "
+        "      UNION ALL "
+        "      SELECT up.user_id, up.product_id FROM room_archive a "
+        "      CROSS JOIN jsonb_to_recordset(a.room_rows->'user_products') "
+        "          AS up(user_id int4, product_id int4) "
+        "      WHERE a.room_id = $1) up "
+        "GROUP BY up.user_id;",
+        *room_id);
     if (result.IsEmpty()) {
-      request.SetResponseStatus(userver::server::http::HttpStatus::kNotFound);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "Room Id does not exist or does not have any products";
-      return userver::formats::json::ToString(response.ExtractValue());
+      return kRoomWithoutProductsError(request);
     }
 
     userver::formats::json::ValueBuilder response;//TODO govnocode
@@ -90,11 +81,12 @@ class GetUserProducts final
       user_entry["product_ids"] = row["product_ids"].As<std::vector<int>>();
       response["users"].PushBack(std::move(user_entry));
     }
-    return userver::formats::json::ToString(response.ExtractValue());
+    return compression_.Compress(
+        request, userver::formats::json::ToString(response.ExtractValue()));
   }
 
  private:
-  userver::storages::postgres::ClusterPtr pg_cluster_;
+  const ResponseCompression& compression_;
 };
 }  // namespace
 
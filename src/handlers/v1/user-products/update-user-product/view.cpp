@@ -4,121 +4,107 @@
 #include <unordered_map>
 
 #include <userver/components/component_context.hpp>
-#include <userver/server/handlers/http_handler_base.hpp>
 #include <userver/server/http/http_status.hpp>
 #include <userver/storages/postgres/cluster.hpp>
 #include <userver/storages/postgres/component.hpp>
 
 #include "../../../../models/user-product.hpp"
 
-#include "../../../lib/auth.hpp"
+#include "../../../lib/args.hpp"
+#include "../../../lib/authenticated-handler.hpp"
+#include "../../../lib/room-access.hpp"
+#include "../../../lib/room-version.hpp"
 #include "../filters.hpp"
 
 namespace split_bill {
 
 namespace {
 
+const TErrorResponse kInvalidUserProductIdError{
+    userver::server::http::HttpStatus::kBadRequest, "Invalid user product ID"};
+const TErrorResponse kUnknownUserProductError{
+    userver::server::http::HttpStatus::kNotFound,
+    "User Product Id Does not exist!"};
+const TErrorResponse kNotOwnerError{
+    userver::server::http::HttpStatus::kForbidden,
+    "User is not an owner of the Room!"};
+const TErrorResponse kMissingStatusError{
+    userver::server::http::HttpStatus::kBadRequest,
+    "Missing or invalid 'status' field"};
+const TErrorResponse kUserProductNotFoundError{
+    userver::server::http::HttpStatus::kNotFound, "User product not found"};
+
 class UpdateUserProduct final
-    : public userver::server::handlers::HttpHandlerBase {
+    : public AuthenticatedJsonHandler<UpdateUserProduct> {
  public:
   static constexpr std::string_view kName = "handler-v1-update-user-product";
+  static constexpr auto kEndpointClass = EEndpointClass::kWrite;
 
   UpdateUserProduct(
       const userver::components::ComponentConfig& config,
       const userver::components::ComponentContext& component_context)
-      : HttpHandlerBase(config, component_context),
-        pg_cluster_(
-            component_context
-                .FindComponent<userver::components::Postgres>("postgres-db-1")
-                .GetCluster()) {}
+      : AuthenticatedJsonHandler(config, component_context) {}
 
-  std::string HandleRequestThrow(
+  std::string HandleAuthenticated(
       const userver::server::http::HttpRequest& request,
-      userver::server::request::RequestContext&) const override {
-    request.GetHttpResponse().SetContentType(
-        userver::http::content_type::kApplicationJson);
-    auto session = GetSessionInfo(pg_cluster_, request);
-    if (!session) {
-      request.SetResponseStatus(
-          userver::server::http::HttpStatus::kUnauthorized);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "Unauthorized";
-      return userver::formats::json::ToString(response.ExtractValue());
-    }
-
-    const auto& id_str = request.GetPathArg("id");
-    int user_product_id;
-    try {
-      user_product_id = std::stoi(id_str);
-    } catch (const std::exception&) {
-      request.SetResponseStatus(userver::server::http::HttpStatus::kBadRequest);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "Invalid user product ID";
-      return userver::formats::json::ToString(response.ExtractValue());
+      userver::server::request::RequestContext& context,
+      const TSession& session) const {
+    const auto user_product_id = GetIntPathArg(request, "id");
+    if (!user_product_id) {
+      return kInvalidUserProductIdError(request);
     }
-    auto check_user_id = pg_cluster_->Execute(
-        userver::storages::postgres::ClusterHostType::kMaster,
-        "SELECT 1 FROM user_products WHERE id = $1", user_product_id);
-    if (check_user_id.IsEmpty()) {
-      request.SetResponseStatus(userver::server::http::HttpStatus::kNotFound);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "User Product Id Does not exist!";
-      return userver::formats::json::ToString(response.ExtractValue());
+    auto pg_cluster = shard_router_.ForUserProduct(*user_product_id);
+    auto user_product_room = CountedExecute(
+        pg_cluster, userver::storages::postgres::ClusterHostType::kMaster,
+        "SELECT room_id FROM user_product_rooms WHERE id = $1",
+        *user_product_id);
+    if (user_product_room.IsEmpty()) {
+      return kUnknownUserProductError(request);
     }
 
-    auto owner_id = pg_cluster_->Execute(
-        userver::storages::postgres::ClusterHostType::kSlave,
-        "SELECT r.user_id "
-        "FROM rooms r "
-        "JOIN products p ON r.id = p.room_id "
-        "JOIN user_products up ON p.id = up.product_id "
-        "WHERE up.id = $1",
-        user_product_id);
-
-    if(session->user_id != owner_id[0]["user_id"].As<int>()){
-      request.SetResponseStatus(userver::server::http::HttpStatus::kForbidden);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "User is not an owner of the Room!";
-      return userver::formats::json::ToString(response.ExtractValue());
+    const auto room_id = user_product_room.AsSingleRow<int>();
+    const auto room = GetRoomAccess(context, shard_router_, room_id);
+    if (!room || session.user_id != room->owner_id) {
+      return kNotOwnerError(request);
     }
     auto request_body =
         userver::formats::json::FromString(request.RequestBody());
 
     auto status = request_body["status"].As<std::optional<std::string>>();
     if (!status) {
-      request.SetResponseStatus(userver::server::http::HttpStatus::kBadRequest);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "Missing or invalid 'status' field";
-      return userver::formats::json::ToString(response.ExtractValue());
-    }else if(status != "PAID" && status != "UNPAID"){
-      request.SetResponseStatus(userver::server::http::HttpStatus::kBadRequest);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "Status is not valid!(PAID | UNPAID)";
-      return userver::formats::json::ToString(response.ExtractValue());
+      return kMissingStatusError(request);
+    }else if(!ParseUserProductStatus(*status)){
+      return kInvalidStatusError(request);
     }
 
-    auto result = pg_cluster_->Execute(
-        userver::storages::postgres::ClusterHostType::kSlave,
-        "UPDATE user_products SET status = $1 "
-        "WHERE id = $2 "
-        "RETURNING id, status, product_id, user_id",
-        *status, user_product_id);
+    auto transaction = pg_cluster->Begin(
+        userver::storages::postgres::TransactionOptions(),
+        userver::storages::postgres::OptionalCommandControl{});
+    if (!ClaimRoomVersion(request, transaction, room_id)) {
+      return kRoomChangedError(request);
+    }
+    UnarchiveRoom(context, transaction, room_id);
+
+    auto result = CountedExecute(
+        transaction,
+        "UPDATE user_products SET status = $1::user_product_status "
+        "WHERE room_id = $2 AND id = $3 AND NOT EXISTS ("
+        "    SELECT 1 FROM products p WHERE p.room_id = $2 "
+        "    AND p.id = user_products.product_id "
+        "    AND p.deleted_at IS NOT NULL) "
+        "RETURNING id, status::text AS status, product_id, user_id",
+        *status, room_id, *user_product_id);
 
     if (result.IsEmpty()) {
-      request.SetResponseStatus(userver::server::http::HttpStatus::kNotFound);
-      userver::formats::json::ValueBuilder response;
-      response["error"] = "User product not found";
-      return userver::formats::json::ToString(response.ExtractValue());
+      return kUserProductNotFoundError(request);
     }
+    transaction.Commit();
     auto updated_user_product =
         result.AsSingleRow<TUserProduct>(userver::storages::postgres::kRowTag);
     return userver::formats::json::ToString(
         userver::formats::json::ValueBuilder{updated_user_product}
             .ExtractValue());
   }
-
- private:
-  userver::storages::postgres::ClusterPtr pg_cluster_;
 };
 }  // namespace
 
@@ -0,0 +1,143 @@
+#include "view.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#include <userver/cache/lru_map.hpp>
+#include <userver/components/component_context.hpp>
+#include <userver/engine/mutex.hpp>
+#include <userver/formats/json.hpp>
+#include <userver/storages/postgres/cluster.hpp>
+
+#include "../../../../components/user-search-cache.hpp"
+#include "../../../lib/args.hpp"
+#include "../../../lib/authenticated-handler.hpp"
+
+namespace split_bill {
+
+namespace {
+
+const TErrorResponse kInvalidQueryError{
+    userver::server::http::HttpStatus::kBadRequest,
+    "Query must be 1 to 64 characters long"};
+
+constexpr size_t kMaxQueryLength = 64;
+constexpr size_t kDefaultLimit = 20;
+constexpr size_t kMaxLimit = 100;
+
+// Room co-members of a user, ranked first in their searches. Joining a room
+// shows up in the ranking once the entry expires.
+constexpr std::chrono::seconds kCoMembersTtl{30};
+constexpr size_t kCoMembersCacheSize = 10000;
+
+struct TCoMembers {
+  std::vector<int> user_ids;  // sorted
+  std::chrono::steady_clock::time_point expires_at;
+};
+
+class SearchUsers final : public AuthenticatedJsonHandler<SearchUsers> {
+ public:
+  static constexpr std::string_view kName = "handler-v1-search-users";
+  static constexpr auto kEndpointClass = EEndpointClass::kInteractive;
+
+  SearchUsers(const userver::components::ComponentConfig& config,
+              const userver::components::ComponentContext& component_context)
+      : AuthenticatedJsonHandler(config, component_context),
+        search_cache_(component_context.FindComponent<UserSearchCache>()),
+        co_members_(kCoMembersCacheSize) {}
+
+  std::string HandleAuthenticated(
+      const userver::server::http::HttpRequest& request,
+      userver::server::request::RequestContext&,
+      const TSession& session) const {
+    const auto& query = request.GetArg("q");
+    if (query.empty() || query.size() > kMaxQueryLength) {
+      return kInvalidQueryError(request);
+    }
+
+    size_t limit = kDefaultLimit;
+    if (const auto limit_arg = GetIntArg(request, "limit")) {
+      limit = std::clamp<int>(*limit_arg, 1, kMaxLimit);
+    }
+
+    const auto index = search_cache_.Get();
+    const auto users =
+        index->Search(query, GetCoMembers(session.user_id), limit);
+
+    userver::formats::json::ValueBuilder response;
+    response["users"] =
+        userver::formats::json::ValueBuilder(userver::formats::json::Type::kArray);
+    for (const auto* info : users) {
+      userver::formats::json::ValueBuilder user;
+      user["id"] = info->id;
+      user["username"] = info->username;
+
+      if (info->full_name) {
+        user["full_name"] = *info->full_name;
+      } else {
+        user["full_name"] = nullptr;
+      }
+
+      if (info->photo_url) {
+        user["photo_url"] = *info->photo_url;
+      } else {
+        user["photo_url"] = nullptr;
+      }
+      response["users"].PushBack(std::move(user));
+    }
+
+    return userver::formats::json::ToString(response.ExtractValue());
+  }
+
+ private:
+  std::vector<int> GetCoMembers(int user_id) const {
+    const auto now = std::chrono::steady_clock::now();
+    {
+      std::lock_guard lock(mutex_);
+      const auto* cached = co_members_.Get(user_id);
+      if (cached && cached->expires_at > now) {
+        return cached->user_ids;
+      }
+    }
+
+    // Membership is stored with the rooms, spread over every shard
+    auto shard_results = shard_router_.FanOut(
+        "search-users-co-members",
+        [user_id](const userver::storages::postgres::ClusterPtr& pg_cluster) {
+          return CountedExecute(
+              pg_cluster, userver::storages::postgres::ClusterHostType::kSlave,
+              "SELECT DISTINCT other.user_id FROM user_rooms own "
+              "JOIN user_rooms other ON other.room_id = own.room_id "
+              "WHERE own.user_id = $1 AND other.user_id <> $1",
+              user_id)
+              .AsContainer<std::vector<int>>();
+        });
+
+    std::vector<int> user_ids;
+    for (const auto& shard_user_ids : shard_results) {
+      user_ids.insert(user_ids.end(), shard_user_ids.begin(),
+                      shard_user_ids.end());
+    }
+    std::sort(user_ids.begin(), user_ids.end());
+    user_ids.erase(std::unique(user_ids.begin(), user_ids.end()),
+                   user_ids.end());
+
+    std::lock_guard lock(mutex_);
+    co_members_.Put(user_id, TCoMembers{user_ids, now + kCoMembersTtl});
+    return user_ids;
+  }
+
+  const UserSearchCache& search_cache_;
+  mutable userver::engine::Mutex mutex_;
+  mutable userver::cache::LruMap<int, TCoMembers> co_members_;
+};
+
+}  // namespace
+
+void AppendSearchUsers(userver::components::ComponentList& component_list) {
+  component_list.Append<SearchUsers>();
+}
+
+}  // namespace split_bill
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include <userver/components/component_list.hpp>
+
+namespace split_bill {
+
+void AppendSearchUsers(userver::components::ComponentList& component_list);
+
+}  // namespace split_bill
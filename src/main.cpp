@@ -8,6 +8,20 @@
 #include <userver/utils/daemon_run.hpp>
 
 // Products header files
+#include "components/admission-control.hpp"
+#include "components/idempotency-store.hpp"
+#include "components/product-reaper.hpp"
+#include "components/query-stats.hpp"
+#include "components/request-logging.hpp"
+#include "components/request-coalescing.hpp"
+#include "components/response-compression.hpp"
+#include "components/schema-migrator.hpp"
+#include "components/shard-router.hpp"
+#include "components/room-archiver.hpp"
+#include "components/room-snapshot-cache.hpp"
+#include "components/server-timing.hpp"
+#include "components/traffic-capture.hpp"
+#include "components/user-search-cache.hpp"
 #include "handlers/v1/products/add-product/view.hpp"
 #include "handlers/v1/products/get-product/view.hpp"
 #include "handlers/v1/products/delete-product/view.hpp"
@@ -18,8 +32,10 @@
 #include "handlers/v1/rooms/update-room/view.hpp"
 #include "handlers/v1/rooms/get-room/view.hpp"
 #include "handlers/v1/rooms/get-room-user-prices/view.hpp"
+#include "handlers/v1/rooms/get-room-summary/view.hpp"
 #include "handlers/v1/rooms/get-room-users/view.hpp"
 #include "handlers/v1/rooms/join-room/view.hpp"
+#include "handlers/v1/rooms/import-receipt/view.hpp"
 #include "handlers/v1/register/view.hpp"
 #include "handlers/v1/login/view.hpp"
 // user products header files
@@ -27,6 +43,9 @@
 #include "handlers/v1/user-products/get-user-products/view.hpp"
 #include "handlers/v1/user-products/get-user-product/view.hpp"
 #include "handlers/v1/user-products/update-user-product/view.hpp"
+#include "handlers/v1/users/search-users/view.hpp"
+#include "handlers/service/introspection/view.hpp"
+#include "handlers/service/cpu-profile/view.hpp"
 
 
 int main(int argc, char* argv[]) {
@@ -37,7 +56,29 @@ int main(int argc, char* argv[]) {
           .Append<userver::components::HttpClient>()
           .Append<userver::server::handlers::TestsControl>()
           .Append<userver::components::Postgres>("postgres-db-1")
+          // Extra room shards, disabled unless listed in `shard-router`
+          .Append<userver::components::Postgres>("postgres-room-shard-1")
+          .Append<userver::components::Postgres>("postgres-room-shard-2")
+          .Append<userver::components::Postgres>("postgres-room-shard-3")
+          .Append<split_bill::ShardRouter>()
+          .Append<split_bill::SchemaMigrator>()
+          .Append<split_bill::RequestCoalescing>()
+          .Append<split_bill::ResponseCompression>()
+          .Append<split_bill::QueryStats>()
+          .Append<split_bill::RequestLogging>()
+          .Append<split_bill::ServerTiming>()
+          .Append<split_bill::TrafficCapture>()
+          .Append<split_bill::RoomSnapshotCache>()
+          .Append<split_bill::RoomArchiver>()
+          .Append<split_bill::ProductReaper>()
+          .Append<split_bill::UserSearchCache>()
+          .Append<split_bill::IdempotencyStore>()
+          .Append<split_bill::AdmissionControl>()
           .Append<userver::clients::dns::Component>();
+  // Monitor listener only
+  split_bill::AppendIntrospection(component_list);
+  split_bill::AppendCpuProfile(component_list);
+
   // Product endpoints
   split_bill::AppendAddProduct(component_list);
   split_bill::AppendGetProduct(component_list);
@@ -47,6 +88,7 @@ int main(int argc, char* argv[]) {
   // User Authentication
   split_bill::AppendRegisterUser(component_list);
   split_bill::AppendLoginUser(component_list);
+  split_bill::AppendSearchUsers(component_list);
   // User products
   split_bill::AppendAddUserToProduct(component_list);
   split_bill::AppendGetUserProducts(component_list);
@@ -59,9 +101,11 @@ int main(int argc, char* argv[]) {
   split_bill::AppendGetCreatedRooms(component_list);
   split_bill::AppendGetRoom(component_list);
   split_bill::AppendGetRoomUserPrices(component_list);
+  split_bill::AppendGetRoomSummary(component_list);
   split_bill::AppendUpdateRoom(component_list);
   split_bill::AppendJoinRoom(component_list);
   split_bill::AppendGetRoomUsers(component_list);
+  split_bill::AppendImportReceipt(component_list);
 
   return userver::utils::DaemonMain(argc, argv, component_list);
 }
@@ -0,0 +1,18 @@
+#include "archived-room.hpp"
+
+#include <algorithm>
+
+#include "memory-usage.hpp"
+
+namespace split_bill {
+
+bool TArchivedRoom::IsMember(int user_id) const {
+  return std::binary_search(member_ids.begin(), member_ids.end(), user_id);
+}
+
+size_t TArchivedRoom::MemoryUsage() const {
+  return sizeof(*this) + HeapBytes(member_ids) + HeapBytes(details) +
+         HeapBytes(calculation) + HeapBytes(summary);
+}
+
+}  // namespace split_bill
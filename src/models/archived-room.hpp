@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace split_bill {
+
+// A room moved to room_archive by room-archiver. Its responses were
+// serialized when it was archived and are kept gzipped; they stay valid
+// until the room is edited, which unarchives it.
+struct TArchivedRoom {
+  int room_id;
+  int owner_id;
+  int64_t version;
+  std::vector<int> member_ids;  // sorted
+
+  // Gzipped bodies of GET /v1/rooms/{id}, /calculate and /summary
+  std::string details;
+  std::string calculation;
+  std::string summary;
+
+  bool IsMember(int user_id) const;
+  // Approximate heap bytes, this struct included
+  size_t MemoryUsage() const;
+};
+
+}  // namespace split_bill
@@ -1,32 +1,129 @@
 #include "detailed-room.hpp"
-#include <userver/formats/json/value_builder.hpp>
+#include <stdexcept>
 
 namespace split_bill {
 
-userver::formats::json::Value Serialize(
-    const TRoomProduct& room_product,
-    userver::formats::serialize::To<userver::formats::json::Value>) {
-  userver::formats::json::ValueBuilder json;
-  json["id"] = room_product.id;
-  json["name"] = room_product.name;
-  json["price"] = room_product.price;
-  json["room_id"] = room_product.room_id;
-  json["user_products"] = room_product.user_products;
-  return json.ExtractValue();
+std::string_view ToString(ERoomStatus status) {
+  switch (status) {
+    case ERoomStatus::kActive:
+      return "ACTIVE";
+    case ERoomStatus::kArchived:
+      return "ARCHIVED";
+  }
+  throw std::invalid_argument("Unknown room status");
 }
 
-userver::formats::json::Value Serialize(
-    const TRoomDetails& room_details,
-    userver::formats::serialize::To<userver::formats::json::Value>) {
-  userver::formats::json::ValueBuilder json;
-  json["id"] = room_details.id;
-  json["name"] = room_details.name;
-  json["owner_id"] = room_details.owner_id;
-  json["room_products"] = room_details.room_products;
-  json["room_status"] = room_details.status;
-  json["total_price"] = room_details.total_price;
-  json["total_members"] = room_details.total_members;
-  return json.ExtractValue();
+// Written straight to the output buffer: building a json::Value first would
+// allocate a node per field of every user product.
+void WriteToStream(const TRoomProduct& room_product,
+                   userver::formats::json::StringBuilder& sw) {
+  userver::formats::json::StringBuilder::ObjectGuard guard{sw};
+  sw.Key("id");
+  WriteToStream(room_product.id, sw);
+  sw.Key("name");
+  WriteToStream(std::string_view{room_product.name}, sw);
+  sw.Key("price");
+  WriteToStream(static_cast<int64_t>(room_product.price), sw);
+  sw.Key("room_id");
+  WriteToStream(room_product.room_id, sw);
+  sw.Key("user_products");
+  {
+    userver::formats::json::StringBuilder::ArrayGuard array_guard{sw};
+    for (const auto& user_product : room_product.user_products) {
+      WriteToStream(user_product, sw);
+    }
+  }
+}
+
+void WriteToStream(const TRoomDetails& room_details,
+                   userver::formats::json::StringBuilder& sw) {
+  userver::formats::json::StringBuilder::ObjectGuard guard{sw};
+  sw.Key("id");
+  WriteToStream(room_details.id, sw);
+  sw.Key("name");
+  WriteToStream(std::string_view{room_details.name}, sw);
+  sw.Key("owner_id");
+  WriteToStream(room_details.owner_id, sw);
+  sw.Key("room_products");
+  {
+    userver::formats::json::StringBuilder::ArrayGuard array_guard{sw};
+    for (const auto& room_product : room_details.room_products) {
+      WriteToStream(room_product, sw);
+    }
+  }
+  sw.Key("room_status");
+  WriteToStream(ToString(room_details.status), sw);
+  sw.Key("total_price");
+  WriteToStream(static_cast<int64_t>(room_details.total_price), sw);
+  sw.Key("total_members");
+  WriteToStream(room_details.total_members, sw);
+}
+
+void WriteToStream(const TRoomProductsPage& page,
+                   userver::formats::json::StringBuilder& sw) {
+  userver::formats::json::StringBuilder::ObjectGuard guard{sw};
+  sw.Key("room_products");
+  {
+    userver::formats::json::StringBuilder::ArrayGuard array_guard{sw};
+    for (const auto& room_product : page.room_products) {
+      WriteToStream(room_product, sw);
+    }
+  }
+  if (page.next_cursor) {
+    sw.Key("next_cursor");
+    WriteToStream(*page.next_cursor, sw);
+  }
+}
+
+void WriteToMsgPack(const TRoomProduct& room_product, TMsgPackWriter& writer) {
+  writer.MapHeader(5);
+  writer.String("id");
+  writer.Int(room_product.id);
+  writer.String("name");
+  writer.String(room_product.name);
+  writer.String("price");
+  writer.Int(room_product.price);
+  writer.String("room_id");
+  writer.Int(room_product.room_id);
+  writer.String("user_products");
+  writer.ArrayHeader(static_cast<uint32_t>(room_product.user_products.size()));
+  for (const auto& user_product : room_product.user_products) {
+    WriteToMsgPack(user_product, writer);
+  }
+}
+
+void WriteToMsgPack(const TRoomDetails& room_details, TMsgPackWriter& writer) {
+  writer.MapHeader(7);
+  writer.String("id");
+  writer.Int(room_details.id);
+  writer.String("name");
+  writer.String(room_details.name);
+  writer.String("owner_id");
+  writer.Int(room_details.owner_id);
+  writer.String("room_products");
+  writer.ArrayHeader(static_cast<uint32_t>(room_details.room_products.size()));
+  for (const auto& room_product : room_details.room_products) {
+    WriteToMsgPack(room_product, writer);
+  }
+  writer.String("room_status");
+  writer.String(ToString(room_details.status));
+  writer.String("total_price");
+  writer.Int(room_details.total_price);
+  writer.String("total_members");
+  writer.Int(room_details.total_members);
+}
+
+void WriteToMsgPack(const TRoomProductsPage& page, TMsgPackWriter& writer) {
+  writer.MapHeader(page.next_cursor ? 2 : 1);
+  writer.String("room_products");
+  writer.ArrayHeader(static_cast<uint32_t>(page.room_products.size()));
+  for (const auto& room_product : page.room_products) {
+    WriteToMsgPack(room_product, writer);
+  }
+  if (page.next_cursor) {
+    writer.String("next_cursor");
+    writer.Int(*page.next_cursor);
+  }
 }
 
 userver::formats::json::Value Serialize(
@@ -1,11 +1,16 @@
 #pragma once
 
+#include <cstdint>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <optional>
+#include "msgpack.hpp"
 #include "user-product.hpp"
 #include "product.hpp"
 
+#include <userver/formats/json/string_builder.hpp>
 #include <userver/formats/json/value.hpp>
 #include <userver/formats/json/serialize_container.hpp>
 #include <userver/formats/json/value_builder.hpp>
@@ -14,40 +19,55 @@
 
 namespace split_bill {
 
-// Forward declarations
-struct TRoomProduct;
-struct TRoomDetails;
+enum class ERoomStatus : uint8_t { kActive, kArchived };
 
-userver::formats::json::Value Serialize(
-    const TRoomProduct& data,
-    userver::formats::serialize::To<userver::formats::json::Value>);
-
-userver::formats::json::Value Serialize(
-    const TRoomDetails& data,
-    userver::formats::serialize::To<userver::formats::json::Value>);
+// "ACTIVE" while anything in the room is unpaid, "ARCHIVED" otherwise
+std::string_view ToString(ERoomStatus status);
 
+// TRoomProduct and TRoomDetails keep every string and vector in one memory
+// resource, normally the request arena (see handlers/lib/arena.hpp), so a
+// room response is freed in one step.
 struct TRoomProduct {
   int id;
-  std::string name;
+  std::pmr::string name;
   long price;
   int room_id;
-  std::vector<split_bill::TUserProductWithDetails> user_products;
-
-  TRoomProduct(int id, const std::string& name, long price, int room_id, std::vector<split_bill::TUserProductWithDetails>&& user_products)
-      : id(id), name(name), price(price), room_id(room_id), user_products(std::move(user_products)) {}
+  std::pmr::vector<split_bill::TUserProductWithDetails> user_products;
 };
 
-
 struct TRoomDetails {
   int id;
-  std::string name;
+  std::pmr::string name;
   int owner_id;
-  std::vector<TRoomProduct> room_products;
-  std::string status;
+  std::pmr::vector<TRoomProduct> room_products;
+  ERoomStatus status;
   long total_price;
   int total_members;
 };
 
+// One page of the products section of GET /v1/rooms/{id}; next_cursor is
+// set while more products follow
+struct TRoomProductsPage {
+  std::pmr::vector<TRoomProduct> room_products;
+  std::optional<int> next_cursor;
+};
+
+void WriteToStream(const TRoomProduct& data,
+                   userver::formats::json::StringBuilder& sw);
+
+void WriteToStream(const TRoomDetails& data,
+                   userver::formats::json::StringBuilder& sw);
+
+void WriteToStream(const TRoomProductsPage& data,
+                   userver::formats::json::StringBuilder& sw);
+
+// Same keys, in the same order, as WriteToStream
+void WriteToMsgPack(const TRoomProduct& data, TMsgPackWriter& writer);
+
+void WriteToMsgPack(const TRoomDetails& data, TMsgPackWriter& writer);
+
+void WriteToMsgPack(const TRoomProductsPage& data, TMsgPackWriter& writer);
+
 struct TUserProductTransaction {
   std::string action;
   std::optional<int> id;
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <bitset>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "json-reader.hpp"
+
+namespace split_bill {
+
+// Request DTOs are structs describing their JSON fields in a static
+// Fields(), read in one pass by ReadDto without a DOM:
+//
+//   struct TLoginRequest {
+//     std::optional<std::string> username;
+//     static constexpr auto Fields() {
+//       return std::make_tuple(Optional("username", &TLoginRequest::username));
+//     }
+//   };
+//
+// A Required field missing from the object is an error, an Optional one
+// keeps its default. Null is accepted only by std::optional members. Unknown
+// fields are skipped.
+template <typename Dto, typename T>
+struct TDtoField {
+  std::string_view name;
+  T Dto::*member;
+  bool required;
+};
+
+template <typename Dto, typename T>
+constexpr TDtoField<Dto, T> Required(std::string_view name, T Dto::*member) {
+  return {name, member, true};
+}
+
+template <typename Dto, typename T>
+constexpr TDtoField<Dto, T> Optional(std::string_view name, T Dto::*member) {
+  return {name, member, false};
+}
+
+template <typename T, typename = void>
+struct TIsDto : std::false_type {};
+
+template <typename T>
+struct TIsDto<T, std::void_t<decltype(T::Fields())>> : std::true_type {};
+
+inline void ReadValue(TJsonReader& reader, bool& value) {
+  value = reader.ReadBool();
+}
+
+inline void ReadValue(TJsonReader& reader, int64_t& value) {
+  value = reader.ReadInt64();
+}
+
+inline void ReadValue(TJsonReader& reader, int& value) {
+  const auto wide = reader.ReadInt64();
+  if (wide < std::numeric_limits<int>::min() ||
+      wide > std::numeric_limits<int>::max()) {
+    throw TJsonReadError("integer out of the int32 range");
+  }
+  value = static_cast<int>(wide);
+}
+
+inline void ReadValue(TJsonReader& reader, std::string& value) {
+  value = reader.ReadString();
+}
+
+template <typename T>
+void ReadValue(TJsonReader& reader, std::optional<T>& value);
+template <typename T>
+void ReadValue(TJsonReader& reader, std::vector<T>& value);
+template <typename T>
+std::enable_if_t<TIsDto<T>::value> ReadValue(TJsonReader& reader, T& value);
+
+template <typename T>
+void ReadValue(TJsonReader& reader, std::optional<T>& value) {
+  if (reader.TryNull()) {
+    value.reset();
+    return;
+  }
+  ReadValue(reader, value.emplace());
+}
+
+template <typename T>
+void ReadValue(TJsonReader& reader, std::vector<T>& value) {
+  value.clear();
+  reader.BeginArray();
+  while (reader.NextItem()) {
+    try {
+      ReadValue(reader, value.emplace_back());
+    } catch (TJsonReadError& e) {
+      e.AddPathPrefix('[' + std::to_string(value.size() - 1) + ']');
+      throw;
+    }
+  }
+}
+
+namespace impl {
+
+template <typename T, size_t... Indices>
+bool ReadDtoField(TJsonReader& reader, std::string_view key, T& value,
+                  std::bitset<sizeof...(Indices)>& seen,
+                  std::index_sequence<Indices...>) {
+  constexpr auto kFields = T::Fields();
+  const auto read = [&](const auto& field, size_t index) {
+    if (seen[index]) {
+      throw TJsonReadError("duplicate field");
+    }
+    seen.set(index);
+    ReadValue(reader, value.*field.member);
+  };
+  const auto try_field = [&](const auto& field, size_t index) {
+    if (field.name != key) {
+      return false;
+    }
+    try {
+      read(field, index);
+    } catch (TJsonReadError& e) {
+      e.AddPathPrefix(field.name);
+      throw;
+    }
+    return true;
+  };
+  return (try_field(std::get<Indices>(kFields), Indices) || ...);
+}
+
+template <typename T, size_t... Indices>
+void CheckRequiredFields(const std::bitset<sizeof...(Indices)>& seen,
+                         std::index_sequence<Indices...>) {
+  constexpr auto kFields = T::Fields();
+  const auto check = [&](const auto& field, size_t index) {
+    if (field.required && !seen[index]) {
+      TJsonReadError error("required field is missing");
+      error.AddPathPrefix(field.name);
+      throw error;
+    }
+  };
+  (check(std::get<Indices>(kFields), Indices), ...);
+}
+
+}  // namespace impl
+
+template <typename T>
+std::enable_if_t<TIsDto<T>::value> ReadValue(TJsonReader& reader, T& value) {
+  constexpr auto kFieldCount = std::tuple_size_v<decltype(T::Fields())>;
+  constexpr auto kIndices = std::make_index_sequence<kFieldCount>{};
+  std::bitset<kFieldCount> seen;
+  reader.BeginObject();
+  std::string_view key;
+  while (reader.NextKey(key)) {
+    if (!impl::ReadDtoField(reader, key, value, seen, kIndices)) {
+      reader.Skip();
+    }
+  }
+  impl::CheckRequiredFields<T>(seen, kIndices);
+}
+
+// Reads a whole JSON document into the DTO T, throws TJsonReadError
+template <typename T>
+T ReadDto(std::string_view json) {
+  static_assert(TIsDto<T>::value);
+  TJsonReader reader(json);
+  T value{};
+  ReadValue(reader, value);
+  reader.End();
+  return value;
+}
+
+}  // namespace split_bill
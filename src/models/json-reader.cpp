@@ -0,0 +1,373 @@
+#include "json-reader.hpp"
+
+#include <charconv>
+
+namespace split_bill {
+
+namespace {
+
+bool IsWhitespace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+int HexDigit(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+void AppendUtf8(std::string& out, uint32_t code_point) {
+  if (code_point < 0x80) {
+    out += static_cast<char>(code_point);
+  } else if (code_point < 0x800) {
+    out += static_cast<char>(0xC0 | (code_point >> 6));
+    out += static_cast<char>(0x80 | (code_point & 0x3F));
+  } else if (code_point < 0x10000) {
+    out += static_cast<char>(0xE0 | (code_point >> 12));
+    out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (code_point & 0x3F));
+  } else {
+    out += static_cast<char>(0xF0 | (code_point >> 18));
+    out += static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+    out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (code_point & 0x3F));
+  }
+}
+
+}  // namespace
+
+TJsonReadError::TJsonReadError(std::string message)
+    : std::runtime_error(message),
+      message_(std::move(message)),
+      full_(message_) {}
+
+void TJsonReadError::AddPathPrefix(std::string_view item) {
+  if (path_.empty() || path_.front() == '[') {
+    path_.insert(0, item);
+  } else {
+    path_.insert(0, std::string{item} + '.');
+  }
+  full_ = path_ + ": " + message_;
+}
+
+TJsonReader::TJsonReader(std::string_view json) : json_(json) {}
+
+bool TJsonReader::TryNull() {
+  if (Peek() != 'n') {
+    return false;
+  }
+  ReadLiteral("null");
+  return true;
+}
+
+bool TJsonReader::ReadBool() {
+  const auto c = Peek();
+  if (c == 't') {
+    ReadLiteral("true");
+    return true;
+  }
+  if (c == 'f') {
+    ReadLiteral("false");
+    return false;
+  }
+  Fail("a boolean");
+}
+
+int64_t TJsonReader::ReadInt64() {
+  Peek();
+  const auto begin = pos_;
+  if (pos_ < json_.size() && json_[pos_] == '-') {
+    ++pos_;
+  }
+  const auto digits = pos_;
+  while (pos_ < json_.size() && IsDigit(json_[pos_])) {
+    ++pos_;
+  }
+  const bool leading_zero = pos_ - digits > 1 && json_[digits] == '0';
+  if (pos_ == digits || leading_zero ||
+      (pos_ < json_.size() &&
+       (json_[pos_] == '.' || json_[pos_] == 'e' || json_[pos_] == 'E'))) {
+    pos_ = begin;
+    Fail("an integer");
+  }
+
+  int64_t value = 0;
+  const auto [end, error] =
+      std::from_chars(json_.data() + begin, json_.data() + pos_, value);
+  if (error != std::errc{}) {
+    pos_ = begin;
+    Fail("an integer in the int64 range");
+  }
+  return value;
+}
+
+std::string TJsonReader::ReadString() {
+  std::string value;
+  const auto view = ReadStringView(value);
+  if (view.data() != value.data()) {
+    value.assign(view);
+  }
+  return value;
+}
+
+void TJsonReader::BeginObject() {
+  Expect('{', "an object");
+  Enter();
+}
+
+bool TJsonReader::NextKey(std::string_view& key) {
+  if (Peek() == '}') {
+    ++pos_;
+    --depth_;
+    first_ = false;
+    return false;
+  }
+  if (!first_) {
+    Expect(',', "',' or '}'");
+    Peek();
+  }
+  first_ = false;
+  if (pos_ >= json_.size() || json_[pos_] != '"') {
+    Fail("a field name");
+  }
+  key = ReadStringView(key_);
+  Expect(':', "':'");
+  return true;
+}
+
+void TJsonReader::BeginArray() {
+  Expect('[', "an array");
+  Enter();
+}
+
+bool TJsonReader::NextItem() {
+  if (Peek() == ']') {
+    ++pos_;
+    --depth_;
+    first_ = false;
+    return false;
+  }
+  if (!first_) {
+    Expect(',', "',' or ']'");
+  }
+  first_ = false;
+  return true;
+}
+
+void TJsonReader::Skip() {
+  switch (Peek()) {
+    case '{': {
+      BeginObject();
+      std::string_view key;
+      while (NextKey(key)) {
+        Skip();
+      }
+      break;
+    }
+    case '[':
+      BeginArray();
+      while (NextItem()) {
+        Skip();
+      }
+      break;
+    case '"':
+      ReadStringView(key_);
+      break;
+    case 't':
+    case 'f':
+      ReadBool();
+      break;
+    case 'n':
+      ReadLiteral("null");
+      break;
+    default:
+      SkipNumber();
+  }
+}
+
+void TJsonReader::End() {
+  while (pos_ < json_.size() && IsWhitespace(json_[pos_])) {
+    ++pos_;
+  }
+  if (pos_ != json_.size()) {
+    Fail("the end of the document");
+  }
+}
+
+void TJsonReader::Fail(std::string_view expected) const {
+  std::string message = "expected ";
+  message += expected;
+  if (pos_ < json_.size()) {
+    message += " at offset " + std::to_string(pos_);
+  } else {
+    message += ", found the end of the document";
+  }
+  throw TJsonReadError(std::move(message));
+}
+
+char TJsonReader::Peek() {
+  while (pos_ < json_.size() && IsWhitespace(json_[pos_])) {
+    ++pos_;
+  }
+  return pos_ < json_.size() ? json_[pos_] : '\0';
+}
+
+void TJsonReader::Expect(char c, std::string_view expected) {
+  if (Peek() != c) {
+    Fail(expected);
+  }
+  ++pos_;
+}
+
+void TJsonReader::ReadLiteral(std::string_view literal) {
+  if (json_.substr(pos_, literal.size()) != literal) {
+    Fail(literal);
+  }
+  pos_ += literal.size();
+}
+
+std::string_view TJsonReader::ReadStringView(std::string& out) {
+  Expect('"', "a string");
+  const auto begin = pos_;
+  // Fast path: no escapes, the view points into the document
+  while (pos_ < json_.size() && json_[pos_] != '"' && json_[pos_] != '\\' &&
+         static_cast<unsigned char>(json_[pos_]) >= 0x20) {
+    ++pos_;
+  }
+  if (pos_ < json_.size() && json_[pos_] == '"') {
+    return json_.substr(begin, pos_++ - begin);
+  }
+
+  out.assign(json_.substr(begin, pos_ - begin));
+  while (pos_ < json_.size() && json_[pos_] != '"') {
+    const auto c = json_[pos_];
+    if (static_cast<unsigned char>(c) < 0x20) {
+      Fail("an escaped control character");
+    }
+    if (c == '\\') {
+      ++pos_;
+      ReadEscape(out);
+    } else {
+      out += c;
+      ++pos_;
+    }
+  }
+  if (pos_ >= json_.size()) {
+    Fail("'\"'");
+  }
+  ++pos_;
+  return out;
+}
+
+void TJsonReader::ReadEscape(std::string& out) {
+  if (pos_ >= json_.size()) {
+    Fail("an escape sequence");
+  }
+  const auto c = json_[pos_++];
+  switch (c) {
+    case '"':
+    case '\\':
+    case '/':
+      out += c;
+      return;
+    case 'b':
+      out += '\b';
+      return;
+    case 'f':
+      out += '\f';
+      return;
+    case 'n':
+      out += '\n';
+      return;
+    case 'r':
+      out += '\r';
+      return;
+    case 't':
+      out += '\t';
+      return;
+    case 'u':
+      break;
+    default:
+      --pos_;
+      Fail("an escape sequence");
+  }
+
+  const auto read_code_unit = [this] {
+    uint32_t code_unit = 0;
+    for (int i = 0; i < 4; ++i) {
+      const auto digit = pos_ < json_.size() ? HexDigit(json_[pos_]) : -1;
+      if (digit < 0) {
+        Fail("a hex digit");
+      }
+      code_unit = code_unit * 16 + digit;
+      ++pos_;
+    }
+    return code_unit;
+  };
+  auto code_point = read_code_unit();
+  if (code_point >= 0xD800 && code_point < 0xDC00) {
+    // High surrogate, the low one has to follow
+    if (json_.substr(pos_, 2) != "\\u") {
+      Fail("a low surrogate");
+    }
+    pos_ += 2;
+    const auto low = read_code_unit();
+    if (low < 0xDC00 || low >= 0xE000) {
+      Fail("a low surrogate");
+    }
+    code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+  } else if (code_point >= 0xDC00 && code_point < 0xE000) {
+    Fail("a high surrogate");
+  }
+  AppendUtf8(out, code_point);
+}
+
+void TJsonReader::SkipNumber() {
+  const auto begin = pos_;
+  const auto skip_digits = [this] {
+    const auto start = pos_;
+    while (pos_ < json_.size() && IsDigit(json_[pos_])) {
+      ++pos_;
+    }
+    return pos_ > start;
+  };
+  if (pos_ < json_.size() && json_[pos_] == '-') {
+    ++pos_;
+  }
+  const auto digits = pos_;
+  bool valid = skip_digits() && (pos_ - digits == 1 || json_[digits] != '0');
+  if (valid && pos_ < json_.size() && json_[pos_] == '.') {
+    ++pos_;
+    valid = skip_digits();
+  }
+  if (valid && pos_ < json_.size() &&
+      (json_[pos_] == 'e' || json_[pos_] == 'E')) {
+    ++pos_;
+    if (pos_ < json_.size() && (json_[pos_] == '+' || json_[pos_] == '-')) {
+      ++pos_;
+    }
+    valid = skip_digits();
+  }
+  if (!valid) {
+    pos_ = begin;
+    Fail("a value");
+  }
+}
+
+void TJsonReader::Enter() {
+  if (++depth_ > kMaxDepth) {
+    Fail("at most 64 levels of nesting");
+  }
+  first_ = true;
+}
+
+}  // namespace split_bill
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace split_bill {
+
+// Malformed JSON or a value of the wrong type. `Path()` is where in the
+// document it is, e.g. `product.add[3].price`, filled in by the DTO readers
+// as the error goes up.
+class TJsonReadError : public std::runtime_error {
+ public:
+  explicit TJsonReadError(std::string message);
+
+  // Prepends a field name or an `[index]` to the path
+  void AddPathPrefix(std::string_view item);
+
+  const std::string& Path() const { return path_; }
+  const std::string& Message() const { return message_; }
+  const char* what() const noexcept override { return full_.c_str(); }
+
+ private:
+  std::string path_;
+  std::string message_;
+  std::string full_;
+};
+
+// Pull reader walking a JSON document front to back in one pass, without
+// building a DOM. The caller asks for the value it expects next; anything
+// else throws TJsonReadError with the offset.
+//
+//   reader.BeginObject();
+//   std::string_view key;
+//   while (reader.NextKey(key)) {
+//     if (key == "id") id = reader.ReadInt64(); else reader.Skip();
+//   }
+//   reader.End();
+class TJsonReader {
+ public:
+  static constexpr size_t kMaxDepth = 64;
+
+  explicit TJsonReader(std::string_view json);
+
+  // Consumes a null if it is the next value
+  bool TryNull();
+  bool ReadBool();
+  // Integer without fraction or exponent
+  int64_t ReadInt64();
+  std::string ReadString();
+
+  void BeginObject();
+  // Reads the next key of the current object, false at its end. `key` is
+  // valid until the next call.
+  bool NextKey(std::string_view& key);
+
+  void BeginArray();
+  // False at the end of the current array
+  bool NextItem();
+
+  // Skips the next value of any type
+  void Skip();
+  // Checks that nothing but whitespace follows
+  void End();
+
+  [[noreturn]] void Fail(std::string_view expected) const;
+
+ private:
+  char Peek();
+  void Expect(char c, std::string_view expected);
+  void ReadLiteral(std::string_view literal);
+  // Reads a string into `out`, returns a view of the body when it has no
+  // escapes and of `out` otherwise
+  std::string_view ReadStringView(std::string& out);
+  void ReadEscape(std::string& out);
+  void SkipNumber();
+  void Enter();
+
+  std::string_view json_;
+  size_t pos_ = 0;
+  size_t depth_ = 0;
+  // No member or item of the innermost container read yet
+  bool first_ = false;
+  std::string key_;
+};
+
+}  // namespace split_bill
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace split_bill {
+
+// Entries of an in-memory cache and the heap bytes they hold, approximately
+struct TCacheMemory {
+  size_t entries = 0;
+  size_t bytes = 0;
+};
+
+// Heap bytes of a string, none for one short enough to be stored inline
+inline size_t HeapBytes(const std::string& value) {
+  return value.capacity() > std::string{}.capacity() ? value.capacity() + 1
+                                                     : 0;
+}
+
+inline size_t HeapBytes(const std::optional<std::string>& value) {
+  return value ? HeapBytes(*value) : 0;
+}
+
+// The buffer of a vector only, not what its elements point to
+template <typename T>
+size_t HeapBytes(const std::vector<T>& values) {
+  return values.capacity() * sizeof(T);
+}
+
+}  // namespace split_bill
@@ -0,0 +1,131 @@
+#include "msgpack.hpp"
+
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace split_bill {
+
+template <typename T>
+void TMsgPackWriter::BigEndian(T value) {
+  for (int shift = (sizeof(T) - 1) * 8; shift >= 0; shift -= 8) {
+    buffer_ += static_cast<char>((value >> shift) & 0xff);
+  }
+}
+
+void TMsgPackWriter::Nil() { buffer_ += '\xc0'; }
+
+void TMsgPackWriter::Bool(bool value) { buffer_ += value ? '\xc3' : '\xc2'; }
+
+void TMsgPackWriter::Int(int64_t value) {
+  if (value >= 0) {
+    if (value < 0x80) {  // positive fixint
+      buffer_ += static_cast<char>(value);
+    } else if (value <= std::numeric_limits<uint8_t>::max()) {
+      buffer_ += '\xcc';
+      BigEndian(static_cast<uint8_t>(value));
+    } else if (value <= std::numeric_limits<uint16_t>::max()) {
+      buffer_ += '\xcd';
+      BigEndian(static_cast<uint16_t>(value));
+    } else if (value <= std::numeric_limits<uint32_t>::max()) {
+      buffer_ += '\xce';
+      BigEndian(static_cast<uint32_t>(value));
+    } else {
+      buffer_ += '\xcf';
+      BigEndian(static_cast<uint64_t>(value));
+    }
+  } else if (value >= -32) {  // negative fixint
+    buffer_ += static_cast<char>(value);
+  } else if (value >= std::numeric_limits<int8_t>::min()) {
+    buffer_ += '\xd0';
+    BigEndian(static_cast<uint8_t>(value));
+  } else if (value >= std::numeric_limits<int16_t>::min()) {
+    buffer_ += '\xd1';
+    BigEndian(static_cast<uint16_t>(value));
+  } else if (value >= std::numeric_limits<int32_t>::min()) {
+    buffer_ += '\xd2';
+    BigEndian(static_cast<uint32_t>(value));
+  } else {
+    buffer_ += '\xd3';
+    BigEndian(static_cast<uint64_t>(value));
+  }
+}
+
+void TMsgPackWriter::Double(double value) {
+  uint64_t bits = 0;
+  std::memcpy(&bits, &value, sizeof(bits));
+  buffer_ += '\xcb';
+  BigEndian(bits);
+}
+
+void TMsgPackWriter::String(std::string_view value) {
+  const auto size = value.size();
+  if (size < 32) {  // fixstr
+    buffer_ += static_cast<char>(0xa0 | size);
+  } else if (size <= std::numeric_limits<uint8_t>::max()) {
+    buffer_ += '\xd9';
+    BigEndian(static_cast<uint8_t>(size));
+  } else if (size <= std::numeric_limits<uint16_t>::max()) {
+    buffer_ += '\xda';
+    BigEndian(static_cast<uint16_t>(size));
+  } else {
+    buffer_ += '\xdb';
+    BigEndian(static_cast<uint32_t>(size));
+  }
+  buffer_ += value;
+}
+
+void TMsgPackWriter::ArrayHeader(uint32_t size) {
+  if (size < 16) {  // fixarray
+    buffer_ += static_cast<char>(0x90 | size);
+  } else if (size <= std::numeric_limits<uint16_t>::max()) {
+    buffer_ += '\xdc';
+    BigEndian(static_cast<uint16_t>(size));
+  } else {
+    buffer_ += '\xdd';
+    BigEndian(size);
+  }
+}
+
+void TMsgPackWriter::MapHeader(uint32_t size) {
+  if (size < 16) {  // fixmap
+    buffer_ += static_cast<char>(0x80 | size);
+  } else if (size <= std::numeric_limits<uint16_t>::max()) {
+    buffer_ += '\xde';
+    BigEndian(static_cast<uint16_t>(size));
+  } else {
+    buffer_ += '\xdf';
+    BigEndian(size);
+  }
+}
+
+void WriteToMsgPack(const userver::formats::json::Value& value,
+                    TMsgPackWriter& writer) {
+  if (value.IsNull()) {
+    writer.Nil();
+  } else if (value.IsBool()) {
+    writer.Bool(value.As<bool>());
+  } else if (value.IsInt64()) {
+    writer.Int(value.As<int64_t>());
+  } else if (value.IsDouble()) {
+    writer.Double(value.As<double>());
+  } else if (value.IsString()) {
+    writer.String(value.As<std::string>());
+  } else if (value.IsArray()) {
+    writer.ArrayHeader(static_cast<uint32_t>(value.GetSize()));
+    for (const auto& item : value) {
+      WriteToMsgPack(item, writer);
+    }
+  } else if (value.IsObject()) {
+    writer.MapHeader(static_cast<uint32_t>(value.GetSize()));
+    for (auto it = value.begin(); it != value.end(); ++it) {
+      writer.String(it.GetName());
+      WriteToMsgPack(*it, writer);
+    }
+  } else {
+    throw std::invalid_argument("Unsupported JSON value at " +
+                                value.GetPath());
+  }
+}
+
+}  // namespace split_bill
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <userver/formats/json/value.hpp>
+
+namespace split_bill {
+
+// Content type of MessagePack response bodies
+inline constexpr std::string_view kMsgPackContentType = "application/msgpack";
+
+// Appends MessagePack (https://msgpack.org/) values to a buffer, each in its
+// shortest encoding. Maps and arrays are written as a header with the
+// number of entries followed by the entries, so the models write the same
+// keys in the same order as their JSON WriteToStream.
+class TMsgPackWriter final {
+ public:
+  void Nil();
+  void Bool(bool value);
+  void Int(int64_t value);
+  void Double(double value);
+  void String(std::string_view value);
+  void ArrayHeader(uint32_t size);
+  void MapHeader(uint32_t size);
+
+  const std::string& GetString() const { return buffer_; }
+  std::string ExtractString() { return std::move(buffer_); }
+
+ private:
+  template <typename T>
+  void BigEndian(T value);
+
+  std::string buffer_;
+};
+
+// Same document as the JSON `value`, for the responses built as a
+// json::Value (ToCalculation, ToSummary) and the stored JSON of archived
+// rooms
+void WriteToMsgPack(const userver::formats::json::Value& value,
+                    TMsgPackWriter& writer);
+
+}  // namespace split_bill
@@ -0,0 +1,97 @@
+#include "msgpack.hpp"
+
+#include <memory_resource>
+
+#include <benchmark/benchmark.h>
+#include <userver/formats/json/serialize.hpp>
+#include <userver/formats/json/string_builder.hpp>
+
+#include "detailed-room.hpp"
+#include "room-snapshot.hpp"
+
+namespace split_bill {
+
+namespace {
+
+constexpr int kUsersPerProduct = 4;
+
+TRoomSnapshot MakeSnapshot(int products) {
+  std::vector<TRoomSnapshot::TProductRow> product_rows;
+  std::vector<TRoomSnapshot::TUserProductRow> user_product_rows;
+  std::vector<TRoomSnapshot::TUserDetails> users;
+  std::vector<int> member_ids;
+  for (int user_id = 1; user_id <= kUsersPerProduct * 2; ++user_id) {
+    member_ids.push_back(user_id);
+    users.push_back({user_id, "User " + std::to_string(user_id),
+                     "https://example.com/" + std::to_string(user_id)});
+  }
+  for (int product = 1; product <= products; ++product) {
+    product_rows.push_back({product, "Product", 100 + product});
+    for (int i = 0; i < kUsersPerProduct; ++i) {
+      user_product_rows.push_back(
+          {product * kUsersPerProduct + i, product,
+           (product + i) % (kUsersPerProduct * 2) + 1, (product + i) % 3 == 0});
+    }
+  }
+  return TRoomSnapshot(1, "Room", 1, 1, std::move(member_ids),
+                       std::move(product_rows), std::move(user_product_rows),
+                       std::move(users));
+}
+
+// GET /v1/rooms/{id} bodies; the "bytes" counter is the size of one body
+void RoomDetailsJson(benchmark::State& state) {
+  const auto details = MakeSnapshot(state.range(0))
+                           .ToRoomDetails(std::pmr::new_delete_resource());
+  size_t size = 0;
+  for ([[maybe_unused]] auto _ : state) {
+    userver::formats::json::StringBuilder sw;
+    WriteToStream(details, sw);
+    size = sw.GetString().size();
+    benchmark::DoNotOptimize(size);
+  }
+  state.counters["bytes"] = static_cast<double>(size);
+}
+BENCHMARK(RoomDetailsJson)->RangeMultiplier(8)->Range(8, 4096);
+
+void RoomDetailsMsgPack(benchmark::State& state) {
+  const auto details = MakeSnapshot(state.range(0))
+                           .ToRoomDetails(std::pmr::new_delete_resource());
+  size_t size = 0;
+  for ([[maybe_unused]] auto _ : state) {
+    TMsgPackWriter writer;
+    WriteToMsgPack(details, writer);
+    size = writer.GetString().size();
+    benchmark::DoNotOptimize(size);
+  }
+  state.counters["bytes"] = static_cast<double>(size);
+}
+BENCHMARK(RoomDetailsMsgPack)->RangeMultiplier(8)->Range(8, 4096);
+
+// GET /v1/rooms/{id}/calculate bodies, built as a json::Value
+void CalculationJson(benchmark::State& state) {
+  const auto calculation = MakeSnapshot(state.range(0)).ToCalculation();
+  size_t size = 0;
+  for ([[maybe_unused]] auto _ : state) {
+    size = userver::formats::json::ToString(calculation).size();
+    benchmark::DoNotOptimize(size);
+  }
+  state.counters["bytes"] = static_cast<double>(size);
+}
+BENCHMARK(CalculationJson)->RangeMultiplier(8)->Range(8, 4096);
+
+void CalculationMsgPack(benchmark::State& state) {
+  const auto calculation = MakeSnapshot(state.range(0)).ToCalculation();
+  size_t size = 0;
+  for ([[maybe_unused]] auto _ : state) {
+    TMsgPackWriter writer;
+    WriteToMsgPack(calculation, writer);
+    size = writer.GetString().size();
+    benchmark::DoNotOptimize(size);
+  }
+  state.counters["bytes"] = static_cast<double>(size);
+}
+BENCHMARK(CalculationMsgPack)->RangeMultiplier(8)->Range(8, 4096);
+
+}  // namespace
+
+}  // namespace split_bill
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "dto.hpp"
+
+namespace split_bill {
+
+// POST /register
+struct TRegisterRequest {
+  static constexpr size_t kMaxBodySize = 4096;
+
+  std::optional<std::string> username;
+  std::optional<std::string> password;
+  std::optional<std::string> full_name;
+  std::optional<std::string> photo_url;
+
+  static constexpr auto Fields() {
+    return std::make_tuple(
+        Optional("username", &TRegisterRequest::username),
+        Optional("password", &TRegisterRequest::password),
+        Optional("full_name", &TRegisterRequest::full_name),
+        Optional("photo_url", &TRegisterRequest::photo_url));
+  }
+};
+
+// POST /login
+struct TLoginRequest {
+  static constexpr size_t kMaxBodySize = 4096;
+
+  std::optional<std::string> username;
+  std::optional<std::string> password;
+
+  static constexpr auto Fields() {
+    return std::make_tuple(Optional("username", &TLoginRequest::username),
+                           Optional("password", &TLoginRequest::password));
+  }
+};
+
+// POST /v1/user-products
+struct TAddUserToProductRequest {
+  static constexpr size_t kMaxBodySize = 4096;
+
+  std::optional<std::string> status;
+  std::optional<int> product_id;
+  std::optional<int> user_id;
+
+  static constexpr auto Fields() {
+    return std::make_tuple(
+        Optional("status", &TAddUserToProductRequest::status),
+        Optional("product_id", &TAddUserToProductRequest::product_id),
+        Optional("user_id", &TAddUserToProductRequest::user_id));
+  }
+};
+
+// PUT /v1/rooms/{id}
+struct TRoomChanges {
+  std::optional<std::string> name;
+
+  static constexpr auto Fields() {
+    return std::make_tuple(Optional("name", &TRoomChanges::name));
+  }
+};
+
+struct TProductToAdd {
+  std::string name;
+  int price = 0;
+  std::vector<int> add_users;
+
+  static constexpr auto Fields() {
+    return std::make_tuple(
+        Required("name", &TProductToAdd::name),
+        Required("price", &TProductToAdd::price),
+        Optional("add_users", &TProductToAdd::add_users));
+  }
+};
+
+struct TProductEdit {
+  int id = 0;
+  std::optional<std::string> name;
+  std::optional<int> price;
+  std::optional<std::string> status;
+  std::vector<int> delete_users;
+
+  static constexpr auto Fields() {
+    return std::make_tuple(
+        Required("id", &TProductEdit::id),
+        Optional("name", &TProductEdit::name),
+        Optional("price", &TProductEdit::price),
+        Optional("status", &TProductEdit::status),
+        Optional("delete_users", &TProductEdit::delete_users));
+  }
+};
+
+struct TProductToRemove {
+  int id = 0;
+
+  static constexpr auto Fields() {
+    return std::make_tuple(Required("id", &TProductToRemove::id));
+  }
+};
+
+struct TProductChanges {
+  std::optional<std::vector<TProductToAdd>> add;
+  std::optional<std::vector<TProductEdit>> edit;
+  std::optional<std::vector<TProductToRemove>> remove;
+
+  static constexpr auto Fields() {
+    return std::make_tuple(Optional("add", &TProductChanges::add),
+                           Optional("edit", &TProductChanges::edit),
+                           Optional("remove", &TProductChanges::remove));
+  }
+};
+
+struct TUpdateRoomRequest {
+  // Room of a few thousand products with their users
+  static constexpr size_t kMaxBodySize = 1 << 20;
+
+  std::optional<TRoomChanges> room;
+  std::optional<TProductChanges> product;
+
+  static constexpr auto Fields() {
+    return std::make_tuple(Optional("room", &TUpdateRoomRequest::room),
+                           Optional("product", &TUpdateRoomRequest::product));
+  }
+};
+
+}  // namespace split_bill
@@ -0,0 +1,80 @@
+#include "requests.hpp"
+
+#include <benchmark/benchmark.h>
+#include <userver/formats/json/serialize.hpp>
+#include <userver/formats/json/value.hpp>
+#include <userver/formats/json/value_builder.hpp>
+
+namespace split_bill {
+
+namespace {
+
+constexpr int kUsersPerProduct = 4;
+
+// PUT /v1/rooms/{id} body adding and editing `products` products each
+std::string MakeUpdateRoomBody(int products) {
+  userver::formats::json::ValueBuilder body;
+  body["room"]["name"] = "Room";
+  auto add = body["product"]["add"];
+  auto edit = body["product"]["edit"];
+  for (int product = 1; product <= products; ++product) {
+    userver::formats::json::ValueBuilder users;
+    for (int user_id = 1; user_id <= kUsersPerProduct; ++user_id) {
+      users.PushBack(user_id);
+    }
+    userver::formats::json::ValueBuilder added;
+    added["name"] = "Product " + std::to_string(product);
+    added["price"] = 100 + product;
+    added["add_users"] = users;
+    add.PushBack(std::move(added));
+
+    userver::formats::json::ValueBuilder edited;
+    edited["id"] = product;
+    edited["price"] = 200 + product;
+    edited["status"] = "PAID";
+    edited["delete_users"] = users;
+    edit.PushBack(std::move(edited));
+  }
+  return userver::formats::json::ToString(body.ExtractValue());
+}
+
+// The body read the way the handler did before request DTOs
+void UpdateRoomDom(benchmark::State& state) {
+  const auto body = MakeUpdateRoomBody(state.range(0));
+  for ([[maybe_unused]] auto _ : state) {
+    const auto json = userver::formats::json::FromString(body);
+    size_t users = 0;
+    const auto& product_data = json["product"];
+    for (const auto& product : product_data["add"]) {
+      benchmark::DoNotOptimize(product["name"].As<std::string>());
+      benchmark::DoNotOptimize(product["price"].As<int>());
+      users += product["add_users"].As<std::vector<int>>().size();
+    }
+    for (const auto& product : product_data["edit"]) {
+      benchmark::DoNotOptimize(product["id"].As<int>());
+      benchmark::DoNotOptimize(
+          product["name"].As<std::optional<std::string>>());
+      benchmark::DoNotOptimize(product["price"].As<std::optional<int>>());
+      benchmark::DoNotOptimize(
+          product["status"].As<std::optional<std::string>>());
+      users += product["delete_users"].As<std::vector<int>>().size();
+    }
+    benchmark::DoNotOptimize(users);
+  }
+  state.counters["bytes"] = static_cast<double>(body.size());
+}
+BENCHMARK(UpdateRoomDom)->RangeMultiplier(8)->Range(8, 4096);
+
+void UpdateRoomDto(benchmark::State& state) {
+  const auto body = MakeUpdateRoomBody(state.range(0));
+  for ([[maybe_unused]] auto _ : state) {
+    auto request = ReadDto<TUpdateRoomRequest>(body);
+    benchmark::DoNotOptimize(request);
+  }
+  state.counters["bytes"] = static_cast<double>(body.size());
+}
+BENCHMARK(UpdateRoomDto)->RangeMultiplier(8)->Range(8, 4096);
+
+}  // namespace
+
+}  // namespace split_bill
@@ -0,0 +1,369 @@
+#include "room-snapshot.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <tuple>
+
+#include <userver/formats/json/value_builder.hpp>
+
+#include "memory-usage.hpp"
+
+namespace split_bill {
+
+namespace {
+
+EUserProductStatus ToStatus(uint8_t paid) {
+  return paid ? EUserProductStatus::kPaid : EUserProductStatus::kUnpaid;
+}
+
+std::optional<std::pmr::string> CopyTo(
+    const std::optional<std::string>& value,
+    std::pmr::memory_resource* resource) {
+  if (!value) {
+    return std::nullopt;
+  }
+  return std::pmr::string{*value, resource};
+}
+
+template <typename T>
+uint32_t IndexOf(const std::vector<T>& sorted, T value) {
+  return static_cast<uint32_t>(
+      std::lower_bound(sorted.begin(), sorted.end(), value) - sorted.begin());
+}
+
+template <typename T>
+bool Contains(const std::vector<T>& sorted, T value) {
+  return std::binary_search(sorted.begin(), sorted.end(), value);
+}
+
+}  // namespace
+
+TRoomSnapshot::TRoomSnapshot(int room_id, std::string name, int owner_id,
+                             int64_t version, std::vector<int> member_ids,
+                             std::vector<TProductRow> products,
+                             std::vector<TUserProductRow> user_products,
+                             std::vector<TUserDetails> users)
+    : room_id_(room_id),
+      name_(std::move(name)),
+      owner_id_(owner_id),
+      version_(version),
+      member_ids_(std::move(member_ids)) {
+  std::sort(member_ids_.begin(), member_ids_.end());
+
+  std::sort(products.begin(), products.end(),
+            [](const auto& lhs, const auto& rhs) { return lhs.id < rhs.id; });
+  product_ids_.reserve(products.size());
+  product_prices_.reserve(products.size());
+  product_names_.reserve(products.size());
+  for (auto& product : products) {
+    product_ids_.push_back(product.id);
+    product_prices_.push_back(product.price);
+    product_names_.push_back(std::move(product.name));
+  }
+
+  user_products.erase(
+      std::remove_if(user_products.begin(), user_products.end(),
+                     [this](const auto& user_product) {
+                       return !Contains(product_ids_, user_product.product_id);
+                     }),
+      user_products.end());
+  std::sort(user_products.begin(), user_products.end(),
+            [](const auto& lhs, const auto& rhs) {
+              return std::tie(lhs.product_id, lhs.id) <
+                     std::tie(rhs.product_id, rhs.id);
+            });
+
+  for (const auto& user_product : user_products) {
+    user_ids_.push_back(user_product.user_id);
+  }
+  std::sort(user_ids_.begin(), user_ids_.end());
+  user_ids_.erase(std::unique(user_ids_.begin(), user_ids_.end()),
+                  user_ids_.end());
+
+  std::sort(users.begin(), users.end(),
+            [](const auto& lhs, const auto& rhs) { return lhs.id < rhs.id; });
+  users_.reserve(user_ids_.size());
+  for (const auto user_id : user_ids_) {
+    auto it = std::lower_bound(
+        users.begin(), users.end(), user_id,
+        [](const auto& user, int id) { return user.id < id; });
+    if (it != users.end() && it->id == user_id) {
+      users_.push_back(std::move(*it));
+    } else {
+      users_.push_back({user_id, std::nullopt, std::nullopt});
+    }
+  }
+
+  share_offsets_.assign(product_ids_.size() + 1, 0);
+  share_ids_.reserve(user_products.size());
+  share_products_.reserve(user_products.size());
+  share_users_.reserve(user_products.size());
+  share_paid_.reserve(user_products.size());
+  for (const auto& user_product : user_products) {
+    const auto product_index = IndexOf(product_ids_, user_product.product_id);
+    ++share_offsets_[product_index + 1];
+
+    share_ids_.push_back(user_product.id);
+    share_products_.push_back(product_index);
+    share_users_.push_back(IndexOf(user_ids_, user_product.user_id));
+    share_paid_.push_back(user_product.paid ? 1 : 0);
+  }
+  std::partial_sum(share_offsets_.begin(), share_offsets_.end(),
+                   share_offsets_.begin());
+
+  // User products are ordered by product, so both indices come out sorted
+  user_product_offsets_.assign(user_ids_.size() + 1, 0);
+  for (const auto user : share_users_) {
+    ++user_product_offsets_[user + 1];
+  }
+  std::partial_sum(user_product_offsets_.begin(), user_product_offsets_.end(),
+                   user_product_offsets_.begin());
+  user_product_index_.resize(share_users_.size());
+  auto next = user_product_offsets_;
+  for (size_t i = 0; i < share_ids_.size(); ++i) {
+    const auto product = share_products_[i];
+    user_product_index_[next[share_users_[i]]++] = product;
+    if (!share_paid_[i] && (unpaid_product_index_.empty() ||
+                            unpaid_product_index_.back() != product)) {
+      unpaid_product_index_.push_back(product);
+    }
+  }
+}
+
+size_t TRoomSnapshot::MemoryUsage() const {
+  size_t bytes = sizeof(*this) + HeapBytes(name_) + HeapBytes(member_ids_) +
+                 HeapBytes(product_ids_) + HeapBytes(product_prices_) +
+                 HeapBytes(product_names_) + HeapBytes(share_offsets_) +
+                 HeapBytes(share_ids_) + HeapBytes(share_products_) +
+                 HeapBytes(share_users_) + HeapBytes(share_paid_) +
+                 HeapBytes(user_ids_) + HeapBytes(users_) +
+                 HeapBytes(user_product_offsets_) +
+                 HeapBytes(user_product_index_) +
+                 HeapBytes(unpaid_product_index_);
+  for (const auto& name : product_names_) {
+    bytes += HeapBytes(name);
+  }
+  for (const auto& user : users_) {
+    bytes += HeapBytes(user.full_name) + HeapBytes(user.photo_url);
+  }
+  return bytes;
+}
+
+bool TRoomSnapshot::IsMember(int user_id) const {
+  return Contains(member_ids_, user_id);
+}
+
+int64_t TRoomSnapshot::TotalPrice() const {
+  const int64_t* prices = product_prices_.data();
+  const size_t size = product_prices_.size();
+
+  int64_t total = 0;
+  for (size_t i = 0; i < size; ++i) {
+    total += prices[i];
+  }
+  return total;
+}
+
+int TRoomSnapshot::UnpaidCount() const {
+  const uint8_t* paid = share_paid_.data();
+  const size_t size = share_paid_.size();
+
+  uint32_t paid_count = 0;
+  for (size_t i = 0; i < size; ++i) {
+    paid_count += paid[i];
+  }
+  return static_cast<int>(size - paid_count);
+}
+
+ERoomStatus TRoomSnapshot::Status() const {
+  return UnpaidCount() > 0 ? ERoomStatus::kActive : ERoomStatus::kArchived;
+}
+
+std::vector<int64_t> TRoomSnapshot::SharePrices() const {
+  std::vector<int64_t> share_prices(share_ids_.size());
+  int64_t* out = share_prices.data();
+  const uint32_t* offsets = share_offsets_.data();
+
+  for (size_t product = 0; product < product_ids_.size(); ++product) {
+    const uint32_t begin = offsets[product];
+    const uint32_t end = offsets[product + 1];
+    if (begin == end) {
+      continue;
+    }
+    const int64_t share = product_prices_[product] / (end - begin);
+    for (uint32_t i = begin; i < end; ++i) {
+      out[i] = share;
+    }
+  }
+  return share_prices;
+}
+
+std::vector<TUserShare> TRoomSnapshot::UserShares() const {
+  const auto share_prices = SharePrices();
+  std::vector<int64_t> amounts(user_ids_.size(), 0);
+  std::vector<int> unpaid(user_ids_.size(), 0);
+
+  const size_t size = share_ids_.size();
+  for (size_t i = 0; i < size; ++i) {
+    amounts[share_users_[i]] += share_prices[i];
+    unpaid[share_users_[i]] += 1 - share_paid_[i];
+  }
+
+  std::vector<TUserShare> shares;
+  shares.reserve(user_ids_.size());
+  for (size_t user = 0; user < user_ids_.size(); ++user) {
+    shares.push_back({user_ids_[user], amounts[user], unpaid[user]});
+  }
+  return shares;
+}
+
+TRoomDetails TRoomSnapshot::ToRoomDetails(
+    std::pmr::memory_resource* resource) const {
+  TRoomDetails details{room_id_,
+                       std::pmr::string{name_, resource},
+                       owner_id_,
+                       std::pmr::vector<TRoomProduct>{resource},
+                       Status(),
+                       TotalPrice(),
+                       TotalMembers()};
+  details.room_products.reserve(product_ids_.size());
+  for (uint32_t product = 0; product < product_ids_.size(); ++product) {
+    details.room_products.push_back(ToRoomProduct(product, resource));
+  }
+  return details;
+}
+
+userver::formats::json::Value TRoomSnapshot::ToHeader() const {
+  userver::formats::json::ValueBuilder response;
+  response["id"] = room_id_;
+  response["name"] = name_;
+  response["owner_id"] = owner_id_;
+  response["room_status"] = ToString(Status());
+  response["total_price"] = TotalPrice();
+  response["total_members"] = TotalMembers();
+  response["unpaid_count"] = UnpaidCount();
+  response["product_count"] = ProductCount();
+  response["member_ids"] = member_ids_;
+  return response.ExtractValue();
+}
+
+TRoomProductsPage TRoomSnapshot::ToProductsPage(
+    EProductFilter filter, int user_id, int after_id, size_t limit,
+    std::pmr::memory_resource* resource) const {
+  // The index of kAll is the identity
+  const bool indexed = filter != EProductFilter::kAll;
+  const uint32_t* index = nullptr;
+  size_t size = product_ids_.size();
+  if (filter == EProductFilter::kMine) {
+    size = 0;
+    if (Contains(user_ids_, user_id)) {
+      const auto user = IndexOf(user_ids_, user_id);
+      index = user_product_index_.data() + user_product_offsets_[user];
+      size = user_product_offsets_[user + 1] - user_product_offsets_[user];
+    }
+  } else if (filter == EProductFilter::kUnpaid) {
+    index = unpaid_product_index_.data();
+    size = unpaid_product_index_.size();
+  }
+
+  size_t begin = 0;
+  if (indexed) {
+    begin = std::upper_bound(index, index + size, after_id,
+                             [this](int id, uint32_t product) {
+                               return id < product_ids_[product];
+                             }) -
+            index;
+  } else {
+    begin = std::upper_bound(product_ids_.begin(), product_ids_.end(),
+                             after_id) -
+            product_ids_.begin();
+  }
+  const auto end = std::min(size, begin + limit);
+
+  TRoomProductsPage page{std::pmr::vector<TRoomProduct>{resource},
+                         std::nullopt};
+  page.room_products.reserve(end - begin);
+  for (auto i = begin; i < end; ++i) {
+    page.room_products.push_back(ToRoomProduct(
+        indexed ? index[i] : static_cast<uint32_t>(i), resource));
+  }
+  if (end < size && !page.room_products.empty()) {
+    page.next_cursor = page.room_products.back().id;
+  }
+  return page;
+}
+
+TRoomProduct TRoomSnapshot::ToRoomProduct(
+    uint32_t product, std::pmr::memory_resource* resource) const {
+  TRoomProduct room_product{
+      product_ids_[product],
+      std::pmr::string{product_names_[product], resource},
+      product_prices_[product], room_id_,
+      std::pmr::vector<TUserProductWithDetails>{resource}};
+  room_product.user_products.reserve(share_offsets_[product + 1] -
+                                     share_offsets_[product]);
+  for (auto i = share_offsets_[product]; i < share_offsets_[product + 1];
+       ++i) {
+    const auto& user = users_[share_users_[i]];
+    room_product.user_products.push_back(
+        {share_ids_[i], ToStatus(share_paid_[i]), product_ids_[product],
+         user.id, CopyTo(user.full_name, resource),
+         CopyTo(user.photo_url, resource)});
+  }
+  return room_product;
+}
+
+userver::formats::json::Value TRoomSnapshot::ToCalculation() const {
+  const auto shares = UserShares();
+
+  std::vector<userver::formats::json::ValueBuilder> user_products(
+      user_ids_.size(),
+      userver::formats::json::ValueBuilder{
+          userver::formats::json::Type::kArray});
+  for (size_t i = 0; i < share_ids_.size(); ++i) {
+    const auto product = share_products_[i];
+    userver::formats::json::ValueBuilder product_entry;
+    product_entry["id"] = product_ids_[product];
+    product_entry["name"] = product_names_[product];
+    product_entry["price"] = product_prices_[product];
+    product_entry["status"] = ToString(ToStatus(share_paid_[i]));
+    user_products[share_users_[i]].PushBack(std::move(product_entry));
+  }
+
+  userver::formats::json::ValueBuilder response;
+  response["data"].Resize(0);
+  for (size_t user = 0; user < user_ids_.size(); ++user) {
+    userver::formats::json::ValueBuilder user_entry;
+    user_entry["id"] = user_ids_[user];
+    user_entry["full_name"] = users_[user].full_name.value_or("");
+    user_entry["photo_url"] = users_[user].photo_url.value_or("");
+    user_entry["amount"] = shares[user].amount;
+    user_entry["products"] = std::move(user_products[user]);
+    response["data"].PushBack(std::move(user_entry));
+  }
+  return response.ExtractValue();
+}
+
+userver::formats::json::Value TRoomSnapshot::ToSummary() const {
+  userver::formats::json::ValueBuilder response;
+  response["id"] = room_id_;
+  response["name"] = name_;
+  response["owner_id"] = owner_id_;
+  response["version"] = version_;
+  response["room_status"] = ToString(Status());
+  response["total_price"] = TotalPrice();
+  response["total_members"] = TotalMembers();
+  response["unpaid_count"] = UnpaidCount();
+
+  response["shares"].Resize(0);
+  for (const auto& share : UserShares()) {
+    userver::formats::json::ValueBuilder share_entry;
+    share_entry["user_id"] = share.user_id;
+    share_entry["amount"] = share.amount;
+    share_entry["unpaid_count"] = share.unpaid_count;
+    response["shares"].PushBack(std::move(share_entry));
+  }
+  return response.ExtractValue();
+}
+
+}  // namespace split_bill
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "detailed-room.hpp"
+
+namespace split_bill {
+
+// Products of a products section of GET /v1/rooms/{id}: every one, those
+// shared by the caller, or those with an unpaid user product
+enum class EProductFilter : uint8_t { kAll, kMine, kUnpaid };
+
+struct TUserShare {
+  int user_id;
+  int64_t amount;
+  int unpaid_count;
+};
+
+// Immutable columnar copy of one room version. Products and user products
+// are kept as struct-of-arrays, user products grouped by product, so the
+// aggregates below are plain loops over contiguous integers.
+class TRoomSnapshot {
+ public:
+  struct TProductRow {
+    int id;
+    std::string name;
+    int64_t price;
+  };
+
+  struct TUserProductRow {
+    int id;
+    int product_id;
+    int user_id;
+    bool paid;
+  };
+
+  struct TUserDetails {
+    int id;
+    std::optional<std::string> full_name;
+    std::optional<std::string> photo_url;
+  };
+
+  // `user_products` may come in any order; products missing from `products`
+  // are dropped.
+  TRoomSnapshot(int room_id, std::string name, int owner_id, int64_t version,
+                std::vector<int> member_ids, std::vector<TProductRow> products,
+                std::vector<TUserProductRow> user_products,
+                std::vector<TUserDetails> users);
+
+  int RoomId() const { return room_id_; }
+  const std::string& Name() const { return name_; }
+  int OwnerId() const { return owner_id_; }
+  int64_t Version() const { return version_; }
+
+  size_t ProductCount() const { return product_ids_.size(); }
+  size_t UserProductCount() const { return share_ids_.size(); }
+  int TotalMembers() const { return static_cast<int>(member_ids_.size()); }
+  bool IsMember(int user_id) const;
+  // Approximate heap bytes, this object included
+  size_t MemoryUsage() const;
+
+  int64_t TotalPrice() const;
+  int UnpaidCount() const;
+  ERoomStatus Status() const;
+  // Every product is split evenly between its users; ordered by user id
+  std::vector<TUserShare> UserShares() const;
+
+  // Every string and vector of the result is allocated from `resource`
+  TRoomDetails ToRoomDetails(std::pmr::memory_resource* resource) const;
+  // Header section of GET /v1/rooms/{id}: totals, status and members
+  userver::formats::json::Value ToHeader() const;
+  // Products section: up to `limit` products passing `filter` with ids
+  // above `after_id`, in id order. kMine keeps those `user_id` shares. The
+  // page is a contiguous range of the product index of the filter.
+  TRoomProductsPage ToProductsPage(EProductFilter filter, int user_id,
+                                   int after_id, size_t limit,
+                                   std::pmr::memory_resource* resource) const;
+  // Body of GET /v1/rooms/{id}/calculate
+  userver::formats::json::Value ToCalculation() const;
+  // Body of GET /v1/rooms/{id}/summary
+  userver::formats::json::Value ToSummary() const;
+
+ private:
+  // Per-user-product amount of its product's price
+  std::vector<int64_t> SharePrices() const;
+  TRoomProduct ToRoomProduct(uint32_t product,
+                             std::pmr::memory_resource* resource) const;
+
+  int room_id_;
+  std::string name_;
+  int owner_id_;
+  int64_t version_;
+  std::vector<int> member_ids_;  // sorted
+
+  // Products
+  std::vector<int> product_ids_;
+  std::vector<int64_t> product_prices_;
+  std::vector<std::string> product_names_;
+  // User products of product `i` are [share_offsets_[i], share_offsets_[i+1])
+  std::vector<uint32_t> share_offsets_;
+
+  // User products
+  std::vector<int> share_ids_;
+  std::vector<uint32_t> share_products_;  // index into product arrays
+  std::vector<uint32_t> share_users_;     // index into user arrays
+  std::vector<uint8_t> share_paid_;       // 1 = PAID, 0 = UNPAID
+
+  // Users referenced by user products, sorted by id
+  std::vector<int> user_ids_;
+  std::vector<TUserDetails> users_;
+
+  // Product indices of the filtered sections, ascending like the ids. Those
+  // shared by user `i` are [user_product_offsets_[i],
+  // user_product_offsets_[i+1]) of user_product_index_.
+  std::vector<uint32_t> user_product_offsets_;
+  std::vector<uint32_t> user_product_index_;
+  std::vector<uint32_t> unpaid_product_index_;
+};
+
+}  // namespace split_bill
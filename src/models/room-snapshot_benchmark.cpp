@@ -0,0 +1,107 @@
+#include "room-snapshot.hpp"
+
+#include <memory_resource>
+#include <unordered_map>
+
+#include <benchmark/benchmark.h>
+
+namespace split_bill {
+
+namespace {
+
+constexpr int kUsersPerProduct = 4;
+
+TRoomSnapshot MakeSnapshot(int products) {
+  std::vector<TRoomSnapshot::TProductRow> product_rows;
+  std::vector<TRoomSnapshot::TUserProductRow> user_product_rows;
+  std::vector<TRoomSnapshot::TUserDetails> users;
+  std::vector<int> member_ids;
+  for (int user_id = 1; user_id <= kUsersPerProduct * 2; ++user_id) {
+    member_ids.push_back(user_id);
+    users.push_back({user_id, "User " + std::to_string(user_id), std::nullopt});
+  }
+  for (int product = 1; product <= products; ++product) {
+    product_rows.push_back({product, "Product", 100 + product});
+    for (int i = 0; i < kUsersPerProduct; ++i) {
+      user_product_rows.push_back(
+          {product * kUsersPerProduct + i, product,
+           (product + i) % (kUsersPerProduct * 2) + 1, (product + i) % 3 == 0});
+    }
+  }
+  return TRoomSnapshot(1, "Room", 1, 1, std::move(member_ids),
+                       std::move(product_rows), std::move(user_product_rows),
+                       std::move(users));
+}
+
+// The per-row aggregation GET /v1/rooms/{id} and /calculate used to do
+void RoomAggregatesRows(benchmark::State& state) {
+  const auto details =
+      MakeSnapshot(state.range(0))
+          .ToRoomDetails(std::pmr::get_default_resource());
+  for ([[maybe_unused]] auto _ : state) {
+    long total_price = 0;
+    auto room_status = ERoomStatus::kArchived;
+    std::unordered_map<int, long> amounts;
+    for (const auto& product : details.room_products) {
+      total_price += product.price;
+      for (const auto& user_product : product.user_products) {
+        if (user_product.status == EUserProductStatus::kUnpaid) {
+          room_status = ERoomStatus::kActive;
+        }
+        amounts[user_product.user_id] +=
+            product.price / static_cast<long>(product.user_products.size());
+      }
+    }
+    benchmark::DoNotOptimize(total_price);
+    benchmark::DoNotOptimize(room_status);
+    benchmark::DoNotOptimize(amounts);
+  }
+}
+BENCHMARK(RoomAggregatesRows)->RangeMultiplier(8)->Range(8, 4096);
+
+void RoomAggregatesSnapshot(benchmark::State& state) {
+  const auto snapshot = MakeSnapshot(state.range(0));
+  for ([[maybe_unused]] auto _ : state) {
+    benchmark::DoNotOptimize(snapshot.TotalPrice());
+    benchmark::DoNotOptimize(snapshot.Status());
+    benchmark::DoNotOptimize(snapshot.UserShares());
+  }
+}
+BENCHMARK(RoomAggregatesSnapshot)->RangeMultiplier(8)->Range(8, 4096);
+
+// TRoomDetails assembly for GET /v1/rooms/{id}: one heap allocation per
+// string and vector against a request arena released in one step.
+void RoomDetailsHeap(benchmark::State& state) {
+  const auto snapshot = MakeSnapshot(state.range(0));
+  for ([[maybe_unused]] auto _ : state) {
+    benchmark::DoNotOptimize(
+        snapshot.ToRoomDetails(std::pmr::new_delete_resource()));
+  }
+}
+BENCHMARK(RoomDetailsHeap)->RangeMultiplier(8)->Range(8, 4096);
+
+void RoomDetailsArena(benchmark::State& state) {
+  const auto snapshot = MakeSnapshot(state.range(0));
+  for ([[maybe_unused]] auto _ : state) {
+    std::pmr::monotonic_buffer_resource arena{16 * 1024};
+    benchmark::DoNotOptimize(snapshot.ToRoomDetails(&arena));
+  }
+}
+BENCHMARK(RoomDetailsArena)->RangeMultiplier(8)->Range(8, 4096);
+
+// The last page of the products section of a room, against the whole room
+// above: a page costs the same whatever the size of the room
+void RoomProductsPage(benchmark::State& state) {
+  const auto snapshot = MakeSnapshot(state.range(0));
+  const auto last_page = static_cast<int>(snapshot.ProductCount()) - 100;
+  for ([[maybe_unused]] auto _ : state) {
+    std::pmr::monotonic_buffer_resource arena{16 * 1024};
+    benchmark::DoNotOptimize(snapshot.ToProductsPage(
+        EProductFilter::kAll, 1, last_page, 100, &arena));
+  }
+}
+BENCHMARK(RoomProductsPage)->RangeMultiplier(8)->Range(8, 4096);
+
+}  // namespace
+
+}  // namespace split_bill
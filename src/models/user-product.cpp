@@ -3,6 +3,36 @@
 
 namespace split_bill {
 
+namespace {
+
+// Unlike value_or, doesn't copy the string
+std::string_view ValueOrEmpty(const std::optional<std::pmr::string>& value) {
+  return value ? std::string_view{*value} : std::string_view{};
+}
+
+}  // namespace
+
+std::string_view ToString(EUserProductStatus status) {
+  switch (status) {
+    case EUserProductStatus::kPaid:
+      return "PAID";
+    case EUserProductStatus::kUnpaid:
+      return "UNPAID";
+  }
+  throw std::invalid_argument("Unknown user product status");
+}
+
+std::optional<EUserProductStatus> ParseUserProductStatus(
+    std::string_view status) {
+  if (status == "PAID") {
+    return EUserProductStatus::kPaid;
+  }
+  if (status == "UNPAID") {
+    return EUserProductStatus::kUnpaid;
+  }
+  return std::nullopt;
+}
+
 userver::formats::json::Value Serialize(
     const TUserProduct& user_product,
     userver::formats::serialize::To<userver::formats::json::Value>) {
@@ -14,17 +44,38 @@ userver::formats::json::Value Serialize(
   return item.ExtractValue();
 }
 
-userver::formats::json::Value Serialize(
-    const TUserProductWithDetails& user_product,
-    userver::formats::serialize::To<userver::formats::json::Value>) {
-  userver::formats::json::ValueBuilder item;
-  item["id"] = user_product.id;
-  item["status"] = user_product.status;
-  item["product_id"] = user_product.product_id;
-  item["user_id"] = user_product.user_id;
-  item["full_name"] = user_product.full_name.value_or("");
-  item["photo_url"] = user_product.photo_url.value_or("");
-  return item.ExtractValue();
+void WriteToStream(const TUserProductWithDetails& user_product,
+                   userver::formats::json::StringBuilder& sw) {
+  userver::formats::json::StringBuilder::ObjectGuard guard{sw};
+  sw.Key("id");
+  WriteToStream(user_product.id, sw);
+  sw.Key("status");
+  WriteToStream(ToString(user_product.status), sw);
+  sw.Key("product_id");
+  WriteToStream(user_product.product_id, sw);
+  sw.Key("user_id");
+  WriteToStream(user_product.user_id, sw);
+  sw.Key("full_name");
+  WriteToStream(ValueOrEmpty(user_product.full_name), sw);
+  sw.Key("photo_url");
+  WriteToStream(ValueOrEmpty(user_product.photo_url), sw);
+}
+
+void WriteToMsgPack(const TUserProductWithDetails& user_product,
+                    TMsgPackWriter& writer) {
+  writer.MapHeader(6);
+  writer.String("id");
+  writer.Int(user_product.id);
+  writer.String("status");
+  writer.String(ToString(user_product.status));
+  writer.String("product_id");
+  writer.Int(user_product.product_id);
+  writer.String("user_id");
+  writer.Int(user_product.user_id);
+  writer.String("full_name");
+  writer.String(ValueOrEmpty(user_product.full_name));
+  writer.String("photo_url");
+  writer.String(ValueOrEmpty(user_product.photo_url));
 }
 
 
@@ -1,9 +1,25 @@
 #pragma once
 
+#include <cstdint>
+#include <memory_resource>
+#include <optional>
 #include <string>
+#include <string_view>
+
+#include <userver/formats/json/string_builder.hpp>
 #include <userver/formats/json/value_builder.hpp>
+
+#include "msgpack.hpp"
+
 namespace split_bill {
 
+enum class EUserProductStatus : uint8_t { kUnpaid, kPaid };
+
+// "PAID" / "UNPAID", as stored in user_products.status
+std::string_view ToString(EUserProductStatus status);
+std::optional<EUserProductStatus> ParseUserProductStatus(
+    std::string_view status);
+
 struct TUserProduct {
   int id;
   std::string status;
@@ -11,21 +27,24 @@ struct TUserProduct {
   int user_id;
 };
 
+// Strings are allocated from the memory resource of the owning TRoomDetails
 struct TUserProductWithDetails {
   int id;
-  std::string status;
+  EUserProductStatus status;
   int product_id;
   int user_id;
-  std::optional<std::string> full_name;
-  std::optional<std::string> photo_url;
+  std::optional<std::pmr::string> full_name;
+  std::optional<std::pmr::string> photo_url;
 };
 
 userver::formats::json::Value Serialize(
     const TUserProduct& data,
     userver::formats::serialize::To<userver::formats::json::Value>);
 
-userver::formats::json::Value Serialize(
-    const TUserProductWithDetails& data,
-    userver::formats::serialize::To<userver::formats::json::Value>);
+void WriteToStream(const TUserProductWithDetails& data,
+                   userver::formats::json::StringBuilder& sw);
+
+void WriteToMsgPack(const TUserProductWithDetails& data,
+                    TMsgPackWriter& writer);
 
 }  // namespace split_bill
\ No newline at end of file
@@ -0,0 +1,400 @@
+#include "user-search-index.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <utility>
+
+#include "../handlers/lib/strings.hpp"
+#include "memory-usage.hpp"
+
+namespace split_bill {
+
+namespace {
+
+constexpr size_t kTrigramSize = 3;
+constexpr uint32_t kTrigramCount = 1u << (8 * kTrigramSize);
+// Segments with less text sort (trigram, user) pairs to build the postings
+constexpr size_t kCountingSortMinText = kTrigramCount / 16;
+
+char ToLowerAscii(char c) {
+  return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+std::string ToLowerAscii(std::string_view value) {
+  std::string result(value.size(), '\0');
+  std::transform(value.begin(), value.end(), result.begin(),
+                 [](char c) { return ToLowerAscii(c); });
+  return result;
+}
+
+constexpr std::string_view kSeparators = " \n\t-_.";
+
+bool IsSeparator(char c) {
+  return kSeparators.find(c) != std::string_view::npos;
+}
+
+// Big-endian first 8 bytes, so keys compare like the words do
+uint64_t SortKey(std::string_view word) {
+  uint64_t key = 0;
+  for (size_t i = 0; i < sizeof(key); ++i) {
+    key = key << 8 |
+          (i < word.size() ? static_cast<unsigned char>(word[i]) : 0u);
+  }
+  return key;
+}
+
+uint32_t TrigramAt(std::string_view text, size_t pos) {
+  return static_cast<uint32_t>(static_cast<unsigned char>(text[pos])) << 16 |
+         static_cast<uint32_t>(static_cast<unsigned char>(text[pos + 1]))
+             << 8 |
+         static_cast<uint32_t>(static_cast<unsigned char>(text[pos + 2]));
+}
+
+}  // namespace
+
+class TUserSearchIndex::TSegment {
+ public:
+  explicit TSegment(std::vector<TUserInfo> users) : users_(std::move(users)) {
+    std::sort(users_.begin(), users_.end(),
+              [](const TUserInfo& lhs, const TUserInfo& rhs) {
+                return lhs.id < rhs.id;
+              });
+
+    text_offsets_.reserve(users_.size() + 1);
+    for (const auto& user : users_) {
+      text_offsets_.push_back(static_cast<uint32_t>(text_.size()));
+      // Every word, the last one included, ends with a separator
+      text_ += ToLowerAscii(user.username);
+      text_ += '\n';
+      if (user.full_name) {
+        text_ += ToLowerAscii(*user.full_name);
+        text_ += '\n';
+      }
+    }
+    text_offsets_.push_back(static_cast<uint32_t>(text_.size()));
+
+    for (uint32_t user = 0; user < users_.size(); ++user) {
+      const auto text = Text(user);
+      size_t word_start = 0;
+      for (size_t pos = 0; pos < text.size(); ++pos) {
+        if (!IsSeparator(text[pos])) {
+          continue;
+        }
+        if (pos > word_start) {
+          words_.push_back({SortKey(text.substr(word_start, pos - word_start)),
+                            text_offsets_[user] +
+                                static_cast<uint32_t>(word_start),
+                            static_cast<uint32_t>(pos - word_start), user});
+        }
+        word_start = pos + 1;
+      }
+    }
+
+    std::sort(words_.begin(), words_.end(),
+              [this](const TWord& lhs, const TWord& rhs) {
+                if (lhs.sort_key != rhs.sort_key) {
+                  return lhs.sort_key < rhs.sort_key;
+                }
+                return std::pair{Word(lhs), lhs.user} <
+                       std::pair{Word(rhs), rhs.user};
+              });
+
+    if (text_.size() < kCountingSortMinText) {
+      BuildPostingsBySort();
+    } else {
+      BuildPostingsByCount();
+    }
+  }
+
+  size_t Size() const { return users_.size(); }
+
+  size_t MemoryUsage() const {
+    size_t bytes = sizeof(*this) + HeapBytes(users_) + HeapBytes(text_) +
+                   HeapBytes(text_offsets_) + HeapBytes(words_) +
+                   HeapBytes(trigram_keys_) + HeapBytes(trigram_offsets_) +
+                   HeapBytes(posting_users_);
+    for (const auto& user : users_) {
+      bytes += HeapBytes(user.username) + HeapBytes(user.full_name) +
+               HeapBytes(user.photo_url);
+    }
+    return bytes;
+  }
+
+  const TUserInfo& User(uint32_t user) const { return users_[user]; }
+  const std::vector<TUserInfo>& Users() const { return users_; }
+
+  std::optional<uint32_t> IndexOf(int user_id) const {
+    const auto it = std::lower_bound(
+        users_.begin(), users_.end(), user_id,
+        [](const TUserInfo& user, int id) { return user.id < id; });
+    if (it == users_.end() || it->id != user_id) {
+      return std::nullopt;
+    }
+    return static_cast<uint32_t>(it - users_.begin());
+  }
+
+  bool Matches(uint32_t user, std::string_view query) const {
+    return Text(user).find(query) != std::string_view::npos;
+  }
+
+  // Appends up to `limit` (word, user) pairs of distinct users having a word
+  // that starts with `prefix`, in word order
+  void CollectPrefixMatches(
+      std::string_view prefix, size_t limit,
+      std::vector<std::pair<std::string_view, const TUserInfo*>>& out) const {
+    auto it = std::lower_bound(
+        words_.begin(), words_.end(), prefix,
+        [this](const TWord& word, std::string_view value) {
+          return Word(word) < value;
+        });
+    std::vector<uint32_t> users;
+    for (; it != words_.end() && users.size() < limit; ++it) {
+      const auto word = Word(*it);
+      if (word.substr(0, prefix.size()) != prefix) {
+        break;
+      }
+      if (std::find(users.begin(), users.end(), it->user) == users.end()) {
+        users.push_back(it->user);
+        out.emplace_back(word, &users_[it->user]);
+      }
+    }
+  }
+
+  // Calls `on_match(user)` in id order for users containing `query` of at
+  // least kTrigramSize characters, until it returns false
+  template <typename OnMatch>
+  void ForEachSubstringMatch(std::string_view query, OnMatch on_match) const {
+    // The shortest posting list of the query trigrams
+    size_t candidates = trigram_keys_.size();
+    for (size_t pos = 0; pos + kTrigramSize <= query.size(); ++pos) {
+      const auto trigram = TrigramAt(query, pos);
+      const auto it = std::lower_bound(trigram_keys_.begin(),
+                                       trigram_keys_.end(), trigram);
+      if (it == trigram_keys_.end() || *it != trigram) {
+        return;
+      }
+      const auto key = static_cast<size_t>(it - trigram_keys_.begin());
+      if (candidates == trigram_keys_.size() ||
+          PostingCount(key) < PostingCount(candidates)) {
+        candidates = key;
+      }
+    }
+    for (auto i = trigram_offsets_[candidates];
+         i < trigram_offsets_[candidates + 1]; ++i) {
+      const auto user = posting_users_[i];
+      if (Matches(user, query) && !on_match(user)) {
+        return;
+      }
+    }
+  }
+
+ private:
+  std::string_view Text(uint32_t user) const {
+    return std::string_view{text_}.substr(
+        text_offsets_[user], text_offsets_[user + 1] - text_offsets_[user]);
+  }
+
+  struct TWord {
+    uint64_t sort_key;  // first bytes of the word, compared before the rest
+    uint32_t offset;    // in text_
+    uint32_t size;
+    uint32_t user;
+  };
+
+  std::string_view Word(const TWord& word) const {
+    return std::string_view{text_}.substr(word.offset, word.size);
+  }
+
+  const std::vector<uint32_t>& UniqueTrigrams(
+      uint32_t user, std::vector<uint32_t>& trigrams) const {
+    const auto text = Text(user);
+    trigrams.clear();
+    for (size_t pos = 0; pos + kTrigramSize <= text.size(); ++pos) {
+      trigrams.push_back(TrigramAt(text, pos));
+    }
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()),
+                   trigrams.end());
+    return trigrams;
+  }
+
+  // A segment of a few new users, where zeroing the counting sort table
+  // would cost more than sorting the pairs
+  void BuildPostingsBySort() {
+    std::vector<uint64_t> pairs;  // trigram << 32 | user
+    std::vector<uint32_t> user_trigrams;
+    for (uint32_t user = 0; user < users_.size(); ++user) {
+      for (const auto trigram : UniqueTrigrams(user, user_trigrams)) {
+        pairs.push_back(static_cast<uint64_t>(trigram) << 32 | user);
+      }
+    }
+    std::sort(pairs.begin(), pairs.end());
+
+    posting_users_.reserve(pairs.size());
+    for (const auto pair : pairs) {
+      const auto trigram = static_cast<uint32_t>(pair >> 32);
+      if (trigram_keys_.empty() || trigram_keys_.back() != trigram) {
+        trigram_keys_.push_back(trigram);
+        trigram_offsets_.push_back(
+            static_cast<uint32_t>(posting_users_.size()));
+      }
+      posting_users_.push_back(static_cast<uint32_t>(pair));
+    }
+    trigram_offsets_.push_back(static_cast<uint32_t>(posting_users_.size()));
+  }
+
+  // Counting sort over every possible trigram: two passes over the users
+  // instead of sorting tens of millions of (trigram, user) pairs, and the
+  // posting lists come out ascending
+  void BuildPostingsByCount() {
+    std::vector<uint32_t> positions(kTrigramCount);
+    std::vector<uint32_t> user_trigrams;
+    for (uint32_t user = 0; user < users_.size(); ++user) {
+      for (const auto trigram : UniqueTrigrams(user, user_trigrams)) {
+        ++positions[trigram];
+      }
+    }
+    uint32_t total = 0;
+    for (uint32_t trigram = 0; trigram < kTrigramCount; ++trigram) {
+      if (positions[trigram] == 0) {
+        continue;
+      }
+      trigram_keys_.push_back(trigram);
+      trigram_offsets_.push_back(total);
+      total += std::exchange(positions[trigram], total);
+    }
+    trigram_offsets_.push_back(total);
+
+    posting_users_.resize(total);
+    for (uint32_t user = 0; user < users_.size(); ++user) {
+      for (const auto trigram : UniqueTrigrams(user, user_trigrams)) {
+        posting_users_[positions[trigram]++] = user;
+      }
+    }
+  }
+
+  uint32_t PostingCount(size_t key) const {
+    return trigram_offsets_[key + 1] - trigram_offsets_[key];
+  }
+
+  std::vector<TUserInfo> users_;  // sorted by id
+  // Lowercased username and full name of user `i`, each followed by '\n',
+  // are text_[text_offsets_[i], text_offsets_[i + 1])
+  std::string text_;
+  std::vector<uint32_t> text_offsets_;
+  // Words of every user, sorted
+  std::vector<TWord> words_;
+  // Users containing trigram_keys_[i] are posting_users_[trigram_offsets_[i],
+  // trigram_offsets_[i + 1]), ascending
+  std::vector<uint32_t> trigram_keys_;
+  std::vector<uint32_t> trigram_offsets_;
+  std::vector<uint32_t> posting_users_;
+};
+
+TUserSearchIndex::TUserSearchIndex(std::vector<TUserInfo> users) {
+  segments_.push_back(std::make_shared<const TSegment>(std::move(users)));
+}
+
+TUserSearchIndex::TUserSearchIndex(const TUserSearchIndex& previous,
+                                   std::vector<TUserInfo> new_users)
+    : segments_(previous.segments_) {
+  // Trailing segments not larger than the new one are merged into it, which
+  // keeps the number of segments logarithmic in the number of users
+  while (!segments_.empty() && segments_.back()->Size() <= new_users.size()) {
+    const auto& users = segments_.back()->Users();
+    new_users.insert(new_users.end(), users.begin(), users.end());
+    segments_.pop_back();
+  }
+  segments_.push_back(std::make_shared<const TSegment>(std::move(new_users)));
+}
+
+size_t TUserSearchIndex::Size() const {
+  size_t size = 0;
+  for (const auto& segment : segments_) {
+    size += segment->Size();
+  }
+  return size;
+}
+
+size_t TUserSearchIndex::MemoryUsage() const {
+  size_t bytes = HeapBytes(segments_);
+  for (const auto& segment : segments_) {
+    bytes += segment->MemoryUsage();
+  }
+  return bytes;
+}
+
+int TUserSearchIndex::MaxId() const {
+  for (auto it = segments_.rbegin(); it != segments_.rend(); ++it) {
+    if ((*it)->Size() > 0) {
+      return (*it)->Users().back().id;
+    }
+  }
+  return 0;
+}
+
+const TUserInfo* TUserSearchIndex::Find(int user_id) const {
+  for (const auto& segment : segments_) {
+    if (const auto user = segment->IndexOf(user_id)) {
+      return &segment->User(*user);
+    }
+  }
+  return nullptr;
+}
+
+std::vector<const TUserInfo*> TUserSearchIndex::Search(
+    std::string_view query, const std::vector<int>& preferred_ids,
+    size_t limit) const {
+  std::vector<const TUserInfo*> result;
+  const auto lowered = ToLowerAscii(Trim(query, kSeparators));
+  if (lowered.empty() || limit == 0) {
+    return result;
+  }
+  // Returns false once the result is full
+  const auto add = [&result, limit](const TUserInfo* user) {
+    if (std::find(result.begin(), result.end(), user) == result.end()) {
+      result.push_back(user);
+    }
+    return result.size() < limit;
+  };
+
+  for (const auto user_id : preferred_ids) {
+    for (const auto& segment : segments_) {
+      const auto user = segment->IndexOf(user_id);
+      if (user && segment->Matches(*user, lowered) &&
+          !add(&segment->User(*user))) {
+        return result;
+      }
+    }
+  }
+
+  std::vector<std::pair<std::string_view, const TUserInfo*>> prefix_matches;
+  for (const auto& segment : segments_) {
+    segment->CollectPrefixMatches(lowered, limit, prefix_matches);
+  }
+  std::stable_sort(
+      prefix_matches.begin(), prefix_matches.end(),
+      [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+  for (const auto& [word, user] : prefix_matches) {
+    if (!add(user)) {
+      return result;
+    }
+  }
+
+  if (lowered.size() < kTrigramSize) {
+    return result;
+  }
+  for (const auto& segment : segments_) {
+    bool full = false;
+    segment->ForEachSubstringMatch(lowered, [&](uint32_t user) {
+      full = !add(&segment->User(user));
+      return !full;
+    });
+    if (full) {
+      break;
+    }
+  }
+  return result;
+}
+
+}  // namespace split_bill
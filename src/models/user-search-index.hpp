@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "user.hpp"
+
+namespace split_bill {
+
+// Immutable index over usernames and full names for GET /v1/users/search.
+// Matching is case-insensitive for ASCII letters. Queries shorter than three
+// characters match word prefixes, longer ones any substring through a
+// trigram index.
+//
+// Users are kept in segments: an incremental update adds the users created
+// since the previous one as a new segment and shares the rest.
+class TUserSearchIndex {
+ public:
+  explicit TUserSearchIndex(std::vector<TUserInfo> users);
+  // `previous` with `new_users` added, ids of which are above its MaxId()
+  TUserSearchIndex(const TUserSearchIndex& previous,
+                   std::vector<TUserInfo> new_users);
+
+  size_t Size() const;
+  // Approximate heap bytes of the index, segments shared with another
+  // index included
+  size_t MemoryUsage() const;
+  size_t SegmentCount() const { return segments_.size(); }
+  int MaxId() const;
+  const TUserInfo* Find(int user_id) const;
+
+  // Up to `limit` users matching `query`: those of `preferred_ids` first,
+  // then users with a username or name word starting with the query (closest
+  // completions first), then users containing it elsewhere (by id).
+  std::vector<const TUserInfo*> Search(std::string_view query,
+                                       const std::vector<int>& preferred_ids,
+                                       size_t limit) const;
+
+ private:
+  class TSegment;
+
+  std::vector<std::shared_ptr<const TSegment>> segments_;
+};
+
+}  // namespace split_bill
@@ -0,0 +1,66 @@
+#include "user-search-index.hpp"
+
+#include <algorithm>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+namespace split_bill {
+
+namespace {
+
+constexpr size_t kLimit = 20;
+
+std::vector<TUserInfo> MakeUsers(int first_id, int count) {
+  std::vector<TUserInfo> users;
+  users.reserve(count);
+  for (int id = first_id; id < first_id + count; ++id) {
+    users.push_back({id, "user_" + std::to_string(id * 7919 % 1000003),
+                     "Name" + std::to_string(id % 977) + " Surname" +
+                         std::to_string(id % 8191),
+                     std::nullopt});
+  }
+  return users;
+}
+
+// Index over range(0) users grown by incremental updates of 1% each
+TUserSearchIndex MakeIndex(int users) {
+  const auto batch = std::max(users / 100, 1);
+  TUserSearchIndex index(MakeUsers(1, batch));
+  for (int first_id = batch + 1; first_id <= users; first_id += batch) {
+    index = TUserSearchIndex(index, MakeUsers(first_id, batch));
+  }
+  return index;
+}
+
+void UserSearchPrefix(benchmark::State& state) {
+  const auto index = MakeIndex(state.range(0));
+  const std::vector<int> co_members{1, 2, 3};
+  for ([[maybe_unused]] auto _ : state) {
+    benchmark::DoNotOptimize(index.Search("name12", co_members, kLimit));
+  }
+}
+BENCHMARK(UserSearchPrefix)->RangeMultiplier(10)->Range(1000, 100000);
+
+void UserSearchSubstring(benchmark::State& state) {
+  const auto index = MakeIndex(state.range(0));
+  const std::vector<int> co_members{1, 2, 3};
+  for ([[maybe_unused]] auto _ : state) {
+    benchmark::DoNotOptimize(index.Search("rname81", co_members, kLimit));
+  }
+}
+BENCHMARK(UserSearchSubstring)->RangeMultiplier(10)->Range(1000, 100000);
+
+// A query matching nobody, where every segment is probed
+void UserSearchMiss(benchmark::State& state) {
+  const auto index = MakeIndex(state.range(0));
+  const std::vector<int> co_members{1, 2, 3};
+  for ([[maybe_unused]] auto _ : state) {
+    benchmark::DoNotOptimize(index.Search("zzzz", co_members, kLimit));
+  }
+}
+BENCHMARK(UserSearchMiss)->RangeMultiplier(10)->Range(1000, 100000);
+
+}  // namespace
+
+}  // namespace split_bill
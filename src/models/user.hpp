@@ -1,3 +1,6 @@
+#pragma once
+
+#include <optional>
 #include <string>
 
 namespace split_bill {
@@ -10,4 +13,12 @@ struct TUser {
     std::string password;
 };
 
-}
\ No newline at end of file
+// Public part of a user, without credentials
+struct TUserInfo {
+    int id;
+    std::string username;
+    std::optional<std::string> full_name;
+    std::optional<std::string> photo_url;
+};
+
+}
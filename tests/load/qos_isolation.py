@@ -0,0 +1,138 @@
+"""Checks that heavy endpoints can't degrade interactive latency.
+
+Measures GET /v1/rooms/{id} latency alone, then again while many clients
+hammer the heavy list endpoints, and fails if p99 grew by more than
+--max-p99-ratio. Run against a started service:
+
+    python3 tests/load/qos_isolation.py --url http://localhost:8080
+"""
+
+import argparse
+import asyncio
+import statistics
+import sys
+import time
+import uuid
+
+import aiohttp
+
+HEAVY_PATHS = ['/v1/rooms/', '/v1/products', '/v1/user-products']
+
+
+async def request(session, method, url, **kwargs):
+    # Waits out 429 instead of counting it, admission control is expected
+    # to shed part of the heavy load
+    while True:
+        async with session.request(method, url, **kwargs) as response:
+            if response.status != 429:
+                return response.status, await response.json()
+            await asyncio.sleep(int(response.headers.get('Retry-After', 1)))
+
+
+async def login(session, url):
+    credentials = {
+        'username': f'load_{uuid.uuid4().hex[:12]}',
+        'password': 'load_password',
+    }
+    status, _ = await request(
+        session, 'POST', f'{url}/register', json=credentials)
+    assert status == 200, status
+    status, body = await request(
+        session, 'POST', f'{url}/login', json=credentials)
+    assert status == 200, status
+    return {'X-Ya-User-Ticket': str(body['id'])}
+
+
+async def create_room(session, url, headers, products):
+    status, room = await request(
+        session, 'POST', f'{url}/v1/rooms', headers=headers,
+        json={'name': 'load_room'})
+    assert status == 200, status
+    for i in range(products):
+        status, _ = await request(
+            session, 'POST', f'{url}/v1/products', headers=headers,
+            json={'name': f'product_{i}', 'price': 100 + i,
+                  'room_id': room['id']})
+        assert status == 200, status
+    return room['id']
+
+
+async def measure_interactive(session, url, headers, room_id, duration):
+    latencies = []
+    deadline = time.monotonic() + duration
+    while time.monotonic() < deadline:
+        start = time.monotonic()
+        async with session.get(
+                f'{url}/v1/rooms/{room_id}', headers=headers) as response:
+            await response.read()
+            if response.status == 200:
+                latencies.append(time.monotonic() - start)
+    return latencies
+
+
+async def heavy_client(session, url, headers, stop):
+    i = 0
+    while not stop.is_set():
+        path = HEAVY_PATHS[i % len(HEAVY_PATHS)]
+        async with session.get(
+                f'{url}{path}?limit=100', headers=headers) as response:
+            await response.read()
+            if response.status == 429:
+                await asyncio.sleep(
+                    int(response.headers.get('Retry-After', 1)))
+        i += 1
+
+
+def p99(latencies):
+    return statistics.quantiles(latencies, n=100)[98]
+
+
+def report(name, latencies):
+    print(f'{name}: {len(latencies)} requests, '
+          f'p50 {statistics.median(latencies) * 1000:.1f}ms, '
+          f'p99 {p99(latencies) * 1000:.1f}ms')
+
+
+async def main(args):
+    connector = aiohttp.TCPConnector(limit=0)
+    async with aiohttp.ClientSession(connector=connector) as session:
+        headers = await login(session, args.url)
+        room_id = await create_room(session, args.url, headers, args.products)
+
+        heavy_headers = []
+        for _ in range(args.heavy_clients):
+            heavy_headers.append(await login(session, args.url))
+            await create_room(session, args.url, heavy_headers[-1],
+                              args.products)
+
+        baseline = await measure_interactive(
+            session, args.url, headers, room_id, args.duration)
+        report('interactive alone', baseline)
+
+        stop = asyncio.Event()
+        heavy = [
+            asyncio.create_task(
+                heavy_client(session, args.url, client_headers, stop))
+            for client_headers in heavy_headers
+        ]
+        loaded = await measure_interactive(
+            session, args.url, headers, room_id, args.duration)
+        stop.set()
+        await asyncio.gather(*heavy)
+        report('interactive under heavy load', loaded)
+
+    ratio = p99(loaded) / p99(baseline)
+    print(f'p99 ratio: {ratio:.2f} (max {args.max_p99_ratio})')
+    return 0 if ratio <= args.max_p99_ratio else 1
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--url', default='http://localhost:8080')
+    parser.add_argument('--duration', type=float, default=20,
+                        help='seconds per phase')
+    parser.add_argument('--heavy-clients', type=int, default=50)
+    parser.add_argument('--products', type=int, default=20,
+                        help='products per created room')
+    parser.add_argument('--max-p99-ratio', type=float, default=2.0)
+    sys.exit(asyncio.run(main(parser.parse_args())))
@@ -0,0 +1,91 @@
+import pytest
+
+
+@pytest.fixture
+async def auth_headers(service_client):
+    data = {
+        "username": "test_user",
+        "password": "test_password"
+    }
+    response = await service_client.post('/register', json=data)
+    assert response.status == 200
+
+    response = await service_client.post('/login', json=data)
+    assert response.status == 200
+    return {"X-Ya-User-Ticket": f"{response.json()['id']}"}
+
+
+async def create_room(service_client, headers, status):
+    response = await service_client.post(
+        '/v1/rooms', headers=headers, json={"name": "test_room"})
+    assert response.status == 200
+    response = await service_client.post(
+        '/v1/products', headers=headers,
+        json={"name": "test_product", "price": 12000, "room_id": 1})
+    assert response.status == 200
+    response = await service_client.post(
+        '/v1/user-products', headers=headers,
+        json={"product_id": 1, "user_id": 1, "status": status})
+    assert response.status == 200
+
+
+async def get_room_responses(service_client, headers):
+    responses = []
+    for path in ['/v1/rooms/1', '/v1/rooms/1/calculate']:
+        response = await service_client.get(path, headers=headers)
+        assert response.status == 200
+        responses.append(response.json())
+    return responses
+
+
+def room_rows(pgsql):
+    cursor = pgsql['db_1'].cursor()
+    cursor.execute(
+        'SELECT r.archived, '
+        '(SELECT count(*) FROM products p WHERE p.room_id = r.id) '
+        'FROM rooms r WHERE r.id = 1')
+    return cursor.fetchone()
+
+
+@pytest.mark.asyncio
+async def test_settled_room_is_archived(service_client, auth_headers, pgsql):
+    await create_room(service_client, auth_headers, 'PAID')
+    before = await get_room_responses(service_client, auth_headers)
+    assert before[0]["room_status"] == "ARCHIVED"
+
+    await service_client.run_periodic_task('room-archiver')
+    assert room_rows(pgsql) == (True, 0)
+
+    after = await get_room_responses(service_client, auth_headers)
+    assert after == before
+    response = await service_client.get(
+        '/v1/products/1', headers=auth_headers)
+    assert response.status == 200
+    assert response.json()["name"] == "test_product"
+
+
+@pytest.mark.asyncio
+async def test_active_room_is_not_archived(
+        service_client, auth_headers, pgsql):
+    await create_room(service_client, auth_headers, 'UNPAID')
+
+    await service_client.run_periodic_task('room-archiver')
+    assert room_rows(pgsql) == (False, 1)
+
+
+@pytest.mark.asyncio
+async def test_edited_room_is_unarchived(
+        service_client, auth_headers, pgsql):
+    await create_room(service_client, auth_headers, 'PAID')
+    await service_client.run_periodic_task('room-archiver')
+    assert room_rows(pgsql) == (True, 0)
+
+    response = await service_client.put(
+        '/v1/user-products/1', headers=auth_headers,
+        json={"status": "UNPAID"})
+    assert response.status == 200
+    assert room_rows(pgsql) == (False, 1)
+
+    response = await service_client.get('/v1/rooms/1', headers=auth_headers)
+    assert response.status == 200
+    assert response.json()["room_status"] == "ACTIVE"
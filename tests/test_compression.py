@@ -0,0 +1,82 @@
+import pytest
+
+
+@pytest.fixture
+async def auth_headers(service_client):
+    data = {
+        "username": "test_user",
+        "password": "test_password"
+    }
+    response = await service_client.post('/register', json=data)
+    assert response.status == 200
+
+    response = await service_client.post('/login', json=data)
+    assert response.status == 200
+    headers = {"X-Ya-User-Ticket": f"{response.json()['id']}"}
+
+    response = await service_client.post(
+        '/v1/rooms', headers=headers, json={"name": "test_room"})
+    assert response.status == 200
+    for product_id in range(1, 6):
+        response = await service_client.post(
+            '/v1/products', headers=headers,
+            json={"name": f"product_{product_id}", "price": 1000,
+                  "room_id": 1})
+        assert response.status == 200
+        response = await service_client.post(
+            '/v1/user-products', headers=headers,
+            json={"product_id": product_id, "user_id": 1, "status": "PAID"})
+        assert response.status == 200
+    return headers
+
+
+async def get_room(service_client, headers, accept_encoding):
+    response = await service_client.get(
+        '/v1/rooms/1',
+        headers={**headers, 'Accept-Encoding': accept_encoding})
+    assert response.status == 200
+    return response.headers.get('Content-Encoding'), response.json()
+
+
+@pytest.mark.asyncio
+async def test_response_is_compressed(service_client, auth_headers):
+    encoding, plain = await get_room(
+        service_client, auth_headers, 'identity')
+    assert encoding is None
+
+    encoding, compressed = await get_room(
+        service_client, auth_headers, 'br, gzip;q=0.5')
+    assert encoding == 'gzip'
+    assert compressed == plain
+
+    encoding, _ = await get_room(service_client, auth_headers, 'gzip;q=0')
+    assert encoding is None
+
+
+@pytest.mark.asyncio
+async def test_small_response_is_not_compressed(
+        service_client, auth_headers):
+    response = await service_client.get(
+        '/v1/rooms/1/users',
+        headers={**auth_headers, 'Accept-Encoding': 'gzip'})
+    assert response.status == 200
+    assert 'Content-Encoding' not in response.headers
+    # Larger bodies are compressed, so caches must tell clients apart
+    assert 'Accept-Encoding' in response.headers['Vary']
+
+
+@pytest.mark.asyncio
+async def test_archived_room_is_sent_as_stored(
+        service_client, auth_headers):
+    _, before = await get_room(service_client, auth_headers, 'identity')
+    await service_client.run_periodic_task('room-archiver')
+
+    encoding, compressed = await get_room(
+        service_client, auth_headers, 'gzip')
+    assert encoding == 'gzip'
+    assert compressed == before
+
+    encoding, plain = await get_room(
+        service_client, auth_headers, 'identity')
+    assert encoding is None
+    assert plain == before
@@ -0,0 +1,78 @@
+import pytest
+
+
+@pytest.fixture
+async def auth_headers(service_client):
+    data = {
+        "username": "test_user",
+        "password": "test_password"
+    }
+    response = await service_client.post('/register', json=data)
+    assert response.status == 200
+
+    response = await service_client.post('/login', json=data)
+    assert response.status == 200
+    return {"X-Ya-User-Ticket": f"{response.json()['id']}"}
+
+
+def count_rows(pgsql, table):
+    cursor = pgsql['db_1'].cursor()
+    cursor.execute(f'SELECT count(*) FROM {table}')
+    return cursor.fetchone()[0]
+
+
+@pytest.mark.asyncio
+async def test_retry_is_replayed(service_client, auth_headers, pgsql):
+    headers = {**auth_headers, "Idempotency-Key": "create-room-retry"}
+    first = await service_client.post(
+        '/v1/rooms', headers=headers, json={"name": "test_room"})
+    assert first.status == 200
+    assert 'Idempotent-Replayed' not in first.headers
+
+    retry = await service_client.post(
+        '/v1/rooms', headers=headers, json={"name": "test_room"})
+    assert retry.status == 200
+    assert retry.headers['Idempotent-Replayed'] == 'true'
+    assert retry.json() == first.json()
+    assert count_rows(pgsql, 'rooms') == 1
+
+    response = await service_client.post(
+        '/v1/rooms', headers=headers, json={"name": "other_room"})
+    assert response.status == 422
+
+
+@pytest.mark.asyncio
+async def test_retry_does_not_conflict(service_client, auth_headers, pgsql):
+    response = await service_client.post(
+        '/v1/rooms', headers=auth_headers, json={"name": "test_room"})
+    assert response.status == 200
+
+    headers = {**auth_headers, "Idempotency-Key": "add-product-retry"}
+    data = {"name": "test_product", "price": 100, "room_id": 1}
+    for _ in range(2):
+        response = await service_client.post(
+            '/v1/products', headers=headers, json=data)
+        assert response.status == 200
+        assert response.json()["name"] == "test_product"
+    assert count_rows(pgsql, 'products') == 1
+
+    # Without a key the duplicate is still a conflict
+    response = await service_client.post(
+        '/v1/products', headers=auth_headers, json=data)
+    assert response.status == 409
+
+
+@pytest.mark.asyncio
+async def test_expired_keys_are_deleted(
+        service_client, auth_headers, pgsql):
+    headers = {**auth_headers, "Idempotency-Key": "expired-key"}
+    response = await service_client.post(
+        '/v1/rooms', headers=headers, json={"name": "test_room"})
+    assert response.status == 200
+    assert count_rows(pgsql, 'idempotency_keys') == 1
+
+    cursor = pgsql['db_1'].cursor()
+    cursor.execute(
+        "UPDATE idempotency_keys SET created_at = now() - interval '2 days'")
+    await service_client.run_periodic_task('idempotency-keys-cleanup')
+    assert count_rows(pgsql, 'idempotency_keys') == 0
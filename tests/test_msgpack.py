@@ -0,0 +1,142 @@
+import struct
+
+import pytest
+
+
+def unpack(data, pos=0):
+    """Decodes the MessagePack value at `pos`, returns it and its end."""
+    tag = data[pos]
+    pos += 1
+    if tag < 0x80:
+        return tag, pos
+    if tag >= 0xe0:
+        return tag - 0x100, pos
+    if 0x80 <= tag <= 0x8f or tag in (0xde, 0xdf):
+        size, pos = read_size(data, pos, tag, 0x80, 0xde)
+        result = {}
+        for _ in range(size):
+            key, pos = unpack(data, pos)
+            result[key], pos = unpack(data, pos)
+        return result, pos
+    if 0x90 <= tag <= 0x9f or tag in (0xdc, 0xdd):
+        size, pos = read_size(data, pos, tag, 0x90, 0xdc)
+        result = []
+        for _ in range(size):
+            item, pos = unpack(data, pos)
+            result.append(item)
+        return result, pos
+    if 0xa0 <= tag <= 0xbf or tag in (0xd9, 0xda, 0xdb):
+        if tag <= 0xbf:
+            size = tag & 0x1f
+        else:
+            width = {0xd9: 1, 0xda: 2, 0xdb: 4}[tag]
+            size = int.from_bytes(data[pos:pos + width], 'big')
+            pos += width
+        return data[pos:pos + size].decode(), pos + size
+    if tag in (0xc0, 0xc2, 0xc3):
+        return {0xc0: None, 0xc2: False, 0xc3: True}[tag], pos
+    if tag == 0xcb:
+        return struct.unpack('>d', data[pos:pos + 8])[0], pos + 8
+    formats = {0xcc: '>B', 0xcd: '>H', 0xce: '>I', 0xcf: '>Q',
+               0xd0: '>b', 0xd1: '>h', 0xd2: '>i', 0xd3: '>q'}
+    width = struct.calcsize(formats[tag])
+    return struct.unpack(formats[tag], data[pos:pos + width])[0], pos + width
+
+
+def read_size(data, pos, tag, fix_base, wide_tag):
+    if tag < 0xc0:
+        return tag - fix_base, pos
+    width = 2 if tag == wide_tag else 4
+    return int.from_bytes(data[pos:pos + width], 'big'), pos + width
+
+
+@pytest.fixture
+async def auth_headers(service_client):
+    data = {
+        "username": "test_user",
+        "password": "test_password"
+    }
+    response = await service_client.post('/register', json=data)
+    assert response.status == 200
+
+    response = await service_client.post('/login', json=data)
+    assert response.status == 200
+    headers = {"X-Ya-User-Ticket": f"{response.json()['id']}"}
+
+    response = await service_client.post(
+        '/v1/rooms', headers=headers, json={"name": "test_room"})
+    assert response.status == 200
+    response = await service_client.post(
+        '/v1/products', headers=headers,
+        json={"name": "test_product", "price": 120000, "room_id": 1})
+    assert response.status == 200
+    response = await service_client.post(
+        '/v1/user-products', headers=headers,
+        json={"product_id": 1, "user_id": 1, "status": "PAID"})
+    assert response.status == 200
+    return headers
+
+
+async def get_both(service_client, headers, path):
+    response = await service_client.get(path, headers=headers)
+    assert response.status == 200
+    expected = response.json()
+
+    response = await service_client.get(
+        path, headers={**headers, 'Accept': 'application/msgpack',
+                       'Accept-Encoding': 'identity'})
+    assert response.status == 200
+    assert response.headers['Content-Type'].startswith('application/msgpack')
+    body = response.content
+    decoded, end = unpack(body)
+    assert end == len(body)
+    return expected, decoded
+
+
+@pytest.mark.asyncio
+@pytest.mark.parametrize('path', ['/v1/rooms/1', '/v1/rooms/1/calculate'])
+async def test_msgpack_matches_json(service_client, auth_headers, path):
+    expected, decoded = await get_both(service_client, auth_headers, path)
+    assert decoded == expected
+
+
+@pytest.mark.asyncio
+async def test_archived_room_msgpack(service_client, auth_headers):
+    before = await get_both(service_client, auth_headers, '/v1/rooms/1')
+    await service_client.run_periodic_task('room-archiver')
+    after = await get_both(service_client, auth_headers, '/v1/rooms/1')
+    assert after == before
+
+
+@pytest.mark.asyncio
+async def test_msgpack_refused(service_client, auth_headers):
+    response = await service_client.get(
+        '/v1/rooms/1',
+        headers={**auth_headers,
+                 'Accept': 'application/msgpack;q=0, application/json'})
+    assert response.status == 200
+    assert response.headers['Content-Type'].startswith('application/json')
+    assert response.json()["id"] == 1
+
+
+@pytest.mark.asyncio
+async def test_msgpack_has_own_etag(service_client, auth_headers):
+    response = await service_client.get('/v1/rooms/1', headers=auth_headers)
+    assert response.status == 200
+    assert 'Accept' in response.headers['Vary']
+    json_etag = response.headers['ETag']
+
+    response = await service_client.get(
+        '/v1/rooms/1',
+        headers={**auth_headers, 'Accept': 'application/msgpack'})
+    assert response.status == 200
+    vary = [name.strip() for name in response.headers['Vary'].split(',')]
+    assert 'Accept' in vary and 'Accept-Encoding' in vary
+    msgpack_etag = response.headers['ETag']
+    assert msgpack_etag != json_etag
+
+    # Either tag names the room version for edits
+    response = await service_client.put(
+        '/v1/rooms/1', headers={**auth_headers, 'If-Match': msgpack_etag},
+        json={"room": {"name": "renamed"}})
+    assert response.status == 200
@@ -1,3 +1,4 @@
+import re
 import pytest
 import aiohttp
 import logging
@@ -179,3 +180,78 @@ async def test_add_product_invalid_room(service_client, setup_room):
     assert response.status == 404
     response_data = response.json()
     assert response_data["error"] == "Room ID is Invalid!"
+
+
+@pytest.mark.parametrize('query', [
+    'SELECT id, name, price FROM products WHERE room_id = 1',
+    'SELECT id, user_id FROM user_products WHERE room_id = 1',
+    'SELECT id FROM products '
+    'WHERE room_id = (SELECT room_id FROM product_rooms WHERE id = 1) '
+    'AND id = 1',
+])
+async def test_room_queries_read_one_partition(pgsql, query):
+    cursor = pgsql['db_1'].cursor()
+    cursor.execute('EXPLAIN (ANALYZE, COSTS OFF) ' + query)
+    plan = '\n'.join(row[0] for row in cursor)
+    scanned = {match.group(1) for line in plan.splitlines()
+               if 'never executed' not in line
+               for match in [re.search(r' on ((user_)?products_p\d+)', line)]
+               if match}
+    assert len(scanned) == 1, plan
+
+@pytest.mark.asyncio
+async def test_delete_product_if_match(service_client, setup_product):
+    response = await service_client.get(
+        '/v1/rooms/1', headers=setup_product)
+    etag = response.headers['ETag']
+
+    response = await service_client.delete(
+        '/v1/products/1', headers={**setup_product, "If-Match": '"-1"'})
+    assert response.status == 412
+    response = await service_client.delete(
+        '/v1/products/1', headers={**setup_product, "If-Match": etag})
+    assert response.status == 200
+
+
+def count_rows(pgsql, query):
+    cursor = pgsql['db_1'].cursor()
+    cursor.execute(query)
+    return cursor.fetchone()[0]
+
+
+@pytest.mark.asyncio
+async def test_deleted_product_is_hidden_then_purged(
+        service_client, create_user_product_headers, pgsql):
+    headers = create_user_product_headers
+    response = await service_client.delete('/v1/products/1', headers=headers)
+    assert response.status == 200
+
+    response = await service_client.get('/v1/products/1', headers=headers)
+    assert response.status == 404
+    response = await service_client.delete('/v1/products/1', headers=headers)
+    assert response.status == 404
+    response = await service_client.get('/v1/rooms/1', headers=headers)
+    assert response.status == 200
+    assert response.json()["room_products"] == []
+    response = await service_client.get(
+        '/v1/user-products/1', headers=headers)
+    assert response.status == 404
+
+    # The name is free again before the purge
+    response = await service_client.post(
+        '/v1/products', headers=headers,
+        json={"name": "test_product", "price": 100, "room_id": 1})
+    assert response.status == 200
+
+    assert count_rows(
+        pgsql, 'SELECT count(*) FROM products '
+        'WHERE deleted_at IS NOT NULL') == 1
+    await service_client.run_periodic_task('product-reaper')
+    assert count_rows(
+        pgsql, 'SELECT count(*) FROM products '
+        'WHERE deleted_at IS NOT NULL') == 0
+    assert count_rows(pgsql, 'SELECT count(*) FROM user_products') == 0
+    assert count_rows(
+        pgsql, 'SELECT count(*) FROM user_product_rooms') == 0
+    assert count_rows(
+        pgsql, 'SELECT count(*) FROM product_rooms WHERE id = 1') == 0
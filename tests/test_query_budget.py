@@ -0,0 +1,80 @@
+import pytest
+
+# Most queries a cold read of a room may take, whatever its size: session,
+# room probe, members, products and user products read concurrently, the
+# version recheck and user details
+ROOM_READ_BUDGET = 7
+
+BUDGETS = {
+    '/v1/rooms/1': ROOM_READ_BUDGET,
+    '/v1/rooms/1/calculate': ROOM_READ_BUDGET,
+    '/v1/rooms/1/summary': ROOM_READ_BUDGET,
+    '/v1/rooms/1/users': 3,
+}
+
+
+@pytest.fixture
+async def auth_headers(service_client):
+    data = {
+        "username": "test_user",
+        "password": "test_password"
+    }
+    response = await service_client.post('/register', json=data)
+    assert response.status == 200
+
+    response = await service_client.post('/login', json=data)
+    assert response.status == 200
+    headers = {"X-Ya-User-Ticket": f"{response.json()['id']}"}
+
+    response = await service_client.post(
+        '/v1/rooms', headers=headers, json={"name": "test_room"})
+    assert response.status == 200
+    return headers
+
+
+async def add_products(service_client, headers, first_id, count):
+    for product_id in range(first_id, first_id + count):
+        response = await service_client.post(
+            '/v1/products', headers=headers,
+            json={"name": f"product_{product_id}", "price": 1000,
+                  "room_id": 1})
+        assert response.status == 200
+        response = await service_client.post(
+            '/v1/user-products', headers=headers,
+            json={"product_id": product_id, "user_id": 1,
+                  "status": "UNPAID"})
+        assert response.status == 200
+
+
+async def query_stats(service_client, headers, path):
+    response = await service_client.get(path, headers=headers)
+    assert response.status == 200
+    assert int(response.headers['X-Db-Time-Us']) >= 0
+    return (int(response.headers['X-Db-Queries']),
+            int(response.headers['X-Db-Rows']))
+
+
+@pytest.mark.asyncio
+@pytest.mark.parametrize('path', list(BUDGETS))
+async def test_room_reads_within_budget(service_client, auth_headers, path):
+    await add_products(service_client, auth_headers, 1, 1)
+    small_queries, small_rows = await query_stats(
+        service_client, auth_headers, path)
+
+    await add_products(service_client, auth_headers, 2, 20)
+    large_queries, large_rows = await query_stats(
+        service_client, auth_headers, path)
+
+    assert large_rows >= small_rows
+    assert small_queries == large_queries
+    assert large_queries <= BUDGETS[path]
+
+
+@pytest.mark.asyncio
+async def test_cached_room_read(service_client, auth_headers):
+    await add_products(service_client, auth_headers, 1, 5)
+    await query_stats(service_client, auth_headers, '/v1/rooms/1')
+
+    # Session and version probe only
+    queries, _ = await query_stats(service_client, auth_headers, '/v1/rooms/1')
+    assert queries == 2
@@ -0,0 +1,98 @@
+import pytest
+
+
+@pytest.fixture
+async def auth_headers(service_client):
+    data = {
+        "username": "test_user",
+        "password": "test_password"
+    }
+    response = await service_client.post('/register', json=data)
+    assert response.status == 200
+
+    response = await service_client.post('/login', json=data)
+    assert response.status == 200
+    headers = {"X-Ya-User-Ticket": f"{response.json()['id']}"}
+
+    response = await service_client.post(
+        '/v1/rooms', headers=headers, json={"name": "test_room"})
+    assert response.status == 200
+    return headers
+
+
+async def import_receipt(service_client, headers, content_type, body):
+    response = await service_client.post(
+        '/v1/rooms/1/receipt',
+        headers={**headers, 'Content-Type': content_type}, data=body)
+    assert response.status == 200
+    return response.json()
+
+
+def statuses(result):
+    return [(line["line"], line["status"]) for line in result["lines"]]
+
+
+@pytest.mark.asyncio
+async def test_import_csv_receipt(service_client, auth_headers):
+    body = (
+        'name,price,user_ids\n'
+        'Milk,120,1\n'
+        '"Bread, white",80\n'
+        'Milk,130\n'
+        'Eggs,abc\n'
+        'Tea,50,2\n'
+    )
+    result = await import_receipt(
+        service_client, auth_headers, 'text/csv', body)
+    assert statuses(result) == [
+        (2, "CREATED"), (3, "CREATED"), (4, "DUPLICATE"),
+        (5, "INVALID"), (6, "INVALID")]
+    assert result["created"] == 2
+    assert result["lines"][4]["error"] == "User 2 is not a room member"
+
+    response = await service_client.get(
+        '/v1/rooms/1', headers=auth_headers)
+    assert response.status == 200
+    products = response.json()["room_products"]
+    assert sorted(product["name"] for product in products) == [
+        "Bread, white", "Milk"]
+
+
+@pytest.mark.asyncio
+async def test_import_ndjson_receipt(service_client, auth_headers):
+    response = await service_client.post(
+        '/v1/products', headers=auth_headers,
+        json={"name": "Milk", "price": 120, "room_id": 1})
+    assert response.status == 200
+
+    body = (
+        '{"name": "Milk", "price": 120}\n'
+        '{"name": "Cheese", "price": 300, "user_ids": [1]}\n'
+        '\n'
+        'not json\n'
+    )
+    result = await import_receipt(
+        service_client, auth_headers, 'application/x-ndjson', body)
+    assert statuses(result) == [
+        (1, "DUPLICATE"), (2, "CREATED"), (4, "INVALID")]
+
+    product_id = result["lines"][1]["product_id"]
+    response = await service_client.get(
+        f'/v1/products/{product_id}', headers=auth_headers)
+    assert response.status == 200
+    assert response.json()["name"] == "Cheese"
+
+
+@pytest.mark.asyncio
+async def test_import_receipt_rejected(service_client, auth_headers):
+    response = await service_client.post(
+        '/v1/rooms/1/receipt',
+        headers={**auth_headers, 'Content-Type': 'application/json'},
+        data='[]')
+    assert response.status == 415
+
+    response = await service_client.post(
+        '/v1/rooms/2/receipt',
+        headers={**auth_headers, 'Content-Type': 'text/csv'},
+        data='Milk,120\n')
+    assert response.status == 404
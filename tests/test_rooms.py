@@ -64,6 +64,33 @@ async def test_join_room(service_client, setup_room):
 async def test_get_all_rooms(service_client, setup_room):
     response = await service_client.get('/v1/rooms/', headers=setup_room)
     assert response.status == 200
+
+
+@pytest.mark.asyncio
+async def test_get_all_rooms_page_out_of_reach(service_client, setup_room):
+    response = await service_client.get(
+        '/v1/rooms/', headers=setup_room,
+        params={'page': 10002, 'limit': 1})
+    assert response.status == 400
+    response = await service_client.get(
+        '/v1/rooms/', headers=setup_room,
+        params={'page': 10001, 'limit': 1})
+    assert response.status == 200
+
+
+@pytest.mark.asyncio
+async def test_get_created_rooms_by_name(service_client, auth_headers):
+    for name in ['b', 'B', 'a']:
+        response = await service_client.post(
+            '/v1/rooms', headers=auth_headers, json={"name": name})
+        assert response.status == 200
+    # Byte order on every shard count, as shard pages are merged
+    response = await service_client.get(
+        '/v1/rooms/created/', headers=auth_headers,
+        params={'order_by': 'name'})
+    assert response.status == 200
+    names = [room["name"] for room in response.json()["items"]]
+    assert names == ['B', 'a', 'b']
 #
 # @pytest.mark.asyncio
 # async def test_get_room_users(service_client, auth_headers, setup_room):
@@ -95,3 +122,199 @@ async def test_update_room_nonexistent(service_client, setup_room):
 # async def test_get_room_users_unauthorized(service_client, setup_room):
 #     response = await service_client.get(f"/v1/rooms/{setup_room['id']}/users", headers={})
 #     assert response.status == 403  # Unauthorized
+
+
+@pytest.mark.asyncio
+async def test_get_room_summary(service_client, setup_room):
+    response = await service_client.get('/v1/rooms/1/summary', headers=setup_room)
+    assert response.status == 200
+    summary = response.json()
+    assert summary["name"] == "test_room"
+    assert summary["total_price"] == 0
+    assert summary["shares"] == []
+
+
+@pytest.mark.asyncio
+async def test_get_room_summary_after_update(service_client, setup_room):
+    response = await service_client.get('/v1/rooms/1/summary', headers=setup_room)
+    assert response.status == 200
+    version = response.json()["version"]
+
+    data = {"name": "renamed_room"}
+    response = await service_client.put('/v1/rooms/1', headers=setup_room, json=data)
+    assert response.status == 200
+
+    response = await service_client.get('/v1/rooms/1/summary', headers=setup_room)
+    assert response.status == 200
+    assert response.json()["name"] == "renamed_room"
+    assert response.json()["version"] > version
+
+
+@pytest.mark.asyncio
+async def test_get_room_summary_nonexistent(service_client, setup_room):
+    response = await service_client.get('/v1/rooms/9999/summary', headers=setup_room)
+    assert response.status == 404
+
+
+@pytest.mark.asyncio
+@pytest.mark.parametrize('ticket', ['abc', '1x', '99999999999999'])
+async def test_malformed_ticket(service_client, setup_room, ticket):
+    response = await service_client.get(
+        '/v1/rooms/1', headers={"X-Ya-User-Ticket": ticket})
+    assert response.status == 401
+    assert response.json() == {"error": "Unauthorized"}
+
+
+@pytest.mark.asyncio
+@pytest.mark.parametrize('room_id', ['abc', '1x', '99999999999999'])
+async def test_malformed_room_id(service_client, setup_room, room_id):
+    for path in [f'/v1/rooms/{room_id}', f'/v1/rooms/{room_id}/summary']:
+        response = await service_client.get(path, headers=setup_room)
+        assert response.status == 400
+        assert response.json() == {"error": "Invalid room ID"}
+
+
+@pytest.mark.asyncio
+async def test_update_room_adds_users_per_product(
+        service_client, setup_room, pgsql):
+    data = {"product": {"add": [
+        {"name": "first", "price": 100},
+        {"name": "second", "price": 200, "add_users": [1]},
+    ]}}
+    response = await service_client.put(
+        '/v1/rooms/1', headers=setup_room, json=data)
+    assert response.status == 200
+
+    cursor = pgsql['db_1'].cursor()
+    cursor.execute(
+        'SELECT p.name, up.user_id FROM user_products up '
+        'JOIN products p ON p.id = up.product_id')
+    assert cursor.fetchall() == [('second', 1)]
+
+
+@pytest.mark.asyncio
+@pytest.mark.parametrize('data, error', [
+    ({"product": {"add": [{"name": "p", "price": "x"}]}},
+     'product.add[0].price: expected an integer'),
+    ({"product": {"add": [{"price": 1}]}},
+     'product.add[0].name: required field is missing'),
+    ({"room": {"name": 5}}, 'room.name: expected a string'),
+])
+async def test_update_room_invalid_body(
+        service_client, setup_room, data, error):
+    response = await service_client.put(
+        '/v1/rooms/1', headers=setup_room, json=data)
+    assert response.status == 400
+    assert response.json()["error"].startswith(error)
+
+
+@pytest.mark.asyncio
+async def test_update_room_body_too_large(service_client, setup_room):
+    data = {"room": {"name": "x" * (1 << 20)}}
+    response = await service_client.put(
+        '/v1/rooms/1', headers=setup_room, json=data)
+    assert response.status == 413
+
+
+@pytest.mark.asyncio
+async def test_update_room_if_match(service_client, setup_room):
+    response = await service_client.get('/v1/rooms/1', headers=setup_room)
+    assert response.status == 200
+    etag = response.headers['ETag']
+
+    data = {"room": {"name": "renamed"}}
+    headers = {**setup_room, "If-Match": etag}
+    response = await service_client.put(
+        '/v1/rooms/1', headers=headers, json=data)
+    assert response.status == 200
+
+    # The other editor still holds the old ETag
+    response = await service_client.put(
+        '/v1/rooms/1', headers=headers, json={"room": {"name": "other"}})
+    assert response.status == 412
+
+    response = await service_client.get('/v1/rooms/1', headers=setup_room)
+    assert response.json()["name"] == "renamed"
+    assert response.headers['ETag'] != etag
+
+
+@pytest.mark.asyncio
+@pytest.mark.parametrize('if_match', ['"-1"', 'W/"1"', 'garbage'])
+async def test_update_room_if_match_mismatch(
+        service_client, setup_room, if_match):
+    headers = {**setup_room, "If-Match": if_match}
+    response = await service_client.put(
+        '/v1/rooms/1', headers=headers, json={"room": {"name": "x"}})
+    assert response.status == 412
+
+
+@pytest.mark.asyncio
+async def test_get_room_sections(service_client, setup_room):
+    data = {"product": {"add": [
+        {"name": f"product_{i}", "price": 100,
+         "add_users": [1] if i % 2 else []}
+        for i in range(5)
+    ]}}
+    response = await service_client.put(
+        '/v1/rooms/1', headers=setup_room, json=data)
+    assert response.status == 200
+
+    response = await service_client.get(
+        '/v1/rooms/1', headers=setup_room, params={"section": "header"})
+    assert response.status == 200
+    header = response.json()
+    assert header["total_price"] == 500
+    assert header["product_count"] == 5
+    assert header["member_ids"] == [1]
+    assert "room_products" not in header
+
+    ids = []
+    params = {"section": "products", "limit": 2}
+    while True:
+        response = await service_client.get(
+            '/v1/rooms/1', headers=setup_room, params=params)
+        assert response.status == 200
+        page = response.json()
+        ids += [product["id"] for product in page["room_products"]]
+        if "next_cursor" not in page:
+            break
+        params["cursor"] = page["next_cursor"]
+    assert ids == [1, 2, 3, 4, 5]
+
+    for section_filter in ["mine", "unpaid"]:
+        response = await service_client.get(
+            '/v1/rooms/1', headers=setup_room,
+            params={"section": "products", "filter": section_filter})
+        assert response.status == 200
+        products = response.json()["room_products"]
+        assert [product["id"] for product in products] == [2, 4]
+
+
+@pytest.mark.asyncio
+@pytest.mark.parametrize('params', [
+    {"section": "footer"},
+    {"section": "products", "filter": "paid"},
+    {"section": "products", "cursor": "x"},
+    {"section": "products", "limit": "-"},
+])
+async def test_get_room_invalid_section(service_client, setup_room, params):
+    response = await service_client.get(
+        '/v1/rooms/1', headers=setup_room, params=params)
+    assert response.status == 400
+
+
+@pytest.mark.asyncio
+async def test_get_room_server_timing(service_client, setup_room):
+    response = await service_client.get('/v1/rooms/1', headers=setup_room)
+    assert response.status == 200
+    assert 'Server-Timing' not in response.headers
+
+    response = await service_client.get(
+        '/v1/rooms/1', headers={**setup_room, "X-Server-Timing": "1"})
+    assert response.status == 200
+    phases = {
+        metric.split(';')[0]: metric
+        for metric in response.headers['Server-Timing'].split(', ')}
+    for phase in ["admission", "auth", "db", "assemble", "serialize",
+                  "total"]:
+        assert phases[phase].startswith(phase + ';dur=')
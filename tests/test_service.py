@@ -0,0 +1,35 @@
+async def test_introspection(monitor_client):
+    response = await monitor_client.get('/service/introspection')
+    assert response.status == 200
+    body = response.json()
+    assert body['allocator']['allocator'] in ('jemalloc', 'glibc')
+    assert set(body['caches']) == {
+        'room-snapshots', 'archived-rooms', 'user-search', 'idempotency'}
+    for cache in body['caches'].values():
+        assert cache['entries'] >= 0
+        assert cache['bytes'] >= 0
+    assert body['engine']
+
+
+async def test_introspection_not_on_main_listener(service_client):
+    response = await service_client.get('/service/introspection')
+    assert response.status == 404
+
+
+async def test_cpu_profile(monitor_client):
+    response = await monitor_client.get(
+        '/service/cpu-profile', params={'seconds': 1, 'hz': 997})
+    assert response.status == 200
+    assert response.headers['Content-Type'].startswith('text/plain')
+    for line in response.text.splitlines():
+        stack, count = line.rsplit(' ', 1)
+        assert stack
+        assert int(count) > 0
+
+
+async def test_cpu_profile_bad_args(monitor_client):
+    for params in ({'seconds': 0}, {'seconds': 61}, {'hz': 'x'},
+                   {'hz': 1001}):
+        response = await monitor_client.get(
+            '/service/cpu-profile', params=params)
+        assert response.status == 400
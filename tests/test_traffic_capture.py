@@ -0,0 +1,66 @@
+import importlib.util
+import pathlib
+
+# traffic-capture-file of configs/config_vars.testing.yaml
+CAPTURE_FILE = '/tmp/split_bill_testing.traffic'
+
+
+def load_replayer():
+    path = pathlib.Path(__file__).parent / 'load' / 'replay_traffic.py'
+    spec = importlib.util.spec_from_file_location('replay_traffic', path)
+    module = importlib.util.module_from_spec(spec)
+    spec.loader.exec_module(module)
+    return module
+
+
+async def test_requests_captured(service_client):
+    credentials = {'username': 'capture_user', 'password': 'secret_pw'}
+    response = await service_client.post('/register', json=credentials)
+    assert response.status == 200
+    response = await service_client.post('/login', json=credentials)
+    assert response.status == 200
+    ticket = str(response.json()['id'])
+    response = await service_client.post(
+        '/v1/rooms', headers={'X-Ya-User-Ticket': ticket},
+        json={'name': 'captured_room'})
+    assert response.status == 200
+    room_id = response.json()['id']
+    response = await service_client.get(
+        f'/v1/rooms/{room_id}?section=header',
+        headers={'X-Ya-User-Ticket': ticket})
+    assert response.status == 200
+
+    await service_client.run_periodic_task('traffic-capture-flush')
+    _, records = load_replayer().read_log(CAPTURE_FILE)
+
+    logins = [record for record in records
+              if record.handler == 'handler-login-user'
+              and b'capture_user' in record.body]
+    assert logins
+    assert b'secret_pw' not in logins[-1].body
+    assert b'"replay"' in logins[-1].body
+
+    room_reads = [
+        record for record in records
+        if record.target == f'/v1/rooms/{room_id}?section=header']
+    assert len(room_reads) == 1
+    room_read = room_reads[0]
+    assert room_read.handler == 'handler-v1-get-rooms-by-id'
+    assert room_read.method == 'GET'
+    assert room_read.status == 200
+    assert room_read.user_id > 0
+    assert 'X-Ya-User-Ticket' not in room_read.headers
+    assert room_read.start_us >= logins[-1].start_us
+
+
+def test_failed_requests_match_any_error():
+    replayer = load_replayer()
+    failed = replayer.Record(
+        0, 0, 0, 1, 'handler', 'GET', '/', {}, replayer.FAILED, b'')
+    assert replayer.status_matches(failed, 500)
+    assert replayer.status_matches(failed, 404)
+    assert not replayer.status_matches(failed, 200)
+
+    served = failed._replace(status=200, flags=0)
+    assert replayer.status_matches(served, 200)
+    assert not replayer.status_matches(served, 500)
@@ -1,3 +1,4 @@
+import asyncio
 import pytest
 import aiohttp
 import logging
@@ -200,6 +201,21 @@ async def test_add_user_to_product_duplicate_entry(service_client, setup_product
     assert response.status == 409
     response_data = response.json()
     assert response_data["error"] == "User already associated with this product"
+
+
+@pytest.mark.asyncio
+async def test_add_user_to_product_concurrent_duplicates(
+        service_client, setup_product):
+    data = {"product_id": 1, "user_id": 1}
+    responses = await asyncio.gather(*[
+        service_client.post(
+            '/v1/user-products', headers=setup_product, json=data)
+        for _ in range(5)
+    ])
+    assert sorted(response.status for response in responses) == [
+        200, 409, 409, 409, 409]
+
+
 @pytest.mark.asyncio
 async def test_add_user_to_product_invalid_status(service_client, setup_product):
     data = {
@@ -0,0 +1,75 @@
+import pytest
+
+USERS = [
+    ("anna_smith", "Anna Smith"),
+    ("annabel", "Annabel Lee"),
+    ("bob_joanna", None),
+    ("carl", "Carl Johnson"),
+]
+
+
+async def register(service_client, username, full_name=None):
+    data = {"username": username, "password": "test_password"}
+    if full_name:
+        data["full_name"] = full_name
+    response = await service_client.post('/register', json=data)
+    assert response.status == 200
+    return await login(service_client, username)
+
+
+async def login(service_client, username):
+    data = {"username": username, "password": "test_password"}
+    response = await service_client.post('/login', json=data)
+    assert response.status == 200
+    return {"X-Ya-User-Ticket": f"{response.json()['id']}"}
+
+
+@pytest.fixture
+async def auth_headers(service_client):
+    headers = await register(service_client, "test_user")
+    for username, full_name in USERS:
+        await register(service_client, username, full_name)
+    await service_client.invalidate_caches()
+    return headers
+
+
+async def search(service_client, headers, query, **params):
+    response = await service_client.get(
+        '/v1/users/search', headers=headers, params={"q": query, **params})
+    assert response.status == 200
+    return [user["username"] for user in response.json()["users"]]
+
+
+@pytest.mark.asyncio
+async def test_search_users(service_client, auth_headers):
+    assert await search(service_client, auth_headers, "ANNA") == [
+        "anna_smith", "annabel", "bob_joanna"]
+    assert await search(service_client, auth_headers, "john") == ["carl"]
+    assert await search(service_client, auth_headers, "an", limit=1) == [
+        "anna_smith"]
+    assert await search(service_client, auth_headers, "nobody") == []
+
+
+@pytest.mark.asyncio
+async def test_room_members_come_first(service_client, auth_headers):
+    response = await service_client.post(
+        '/v1/rooms', headers=auth_headers, json={"name": "test_room"})
+    assert response.status == 200
+    bob_headers = await login(service_client, "bob_joanna")
+    response = await service_client.post(
+        '/v1/rooms/join/1', headers=bob_headers)
+    assert response.status == 200
+
+    assert await search(service_client, auth_headers, "anna") == [
+        "bob_joanna", "anna_smith", "annabel"]
+
+
+@pytest.mark.asyncio
+async def test_search_users_bad_query(service_client, auth_headers):
+    response = await service_client.get(
+        '/v1/users/search', headers=auth_headers, params={"q": ""})
+    assert response.status == 400
+
+    response = await service_client.get(
+        '/v1/users/search', params={"q": "anna"})
+    assert response.status == 401